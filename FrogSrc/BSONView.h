@@ -0,0 +1,651 @@
+#ifndef __FROG__BSONVIEW_H__
+#define __FROG__BSONVIEW_H__
+
+#include <string.h>
+#include "FrogMemory.h"
+#include "Debug.h"
+#include "Utility.h"
+#include "FrogString.h"
+#include "Table.h"
+#include "FlatHashMap.h"
+#include "FileManager.h"
+#include "FileManagerDatMapped.h"
+#include "BSONIterator.h"
+
+namespace Webfoot {
+
+class BSONDocumentView;
+
+//Number of lookups by key or index on the same collection after which
+//BSONDocumentView builds an index for it.
+#define BSON_VIEW_CACHE_LOOKUP_THRESHOLD 4
+//Collections with fewer elements than this are always searched linearly.
+#define BSON_VIEW_CACHE_SIZE_MIN 8
+//Number of counters BSONDocumentView uses to find hot collections.  This
+//must be a power of 2.
+#define BSON_VIEW_CACHE_COUNTER_COUNT 256
+
+//==============================================================================
+
+/// BSONView is a read-only position in a BSON buffer that decodes values only
+/// when they are accessed.  It has the same accessors as BSONIterator and the
+/// read-only parts of JSONValue, so specification-reading code can be written
+/// once for all three, but it makes no allocations of its own.  Views are
+/// obtained from a BSONDocumentView and are only valid while that document
+/// is.  Missing entries are returned as views for which NullCheck is true.
+///
+///  BSONDocumentView document;
+///  if(document.Load("Scenes/Level1", theFiles))
+///  {
+///     BSONView root = document.RootGet();
+///     const char* title = root.Get("Title");
+///     for(BSONView mesh = root.Get("Meshes").Begin(); mesh.WithinCheck(); mesh.Next())
+///        ...
+///     document.Deinit();
+///  }
+class BSONView
+{
+public:
+   BSONView()
+   {
+      document = NULL;
+      key = NULL;
+      value = NULL;
+      type = BSON_ELEMENT_TYPE_RAW_NULL;
+      index = 0;
+   }
+
+   /// Assuming this is an array or object, return a view of the first
+   /// element for iterating over the collection with Next and WithinCheck.
+   BSONView Begin();
+   /// Go to the next element in the collection.
+   void Next() { *this = ElementAt(ValueEndGet(), index + 1); }
+   /// Return true if the view is within the collection being iterated.
+   /// Return false if it is past the end.
+   bool WithinCheck() { return value != NULL; }
+   /// Return the key of the current element while iterating.  For arrays,
+   /// this is the index as a string.
+   const char* Key() { return key; }
+   /// Return the index of the current element while iterating.
+   int Index() { return index; }
+
+   /// If this is an array or object, return the number of elements in it.  If
+   /// it is binary data, return the size of the data in bytes.  Otherwise,
+   /// return 0.
+   int SizeGet();
+
+   /// Assuming this is an array, return the value at the given index.
+   BSONView Get(int _index);
+   /// Assuming this is an object, return the value with the given key.
+   BSONView Get(const char* _key);
+
+   /// Return an iterator at the same position for use with code that takes a
+   /// BSONIterator.  This is only valid for the root and for elements of
+   /// collections.
+   BSONIterator IteratorGet();
+
+   /// Convert the value to a bool.  Numbers are true if they're not zero.
+   /// Defaults to false.
+   operator bool() { return NumberCheck() ? (DoubleGet() != 0.0) : (BooleanCheck() && *value); }
+   /// Convert the value to an int.  Defaults to 0.
+   operator int() { return (int)Int64Get(); }
+   /// Convert the value to an unsigned int.  Defaults to 0.
+   operator unsigned int() { return (unsigned int)Int64Get(); }
+   /// Convert the value to an int64.  Defaults to 0.
+   operator int64() { return Int64Get(); }
+   /// Convert the value to a float.  Defaults to 0.0f.
+   operator float() { return (float)DoubleGet(); }
+   /// Convert the value to a double.  Defaults to 0.0.
+   operator double() { return DoubleGet(); }
+   /// Return a pointer to the string in the buffer.  Defaults to NULL.
+   operator const char*() { return StringCheck() ? (const char*)(value + sizeof(int32)) : NULL; }
+   /// Assuming this is binary data, return a pointer to it in the buffer.
+   /// Defaults to NULL.
+   operator const void*() { return BinaryCheck() ? (value + sizeof(int32) + 1) : NULL; }
+   /// Convert a "x|y" string to a Point2I.  Defaults to all zeros.
+   operator Point2I() { Point2I result = {0, 0}; Point2IExtract(*this, &result); return result; }
+   /// Convert a "x|y" string to a Point2F.  Defaults to all zeros.
+   operator Point2F() { Point2F result = {0.0f, 0.0f}; Point2FExtract(*this, &result); return result; }
+   /// Convert a "x|y|z" string to a Point3F.  Defaults to all zeros.
+   operator Point3F() { Point3F result = {0.0f, 0.0f, 0.0f}; Point3FExtract(*this, &result); return result; }
+   /// Convert a "x|y|width|height" string to a Box2F.  Defaults to all zeros.
+   operator Box2F() { Box2F result = {0.0f, 0.0f, 0.0f, 0.0f}; Box2FExtract(*this, &result); return result; }
+   /// Convert a string to a Box3F.  Defaults to all zeros.
+   operator Box3F() { Box3F result = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f}; Box3FExtract(*this, &result); return result; }
+   /// Convert a "red|green|blue|alpha" string to a ColorRGBA8.  Defaults to black.
+   operator ColorRGBA8() { ColorRGBA8 result = {0, 0, 0, 255}; ColorRGBA8Extract(*this, &result); return result; }
+   /// Convert a "red|green|blue|alpha" string to a ColorRGBA32F.  Defaults to black.
+   operator ColorRGBA32F() { ColorRGBA32F result = {0.0f, 0.0f, 0.0f, 1.0f}; ColorRGBA32FExtract(*this, &result); return result; }
+   /// Convert a "w|x|y|z" string to a Quaternion.  Defaults to identity.
+   operator Quaternion() { Quaternion result = Quaternion::Create(); QuaternionExtract(*this, &result); return result; }
+
+   /// Return true if this is not a defined value.
+   bool NullCheck() { return !value || (type == BSON_ELEMENT_TYPE_RAW_NULL); }
+   /// Assuming this is an array, return true if the value at the given index is not defined.
+   bool NullCheck(int _index) { return Get(_index).NullCheck(); }
+   /// Assuming this is an object, return true if the value at the given key is not defined.
+   bool NullCheck(const char* _key) { return Get(_key).NullCheck(); }
+
+   /// Return true if this represents a boolean.
+   bool BooleanCheck() { return value && (type == BSON_ELEMENT_TYPE_RAW_BOOLEAN); }
+   /// Return true if this represents a number of any type.
+   bool NumberCheck() { return value && ((type == BSON_ELEMENT_TYPE_RAW_DOUBLE) || (type == BSON_ELEMENT_TYPE_RAW_INT32) || (type == BSON_ELEMENT_TYPE_RAW_INT64)); }
+   /// Return true if this represents a double.
+   bool DoubleCheck() { return value && (type == BSON_ELEMENT_TYPE_RAW_DOUBLE); }
+   /// Return true if this represents an int32.
+   bool Int32Check() { return value && (type == BSON_ELEMENT_TYPE_RAW_INT32); }
+   /// Return true if this represents an int64.
+   bool Int64Check() { return value && (type == BSON_ELEMENT_TYPE_RAW_INT64); }
+   /// Return true if this represents a string.
+   bool StringCheck() { return value && (type == BSON_ELEMENT_TYPE_RAW_STRING); }
+   /// Return true if this represents a block of binary data.
+   bool BinaryCheck() { return value && (type == BSON_ELEMENT_TYPE_RAW_BINARY); }
+   /// Return true if this represents an array.
+   bool ArrayCheck() { return value && (type == BSON_ELEMENT_TYPE_RAW_ARRAY); }
+   /// Return true if this represents an object.
+   bool ObjectCheck() { return value && (type == BSON_ELEMENT_TYPE_RAW_OBJECT); }
+
+   /// Assuming this is an array, return true if the value at the given index is a number.
+   bool NumberCheck(int _index) { return Get(_index).NumberCheck(); }
+   /// Assuming this is an object, return true if the value at the given key is a number.
+   bool NumberCheck(const char* _key) { return Get(_key).NumberCheck(); }
+   /// Assuming this is an array, return true if the value at the given index is a string.
+   bool StringCheck(int _index) { return Get(_index).StringCheck(); }
+   /// Assuming this is an object, return true if the value at the given key is a string.
+   bool StringCheck(const char* _key) { return Get(_key).StringCheck(); }
+   /// Assuming this is an array, return true if the value at the given index is an array.
+   bool ArrayCheck(int _index) { return Get(_index).ArrayCheck(); }
+   /// Assuming this is an object, return true if the value at the given key is an array.
+   bool ArrayCheck(const char* _key) { return Get(_key).ArrayCheck(); }
+   /// Assuming this is an array, return true if the value at the given index is an object.
+   bool ObjectCheck(int _index) { return Get(_index).ObjectCheck(); }
+   /// Assuming this is an object, return true if the value at the given key is an object.
+   bool ObjectCheck(const char* _key) { return Get(_key).ObjectCheck(); }
+
+protected:
+   /// Return a view of the element that starts at the given address.  If it's
+   /// the end of the collection, return a view for which WithinCheck is false.
+   BSONView ElementAt(const uchar* element, int _index);
+   /// Return the address just past the value.
+   const uchar* ValueEndGet();
+   /// Return the value as a double, or 0.0 if it isn't a number.
+   double DoubleGet();
+   /// Return the value as an int64, or 0 if it isn't a number or boolean.
+   int64 Int64Get();
+   /// Read a little-endian int32 from the given address.
+   static int32 Int32Read(const uchar* address) { int32 result; memcpy(&result, address, sizeof(result)); return result; }
+
+   /// Document that contains the buffer.
+   BSONDocumentView* document;
+   /// Key of the element, or NULL for the root.
+   const char* key;
+   /// Address of the element's value in the buffer, or NULL if the view is
+   /// past the end of a collection or was returned for a missing entry.
+   const uchar* value;
+   /// BSON element type number of the value.
+   uchar type;
+   /// Position of the element in its collection.
+   int index;
+
+   friend class BSONDocumentView;
+};
+
+//==============================================================================
+
+/// BSONDocumentView provides BSONViews of a BSON buffer that is either
+/// supplied by the caller, loaded from a file, or, with a
+/// FileManagerDatMapped, viewed directly in the mapped resource file.
+///
+/// Arrays and objects that are searched by index or key more than
+/// BSON_VIEW_CACHE_LOOKUP_THRESHOLD times get an index of their elements, so
+/// repeated lookups in hot collections are binary searches rather than walks.
+/// Lookups are counted in a fixed set of counters shared by address, so
+/// collections that are only searched once or twice cost nothing.  Since
+/// collections can share a counter, one may be indexed after fewer lookups
+/// of its own, but a counter starts over each time a collection that uses it
+/// is indexed, so it never stays past the threshold.  Building the indices is
+/// the only allocation made after loading.  Since
+/// lookups can update the cache, only use a document from one thread at a
+/// time, or disable caching with CacheEnabledSet.
+class BSONDocumentView
+{
+public:
+   BSONDocumentView()
+   {
+      buffer = NULL;
+      bufferSize = 0;
+      fileManager = NULL;
+      heapID = HEAP_DEFAULT;
+      cacheEnabled = true;
+      cachedCollectionCount = 0;
+      memset(lookupCounts, 0, sizeof(lookupCounts));
+      collections.Init(AddressHash, AddressesEqualCheck, theAllocatorHeaps[heapID]);
+      cacheEntries.Init(theAllocatorHeaps[heapID]);
+   }
+
+   /// Prepare to view the given BSON buffer, which must outlive the document.
+   /// Use '_heapID' for the lookup cache.  Return true if the buffer appears
+   /// to be valid BSON.
+   bool Init(const void* _buffer, size_t _bufferSize, HeapID _heapID = HEAP_DEFAULT);
+   /// Load the given BSON file, excluding the extension, and view it.  Return
+   /// true if successful.
+   bool Load(const char* filename, FileManager* _fileManager = theFiles, HeapID _heapID = HEAP_DEFAULT);
+   /// Same as the other Load, except the file is viewed in place in the
+   /// resource file if possible rather than copied.
+   bool Load(const char* filename, FileManagerDatMapped* _fileManager, HeapID _heapID = HEAP_DEFAULT);
+   /// Clean up the document, and release the buffer if it was loaded.
+   void Deinit();
+
+   /// Return a view of the root object.
+   BSONView RootGet();
+
+   /// Set whether hot collections should be indexed.
+   void CacheEnabledSet(bool _cacheEnabled) { cacheEnabled = _cacheEnabled; }
+   /// Return the number of collections that have been indexed.
+   int CachedCollectionCountGet() { return cachedCollectionCount; }
+
+protected:
+   enum
+   {
+      /// Value of CollectionInfo::entryFirst for collections that are too
+      /// small to index.
+      COLLECTION_NOT_INDEXED = -2
+   };
+
+   /// Index position for a collection.
+   struct CollectionInfo
+   {
+      /// Position of the collection's elements in 'cacheEntries', or
+      /// COLLECTION_NOT_INDEXED if it's too small to be worth indexing.
+      int entryFirst;
+      /// Number of elements in the index.
+      int entryCount;
+   };
+
+   /// Element of an indexed collection.  Array elements are kept in order,
+   /// and object elements are sorted by key.
+   struct CacheEntry
+   {
+      /// Key of the element within the buffer.
+      const char* key;
+      /// Address of the element within the buffer.
+      const uchar* element;
+      /// Position of the element in the collection.
+      int index;
+   };
+
+   /// Share the pre-load setup of Init and Load.
+   void Reset(HeapID _heapID);
+   /// Count a lookup in the given collection, index it if it has become hot,
+   /// and return its info if it has been indexed.  Return NULL otherwise.
+   CollectionInfo* CacheCheck(BSONView* collection);
+   /// Return true if 'a' should be sorted before 'b'.
+   static bool CacheEntryComparator(const CacheEntry& a, const CacheEntry& b) { return strcmp(a.key, b.key) < 0; }
+   /// Hash function for collection addresses.
+   static size_t AddressHash(const uchar* const& address) { return (size_t)address ^ ((size_t)address >> 9); }
+   /// Return true if the addresses are the same.
+   static bool AddressesEqualCheck(const uchar* const& a, const uchar* const& b) { return a == b; }
+
+   /// BSON data being viewed.
+   const uchar* buffer;
+   /// Size of 'buffer' in bytes.
+   size_t bufferSize;
+   /// If the buffer was loaded by the document, this is the FileManager
+   /// that should unload it.
+   FileManager* fileManager;
+   /// Heap for the lookup cache.
+   HeapID heapID;
+   /// True if hot collections should be indexed.
+   bool cacheEnabled;
+   /// Number of collections that have been indexed.
+   int cachedCollectionCount;
+   /// Number of lookups in the collections whose addresses hash to each
+   /// counter.  Collections that share a counter are just indexed sooner.
+   /// A counter is reset when a collection that uses it is indexed.
+   uchar lookupCounts[BSON_VIEW_CACHE_COUNTER_COUNT];
+   /// Index positions of the hot collections, keyed by the address of each
+   /// one's value.
+   FlatHashMap<const uchar*, CollectionInfo, size_t(*)(const uchar* const&), bool(*)(const uchar* const&, const uchar* const&)> collections;
+   /// Elements of all the indexed collections.
+   Table<CacheEntry> cacheEntries;
+
+   friend class BSONView;
+};
+
+//==============================================================================
+
+inline BSONView BSONView::Begin()
+{
+   if(!ArrayCheck() && !ObjectCheck())
+      return BSONView();
+   return ElementAt(value + sizeof(int32), 0);
+}
+
+//------------------------------------------------------------------------------
+
+inline int BSONView::SizeGet()
+{
+   if(BinaryCheck())
+      return Int32Read(value);
+   if(!ArrayCheck() && !ObjectCheck())
+      return 0;
+   BSONDocumentView::CollectionInfo* info = document->CacheCheck(this);
+   if(info)
+      return info->entryCount;
+   int size = 0;
+   for(BSONView element = Begin(); element.WithinCheck(); element.Next())
+      size++;
+   return size;
+}
+
+//------------------------------------------------------------------------------
+
+inline BSONView BSONView::Get(int _index)
+{
+   if(!ArrayCheck() || (_index < 0))
+      return BSONView();
+   BSONDocumentView::CollectionInfo* info = document->CacheCheck(this);
+   if(info)
+   {
+      if(_index >= info->entryCount)
+         return BSONView();
+      return ElementAt(document->cacheEntries[info->entryFirst + _index].element, _index);
+   }
+   BSONView element = Begin();
+   while(element.WithinCheck() && (element.index < _index))
+      element.Next();
+   return element.WithinCheck() ? element : BSONView();
+}
+
+//------------------------------------------------------------------------------
+
+inline BSONView BSONView::Get(const char* _key)
+{
+   if(!ObjectCheck() || !_key)
+      return BSONView();
+   BSONDocumentView::CollectionInfo* info = document->CacheCheck(this);
+   if(info)
+   {
+      // Binary search of the sorted keys.
+      int low = info->entryFirst;
+      int high = info->entryFirst + info->entryCount;
+      while(low < high)
+      {
+         int middle = low + (high - low) / 2;
+         if(strcmp(document->cacheEntries[middle].key, _key) < 0)
+            low = middle + 1;
+         else
+            high = middle;
+      }
+      if((low < info->entryFirst + info->entryCount) && !strcmp(document->cacheEntries[low].key, _key))
+         return ElementAt(document->cacheEntries[low].element, document->cacheEntries[low].index);
+      return BSONView();
+   }
+   for(BSONView element = Begin(); element.WithinCheck(); element.Next())
+   {
+      if(!strcmp(element.key, _key))
+         return element;
+   }
+   return BSONView();
+}
+
+//------------------------------------------------------------------------------
+
+inline BSONIterator BSONView::IteratorGet()
+{
+   BSONIterator iterator;
+   if(!value)
+      return iterator;
+   if(!key)
+      iterator.Init(value, true, index);
+   else
+      iterator.Init(key - 1, false, index);
+   return iterator;
+}
+
+//------------------------------------------------------------------------------
+
+inline BSONView BSONView::ElementAt(const uchar* element, int _index)
+{
+   BSONView view;
+   view.document = document;
+   view.index = _index;
+   if(!element || !*element)
+      return view;
+   view.type = *element;
+   view.key = (const char*)(element + 1);
+   view.value = (const uchar*)view.key + strlen(view.key) + 1;
+   return view;
+}
+
+//------------------------------------------------------------------------------
+
+inline const uchar* BSONView::ValueEndGet()
+{
+   switch(type)
+   {
+   case BSON_ELEMENT_TYPE_RAW_DOUBLE:
+   case BSON_ELEMENT_TYPE_RAW_INT64:
+      return value + 8;
+   case BSON_ELEMENT_TYPE_RAW_INT32:
+      return value + 4;
+   case BSON_ELEMENT_TYPE_RAW_BOOLEAN:
+      return value + 1;
+   case BSON_ELEMENT_TYPE_RAW_NULL:
+      return value;
+   case BSON_ELEMENT_TYPE_RAW_STRING:
+      return value + sizeof(int32) + Int32Read(value);
+   case BSON_ELEMENT_TYPE_RAW_BINARY:
+      return value + sizeof(int32) + 1 + Int32Read(value);
+   case BSON_ELEMENT_TYPE_RAW_OBJECT:
+   case BSON_ELEMENT_TYPE_RAW_ARRAY:
+      return value + Int32Read(value);
+   default:
+      WarningPrintf("BSONView::ValueEndGet -- Unsupported element type 0x%02X.\n", (int)type);
+      return NULL;
+   }
+}
+
+//------------------------------------------------------------------------------
+
+inline double BSONView::DoubleGet()
+{
+   if(DoubleCheck())
+   {
+      double result;
+      memcpy(&result, value, sizeof(result));
+      return result;
+   }
+   return (double)Int64Get();
+}
+
+//------------------------------------------------------------------------------
+
+inline int64 BSONView::Int64Get()
+{
+   if(!value)
+      return 0;
+   switch(type)
+   {
+   case BSON_ELEMENT_TYPE_RAW_INT32:
+      return Int32Read(value);
+   case BSON_ELEMENT_TYPE_RAW_INT64:
+   {
+      int64 result;
+      memcpy(&result, value, sizeof(result));
+      return result;
+   }
+   case BSON_ELEMENT_TYPE_RAW_DOUBLE:
+      return (int64)DoubleGet();
+   case BSON_ELEMENT_TYPE_RAW_BOOLEAN:
+      return *value ? 1 : 0;
+   default:
+      return 0;
+   }
+}
+
+//==============================================================================
+
+inline bool BSONDocumentView::Init(const void* _buffer, size_t _bufferSize, HeapID _heapID)
+{
+   Reset(_heapID);
+   buffer = (const uchar*)_buffer;
+   bufferSize = _bufferSize;
+
+   // The buffer must hold at least an empty document, and the document must
+   // fit in the buffer and end with a terminator.
+   if(!buffer || (bufferSize < 5))
+      return false;
+   int32 documentSize = BSONView::Int32Read(buffer);
+   if((documentSize < 5) || ((size_t)documentSize > bufferSize) || buffer[documentSize - 1])
+   {
+      WarningPrintf("BSONDocumentView::Init -- Invalid BSON document.\n");
+      return false;
+   }
+   return true;
+}
+
+//------------------------------------------------------------------------------
+
+inline bool BSONDocumentView::Load(const char* filename, FileManager* _fileManager, HeapID _heapID)
+{
+   assert(_fileManager);
+   char path[FROG_PATH_MAX+1];
+   if(!FrogSnprintf(path, sizeof(path), "%s.%s", filename, BSON_FILE_EXTENSION))
+      return false;
+   size_t length = 0;
+   void* data = _fileManager->FileLoad(path, &length, FROG_MEM_ALIGN, _heapID);
+   if(!data)
+      return false;
+   bool success = Init(data, length, _heapID);
+   fileManager = _fileManager;
+   if(!success)
+      Deinit();
+   return success;
+}
+
+//------------------------------------------------------------------------------
+
+inline bool BSONDocumentView::Load(const char* filename, FileManagerDatMapped* _fileManager, HeapID _heapID)
+{
+   assert(_fileManager);
+   char path[FROG_PATH_MAX+1];
+   if(!FrogSnprintf(path, sizeof(path), "%s.%s", filename, BSON_FILE_EXTENSION))
+      return false;
+   size_t length = 0;
+   const void* data = _fileManager->FileLoadView(path, &length);
+   if(!data)
+      return Load(filename, (FileManager*)_fileManager, _heapID);
+   bool success = Init(data, length, _heapID);
+   fileManager = _fileManager;
+   if(!success)
+      Deinit();
+   return success;
+}
+
+//------------------------------------------------------------------------------
+
+inline void BSONDocumentView::Deinit()
+{
+   cacheEntries.Deinit();
+   collections.Deinit();
+   if(fileManager && buffer)
+      fileManager->FileUnload((void*)buffer);
+   fileManager = NULL;
+   buffer = NULL;
+   bufferSize = 0;
+   cachedCollectionCount = 0;
+   memset(lookupCounts, 0, sizeof(lookupCounts));
+}
+
+//------------------------------------------------------------------------------
+
+inline BSONView BSONDocumentView::RootGet()
+{
+   BSONView view;
+   view.document = this;
+   if(buffer)
+   {
+      view.value = buffer;
+      view.type = BSON_ELEMENT_TYPE_RAW_OBJECT;
+   }
+   return view;
+}
+
+//------------------------------------------------------------------------------
+
+inline void BSONDocumentView::Reset(HeapID _heapID)
+{
+   heapID = _heapID;
+   buffer = NULL;
+   bufferSize = 0;
+   fileManager = NULL;
+   cachedCollectionCount = 0;
+   memset(lookupCounts, 0, sizeof(lookupCounts));
+   collections.Init(AddressHash, AddressesEqualCheck, theAllocatorHeaps[heapID]);
+   cacheEntries.Init(theAllocatorHeaps[heapID]);
+}
+
+//------------------------------------------------------------------------------
+
+inline BSONDocumentView::CollectionInfo* BSONDocumentView::CacheCheck(BSONView* collection)
+{
+   if(!cacheEnabled)
+      return NULL;
+
+   typedef FlatHashMap<const uchar*, CollectionInfo, size_t(*)(const uchar* const&), bool(*)(const uchar* const&, const uchar* const&)> CollectionMap;
+   // Collections only get an entry in 'collections' once they're hot.
+   CollectionMap::Iterator iterator = collections.Find(collection->value);
+   if(iterator.WithinCheck())
+      return (iterator.Value().entryFirst >= 0) ? &iterator.Value() : NULL;
+   uchar& lookupCount = lookupCounts[AddressHash(collection->value) & (BSON_VIEW_CACHE_COUNTER_COUNT - 1)];
+   if(lookupCount < BSON_VIEW_CACHE_LOOKUP_THRESHOLD)
+   {
+      lookupCount++;
+      return NULL;
+   }
+   // This collection no longer needs the counter, so let the others that
+   // share it start over.
+   lookupCount = 0;
+
+   // Index the collection.  Small ones are cheap enough to walk, so they're
+   // just marked as not worth indexing.
+   Table<CacheEntry> entries;
+   entries.Init(theAllocatorTemp);
+   for(BSONView element = collection->Begin(); element.WithinCheck(); element.Next())
+   {
+      CacheEntry entry;
+      entry.key = element.key;
+      entry.element = (const uchar*)element.key - 1;
+      entry.index = element.index;
+      entries.Add(entry);
+   }
+   CollectionInfo info;
+   info.entryFirst = COLLECTION_NOT_INDEXED;
+   info.entryCount = 0;
+   if(entries.SizeGet() < BSON_VIEW_CACHE_SIZE_MIN)
+   {
+      entries.Deinit();
+      collections.Add(collection->value, info);
+      return NULL;
+   }
+   if(collection->ObjectCheck())
+      entries.SortStable(CacheEntryComparator);
+   int entryFirst = cacheEntries.SizeGet();
+   int entryCount = entries.SizeGet();
+   cacheEntries.AddCount(&entries[0], entryCount);
+   entries.Deinit();
+
+   info.entryFirst = entryFirst;
+   info.entryCount = entryCount;
+   collections.Add(collection->value, info);
+   cachedCollectionCount++;
+   iterator = collections.Find(collection->value);
+   return iterator.WithinCheck() ? &iterator.Value() : NULL;
+}
+
+//------------------------------------------------------------------------------
+
+} //namespace Webfoot {
+
+#endif //#ifndef __FROG__BSONVIEW_H__
@@ -0,0 +1,55 @@
+#ifndef __FROG__BENCHMARKTIMER_H__
+#define __FROG__BENCHMARKTIMER_H__
+
+#include "FrogMemory.h"
+
+#if PLATFORM_IS_WINDOWS
+   #include <windows.h>
+#else
+   #include <time.h>
+#endif
+
+namespace Webfoot {
+
+//==============================================================================
+
+/// BenchmarkTimer measures elapsed wall-clock time with a high resolution
+/// timer for the standalone benchmark programs in this folder.  Clock only
+/// has millisecond resolution and needs the rest of the engine to be
+/// initialized, so it isn't used here.
+class BenchmarkTimer
+{
+public:
+   BenchmarkTimer() { Start(); }
+
+   /// Start timing from now.
+   void Start() { startTime = NowGet(); }
+   /// Return the number of seconds since Start was called.
+   double SecondsGet() { return NowGet() - startTime; }
+
+   /// Return the current time in seconds from an arbitrary starting point.
+   static double NowGet()
+   {
+#if PLATFORM_IS_WINDOWS
+      LARGE_INTEGER frequency;
+      LARGE_INTEGER counter;
+      QueryPerformanceFrequency(&frequency);
+      QueryPerformanceCounter(&counter);
+      return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+      timespec now;
+      clock_gettime(CLOCK_MONOTONIC, &now);
+      return (double)now.tv_sec + ((double)now.tv_nsec * 1e-9);
+#endif
+   }
+
+protected:
+   /// Time when Start was last called.
+   double startTime;
+};
+
+//==============================================================================
+
+} //namespace Webfoot {
+
+#endif //#ifndef __FROG__BENCHMARKTIMER_H__
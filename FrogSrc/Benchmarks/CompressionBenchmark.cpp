@@ -0,0 +1,475 @@
+/// CompressionBenchmark measures the codecs of the FileManagerArchive format
+/// against the zlib path that CompressedFileSave and CompressedFileLoad use.
+///
+/// First, each codec compresses and decompresses the input in chunks of
+/// several sizes, which shows the size and speed tradeoff on its own.  zlib
+/// is also run on each whole file, the way CompressedFileSave stores it.
+/// Then the input is written both as CompressedFileSave files and as
+/// archives, and each file is loaded back with CompressedFileLoad and
+/// through FileManagerArchive, which is what a level load does.  Packing the
+/// archive is timed with one thread and with all of them.
+///
+/// Pass the files to measure as arguments, such as sprite sheets and Duck
+/// scenes.  Without any, a synthetic sprite sheet and scene are used.
+/// Temporary files are written to the working directory and removed
+/// afterward.
+///
+/// Build it as a console program linked with the Frog library.  Speeds are
+/// in MB/s of uncompressed data.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "FrogMemory.h"
+#include "Utility.h"
+#include "Table.h"
+#include "File.h"
+#include "FileManagerStdio.h"
+#include "FileManagerArchive.h"
+#include "FileArchiveWriter.h"
+#include "CompressionLZ4.h"
+#include "zlib.h"
+#include "Thread.h"
+#include "BenchmarkTimer.h"
+
+using namespace Webfoot;
+
+/// Approximate number of bytes to process for each speed measurement.
+#define COMPRESSION_BENCHMARK_BYTES_PER_MEASUREMENT (256*1024*1024)
+/// Size of each synthetic input.
+#define COMPRESSION_BENCHMARK_SYNTHETIC_SIZE (4*1024*1024)
+/// Width in pixels of the synthetic sprite sheet.
+#define COMPRESSION_BENCHMARK_SHEET_WIDTH 1024
+/// Prefix of the temporary files.
+#define COMPRESSION_BENCHMARK_TEMP_PREFIX "CompressionBenchmark"
+
+//==============================================================================
+
+/// One file to be measured.
+struct CompressionBenchmarkInput
+{
+   /// Name to use in the archive and for the temporary file.
+   char name[64];
+   /// Contents of the file.
+   unsigned char* data;
+   /// Size of 'data' in bytes.
+   size_t size;
+};
+
+//==============================================================================
+
+/// Deterministic random numbers so the synthetic input is the same every run.
+class CompressionBenchmarkRandom
+{
+public:
+   CompressionBenchmarkRandom() { state = 12345; }
+   /// Return a number from 0 to 'limit'-1.
+   unsigned int Get(unsigned int limit)
+   {
+      state = state * 1103515245 + 12345;
+      return (state >> 8) % limit;
+   }
+
+protected:
+   unsigned int state;
+};
+
+//==============================================================================
+
+/// Return the number of times to repeat an operation on 'size' bytes so that
+/// about COMPRESSION_BENCHMARK_BYTES_PER_MEASUREMENT bytes are processed.
+static int RepeatCountGet(size_t size)
+{
+   size_t repeatCount = COMPRESSION_BENCHMARK_BYTES_PER_MEASUREMENT / (size ? size : 1);
+   return (int)std::max((size_t)1, std::min(repeatCount, (size_t)1000));
+}
+
+//------------------------------------------------------------------------------
+
+/// Return the speed in MB/s of processing 'size' bytes 'repeatCount' times in
+/// 'seconds'.
+static double SpeedGet(size_t size, int repeatCount, double seconds)
+{
+   if(seconds <= 0.0)
+      return 0.0;
+   return ((double)size * (double)repeatCount) / (seconds * 1024.0 * 1024.0);
+}
+
+//------------------------------------------------------------------------------
+
+/// Compress 'sourceSize' bytes with the given codec.  Return the compressed
+/// size, or 0 if it didn't fit.
+static size_t Compress(int codec, const unsigned char* source, size_t sourceSize,
+   unsigned char* destination, size_t destinationCapacity)
+{
+   if(codec == FILE_ARCHIVE_CODEC_LZ4)
+      return LZ4Compress(source, sourceSize, destination, destinationCapacity);
+   uLongf deflateSize = (uLongf)destinationCapacity;
+   if(compress2(destination, &deflateSize, source, (uLong)sourceSize, Z_DEFAULT_COMPRESSION) != Z_OK)
+      return 0;
+   return (size_t)deflateSize;
+}
+
+//------------------------------------------------------------------------------
+
+/// Compress and decompress 'input' with the given codec in chunks of
+/// 'chunkSize' bytes, or as a whole if 'chunkSize' is 0, and print the
+/// results.
+static void CodecMeasure(const char* codecName, int codec, size_t chunkSize, const CompressionBenchmarkInput& input)
+{
+   if(!chunkSize || (chunkSize > input.size))
+      chunkSize = input.size;
+   size_t chunkCount = (input.size + chunkSize - 1) / chunkSize;
+   size_t capacity = std::max(LZ4CompressBoundGet(chunkSize), (size_t)compressBound((uLong)chunkSize));
+   unsigned char* compressed = (unsigned char*)malloc(capacity * chunkCount);
+   size_t* compressedSizes = (size_t*)malloc(sizeof(size_t) * chunkCount);
+   unsigned char* decompressed = (unsigned char*)malloc(input.size);
+
+   // Deflate is much slower to compress, so it gets fewer repeats.
+   int repeatCount = RepeatCountGet(input.size);
+   int compressRepeatCount = (codec == FILE_ARCHIVE_CODEC_LZ4) ? repeatCount : std::max(1, repeatCount / 8);
+   size_t compressedTotal = 0;
+   BenchmarkTimer timer;
+   for(int repeatIndex = 0; repeatIndex < compressRepeatCount; repeatIndex++)
+   {
+      compressedTotal = 0;
+      for(size_t chunkIndex = 0; chunkIndex < chunkCount; chunkIndex++)
+      {
+         size_t offset = chunkIndex * chunkSize;
+         size_t size = std::min(chunkSize, input.size - offset);
+         compressedSizes[chunkIndex] = Compress(codec, input.data + offset, size, compressed + chunkIndex * capacity, capacity);
+         compressedTotal += compressedSizes[chunkIndex];
+      }
+   }
+   double compressSeconds = timer.SecondsGet();
+
+   bool success = true;
+   timer.Start();
+   for(int repeatIndex = 0; repeatIndex < repeatCount; repeatIndex++)
+   {
+      for(size_t chunkIndex = 0; chunkIndex < chunkCount; chunkIndex++)
+      {
+         size_t offset = chunkIndex * chunkSize;
+         size_t size = std::min(chunkSize, input.size - offset);
+         success = FileArchiveChunkDecompress(codec, compressed + chunkIndex * capacity, compressedSizes[chunkIndex],
+            decompressed + offset, size) && success;
+      }
+   }
+   double decompressSeconds = timer.SecondsGet();
+   if(memcmp(decompressed, input.data, input.size))
+      success = false;
+
+   char chunkDescription[32];
+   if(chunkCount == 1)
+      FrogSnprintf(chunkDescription, sizeof(chunkDescription), "whole");
+   else
+      FrogSnprintf(chunkDescription, sizeof(chunkDescription), "%uKB", (unsigned int)(chunkSize / 1024));
+   printf("%-24s %-8s %-8s %9.1f%% %12.1f %12.1f%s\n", input.name, codecName, chunkDescription,
+      100.0 * (double)compressedTotal / (double)input.size,
+      SpeedGet(input.size, compressRepeatCount, compressSeconds), SpeedGet(input.size, repeatCount, decompressSeconds),
+      success ? "" : "  MISMATCH");
+
+   free(decompressed);
+   free(compressedSizes);
+   free(compressed);
+}
+
+//------------------------------------------------------------------------------
+
+/// Write every input to an archive with the given codec using the given
+/// number of threads.  Return the time taken in seconds, or a negative number
+/// if it failed.
+static double ArchiveWrite(FileManager* fileManager, const char* archiveFilename, Table<CompressionBenchmarkInput>* inputs,
+   FileArchiveCodec codec, int threadCount)
+{
+   FileArchiveWriter writer;
+   writer.Init();
+   for(int inputIndex = 0; inputIndex < inputs->SizeGet(); inputIndex++)
+      writer.Add((*inputs)[inputIndex].name, (*inputs)[inputIndex].data, (*inputs)[inputIndex].size, codec);
+   File* file = fileManager->Open(archiveFilename, FileManager::WRITE);
+   if(!file)
+   {
+      writer.Deinit();
+      return -1.0;
+   }
+   BenchmarkTimer timer;
+   bool success = writer.Write(file, threadCount);
+   double seconds = timer.SecondsGet();
+   fileManager->Close(file);
+   writer.Deinit();
+   return success ? seconds : -1.0;
+}
+
+//------------------------------------------------------------------------------
+
+/// Load every input from 'loadFileManager' 'repeatCount' times, either with
+/// FileLoad or with CompressedFileLoad, and return the time taken in
+/// seconds, or a negative number if anything didn't match.
+static double LoadMeasure(FileManager* loadFileManager, Table<CompressionBenchmarkInput>* inputs, bool compressed,
+   int repeatCount)
+{
+   bool success = true;
+   char filename[FROG_PATH_MAX+1];
+   BenchmarkTimer timer;
+   for(int repeatIndex = 0; repeatIndex < repeatCount; repeatIndex++)
+   {
+      for(int inputIndex = 0; inputIndex < inputs->SizeGet(); inputIndex++)
+      {
+         const CompressionBenchmarkInput& input = (*inputs)[inputIndex];
+         size_t length = 0;
+         void* data;
+         if(compressed)
+         {
+            FrogSnprintf(filename, sizeof(filename), "%s_%s.tmp", COMPRESSION_BENCHMARK_TEMP_PREFIX, input.name);
+            data = loadFileManager->CompressedFileLoad(filename, &length);
+         }
+         else
+         {
+            data = loadFileManager->FileLoad(input.name, &length);
+         }
+         if(!data || (length != input.size))
+            success = false;
+         else if(repeatIndex == 0)
+            success = !memcmp(data, input.data, length) && success;
+         if(compressed)
+            loadFileManager->CompressedFileUnload(data);
+         else
+            loadFileManager->FileUnload(data);
+      }
+   }
+   double seconds = timer.SecondsGet();
+   return success ? seconds : -1.0;
+}
+
+//------------------------------------------------------------------------------
+
+/// Print one row of the loading results.
+static void LoadResultPrint(const char* methodName, size_t totalSize, size_t storedSize, int repeatCount, double seconds)
+{
+   if(seconds < 0.0)
+   {
+      printf("%-24s failed\n", methodName);
+      return;
+   }
+   printf("%-24s %9.1f%% %12.1f\n", methodName, 100.0 * (double)storedSize / (double)totalSize,
+      SpeedGet(totalSize, repeatCount, seconds));
+}
+
+//------------------------------------------------------------------------------
+
+/// Return the size of the given file in 'fileManager', or 0 if it can't be
+/// opened.
+static size_t FileSizeGet(FileManager* fileManager, const char* filename)
+{
+   File* file = fileManager->Open(filename);
+   if(!file)
+      return 0;
+   size_t size = (size_t)file->SizeGet();
+   fileManager->Close(file);
+   return size;
+}
+
+//------------------------------------------------------------------------------
+
+/// Compare loading every input through archives and with CompressedFileLoad.
+static void LoadSuiteRun(FileManager* fileManager, Table<CompressionBenchmarkInput>* inputs)
+{
+   const char* lz4ArchiveFilename = COMPRESSION_BENCHMARK_TEMP_PREFIX "_LZ4.tmp";
+   const char* deflateArchiveFilename = COMPRESSION_BENCHMARK_TEMP_PREFIX "_Deflate.tmp";
+   char filename[FROG_PATH_MAX+1];
+   size_t totalSize = 0;
+   size_t compressedFilesSize = 0;
+   for(int inputIndex = 0; inputIndex < inputs->SizeGet(); inputIndex++)
+   {
+      const CompressionBenchmarkInput& input = (*inputs)[inputIndex];
+      FrogSnprintf(filename, sizeof(filename), "%s_%s.tmp", COMPRESSION_BENCHMARK_TEMP_PREFIX, input.name);
+      fileManager->CompressedFileSave(filename, input.data, input.size);
+      compressedFilesSize += FileSizeGet(fileManager, filename);
+      totalSize += input.size;
+   }
+   int repeatCount = RepeatCountGet(totalSize) / 4 + 1;
+
+   int processorCount = Thread::ProcessorCountGet();
+   printf("\nPacking, s\n");
+   printf("%-24s %12s %12s\n", "", "1 thread", "All threads");
+   printf("%-24s %12.3f %12.3f\n", "LZ4", ArchiveWrite(fileManager, lz4ArchiveFilename, inputs, FILE_ARCHIVE_CODEC_LZ4, 0),
+      ArchiveWrite(fileManager, lz4ArchiveFilename, inputs, FILE_ARCHIVE_CODEC_LZ4, processorCount - 1));
+   printf("%-24s %12.3f %12.3f\n", "Deflate", ArchiveWrite(fileManager, deflateArchiveFilename, inputs, FILE_ARCHIVE_CODEC_DEFLATE, 0),
+      ArchiveWrite(fileManager, deflateArchiveFilename, inputs, FILE_ARCHIVE_CODEC_DEFLATE, processorCount - 1));
+
+   printf("\nLoading %d times, including reading the files\n", repeatCount);
+   printf("%-24s %10s %12s\n", "", "Stored", "MB/s");
+   LoadResultPrint("CompressedFileLoad", totalSize, compressedFilesSize, repeatCount,
+      LoadMeasure(fileManager, inputs, true, repeatCount));
+
+   FileManagerArchive archiveFileManager;
+   if(archiveFileManager.Init(fileManager, lz4ArchiveFilename))
+   {
+      LoadResultPrint("FileManagerArchive LZ4", totalSize, FileSizeGet(fileManager, lz4ArchiveFilename), repeatCount,
+         LoadMeasure(&archiveFileManager, inputs, false, repeatCount));
+      archiveFileManager.Deinit();
+   }
+   if(archiveFileManager.Init(fileManager, deflateArchiveFilename))
+   {
+      LoadResultPrint("FileManagerArchive zlib", totalSize, FileSizeGet(fileManager, deflateArchiveFilename), repeatCount,
+         LoadMeasure(&archiveFileManager, inputs, false, repeatCount));
+      archiveFileManager.Deinit();
+   }
+
+   fileManager->FileRemove(lz4ArchiveFilename);
+   fileManager->FileRemove(deflateArchiveFilename);
+   for(int inputIndex = 0; inputIndex < inputs->SizeGet(); inputIndex++)
+   {
+      FrogSnprintf(filename, sizeof(filename), "%s_%s.tmp", COMPRESSION_BENCHMARK_TEMP_PREFIX, (*inputs)[inputIndex].name);
+      fileManager->FileRemove(filename);
+   }
+}
+
+//------------------------------------------------------------------------------
+
+/// Add a synthetic RGBA sprite sheet, with transparent space between
+/// sprites made of a few flat colors and some noise.
+static void SyntheticSheetAdd(Table<CompressionBenchmarkInput>* inputs, CompressionBenchmarkRandom* random)
+{
+   CompressionBenchmarkInput input;
+   FrogSnprintf(input.name, sizeof(input.name), "SyntheticSheet");
+   input.size = COMPRESSION_BENCHMARK_SYNTHETIC_SIZE;
+   input.data = (unsigned char*)calloc(input.size, 1);
+   int width = COMPRESSION_BENCHMARK_SHEET_WIDTH;
+   int height = (int)(input.size / 4 / width);
+   for(int spriteTop = 0; spriteTop + 64 <= height; spriteTop += 80)
+   {
+      for(int spriteLeft = 0; spriteLeft + 64 <= width; spriteLeft += 80)
+      {
+         unsigned char palette[4][3];
+         for(int colorIndex = 0; colorIndex < 4; colorIndex++)
+            for(int channel = 0; channel < 3; channel++)
+               palette[colorIndex][channel] = (unsigned char)random->Get(256);
+         for(int y = spriteTop; y < spriteTop + 64; y++)
+         {
+            for(int x = spriteLeft; x < spriteLeft + 64; x++)
+            {
+               unsigned char* pixel = &input.data[(y * width + x) * 4];
+               int colorIndex = ((x - spriteLeft) / 16 + (y - spriteTop) / 16) & 3;
+               for(int channel = 0; channel < 3; channel++)
+                  pixel[channel] = (unsigned char)(palette[colorIndex][channel] + random->Get(4));
+               pixel[3] = 255;
+            }
+         }
+      }
+   }
+   inputs->Add(input);
+}
+
+//------------------------------------------------------------------------------
+
+/// Add a synthetic JSON scene with many similar objects.
+static void SyntheticSceneAdd(Table<CompressionBenchmarkInput>* inputs, CompressionBenchmarkRandom* random)
+{
+   static const char* spriteNames[] = { "Player", "Enemy", "Coin", "Platform", "Door", "Tree" };
+   CompressionBenchmarkInput input;
+   FrogSnprintf(input.name, sizeof(input.name), "SyntheticScene");
+   input.data = (unsigned char*)malloc(COMPRESSION_BENCHMARK_SYNTHETIC_SIZE);
+   size_t capacity = COMPRESSION_BENCHMARK_SYNTHETIC_SIZE;
+   strcpy((char*)input.data, "{\"objects\":[\n");
+   size_t size = strlen((char*)input.data);
+   for(int objectIndex = 0; size + 256 < capacity; objectIndex++)
+   {
+      char* object = (char*)input.data + size;
+      FrogSnprintf(object, capacity - size,
+         "{\"name\":\"Object%d\",\"sprite\":\"Sprites/%s\",\"position\":[%u,%u],\"scale\":%u.%u,\"layer\":%u},\n",
+         objectIndex, spriteNames[random->Get(6)], random->Get(4096), random->Get(2048), random->Get(3), random->Get(10),
+         random->Get(8));
+      size += strlen(object);
+   }
+   strcpy((char*)input.data + size, "{}]}\n");
+   input.size = size + strlen((char*)input.data + size);
+   inputs->Add(input);
+}
+
+//------------------------------------------------------------------------------
+
+/// Load the given file into a new input.  Return false if it couldn't be
+/// read.
+static bool InputLoad(Table<CompressionBenchmarkInput>* inputs, const char* path, int inputIndex)
+{
+   FILE* file = fopen(path, "rb");
+   if(!file)
+      return false;
+   CompressionBenchmarkInput input;
+   fseek(file, 0, SEEK_END);
+   long size = ftell(file);
+   fseek(file, 0, SEEK_SET);
+   input.size = (size > 0) ? (size_t)size : 0;
+   input.data = (unsigned char*)malloc(input.size ? input.size : 1);
+   bool success = input.size && (fread(input.data, 1, input.size, file) == input.size);
+   fclose(file);
+   if(!success)
+   {
+      free(input.data);
+      return false;
+   }
+   // Use the last part of the path, so long paths still fit.
+   const char* baseName = strrchr(path, '/');
+   baseName = baseName ? baseName + 1 : path;
+   FrogSnprintf(input.name, sizeof(input.name), "%d_%.40s", inputIndex, baseName);
+   inputs->Add(input);
+   return true;
+}
+
+//------------------------------------------------------------------------------
+
+int main(int argc, char** argv)
+{
+   FrogMemoryInit();
+   FileManagerStdio fileManager;
+   if(!fileManager.Init())
+      return 1;
+
+   Table<CompressionBenchmarkInput> inputs;
+   inputs.Init(theAllocatorMallocFree);
+   for(int argIndex = 1; argIndex < argc; argIndex++)
+   {
+      if(!InputLoad(&inputs, argv[argIndex], argIndex))
+         printf("CompressionBenchmark -- Unable to read %s\n", argv[argIndex]);
+   }
+   if(!inputs.SizeGet())
+   {
+      CompressionBenchmarkRandom random;
+      SyntheticSheetAdd(&inputs, &random);
+      SyntheticSceneAdd(&inputs, &random);
+   }
+
+   printf("CompressionBenchmark -- %d files, %d processors\n", inputs.SizeGet(), Thread::ProcessorCountGet());
+   printf("%-24s %-8s %-8s %10s %12s %12s\n", "", "Codec", "Chunks", "Size", "Compress", "Decompress");
+   static const size_t chunkSizes[] = { 64*1024, FILE_ARCHIVE_CHUNK_SIZE_DEFAULT, 1024*1024 };
+   for(int inputIndex = 0; inputIndex < inputs.SizeGet(); inputIndex++)
+   {
+      for(int chunkSizeIndex = 0; chunkSizeIndex < (int)(sizeof(chunkSizes) / sizeof(chunkSizes[0])); chunkSizeIndex++)
+      {
+         CodecMeasure("LZ4", FILE_ARCHIVE_CODEC_LZ4, chunkSizes[chunkSizeIndex], inputs[inputIndex]);
+         CodecMeasure("zlib", FILE_ARCHIVE_CODEC_DEFLATE, chunkSizes[chunkSizeIndex], inputs[inputIndex]);
+      }
+      CodecMeasure("zlib", FILE_ARCHIVE_CODEC_DEFLATE, 0, inputs[inputIndex]);
+   }
+
+   LoadSuiteRun(&fileManager, &inputs);
+
+   for(int inputIndex = 0; inputIndex < inputs.SizeGet(); inputIndex++)
+      free(inputs[inputIndex].data);
+   inputs.Deinit();
+   fileManager.Deinit();
+   return 0;
+}
+
+//------------------------------------------------------------------------------
+
+void Webfoot::ProjectMemoryInit()
+{
+}
+
+//------------------------------------------------------------------------------
+
+void Webfoot::ProjectMemoryDeinit()
+{
+}
@@ -0,0 +1,244 @@
+/// HeapBenchmark replays an allocation trace against Heap and HeapSmall,
+/// which search a single address-sorted free list, and against HeapBinned
+/// and HeapSmallBinned, which use segregated size classes.  For each heap it
+/// reports the time to replay the trace, the number of allocations that
+/// failed, and the free memory and largest free block at the end.
+///
+/// A trace is a text file with one event per line:
+///
+///    a <id> <size>   Allocate 'size' bytes and call the result 'id'.
+///    f <id>          Free the allocation called 'id'.
+///
+/// IDs are non-negative integers and can be reused once they're freed.  Pass
+/// the trace filename as the first argument.  Without one, a synthetic trace
+/// is used that resembles several level loads, with many small JSONValue,
+/// Sprite, and Table sized allocations and some long-lived survivors.
+///
+/// Build it as a console program linked with the Frog library.  Times are
+/// in milliseconds.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "FrogMemory.h"
+#include "Table.h"
+#include "Heap.h"
+#include "HeapSmall.h"
+#include "HeapBinned.h"
+#include "HeapSmallBinned.h"
+#include "BenchmarkTimer.h"
+
+using namespace Webfoot;
+
+/// Size of the memory given to Heap and HeapBinned.
+#define HEAP_BENCHMARK_REGULAR_SIZE (64*1024*1024)
+/// Largest allocation replayed against HeapSmall and HeapSmallBinned.
+#define HEAP_BENCHMARK_SMALL_ALLOCATION_MAX 256
+/// Number of level loads in the synthetic trace.
+#define HEAP_BENCHMARK_LEVEL_COUNT 8
+/// Number of allocations per level load in the synthetic trace.
+#define HEAP_BENCHMARK_LEVEL_ALLOCATION_COUNT 40000
+
+//==============================================================================
+
+/// One event of an allocation trace.
+struct HeapBenchmarkEvent
+{
+   /// Name of the allocation.
+   int id;
+   /// Number of bytes to allocate, or 0 to free.
+   size_t size;
+};
+
+//==============================================================================
+
+/// Deterministic random numbers so the synthetic trace is the same every run.
+class HeapBenchmarkRandom
+{
+public:
+   HeapBenchmarkRandom() { state = 12345; }
+   /// Return a number from 0 to 'limit'-1.
+   unsigned int Get(unsigned int limit)
+   {
+      state = state * 1103515245 + 12345;
+      return (state >> 8) % limit;
+   }
+
+protected:
+   unsigned int state;
+};
+
+//==============================================================================
+
+/// Load the trace from the given file.  Return false if it couldn't be read.
+static bool TraceLoad(const char* filename, Table<HeapBenchmarkEvent>* events, int* idCount)
+{
+   FILE* file = fopen(filename, "r");
+   if(!file)
+      return false;
+   char kind;
+   int id;
+   unsigned long size;
+   *idCount = 0;
+   while(fscanf(file, " %c %d", &kind, &id) == 2)
+   {
+      HeapBenchmarkEvent event;
+      event.id = id;
+      event.size = 0;
+      if(kind == 'a')
+      {
+         if(fscanf(file, "%lu", &size) != 1)
+            break;
+         event.size = size ? (size_t)size : 1;
+      }
+      if(id < 0)
+         continue;
+      if(id >= *idCount)
+         *idCount = id + 1;
+      events->Add(event);
+   }
+   fclose(file);
+   return true;
+}
+
+//------------------------------------------------------------------------------
+
+/// Return the size of an allocation in the synthetic trace.
+static size_t SyntheticSizeGet(HeapBenchmarkRandom* random)
+{
+   unsigned int kind = random->Get(100);
+   if(kind < 70)
+      return 16 + random->Get(48);
+   if(kind < 90)
+      return 64 + random->Get(448);
+   if(kind < 99)
+      return 512 + random->Get(7680);
+   return 8192 + random->Get(256*1024);
+}
+
+//------------------------------------------------------------------------------
+
+/// Build a trace that resembles several level loads.  During each load,
+/// some recent allocations are freed as temporary data is thrown away.  At
+/// the end of each load, most of the level is freed, but some of it
+/// survives into later levels.
+static void TraceSynthesize(Table<HeapBenchmarkEvent>* events, int* idCount)
+{
+   HeapBenchmarkRandom random;
+   Table<int> live;
+   live.Init(theAllocatorMallocFree);
+   Table<int> freeIDs;
+   freeIDs.Init(theAllocatorMallocFree);
+   *idCount = 0;
+
+   for(int levelIndex = 0; levelIndex < HEAP_BENCHMARK_LEVEL_COUNT; levelIndex++)
+   {
+      for(int allocationIndex = 0; allocationIndex < HEAP_BENCHMARK_LEVEL_ALLOCATION_COUNT; allocationIndex++)
+      {
+         HeapBenchmarkEvent event;
+         event.id = freeIDs.SizeGet() ? freeIDs.Pop() : (*idCount)++;
+         event.size = SyntheticSizeGet(&random);
+         events->Add(event);
+         live.Add(event.id);
+
+         if(random.Get(100) < 30)
+         {
+            int liveIndex = live.SizeGet() - 1 - (int)random.Get(std::min(live.SizeGet(), 64));
+            event.id = live[liveIndex];
+            event.size = 0;
+            events->Add(event);
+            live.RemoveIndexUnordered(liveIndex);
+            freeIDs.Add(event.id);
+         }
+      }
+
+      for(int liveIndex = live.SizeGet() - 1; liveIndex >= 0; liveIndex--)
+      {
+         if(random.Get(100) < 10)
+            continue;
+         HeapBenchmarkEvent event;
+         event.id = live[liveIndex];
+         event.size = 0;
+         events->Add(event);
+         live.RemoveIndexUnordered(liveIndex);
+         freeIDs.Add(event.id);
+      }
+   }
+
+   live.Deinit();
+   freeIDs.Deinit();
+}
+
+//------------------------------------------------------------------------------
+
+/// Replay the events against a heap of the given type using 'memory', and
+/// print the results.  Allocations larger than 'allocationMax' are skipped.
+template<typename HeapType>
+void Replay(const char* heapName, Table<HeapBenchmarkEvent>* events, int idCount,
+   void* memory, size_t memorySize, size_t allocationMax)
+{
+   void** addresses = (void**)calloc(idCount, sizeof(void*));
+   HeapType heap;
+   heap.Init(memory, memorySize);
+   int allocationCount = 0;
+   int failureCount = 0;
+
+   BenchmarkTimer timer;
+   int eventCount = events->SizeGet();
+   for(int eventIndex = 0; eventIndex < eventCount; eventIndex++)
+   {
+      HeapBenchmarkEvent& event = (*events)[eventIndex];
+      if(event.size)
+      {
+         if(event.size > allocationMax)
+            continue;
+         addresses[event.id] = heap.Allocate(event.size);
+         allocationCount++;
+         if(!addresses[event.id])
+            failureCount++;
+      }
+      else if(addresses[event.id])
+      {
+         heap.Deallocate(addresses[event.id]);
+         addresses[event.id] = NULL;
+      }
+   }
+   double seconds = timer.SecondsGet();
+
+   printf("%-16s %10.3f %10d %10d %12u %12u\n", heapName, seconds * 1000.0, allocationCount, failureCount,
+      (unsigned int)heap.MemoryFreeGet(), (unsigned int)heap.MaxFreeContiguousSizeGet());
+   free(addresses);
+}
+
+//------------------------------------------------------------------------------
+
+int main(int argc, char** argv)
+{
+   Table<HeapBenchmarkEvent> events;
+   events.Init(theAllocatorMallocFree);
+   int idCount = 0;
+   if(argc > 1)
+   {
+      if(!TraceLoad(argv[1], &events, &idCount))
+      {
+         printf("HeapBenchmark -- Unable to read %s\n", argv[1]);
+         return 1;
+      }
+   }
+   else
+   {
+      TraceSynthesize(&events, &idCount);
+   }
+
+   printf("HeapBenchmark -- %d events, %d IDs, times in ms\n", events.SizeGet(), idCount);
+   printf("%-16s %10s %10s %10s %12s %12s\n", "", "Time", "Allocs", "Failures", "Free", "LargestFree");
+
+   void* memory = malloc(HEAP_BENCHMARK_REGULAR_SIZE);
+   Replay<Heap>("Heap", &events, idCount, memory, HEAP_BENCHMARK_REGULAR_SIZE, (size_t)-1);
+   Replay<HeapBinned>("HeapBinned", &events, idCount, memory, HEAP_BENCHMARK_REGULAR_SIZE, (size_t)-1);
+   Replay<HeapSmall>("HeapSmall", &events, idCount, memory, HEAP_SMALL_SIZE_MAX, HEAP_BENCHMARK_SMALL_ALLOCATION_MAX);
+   Replay<HeapSmallBinned>("HeapSmallBinned", &events, idCount, memory, HEAP_SMALL_SIZE_MAX, HEAP_BENCHMARK_SMALL_ALLOCATION_MAX);
+   free(memory);
+
+   events.Deinit();
+   return 0;
+}
@@ -0,0 +1,230 @@
+/// MapBenchmark compares FlatHashMap with HashTable and Map for collections
+/// of 1e2 to 1e6 entries, with both integer and string keys.  For each size
+/// it times adding every key, finding every key, looking up keys that are not
+/// present, iterating, and removing every key.  Smaller collections are
+/// rebuilt several times so each measurement covers about the same number of
+/// operations.
+///
+/// Build it as a console program linked with the Frog library.  Times are in
+/// nanoseconds per operation.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "FrogMemory.h"
+#include "Utility.h"
+#include "Table.h"
+#include "Map.h"
+#include "HashTable.h"
+#include "FlatHashMap.h"
+#include "BenchmarkTimer.h"
+
+using namespace Webfoot;
+
+/// Smallest collection size to measure.
+#define MAP_BENCHMARK_SIZE_MIN 100
+/// Largest collection size to measure.
+#define MAP_BENCHMARK_SIZE_MAX 1000000
+/// Approximate number of operations of each kind for each measurement.
+#define MAP_BENCHMARK_OPERATION_COUNT 1000000
+/// Maximum length of the string keys, including the terminator.
+#define MAP_BENCHMARK_STRING_KEY_LENGTH 32
+
+//==============================================================================
+
+/// Times for one kind of collection at one size, in nanoseconds per operation.
+struct MapBenchmarkResult
+{
+   double add;
+   double find;
+   double findMissing;
+   double iterate;
+   double remove;
+};
+
+//==============================================================================
+
+/// Sum of the values found, so the lookups can't be optimized away.
+static volatile int mapBenchmarkChecksum = 0;
+
+//------------------------------------------------------------------------------
+
+/// Hash for integer keys.  The keys are spread out so that collections
+/// which use the low bits don't get an unfair advantage.
+static size_t IntHash(const int& key)
+{
+   unsigned int hash = (unsigned int)key * 2654435761u;
+   return (size_t)(hash ^ (hash >> 16));
+}
+
+//------------------------------------------------------------------------------
+
+/// Equality for integer keys.
+static bool IntsEqualCheck(const int& keyA, const int& keyB)
+{
+   return keyA == keyB;
+}
+
+//------------------------------------------------------------------------------
+
+/// Initialize the collection being measured.
+template<typename KeyType, typename ValueType>
+void CollectionInit(Map<KeyType, ValueType>* map, size_t (*)(const KeyType&), bool (*)(const KeyType&, const KeyType&),
+   bool (*comparator)(const KeyType&, const KeyType&))
+{
+   map->Init(comparator, theAllocatorMallocFree);
+}
+
+template<typename KeyType, typename ValueType>
+void CollectionInit(HashTable<KeyType, ValueType>* hashTable, size_t (*hashFunction)(const KeyType&),
+   bool (*keysEqualFunction)(const KeyType&, const KeyType&), bool (*)(const KeyType&, const KeyType&))
+{
+   hashTable->Init(hashFunction, keysEqualFunction, theAllocatorMallocFree);
+}
+
+template<typename KeyType, typename ValueType>
+void CollectionInit(FlatHashMap<KeyType, ValueType>* flatHashMap, size_t (*hashFunction)(const KeyType&),
+   bool (*keysEqualFunction)(const KeyType&, const KeyType&), bool (*)(const KeyType&, const KeyType&))
+{
+   flatHashMap->Init(hashFunction, keysEqualFunction, theAllocatorMallocFree);
+}
+
+//------------------------------------------------------------------------------
+
+/// Measure a collection of type 'CollectionType' holding the first 'size'
+/// of 'keys'.  'missingKeys' must have at least 'size' keys that are not in
+/// 'keys'.
+template<typename CollectionType, typename KeyType>
+MapBenchmarkResult Measure(int size, const KeyType* keys, const KeyType* missingKeys,
+   size_t (*hashFunction)(const KeyType&), bool (*keysEqualFunction)(const KeyType&, const KeyType&),
+   bool (*comparator)(const KeyType&, const KeyType&))
+{
+   int repeatCount = std::max(1, MAP_BENCHMARK_OPERATION_COUNT / size);
+   double operationCount = (double)repeatCount * (double)size;
+   double addTime = 0.0;
+   double findTime = 0.0;
+   double findMissingTime = 0.0;
+   double iterateTime = 0.0;
+   double removeTime = 0.0;
+   int checksum = 0;
+
+   for(int repeatIndex = 0; repeatIndex < repeatCount; repeatIndex++)
+   {
+      CollectionType collection;
+      CollectionInit(&collection, hashFunction, keysEqualFunction, comparator);
+
+      BenchmarkTimer timer;
+      for(int keyIndex = 0; keyIndex < size; keyIndex++)
+         collection.Add(keys[keyIndex], keyIndex);
+      addTime += timer.SecondsGet();
+
+      timer.Start();
+      for(int keyIndex = 0; keyIndex < size; keyIndex++)
+         checksum += collection.Find(keys[keyIndex]).Value();
+      findTime += timer.SecondsGet();
+
+      timer.Start();
+      for(int keyIndex = 0; keyIndex < size; keyIndex++)
+         checksum += collection.Find(missingKeys[keyIndex]).WithinCheck() ? 1 : 0;
+      findMissingTime += timer.SecondsGet();
+
+      timer.Start();
+      for(typename CollectionType::Iterator iterator = collection.Begin(); iterator.WithinCheck(); iterator.Next())
+         checksum += iterator.Value();
+      iterateTime += timer.SecondsGet();
+
+      timer.Start();
+      for(int keyIndex = 0; keyIndex < size; keyIndex++)
+         collection.Remove(keys[keyIndex]);
+      removeTime += timer.SecondsGet();
+
+      collection.Deinit();
+   }
+
+   // Keep the compiler from discarding the lookups.
+   mapBenchmarkChecksum += checksum;
+
+   MapBenchmarkResult result;
+   result.add = addTime * 1e9 / operationCount;
+   result.find = findTime * 1e9 / operationCount;
+   result.findMissing = findMissingTime * 1e9 / operationCount;
+   result.iterate = iterateTime * 1e9 / operationCount;
+   result.remove = removeTime * 1e9 / operationCount;
+   return result;
+}
+
+//------------------------------------------------------------------------------
+
+/// Print one row of results.
+static void ResultPrint(const char* collectionName, int size, const MapBenchmarkResult& result)
+{
+   printf("%-12s %8d %10.1f %10.1f %10.1f %10.1f %10.1f\n", collectionName, size,
+      result.add, result.find, result.findMissing, result.iterate, result.remove);
+}
+
+//------------------------------------------------------------------------------
+
+/// Measure each kind of collection at each size with the given keys.
+template<typename KeyType>
+void SuiteRun(const char* keyDescription, const KeyType* keys, const KeyType* missingKeys,
+   size_t (*hashFunction)(const KeyType&), bool (*keysEqualFunction)(const KeyType&, const KeyType&),
+   bool (*comparator)(const KeyType&, const KeyType&))
+{
+   printf("\n%s keys, ns per operation\n", keyDescription);
+   printf("%-12s %8s %10s %10s %10s %10s %10s\n", "", "Size", "Add", "Find", "FindMissing", "Iterate", "Remove");
+   for(int size = MAP_BENCHMARK_SIZE_MIN; size <= MAP_BENCHMARK_SIZE_MAX; size *= 10)
+   {
+      ResultPrint("Map", size, Measure<Map<KeyType, int> >(size, keys, missingKeys,
+         hashFunction, keysEqualFunction, comparator));
+      ResultPrint("HashTable", size, Measure<HashTable<KeyType, int> >(size, keys, missingKeys,
+         hashFunction, keysEqualFunction, comparator));
+      ResultPrint("FlatHashMap", size, Measure<FlatHashMap<KeyType, int> >(size, keys, missingKeys,
+         hashFunction, keysEqualFunction, comparator));
+   }
+}
+
+//------------------------------------------------------------------------------
+
+int main()
+{
+   // Shuffle the integer keys so they aren't added in order.  The missing
+   // keys are all negative.
+   int* intKeys = (int*)malloc(sizeof(int) * MAP_BENCHMARK_SIZE_MAX);
+   int* intMissingKeys = (int*)malloc(sizeof(int) * MAP_BENCHMARK_SIZE_MAX);
+   unsigned int random = 12345;
+   for(int keyIndex = 0; keyIndex < MAP_BENCHMARK_SIZE_MAX; keyIndex++)
+   {
+      intKeys[keyIndex] = keyIndex;
+      intMissingKeys[keyIndex] = -1 - keyIndex;
+   }
+   for(int keyIndex = MAP_BENCHMARK_SIZE_MAX - 1; keyIndex > 0; keyIndex--)
+   {
+      random = random * 1103515245 + 12345;
+      int otherIndex = (int)((random >> 8) % (unsigned int)(keyIndex + 1));
+      SwapByCopy(intKeys[keyIndex], intKeys[otherIndex]);
+   }
+
+   // String keys look like the filenames used for resources.
+   char* stringKeyData = (char*)malloc(MAP_BENCHMARK_STRING_KEY_LENGTH * MAP_BENCHMARK_SIZE_MAX * 2);
+   const char** stringKeys = (const char**)malloc(sizeof(const char*) * MAP_BENCHMARK_SIZE_MAX);
+   const char** stringMissingKeys = (const char**)malloc(sizeof(const char*) * MAP_BENCHMARK_SIZE_MAX);
+   for(int keyIndex = 0; keyIndex < MAP_BENCHMARK_SIZE_MAX; keyIndex++)
+   {
+      char* key = &stringKeyData[keyIndex * 2 * MAP_BENCHMARK_STRING_KEY_LENGTH];
+      char* missingKey = key + MAP_BENCHMARK_STRING_KEY_LENGTH;
+      FrogSnprintf(key, MAP_BENCHMARK_STRING_KEY_LENGTH, "Sprites/Level%d/Frame%d", intKeys[keyIndex] % 97, intKeys[keyIndex]);
+      FrogSnprintf(missingKey, MAP_BENCHMARK_STRING_KEY_LENGTH, "Sounds/Level%d/Clip%d", keyIndex % 97, keyIndex);
+      stringKeys[keyIndex] = key;
+      stringMissingKeys[keyIndex] = missingKey;
+   }
+
+   printf("MapBenchmark");
+   SuiteRun<int>("Integer", intKeys, intMissingKeys, IntHash, IntsEqualCheck, MapComparatorDefault<int>);
+   SuiteRun<const char*>("String", stringKeys, stringMissingKeys, StringHash, StringsEqualCheck, StringComparator);
+
+   free(stringMissingKeys);
+   free(stringKeys);
+   free(stringKeyData);
+   free(intMissingKeys);
+   free(intKeys);
+   return 0;
+}
@@ -0,0 +1,214 @@
+/// ParticleBenchmark compares updating Particle2D objects one at a time, the
+/// way ParticleEffectEmitter2D does, with updating a ParticleSystemSoA2D in
+/// bulk, the way ParticleEffectEmitterSoA2D does.  Both apply the same motion
+/// along with the changes made by the ColorLinear2D,
+/// AdditiveBlendingLinear2D, and ScaleSplineLinear2D emitter modifiers.  It
+/// measures 1k, 10k, and 100k particles.  Smaller systems are updated more
+/// times so each measurement covers about the same number of particle
+/// updates.  Nothing is drawn.
+///
+/// Build it as a console program linked with the Frog library.  Times are in
+/// nanoseconds per particle per update.
+
+#include <stdio.h>
+#include "FrogMemory.h"
+#include "Table.h"
+#include "Color.h"
+#include "Progression.h"
+#include "SplineLinear.h"
+#include "Particle2D.h"
+#include "ParticleSystemSoA2D.h"
+#include "BenchmarkTimer.h"
+
+using namespace Webfoot;
+
+/// Smallest number of particles to measure.
+#define PARTICLE_BENCHMARK_COUNT_MIN 1000
+/// Largest number of particles to measure.
+#define PARTICLE_BENCHMARK_COUNT_MAX 100000
+/// Approximate number of particle updates for each measurement.
+#define PARTICLE_BENCHMARK_UPDATE_COUNT 10000000
+/// Milliseconds per update.
+#define PARTICLE_BENCHMARK_DT 16
+
+//==============================================================================
+
+/// Settings shared by both kinds of particles.
+struct ParticleBenchmarkSettings
+{
+   ColorRGBA8 colorBegin;
+   ColorRGBA8 colorEnd;
+   float additiveBlendingBegin;
+   float additiveBlendingEnd;
+   /// Scale over each particle's life, with times from 0 to 1000.
+   SplineLinear<Point2F> scaleSpline;
+   /// Life duration of each particle in milliseconds.  It's long enough that
+   /// none expire during a measurement.
+   int lifeDuration;
+};
+
+//==============================================================================
+
+/// Sum of the particle positions, so the updates can't be optimized away.
+static volatile float particleBenchmarkChecksum = 0.0f;
+
+//------------------------------------------------------------------------------
+
+/// Return a pseudorandom value in [min, max) and advance 'state'.
+static float RandomFloatGet(unsigned int* state, float min, float max)
+{
+   *state = *state * 1664525u + 1013904223u;
+   return min + (max - min) * (float)(*state >> 8) * (1.0f / 16777216.0f);
+}
+
+//------------------------------------------------------------------------------
+
+/// Return the number of updates to run for the given number of particles.
+static int UpdateCountGet(int particleCount)
+{
+   int updateCount = PARTICLE_BENCHMARK_UPDATE_COUNT / particleCount;
+   return (updateCount > 10) ? updateCount : 10;
+}
+
+//------------------------------------------------------------------------------
+
+/// Time Particle2D objects updated one at a time.
+static double ObjectsMeasure(int particleCount, ParticleBenchmarkSettings* settings)
+{
+   Table<Particle2D*> particles;
+   particles.Init(theAllocatorMallocFree);
+   particles.Reserve(particleCount);
+   unsigned int random = 12345;
+   for(int particleIndex = 0; particleIndex < particleCount; particleIndex++)
+   {
+      Particle2D* particle = frog_new Particle2D();
+      particle->Init();
+      particle->VelocitySet(Point2F::Create(RandomFloatGet(&random, -100.0f, 100.0f), RandomFloatGet(&random, -100.0f, 100.0f)));
+      particle->AccelerationSet(Point2F::Create(0.0f, 50.0f));
+      particle->AngularVelocitySet(RandomFloatGet(&random, -90.0f, 90.0f));
+      particle->LinearDampingSet(0.1f);
+      particle->LifeDurationSet(settings->lifeDuration);
+      particle->Activate();
+      particles.Add(particle);
+   }
+
+   int updateCount = UpdateCountGet(particleCount);
+   BenchmarkTimer timer;
+   timer.Start();
+   for(int updateIndex = 0; updateIndex < updateCount; updateIndex++)
+   {
+      for(int particleIndex = 0; particleIndex < particleCount; particleIndex++)
+      {
+         Particle2D* particle = particles[particleIndex];
+         particle->Update(PARTICLE_BENCHMARK_DT);
+         // This is what the emitter modifiers do for each particle.
+         float lifeFraction = (float)particle->AgeGet() / (float)particle->LifeDurationGet();
+         float t = theProgressionLinear->ValueGet(lifeFraction);
+         particle->ColorSet(Lerp(settings->colorBegin, settings->colorEnd, t));
+         particle->AdditiveBlendingSet(Lerp(settings->additiveBlendingBegin, settings->additiveBlendingEnd, t));
+         particle->ScaleSet(settings->scaleSpline.ValueGet(lifeFraction * 1000.0f));
+      }
+   }
+   double seconds = timer.SecondsGet();
+
+   float checksum = 0.0f;
+   for(int particleIndex = 0; particleIndex < particleCount; particleIndex++)
+   {
+      checksum += particles[particleIndex]->PositionGet().x;
+      particles[particleIndex]->Deinit();
+      frog_delete particles[particleIndex];
+   }
+   particleBenchmarkChecksum = particleBenchmarkChecksum + checksum;
+   particles.Deinit();
+   return seconds * 1.0e9 / ((double)updateCount * particleCount);
+}
+
+//------------------------------------------------------------------------------
+
+/// Time a ParticleSystemSoA2D updated in bulk.
+static double SystemMeasure(int particleCount, ParticleBenchmarkSettings* settings)
+{
+   ParticleSystemSoA2D particles;
+   particles.Init(particleCount);
+
+   ParticleModifierColorLinearSoA2D colorModifier;
+   colorModifier.Init(settings->colorBegin, settings->colorEnd, theProgressionLinear);
+   ParticleModifierAdditiveBlendingLinearSoA2D additiveBlendingModifier;
+   additiveBlendingModifier.Init(settings->additiveBlendingBegin, settings->additiveBlendingEnd, theProgressionLinear);
+   ParticleModifierScaleSplineLinearSoA2D scaleModifier;
+   scaleModifier.Init(&settings->scaleSpline, true);
+   ParticleModifierSoA2D* modifiers[] = { &colorModifier, &additiveBlendingModifier, &scaleModifier };
+   const int modifierCount = (int)(sizeof(modifiers) / sizeof(modifiers[0]));
+
+   unsigned int random = 12345;
+   for(int particleIndex = 0; particleIndex < particleCount; particleIndex++)
+   {
+      int index = particles.Add();
+      particles.velocityX[index] = RandomFloatGet(&random, -100.0f, 100.0f);
+      particles.velocityY[index] = RandomFloatGet(&random, -100.0f, 100.0f);
+      particles.accelerationY[index] = 50.0f;
+      particles.angularVelocity[index] = RandomFloatGet(&random, -90.0f, 90.0f);
+      particles.LinearDampingSet(index, 0.1f);
+      particles.lifeDuration[index] = settings->lifeDuration;
+      for(int modifierIndex = 0; modifierIndex < modifierCount; modifierIndex++)
+         modifiers[modifierIndex]->OnEmit(&particles, index);
+   }
+
+   int updateCount = UpdateCountGet(particleCount);
+   BenchmarkTimer timer;
+   timer.Start();
+   for(int updateIndex = 0; updateIndex < updateCount; updateIndex++)
+   {
+      int size = particles.SizeGet();
+      particles.Integrate(0, size, PARTICLE_BENCHMARK_DT);
+      for(int modifierIndex = 0; modifierIndex < modifierCount; modifierIndex++)
+         modifiers[modifierIndex]->Update(&particles, 0, size, PARTICLE_BENCHMARK_DT);
+      particles.ExpiredRemove();
+   }
+   double seconds = timer.SecondsGet();
+
+   float checksum = 0.0f;
+   for(int index = 0; index < particles.SizeGet(); index++)
+      checksum += particles.positionX[index];
+   particleBenchmarkChecksum = particleBenchmarkChecksum + checksum;
+   scaleModifier.Deinit();
+   particles.Deinit();
+   return seconds * 1.0e9 / ((double)updateCount * particleCount);
+}
+
+//------------------------------------------------------------------------------
+
+int main()
+{
+   ParticleBenchmarkSettings settings;
+   settings.colorBegin = ColorRGBA8::Create(255, 255, 255, 255);
+   settings.colorEnd = ColorRGBA8::Create(255, 64, 0, 0);
+   settings.additiveBlendingBegin = 1.0f;
+   settings.additiveBlendingEnd = 0.0f;
+   SplineLinearControlPoint<Point2F> scalePoints[3];
+   scalePoints[0].value = Point2F::Create(0.5f, 0.5f);
+   scalePoints[0].time = 0;
+   scalePoints[0].progression = theProgressionLinear;
+   scalePoints[1].value = Point2F::Create(2.0f, 2.0f);
+   scalePoints[1].time = 250;
+   scalePoints[1].progression = theProgressionLinear;
+   scalePoints[2].value = Point2F::Create(1.0f, 1.0f);
+   scalePoints[2].time = 1000;
+   scalePoints[2].progression = theProgressionLinear;
+   settings.scaleSpline.Init();
+   settings.scaleSpline.PointsAdd(scalePoints, 3);
+
+   printf("%10s %12s %12s %8s\n", "particles", "Particle2D", "SoA2D", "speedup");
+   for(int particleCount = PARTICLE_BENCHMARK_COUNT_MIN; particleCount <= PARTICLE_BENCHMARK_COUNT_MAX; particleCount *= 10)
+   {
+      // Make the particles live about twice as long as the measurement, so
+      // the modifiers cover the first half of their range.
+      settings.lifeDuration = UpdateCountGet(particleCount) * PARTICLE_BENCHMARK_DT * 2;
+      double objectsTime = ObjectsMeasure(particleCount, &settings);
+      double systemTime = SystemMeasure(particleCount, &settings);
+      printf("%10d %12.2f %12.2f %7.1fx\n", particleCount, objectsTime, systemTime, objectsTime / systemTime);
+   }
+
+   settings.scaleSpline.Deinit();
+   return 0;
+}
@@ -0,0 +1,187 @@
+/// ParticleUpdaterBenchmark measures how ParticleUpdaterThreaded2D scales
+/// from one core to all of them.  It builds a scene of many effects with
+/// several independent emitters each, and times updating it with 0 worker
+/// threads, then 1, and so on up to one fewer than the number of processors,
+/// since the calling thread works too.  Every run uses the same seed, so it
+/// also checks that the particles end up in the same places no matter how
+/// many threads there are.  Nothing is drawn.
+///
+/// Build it as a console program linked with the Frog library.  Times are in
+/// milliseconds per update.
+
+#include <stdio.h>
+#include "FrogMemory.h"
+#include "Table.h"
+#include "List.h"
+#include "Thread.h"
+#include "Particle2D.h"
+#include "ParticleEmitter2D.h"
+#include "ParticleEffect2D.h"
+#include "ParticleUpdaterThreaded2D.h"
+#include "BenchmarkTimer.h"
+
+using namespace Webfoot;
+
+/// Number of effects in the scene.
+#define PARTICLE_UPDATER_BENCHMARK_EFFECT_COUNT 64
+/// Number of emitters in each effect.
+#define PARTICLE_UPDATER_BENCHMARK_EMITTER_COUNT 4
+/// Number of particles in each emitter.
+#define PARTICLE_UPDATER_BENCHMARK_PARTICLE_COUNT 500
+/// Number of updates to time for each thread count.
+#define PARTICLE_UPDATER_BENCHMARK_UPDATE_COUNT 200
+/// Milliseconds per update.
+#define PARTICLE_UPDATER_BENCHMARK_DT 16
+
+//==============================================================================
+
+/// Emitter that releases particles from the origin with random velocities
+/// that live indefinitely, so the number of particles stays constant.
+class ParticleUpdaterBenchmarkEmitter : public ParticleEmitter2D
+{
+public:
+   virtual ~ParticleUpdaterBenchmarkEmitter() {}
+
+   virtual Particle2D* Emit()
+   {
+      Particle2D* particle = EmitHelper();
+      if(!particle)
+         return NULL;
+      particle->PositionSet(Point2F::Create(0.0f, 0.0f));
+      particle->VelocitySet(Point2F::Create(RandomF() * 200.0f - 100.0f, RandomF() * 200.0f - 100.0f));
+      particle->AccelerationSet(Point2F::Create(0.0f, 50.0f));
+      particle->AngularVelocitySet(RandomF() * 180.0f - 90.0f);
+      particle->LinearDampingSet(0.1f);
+      particle->LifeDurationSet(Particle2D::LIFE_DURATION_INDEFINITE);
+      particle->Activate();
+      return particle;
+   }
+};
+
+//==============================================================================
+
+/// Build the scene, add it to the given updater, and release every particle.
+static void SceneCreate(Table<ParticleEffect2D*>* effects, ParticleUpdaterThreaded2D* updater)
+{
+   for(int effectIndex = 0; effectIndex < PARTICLE_UPDATER_BENCHMARK_EFFECT_COUNT; effectIndex++)
+   {
+      ParticleEffect2D* effect = frog_new ParticleEffect2D();
+      effects->Add(effect);
+      effect->Init(PARTICLE_UPDATER_BENCHMARK_EMITTER_COUNT);
+      for(int emitterIndex = 0; emitterIndex < PARTICLE_UPDATER_BENCHMARK_EMITTER_COUNT; emitterIndex++)
+      {
+         ParticleUpdaterBenchmarkEmitter* emitter = frog_new ParticleUpdaterBenchmarkEmitter();
+         emitter->Init(PARTICLE_UPDATER_BENCHMARK_PARTICLE_COUNT);
+         emitter->EmissionFrequencySet(0.0f);
+         for(int particleIndex = 0; particleIndex < PARTICLE_UPDATER_BENCHMARK_PARTICLE_COUNT; particleIndex++)
+         {
+            Particle2D* particle = frog_new Particle2D();
+            particle->Init();
+            emitter->Add(particle);
+         }
+         effect->Add(emitter);
+      }
+      // Adding the effect gives the emitters their seeds, so this comes
+      // before anything is emitted.
+      updater->Add(effect, true);
+      for(int emitterIndex = 0; emitterIndex < PARTICLE_UPDATER_BENCHMARK_EMITTER_COUNT; emitterIndex++)
+      {
+         ParticleEmitter2D* emitter = effect->EmitterGet(emitterIndex);
+         for(int particleIndex = 0; particleIndex < PARTICLE_UPDATER_BENCHMARK_PARTICLE_COUNT; particleIndex++)
+            emitter->Emit();
+      }
+   }
+}
+
+//------------------------------------------------------------------------------
+
+/// Return the sum of the positions of all the particles in the scene.
+static double ChecksumGet(Table<ParticleEffect2D*>* effects)
+{
+   double checksum = 0.0;
+   for(int effectIndex = 0; effectIndex < effects->SizeGet(); effectIndex++)
+   {
+      ParticleEffect2D* effect = (*effects)[effectIndex];
+      for(int emitterIndex = 0; emitterIndex < effect->EmitterCountGet(); emitterIndex++)
+      {
+         List<Particle2D*>* particles = effect->EmitterGet(emitterIndex)->ActiveParticlesGet();
+         for(List<Particle2D*>::Iterator iterator = particles->Begin(); iterator.WithinCheck(); iterator.Next())
+         {
+            Point2F position = iterator.Value()->PositionGet();
+            checksum += position.x + position.y;
+         }
+      }
+   }
+   return checksum;
+}
+
+//------------------------------------------------------------------------------
+
+/// Time updating the scene with the given number of worker threads.  Return
+/// the time in milliseconds per update, and set 'checksum' to the sum of the
+/// particle positions afterward.
+static double Measure(int threadCount, double* checksum)
+{
+   ParticleUpdaterThreaded2D updater;
+   updater.Init(threadCount);
+   Table<ParticleEffect2D*> effects;
+   effects.Init(theAllocatorMallocFree);
+   SceneCreate(&effects, &updater);
+
+   // Let the threads start and the caches warm up before timing.
+   updater.Update(PARTICLE_UPDATER_BENCHMARK_DT);
+   BenchmarkTimer timer;
+   timer.Start();
+   for(int updateIndex = 0; updateIndex < PARTICLE_UPDATER_BENCHMARK_UPDATE_COUNT; updateIndex++)
+      updater.Update(PARTICLE_UPDATER_BENCHMARK_DT);
+   double seconds = timer.SecondsGet();
+   *checksum = ChecksumGet(&effects);
+
+   updater.Deinit();
+   for(int effectIndex = 0; effectIndex < effects.SizeGet(); effectIndex++)
+   {
+      effects[effectIndex]->Deinit();
+      frog_delete effects[effectIndex];
+   }
+   effects.Deinit();
+   return seconds * 1000.0 / PARTICLE_UPDATER_BENCHMARK_UPDATE_COUNT;
+}
+
+//------------------------------------------------------------------------------
+
+int main()
+{
+   int processorCount = Thread::ProcessorCountGet();
+   printf("ParticleUpdaterBenchmark -- %d effects, %d emitters each, %d particles per emitter, %d processors\n",
+      PARTICLE_UPDATER_BENCHMARK_EFFECT_COUNT, PARTICLE_UPDATER_BENCHMARK_EMITTER_COUNT,
+      PARTICLE_UPDATER_BENCHMARK_PARTICLE_COUNT, processorCount);
+   printf("%6s %12s %8s %11s\n", "cores", "ms/update", "speedup", "efficiency");
+
+   double baseTime = 0.0;
+   double baseChecksum = 0.0;
+   bool checksumsMatch = true;
+   for(int threadCount = 0; threadCount < processorCount; threadCount++)
+   {
+      double checksum = 0.0;
+      double time = Measure(threadCount, &checksum);
+      if(!threadCount)
+      {
+         baseTime = time;
+         baseChecksum = checksum;
+      }
+      else if(checksum != baseChecksum)
+      {
+         checksumsMatch = false;
+      }
+      int coreCount = threadCount + 1;
+      double speedup = baseTime / time;
+      printf("%6d %12.3f %7.2fx %10.0f%%\n", coreCount, time, speedup, speedup * 100.0 / coreCount);
+   }
+
+   if(!checksumsMatch)
+   {
+      printf("ParticleUpdaterBenchmark -- The particles ended up in different places with different numbers of threads.\n");
+      return 1;
+   }
+   return 0;
+}
@@ -0,0 +1,194 @@
+/// TableBenchmark compares the ways a Table can move its items when it grows,
+/// inserts, and removes.  The same payload is stored three ways:
+///
+/// - BenchmarkPayloadCopied has no move constructor, so every item is deep
+///   copied, which is how Table behaved before it was move-aware.
+/// - BenchmarkPayloadMoved can be moved, so items are moved instead.
+/// - BenchmarkPayloadRelocated is declared with TABLE_RELOCATABLE_DECLARE, so
+///   items are moved with memcpy and memmove.
+///
+/// Build it as a console program linked with the Frog library, then run it
+/// with an optional item count.  Times are in milliseconds.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "FrogMemory.h"
+#include "Table.h"
+#include "BenchmarkTimer.h"
+
+using namespace Webfoot;
+
+/// Number of bytes owned by each payload.
+#define BENCHMARK_PAYLOAD_SIZE 64
+/// Default number of items for the growth and removal tests.
+#define TABLE_BENCHMARK_ITEM_COUNT_DEFAULT 100000
+/// Number of items inserted at the front, which is quadratic.
+#define TABLE_BENCHMARK_FRONT_COUNT 4000
+
+//==============================================================================
+
+/// Item that owns a block of memory and has no move constructor.
+class BenchmarkPayloadCopied
+{
+public:
+   BenchmarkPayloadCopied() { buffer = (unsigned char*)malloc(BENCHMARK_PAYLOAD_SIZE); buffer[0] = 0; }
+   explicit BenchmarkPayloadCopied(int value) { buffer = (unsigned char*)malloc(BENCHMARK_PAYLOAD_SIZE); buffer[0] = (unsigned char)value; }
+   BenchmarkPayloadCopied(const BenchmarkPayloadCopied& other)
+   {
+      buffer = (unsigned char*)malloc(BENCHMARK_PAYLOAD_SIZE);
+      memcpy(buffer, other.buffer, BENCHMARK_PAYLOAD_SIZE);
+   }
+   ~BenchmarkPayloadCopied() { free(buffer); }
+   BenchmarkPayloadCopied& operator=(const BenchmarkPayloadCopied& other)
+   {
+      // The buffer is NULL if this was moved from.
+      if(!buffer)
+         buffer = (unsigned char*)malloc(BENCHMARK_PAYLOAD_SIZE);
+      memcpy(buffer, other.buffer, BENCHMARK_PAYLOAD_SIZE);
+      return *this;
+   }
+   int ValueGet() const { return buffer[0]; }
+
+protected:
+   /// Take ownership of the given buffer, which may be NULL.
+   explicit BenchmarkPayloadCopied(unsigned char* _buffer) { buffer = _buffer; }
+
+   unsigned char* buffer;
+};
+
+//==============================================================================
+
+/// Item that owns a block of memory and can be moved.
+class BenchmarkPayloadMoved : public BenchmarkPayloadCopied
+{
+public:
+   BenchmarkPayloadMoved() {}
+   explicit BenchmarkPayloadMoved(int value) : BenchmarkPayloadCopied(value) {}
+   BenchmarkPayloadMoved(const BenchmarkPayloadMoved& other) : BenchmarkPayloadCopied(other) {}
+   BenchmarkPayloadMoved& operator=(const BenchmarkPayloadMoved& other) { BenchmarkPayloadCopied::operator=(other); return *this; }
+#if TABLE_MOVE_SUPPORTED
+   BenchmarkPayloadMoved(BenchmarkPayloadMoved&& other) : BenchmarkPayloadCopied((unsigned char*)NULL) { SwapByCopy(buffer, other.buffer); }
+   BenchmarkPayloadMoved& operator=(BenchmarkPayloadMoved&& other) { SwapByCopy(buffer, other.buffer); return *this; }
+#endif
+};
+
+//==============================================================================
+
+/// Item that owns a block of memory and can be relocated with memcpy.
+class BenchmarkPayloadRelocated : public BenchmarkPayloadMoved
+{
+public:
+   BenchmarkPayloadRelocated() {}
+   explicit BenchmarkPayloadRelocated(int value) : BenchmarkPayloadMoved(value) {}
+};
+
+namespace Webfoot {
+TABLE_RELOCATABLE_DECLARE(BenchmarkPayloadRelocated)
+}
+
+//==============================================================================
+
+/// Add 'itemCount' items to the back of an empty Table without reserving.
+template<typename PayloadType>
+double GrowthTime(int itemCount)
+{
+   Table<PayloadType> table;
+   table.Init(theAllocatorMallocFree);
+   BenchmarkTimer timer;
+   for(int itemIndex = 0; itemIndex < itemCount; itemIndex++)
+      table.Add(PayloadType(itemIndex));
+   double seconds = timer.SecondsGet();
+   table.Deinit();
+   return seconds;
+}
+
+//------------------------------------------------------------------------------
+
+/// Construct 'itemCount' items in place at the back of an empty Table.
+template<typename PayloadType>
+double EmplaceTime(int itemCount)
+{
+   Table<PayloadType> table;
+   table.Init(theAllocatorMallocFree);
+   BenchmarkTimer timer;
+   for(int itemIndex = 0; itemIndex < itemCount; itemIndex++)
+      table.EmplaceBack(itemIndex);
+   double seconds = timer.SecondsGet();
+   table.Deinit();
+   return seconds;
+}
+
+//------------------------------------------------------------------------------
+
+/// Add 'itemCount' items to the front of a Table.
+template<typename PayloadType>
+double FrontInsertTime(int itemCount)
+{
+   Table<PayloadType> table;
+   table.Init(theAllocatorMallocFree);
+   BenchmarkTimer timer;
+   for(int itemIndex = 0; itemIndex < itemCount; itemIndex++)
+      table.AddFront(PayloadType(itemIndex));
+   double seconds = timer.SecondsGet();
+   table.Deinit();
+   return seconds;
+}
+
+//------------------------------------------------------------------------------
+
+/// Remove items from the middle of a Table of 'itemCount' items until it's
+/// empty, either preserving the order or not.
+template<typename PayloadType>
+double RemoveTime(int itemCount, bool unordered)
+{
+   Table<PayloadType> table;
+   table.Init(theAllocatorMallocFree);
+   table.Reserve(itemCount);
+   for(int itemIndex = 0; itemIndex < itemCount; itemIndex++)
+      table.EmplaceBack(itemIndex);
+   BenchmarkTimer timer;
+   while(table.SizeGet())
+   {
+      if(unordered)
+         table.RemoveIndexUnordered(table.SizeGet() / 2);
+      else
+         table.RemoveIndex(table.SizeGet() / 2);
+   }
+   double seconds = timer.SecondsGet();
+   table.Deinit();
+   return seconds;
+}
+
+//------------------------------------------------------------------------------
+
+/// Print one row of results.
+static void ResultPrint(const char* testName, double copied, double moved, double relocated)
+{
+   printf("%-28s %12.3f %12.3f %12.3f\n", testName, copied * 1000.0, moved * 1000.0, relocated * 1000.0);
+}
+
+//------------------------------------------------------------------------------
+
+int main(int argc, char** argv)
+{
+   int itemCount = (argc > 1) ? atoi(argv[1]) : TABLE_BENCHMARK_ITEM_COUNT_DEFAULT;
+   if(itemCount <= 0)
+      itemCount = TABLE_BENCHMARK_ITEM_COUNT_DEFAULT;
+   int removeCount = itemCount / 10;
+
+   printf("TableBenchmark -- %d items of %d bytes, times in ms\n", itemCount, BENCHMARK_PAYLOAD_SIZE);
+   printf("%-28s %12s %12s %12s\n", "", "Copied", "Moved", "Relocated");
+   ResultPrint("Add", GrowthTime<BenchmarkPayloadCopied>(itemCount),
+      GrowthTime<BenchmarkPayloadMoved>(itemCount), GrowthTime<BenchmarkPayloadRelocated>(itemCount));
+   ResultPrint("EmplaceBack", EmplaceTime<BenchmarkPayloadCopied>(itemCount),
+      EmplaceTime<BenchmarkPayloadMoved>(itemCount), EmplaceTime<BenchmarkPayloadRelocated>(itemCount));
+   ResultPrint("AddFront", FrontInsertTime<BenchmarkPayloadCopied>(TABLE_BENCHMARK_FRONT_COUNT),
+      FrontInsertTime<BenchmarkPayloadMoved>(TABLE_BENCHMARK_FRONT_COUNT),
+      FrontInsertTime<BenchmarkPayloadRelocated>(TABLE_BENCHMARK_FRONT_COUNT));
+   ResultPrint("RemoveIndex", RemoveTime<BenchmarkPayloadCopied>(removeCount, false),
+      RemoveTime<BenchmarkPayloadMoved>(removeCount, false), RemoveTime<BenchmarkPayloadRelocated>(removeCount, false));
+   ResultPrint("RemoveIndexUnordered", RemoveTime<BenchmarkPayloadCopied>(removeCount, true),
+      RemoveTime<BenchmarkPayloadMoved>(removeCount, true), RemoveTime<BenchmarkPayloadRelocated>(removeCount, true));
+   return 0;
+}
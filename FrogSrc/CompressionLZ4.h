@@ -0,0 +1,257 @@
+#ifndef __FROG__COMPRESSIONLZ4_H__
+#define __FROG__COMPRESSIONLZ4_H__
+
+#include <string.h>
+#include "FrogMemory.h"
+#include "Port.h"
+
+namespace Webfoot {
+
+// This file implements the LZ4 block format, which trades compression ratio
+// for very fast decompression.  Blocks produced here can be decompressed by
+// other LZ4 implementations and vice versa.  The frame format is not
+// supported, so the caller must keep track of the sizes of blocks.
+
+/// Number of bits in the hash used to find matches when compressing.
+/// Higher values find more matches but use more stack space.
+#define COMPRESSION_LZ4_HASH_BITS 12
+/// Shortest match the format can express.
+#define COMPRESSION_LZ4_MATCH_LENGTH_MIN 4
+/// The last match must start at least this many bytes before the end of the input.
+#define COMPRESSION_LZ4_MATCH_START_LIMIT 12
+/// The last this many bytes of the input are always stored as literals.
+#define COMPRESSION_LZ4_LAST_LITERALS 5
+/// Largest distance back to a match.
+#define COMPRESSION_LZ4_DISTANCE_MAX 65535
+
+//==============================================================================
+
+/// Return the largest number of bytes LZ4Compress can produce for an input of
+/// the given size.
+inline size_t LZ4CompressBoundGet(size_t sourceSize)
+{
+   return sourceSize + (sourceSize / 255) + 16;
+}
+
+//------------------------------------------------------------------------------
+
+/// \internal Write a length continuation as used by the LZ4 format.
+/// Return the new output position, or NULL if it doesn't fit.
+inline unsigned char* LZ4LengthWrite(unsigned char* output, unsigned char* outputEnd, size_t length)
+{
+   while(length >= 255)
+   {
+      if(output >= outputEnd)
+         return NULL;
+      *output++ = 255;
+      length -= 255;
+   }
+   if(output >= outputEnd)
+      return NULL;
+   *output++ = (unsigned char)length;
+   return output;
+}
+
+//------------------------------------------------------------------------------
+
+/// \internal Write one LZ4 sequence: the literals from 'literals' up to
+/// 'literalsEnd', followed by a match of 'matchLength' bytes 'distance' back.
+/// If 'matchLength' is 0, only write the literals, as for the last sequence.
+/// Return the new output position, or NULL if it doesn't fit.
+inline unsigned char* LZ4SequenceWrite(unsigned char* output, unsigned char* outputEnd,
+   const unsigned char* literals, const unsigned char* literalsEnd, size_t distance, size_t matchLength)
+{
+   size_t literalLength = literalsEnd - literals;
+   size_t matchCode = matchLength ? (matchLength - COMPRESSION_LZ4_MATCH_LENGTH_MIN) : 0;
+   if(output >= outputEnd)
+      return NULL;
+   unsigned char* token = output++;
+   *token = (unsigned char)(((literalLength >= 15) ? 15 : literalLength) << 4);
+   if(literalLength >= 15)
+   {
+      output = LZ4LengthWrite(output, outputEnd, literalLength - 15);
+      if(!output)
+         return NULL;
+   }
+   if((size_t)(outputEnd - output) < literalLength)
+      return NULL;
+   memcpy(output, literals, literalLength);
+   output += literalLength;
+
+   if(!matchLength)
+      return output;
+   if(outputEnd - output < 2)
+      return NULL;
+   *output++ = (unsigned char)(distance & 0xFF);
+   *output++ = (unsigned char)(distance >> 8);
+   *token |= (unsigned char)((matchCode >= 15) ? 15 : matchCode);
+   if(matchCode >= 15)
+      output = LZ4LengthWrite(output, outputEnd, matchCode - 15);
+   return output;
+}
+
+//------------------------------------------------------------------------------
+
+/// Compress 'sourceSize' bytes from 'source' into 'destination' as a single
+/// LZ4 block.  Return the size of the compressed data, or 0 if it would not
+/// fit in 'destinationCapacity' bytes.  A capacity of
+/// LZ4CompressBoundGet(sourceSize) is always enough.  The compressor is
+/// greedy and uses about 16KB of stack.
+inline size_t LZ4Compress(const void* source, size_t sourceSize, void* destination, size_t destinationCapacity)
+{
+   const unsigned char* input = (const unsigned char*)source;
+   const unsigned char* inputEnd = input + sourceSize;
+   unsigned char* output = (unsigned char*)destination;
+   unsigned char* outputEnd = output + destinationCapacity;
+   const unsigned char* anchor = input;
+
+   if(sourceSize > COMPRESSION_LZ4_MATCH_START_LIMIT)
+   {
+      uint32 hashTable[1 << COMPRESSION_LZ4_HASH_BITS];
+      memset(hashTable, 0, sizeof(hashTable));
+      const unsigned char* matchStartLimit = inputEnd - COMPRESSION_LZ4_MATCH_START_LIMIT;
+      const unsigned char* matchEndLimit = inputEnd - COMPRESSION_LZ4_LAST_LITERALS;
+      const unsigned char* position = input + 1;
+
+      while(position < matchStartLimit)
+      {
+         uint32 sequence;
+         memcpy(&sequence, position, sizeof(sequence));
+         uint32 hash = (sequence * 2654435761U) >> (32 - COMPRESSION_LZ4_HASH_BITS);
+         const unsigned char* match = input + hashTable[hash];
+         hashTable[hash] = (uint32)(position - input);
+
+         uint32 matchSequence;
+         memcpy(&matchSequence, match, sizeof(matchSequence));
+         if((match >= position) || ((size_t)(position - match) > COMPRESSION_LZ4_DISTANCE_MAX) || (matchSequence != sequence))
+         {
+            position++;
+            continue;
+         }
+
+         // Extend the match backward into the pending literals and forward
+         // as far as the format allows.
+         while((position > anchor) && (match > input) && (position[-1] == match[-1]))
+         {
+            position--;
+            match--;
+         }
+         size_t matchLength = COMPRESSION_LZ4_MATCH_LENGTH_MIN;
+         while((position + matchLength < matchEndLimit) && (position[matchLength] == match[matchLength]))
+            matchLength++;
+
+         output = LZ4SequenceWrite(output, outputEnd, anchor, position, (size_t)(position - match), matchLength);
+         if(!output)
+            return 0;
+         position += matchLength;
+         anchor = position;
+
+         // Remember a position inside the match to improve the next search.
+         if(position - 2 > input && position < matchStartLimit)
+         {
+            uint32 previousSequence;
+            memcpy(&previousSequence, position - 2, sizeof(previousSequence));
+            hashTable[(previousSequence * 2654435761U) >> (32 - COMPRESSION_LZ4_HASH_BITS)] = (uint32)(position - 2 - input);
+         }
+      }
+   }
+
+   output = LZ4SequenceWrite(output, outputEnd, anchor, inputEnd, 0, 0);
+   if(!output)
+      return 0;
+   return output - (unsigned char*)destination;
+}
+
+//------------------------------------------------------------------------------
+
+/// Decompress the LZ4 block of 'sourceSize' bytes at 'source' into exactly
+/// 'destinationSize' bytes at 'destination'.  Return true if successful and
+/// false if the data is malformed or doesn't decompress to exactly that size.
+/// Malformed data never causes reads or writes outside the given buffers.
+inline bool LZ4Decompress(const void* source, size_t sourceSize, void* destination, size_t destinationSize)
+{
+   const unsigned char* input = (const unsigned char*)source;
+   const unsigned char* inputEnd = input + sourceSize;
+   unsigned char* outputStart = (unsigned char*)destination;
+   unsigned char* output = outputStart;
+   unsigned char* outputEnd = output + destinationSize;
+
+   while(input < inputEnd)
+   {
+      unsigned char token = *input++;
+
+      // Copy the literals.
+      size_t literalLength = token >> 4;
+      if(literalLength == 15)
+      {
+         unsigned char lengthByte;
+         do
+         {
+            if(input >= inputEnd)
+               return false;
+            lengthByte = *input++;
+            literalLength += lengthByte;
+         } while(lengthByte == 255);
+      }
+      if(((size_t)(inputEnd - input) < literalLength) || ((size_t)(outputEnd - output) < literalLength))
+         return false;
+      memcpy(output, input, literalLength);
+      input += literalLength;
+      output += literalLength;
+
+      // The last sequence has no match.
+      if(input == inputEnd)
+         break;
+
+      // Copy the match.
+      if(inputEnd - input < 2)
+         return false;
+      size_t distance = (size_t)input[0] | ((size_t)input[1] << 8);
+      input += 2;
+      if(!distance || (distance > (size_t)(output - outputStart)))
+         return false;
+      size_t matchLength = token & 15;
+      if(matchLength == 15)
+      {
+         unsigned char lengthByte;
+         do
+         {
+            if(input >= inputEnd)
+               return false;
+            lengthByte = *input++;
+            matchLength += lengthByte;
+         } while(lengthByte == 255);
+      }
+      matchLength += COMPRESSION_LZ4_MATCH_LENGTH_MIN;
+      if((size_t)(outputEnd - output) < matchLength)
+         return false;
+      const unsigned char* match = output - distance;
+      if(distance >= matchLength)
+      {
+         memcpy(output, match, matchLength);
+         output += matchLength;
+      }
+      else
+      {
+         // The match overlaps the output, so copy it as repeats of the
+         // 'distance' bytes before it, which gets longer as it goes.
+         unsigned char* matchEnd = output + matchLength;
+         while(output < matchEnd)
+         {
+            size_t count = (size_t)(output - match);
+            if(count > (size_t)(matchEnd - output))
+               count = (size_t)(matchEnd - output);
+            memcpy(output, match, count);
+            output += count;
+         }
+      }
+   }
+
+   return output == outputEnd;
+}
+
+//------------------------------------------------------------------------------
+
+} //namespace Webfoot {
+
+#endif //#ifndef __FROG__COMPRESSIONLZ4_H__
@@ -0,0 +1,463 @@
+#ifndef __FROG__COOKEDCACHE_H__
+#define __FROG__COOKEDCACHE_H__
+
+#include <string.h>
+#include "FrogMemory.h"
+#include "Port.h"
+#include "Debug.h"
+#include "Allocator.h"
+#include "FrogString.h"
+#include "File.h"
+#include "FileManager.h"
+#include "JSONValue.h"
+#include "JSONParser.h"
+#include "BSONWriter.h"
+#include "Bitmap.h"
+#include "BitmapLoaderPNG.h"
+#include "BitmapManagerDefault.h"
+#include "SoundBuffer.h"
+#include "SoundBufferLoaderWAV.h"
+
+namespace Webfoot {
+
+//Number used to identify a cooked cache file
+#define COOKED_CACHE_SIGNATURE             0xC00CED01
+//Version of the cooked cache file format
+#define COOKED_CACHE_VERSION               2
+//Folder within the cache FileManager that holds the cooked files
+#define COOKED_CACHE_FOLDER                "Cooked"
+//Number of uint32 parameters stored with each cooked file
+#define COOKED_CACHE_PARAMETER_COUNT       4
+//Largest WAV data, in bytes, that SoundBufferLoad will cook
+#define COOKED_CACHE_SOUND_SIZE_MAX        (1024 * 1024)
+//Size of the buffers for source keys, which hold a root path and a source path
+#define COOKED_CACHE_SOURCE_KEY_SIZE       ((FROG_PATH_MAX+1) * 2)
+
+/// Kinds of cooked data.  Each kind has its own cached file for a given
+/// source file.
+enum CookedCacheKind
+{
+   /// JSON specifications converted to BSON.
+   COOKED_CACHE_KIND_SPECS = 1,
+   /// Decoded pixels from a PNG.
+   COOKED_CACHE_KIND_BITMAP = 2,
+   /// Decoded pixels from a PNG with premultiplied alpha.
+   COOKED_CACHE_KIND_BITMAP_PREMULTIPLIED = 3,
+   /// Decoded PCM samples from a WAV.
+   COOKED_CACHE_KIND_SOUND = 4,
+   /// Start of the values applications can use for their own kinds.
+   COOKED_CACHE_KIND_USER = 256
+};
+
+/// Versions of the built-in cooking code.  Increase these when the output of
+/// the corresponding loader changes to make older cooked files misses.
+#define COOKED_CACHE_SPECS_VERSION         1
+#define COOKED_CACHE_BITMAP_VERSION        1
+#define COOKED_CACHE_SOUND_VERSION         1
+
+#if __PRAGMA_PACK__
+#pragma pack (push, 1)
+#endif
+
+typedef struct __GCC_PACKED__
+        {
+        uint32 signature;
+        uint32 version;
+        uint32 kind;
+        uint32 kindVersion;
+        int64  sourceModificationTime;
+        uint64 dataSize;
+        uint32 pathLength;
+        uint32 parameters[COOKED_CACHE_PARAMETER_COUNT];
+        } COOKED_CACHE_HEADER;
+
+#if __PRAGMA_PACK__
+#pragma pack (pop)
+#endif
+
+//==============================================================================
+
+/// CookedCache keeps preprocessed versions of source files in theFilesCache,
+/// so later runs can skip parsing and decoding them.  Each cooked file is
+/// keyed by the root path of the source's FileManager, the source path, the
+/// source's modification time, the kind of cooking, and the version of the
+/// code that did the cooking.  If any of them differ, the cooked file is a
+/// miss and is replaced.  FileManagers without a root path are only told
+/// apart by the source path.
+///
+/// A hit costs a ModificationTimeGet on the source's FileManager, an
+/// ExistsCheck and an Open in the cache, and three reads: the header, the
+/// stored key, and the data, which is read directly into its final
+/// allocation.
+///
+/// The built-in kinds convert JSON specifications to BSON, PNGs to raw or
+/// premultiplied pixels, and short WAVs to PCM.  Other kinds can use
+/// DataLoad and DataSave with kinds from COOKED_CACHE_KIND_USER upward.
+///
+/// Sources on FileManagers that don't support ModificationTimeGet are never
+/// cached, since there would be no way to tell when they change.
+class CookedCache
+{
+public:
+   CookedCache() { cacheFileManager = NULL; }
+
+   /// Store cooked files in the given FileManager.  Make temporary
+   /// allocations from the given heap.
+   void Init(FileManager* _cacheFileManager = theFilesCache, HeapID _heapTempID = HEAP_TEMP);
+   void Deinit() { cacheFileManager = NULL; }
+
+   /// Return true if cooked files can be loaded and saved.
+   bool EnabledCheck() { return cacheFileManager != NULL; }
+
+   /// If the cache has data of the given kind and version for the given
+   /// source file, and the source hasn't been modified since, allocate space
+   /// for it from 'allocator', read it in, and return it.  Set 'dataSize' to
+   /// the size of the data.  If 'parameters' is specified, set it to the
+   /// parameters saved with the data.  Return NULL on a miss.
+   void* DataLoad(const char* sourceFilename, FileManager* sourceFileManager, uint32 kind,
+      uint32 kindVersion, size_t* dataSize, uint32* parameters = NULL, Allocator* allocator = theAllocatorDefault);
+   /// Save the given data as the cooked version of the given source file.
+   /// 'parameters' can hold up to COOKED_CACHE_PARAMETER_COUNT values to be
+   /// returned by DataLoad.  Return true if successful.
+   bool DataSave(const char* sourceFilename, FileManager* sourceFileManager, uint32 kind,
+      uint32 kindVersion, const void* data, size_t dataSize, const uint32* parameters = NULL);
+
+   /// Return the given JSON specifications as BSON data, which can be read in
+   /// place with a BSONIterator or loaded with BSONParser.  Do not include
+   /// the ".json" extension in the filename.  On a miss, the JSON is parsed
+   /// and the result is cooked.  Free the data with 'allocator'.  Return NULL
+   /// if unsuccessful.
+   void* SpecsLoad(const char* filename, FileManager* sourceFileManager, size_t* dataSize,
+      Allocator* allocator = theAllocatorDefault);
+   /// Load the given PNG, including the extension.  On a miss, the PNG is
+   /// decoded and the result is cooked.  If 'premultiplied' is true, the alpha
+   /// will be premultiplied.  The object will be allocated from 'objectHeap'
+   /// and the pixels from 'dataAllocator'.  When you're done with the
+   /// Bitmap, Deinit it and then delete it with frog_delete.  Return NULL if
+   /// unsuccessful.
+   Bitmap* BitmapLoad(const char* filename, FileManager* sourceFileManager, bool premultiplied = false,
+      Allocator* dataAllocator = theAllocatorBitmapData, HeapID objectHeap = HEAP_DEFAULT);
+   /// Load the given WAV, including the extension.  On a miss, the WAV is
+   /// decoded, and the result is cooked if it is no larger than
+   /// COOKED_CACHE_SOUND_SIZE_MAX.  The object will be allocated from
+   /// 'objectHeap' and the samples from 'dataAllocator'.  When you're done
+   /// with the SoundBuffer, Deinit it and then delete it with frog_delete.
+   /// Return NULL if unsuccessful.
+   SoundBuffer* SoundBufferLoad(const char* filename, FileManager* sourceFileManager,
+      Allocator* dataAllocator = theAllocatorDefault, HeapID objectHeap = HEAP_DEFAULT);
+
+   /// Singleton instance
+   static CookedCache* InstanceGet() { static CookedCache instance; return &instance; }
+
+protected:
+   /// Write the key that identifies the given source to 'buffer'.  This is
+   /// the root path of 'sourceFileManager' and 'sourceFilename' separated by
+   /// a '|'.  Return true if successful.
+   static bool SourceKeyGet(char* buffer, size_t bufferSize, const char* sourceFilename, FileManager* sourceFileManager);
+   /// Write the name of the cooked file for the given source key and kind to
+   /// 'buffer'.  Return true if successful.
+   bool CookedFilenameGet(char* buffer, size_t bufferSize, const char* sourceKey, uint32 kind);
+   /// Open the cooked file for the given source and check that it is a hit.
+   /// If so, set 'header' and return the file positioned at the start of the
+   /// data.  Otherwise, return NULL.
+   File* CookedOpen(const char* sourceFilename, FileManager* sourceFileManager, uint32 kind,
+      uint32 kindVersion, COOKED_CACHE_HEADER* header);
+   /// Return the 64-bit FNV-1a hash of the given string.
+   static uint64 PathHash(const char* path);
+
+   /// FileManager for the cooked files, or NULL if caching is disabled.
+   FileManager* cacheFileManager;
+   /// Heap for temporary allocations.
+   HeapID heapTempID;
+};
+
+/// Singleton instance
+static CookedCache* const theCookedCache = CookedCache::InstanceGet();
+
+//==============================================================================
+
+inline void CookedCache::Init(FileManager* _cacheFileManager, HeapID _heapTempID)
+{
+   cacheFileManager = _cacheFileManager;
+   heapTempID = _heapTempID;
+   if(cacheFileManager && !cacheFileManager->ExistsCheck(COOKED_CACHE_FOLDER))
+      cacheFileManager->FolderCreate(COOKED_CACHE_FOLDER, true);
+}
+
+//------------------------------------------------------------------------------
+
+inline void* CookedCache::DataLoad(const char* sourceFilename, FileManager* sourceFileManager, uint32 kind,
+   uint32 kindVersion, size_t* dataSize, uint32* parameters, Allocator* allocator)
+{
+   COOKED_CACHE_HEADER header;
+   File* file = CookedOpen(sourceFilename, sourceFileManager, kind, kindVersion, &header);
+   if(!file)
+      return NULL;
+
+   void* data = allocator->Allocate(header.dataSize ? (size_t)header.dataSize : 1);
+   if(data && (file->Read(data, (size_t)header.dataSize) != header.dataSize))
+   {
+      allocator->Deallocate(data);
+      data = NULL;
+   }
+   cacheFileManager->Close(file);
+   if(!data)
+      return NULL;
+
+   if(dataSize)
+      *dataSize = (size_t)header.dataSize;
+   if(parameters)
+      memcpy(parameters, header.parameters, sizeof(header.parameters));
+   return data;
+}
+
+//------------------------------------------------------------------------------
+
+inline bool CookedCache::DataSave(const char* sourceFilename, FileManager* sourceFileManager, uint32 kind,
+   uint32 kindVersion, const void* data, size_t dataSize, const uint32* parameters)
+{
+   assert(sourceFilename);
+   assert(sourceFileManager);
+   if(!cacheFileManager)
+      return false;
+   int64 sourceModificationTime = sourceFileManager->ModificationTimeGet(sourceFilename);
+   char sourceKey[COOKED_CACHE_SOURCE_KEY_SIZE];
+   char cookedFilename[FROG_PATH_MAX+1];
+   if(!sourceModificationTime || !SourceKeyGet(sourceKey, sizeof(sourceKey), sourceFilename, sourceFileManager)
+      || !CookedFilenameGet(cookedFilename, sizeof(cookedFilename), sourceKey, kind))
+   {
+      return false;
+   }
+
+   COOKED_CACHE_HEADER header;
+   header.signature = COOKED_CACHE_SIGNATURE;
+   header.version = COOKED_CACHE_VERSION;
+   header.kind = kind;
+   header.kindVersion = kindVersion;
+   header.sourceModificationTime = sourceModificationTime;
+   header.dataSize = dataSize;
+   header.pathLength = (uint32)strlen(sourceKey);
+   if(parameters)
+      memcpy(header.parameters, parameters, sizeof(header.parameters));
+   else
+      memset(header.parameters, 0, sizeof(header.parameters));
+
+   File* file = cacheFileManager->Open(cookedFilename, FileManager::WRITE, heapTempID);
+   if(!file)
+      return false;
+   bool success = (file->Write(header) == sizeof(header))
+      && (file->Write(sourceKey, header.pathLength) == header.pathLength)
+      && (file->Write(data, dataSize) == dataSize);
+   success = cacheFileManager->Close(file) && success;
+
+   // Don't leave a truncated file to be found later.
+   if(!success)
+      cacheFileManager->FileRemove(cookedFilename);
+   return success;
+}
+
+//------------------------------------------------------------------------------
+
+inline void* CookedCache::SpecsLoad(const char* filename, FileManager* sourceFileManager, size_t* dataSize,
+   Allocator* allocator)
+{
+   char sourceFilename[FROG_PATH_MAX+1];
+   if(!FrogSnprintf(sourceFilename, sizeof(sourceFilename), "%s.json", filename))
+      return NULL;
+   void* data = DataLoad(sourceFilename, sourceFileManager, COOKED_CACHE_KIND_SPECS, COOKED_CACHE_SPECS_VERSION,
+      dataSize, NULL, allocator);
+   if(data || !cacheFileManager)
+      return data;
+
+   // On a miss, write the BSON straight into the cooked file, then read it
+   // back like a hit.
+   JSONParser parser;
+   JSONValue* specifications = parser.Load(filename, sourceFileManager, heapTempID, heapTempID);
+   if(!specifications)
+      return NULL;
+   int64 sourceModificationTime = sourceFileManager->ModificationTimeGet(sourceFilename);
+   char sourceKey[COOKED_CACHE_SOURCE_KEY_SIZE];
+   char cookedFilename[FROG_PATH_MAX+1];
+   bool success = sourceModificationTime
+      && SourceKeyGet(sourceKey, sizeof(sourceKey), sourceFilename, sourceFileManager)
+      && CookedFilenameGet(cookedFilename, sizeof(cookedFilename), sourceKey, COOKED_CACHE_KIND_SPECS);
+   File* file = success ? cacheFileManager->Open(cookedFilename, FileManager::WRITE, heapTempID) : NULL;
+   if(file)
+   {
+      COOKED_CACHE_HEADER header;
+      memset(&header, 0, sizeof(header));
+      header.signature = COOKED_CACHE_SIGNATURE;
+      header.version = COOKED_CACHE_VERSION;
+      header.kind = COOKED_CACHE_KIND_SPECS;
+      header.kindVersion = COOKED_CACHE_SPECS_VERSION;
+      header.sourceModificationTime = sourceModificationTime;
+      header.pathLength = (uint32)strlen(sourceKey);
+      BSONWriter writer;
+      success = (file->Write(header) == sizeof(header))
+         && (file->Write(sourceKey, header.pathLength) == header.pathLength)
+         && writer.Save(file, specifications);
+      int64 dataEnd = file->Tell();
+      header.dataSize = (uint64)(dataEnd - (int64)(sizeof(header) + header.pathLength));
+      success = success && (dataEnd > 0) && file->Seek(0, File::FRONT) && (file->Write(header) == sizeof(header));
+      success = cacheFileManager->Close(file) && success;
+      if(!success)
+         cacheFileManager->FileRemove(cookedFilename);
+   }
+   specifications->Deinit();
+   frog_delete specifications;
+
+   if(!file || !success)
+      return NULL;
+   return DataLoad(sourceFilename, sourceFileManager, COOKED_CACHE_KIND_SPECS, COOKED_CACHE_SPECS_VERSION,
+      dataSize, NULL, allocator);
+}
+
+//------------------------------------------------------------------------------
+
+inline Bitmap* CookedCache::BitmapLoad(const char* filename, FileManager* sourceFileManager, bool premultiplied,
+   Allocator* dataAllocator, HeapID objectHeap)
+{
+   uint32 kind = premultiplied ? COOKED_CACHE_KIND_BITMAP_PREMULTIPLIED : COOKED_CACHE_KIND_BITMAP;
+   COOKED_CACHE_HEADER header;
+   File* file = CookedOpen(filename, sourceFileManager, kind, COOKED_CACHE_BITMAP_VERSION, &header);
+   if(file)
+   {
+      // parameters: format, width, height
+      Bitmap::Format format = (Bitmap::Format)header.parameters[0];
+      Point2I dimensions = Point2I::Create((int)header.parameters[1], (int)header.parameters[2]);
+      Bitmap* bitmap = NULL;
+      if((format >= 0) && (format < Bitmap::FORMAT_COUNT))
+         bitmap = theBitmaps->BitmapCreate(format, objectHeap);
+      bool success = bitmap && bitmap->Allocate(dimensions, format, dataAllocator)
+         && ((size_t)dimensions.x * dimensions.y * bitmap->BytesPerPixelGet() == header.dataSize)
+         && (file->Read(bitmap->DataGet(), (size_t)header.dataSize) == header.dataSize);
+      cacheFileManager->Close(file);
+      if(success)
+         return bitmap;
+      if(bitmap)
+      {
+         bitmap->Deinit();
+         frog_delete bitmap;
+      }
+   }
+
+   Bitmap* bitmap = theBitmapLoaderPNG->Load(filename, sourceFileManager, dataAllocator, objectHeap, heapTempID);
+   if(!bitmap)
+      return NULL;
+   if(premultiplied)
+      bitmap->PremultiplyAlpha();
+   uint32 parameters[COOKED_CACHE_PARAMETER_COUNT] = { (uint32)bitmap->FormatGet(), (uint32)bitmap->WidthGet(), (uint32)bitmap->HeightGet(), 0 };
+   DataSave(filename, sourceFileManager, kind, COOKED_CACHE_BITMAP_VERSION, bitmap->DataGet(),
+      (size_t)bitmap->WidthGet() * bitmap->HeightGet() * bitmap->BytesPerPixelGet(), parameters);
+   return bitmap;
+}
+
+//------------------------------------------------------------------------------
+
+inline SoundBuffer* CookedCache::SoundBufferLoad(const char* filename, FileManager* sourceFileManager,
+   Allocator* dataAllocator, HeapID objectHeap)
+{
+   COOKED_CACHE_HEADER header;
+   File* file = CookedOpen(filename, sourceFileManager, COOKED_CACHE_KIND_SOUND, COOKED_CACHE_SOUND_VERSION, &header);
+   if(file)
+   {
+      // parameters: format, channel count, length, sample rate
+      SoundBuffer* soundBuffer = frog_new_ex(objectHeap) SoundBuffer();
+      bool success = soundBuffer->Allocate((SoundBuffer::Format)header.parameters[0], (int)header.parameters[1],
+            (int)header.parameters[2], (int)header.parameters[3], dataAllocator)
+         && (soundBuffer->DataSizeBytesGet() == header.dataSize)
+         && (file->Read(soundBuffer->DataGet(), (size_t)header.dataSize) == header.dataSize);
+      cacheFileManager->Close(file);
+      if(success)
+         return soundBuffer;
+      soundBuffer->Deinit();
+      frog_delete soundBuffer;
+   }
+
+   SoundBuffer* soundBuffer = theSoundBufferLoaderWAV->Load(filename, sourceFileManager, dataAllocator, objectHeap, heapTempID);
+   if(soundBuffer && (soundBuffer->DataSizeBytesGet() <= COOKED_CACHE_SOUND_SIZE_MAX))
+   {
+      uint32 parameters[COOKED_CACHE_PARAMETER_COUNT] = { (uint32)soundBuffer->FormatGet(), (uint32)soundBuffer->ChannelCountGet(),
+         (uint32)soundBuffer->LengthGet(), (uint32)soundBuffer->SampleRateGet() };
+      DataSave(filename, sourceFileManager, COOKED_CACHE_KIND_SOUND, COOKED_CACHE_SOUND_VERSION, soundBuffer->DataGet(),
+         soundBuffer->DataSizeBytesGet(), parameters);
+   }
+   return soundBuffer;
+}
+
+//------------------------------------------------------------------------------
+
+inline bool CookedCache::SourceKeyGet(char* buffer, size_t bufferSize, const char* sourceFilename, FileManager* sourceFileManager)
+{
+   return FrogSnprintf(buffer, bufferSize, "%s|%s", sourceFileManager->RootPathGet(), sourceFilename);
+}
+
+//------------------------------------------------------------------------------
+
+inline bool CookedCache::CookedFilenameGet(char* buffer, size_t bufferSize, const char* sourceKey, uint32 kind)
+{
+   // The key itself is stored in the file to catch hash collisions.
+   uint64 hash = PathHash(sourceKey);
+   return FrogSnprintf(buffer, bufferSize, "%s/%08X%08X.%u", COOKED_CACHE_FOLDER,
+      (unsigned int)(hash >> 32), (unsigned int)(hash & 0xFFFFFFFF), (unsigned int)kind);
+}
+
+//------------------------------------------------------------------------------
+
+inline File* CookedCache::CookedOpen(const char* sourceFilename, FileManager* sourceFileManager, uint32 kind,
+   uint32 kindVersion, COOKED_CACHE_HEADER* header)
+{
+   assert(sourceFilename);
+   assert(sourceFileManager);
+   if(!cacheFileManager)
+      return NULL;
+   int64 sourceModificationTime = sourceFileManager->ModificationTimeGet(sourceFilename);
+   char sourceKey[COOKED_CACHE_SOURCE_KEY_SIZE];
+   char cookedFilename[FROG_PATH_MAX+1];
+   if(!sourceModificationTime || !SourceKeyGet(sourceKey, sizeof(sourceKey), sourceFilename, sourceFileManager)
+      || !CookedFilenameGet(cookedFilename, sizeof(cookedFilename), sourceKey, kind))
+   {
+      return NULL;
+   }
+   if(!cacheFileManager->ExistsCheck(cookedFilename))
+      return NULL;
+   File* file = cacheFileManager->Open(cookedFilename, FileManager::READ, heapTempID);
+   if(!file)
+      return NULL;
+
+   size_t pathLength = strlen(sourceKey);
+   char path[COOKED_CACHE_SOURCE_KEY_SIZE];
+   bool hit = (file->Read(*header) == sizeof(*header))
+      && (header->signature == COOKED_CACHE_SIGNATURE)
+      && (header->version == COOKED_CACHE_VERSION)
+      && (header->kind == kind)
+      && (header->kindVersion == kindVersion)
+      && (header->sourceModificationTime == sourceModificationTime)
+      && (header->pathLength == pathLength)
+      && (pathLength < sizeof(path))
+      && (file->Read(path, pathLength) == pathLength)
+      && !memcmp(path, sourceKey, pathLength)
+      && (header->dataSize == (uint64)(file->SizeGet() - (int64)(sizeof(*header) + pathLength)));
+   if(!hit)
+   {
+      cacheFileManager->Close(file);
+      return NULL;
+   }
+   return file;
+}
+
+//------------------------------------------------------------------------------
+
+inline uint64 CookedCache::PathHash(const char* path)
+{
+   uint64 hash = 14695981039346656037ULL;
+   for(; *path; path++)
+      hash = (hash ^ (unsigned char)*path) * 1099511628211ULL;
+   return hash;
+}
+
+//------------------------------------------------------------------------------
+
+} //namespace Webfoot {
+
+#endif //#ifndef __FROG__COOKEDCACHE_H__
@@ -8,6 +8,8 @@
 
 namespace Webfoot {
 
+class StringAtom;
+
 /// Default priority to use for event handlers.
 const int EVENT_PRIORITY_DEFAULT = 0;
 
@@ -94,6 +96,11 @@ protected:
 ///    EventID updateEvent("Update");
 ///    theEvents->Trigger(&updateEvent);
 ///
+/// Events can also be referred to by a StringAtom, which avoids hashing the
+/// name each time.  Include EventManagerAtoms.h to use those overloads.
+///    StringAtom updateAtom = theStringAtoms->AtomGet(StringAtomHash("Update"));
+///    theEvents->Trigger(updateAtom);
+///
 /// You can use the Register function to register a method or a function
 /// for a particular event.
 ///    theEvents->Register("Update", Update);
@@ -163,6 +170,11 @@ public:
    /// Clean up the effects of Reserve.
    void Unreserve(const EventID* eventID);
 
+   /// Same as the other Reserve and Unreserve, but identify the event by a
+   /// StringAtom.  These are defined in EventManagerAtoms.h.
+   inline void Reserve(StringAtom eventName, int reserveCount);
+   inline void Unreserve(StringAtom eventName);
+
    /// Register a function or method to receive calls for the given event.
 
    template<typename R> inline EventRegistration* Register(const char* eventName,
@@ -201,6 +213,26 @@ public:
    template<typename T, typename R> inline EventRegistration* Register(const EventID* eventID,
       T* object, R (T::*method)(void* userData, const EventRegistration* eventRegistration), int priority = EVENT_PRIORITY_DEFAULT);
 
+   /// Same as the other Register functions, but identify the event by a
+   /// StringAtom.  These are defined in EventManagerAtoms.h.
+   template<typename R> inline EventRegistration* Register(StringAtom eventName,
+      R (*function)(), int priority = EVENT_PRIORITY_DEFAULT);
+   template<typename R> inline EventRegistration* Register(StringAtom eventName,
+      R (*function)(void* userData), int priority = EVENT_PRIORITY_DEFAULT);
+   template<typename R> inline EventRegistration* Register(StringAtom eventName,
+      R (*function)(const EventRegistration* eventRegistration), int priority = EVENT_PRIORITY_DEFAULT);
+   template<typename R> inline EventRegistration* Register(StringAtom eventName,
+      R (*function)(void* userData, const EventRegistration* eventRegistration), int priority = EVENT_PRIORITY_DEFAULT);
+
+   template<typename T, typename R> inline EventRegistration* Register(StringAtom eventName,
+      T* object, R (T::*method)(), int priority = EVENT_PRIORITY_DEFAULT);
+   template<typename T, typename R> inline EventRegistration* Register(StringAtom eventName,
+      T* object, R (T::*method)(void* userData), int priority = EVENT_PRIORITY_DEFAULT);
+   template<typename T, typename R> inline EventRegistration* Register(StringAtom eventName,
+      T* object, R (T::*method)(const EventRegistration* eventRegistration), int priority = EVENT_PRIORITY_DEFAULT);
+   template<typename T, typename R> inline EventRegistration* Register(StringAtom eventName,
+      T* object, R (T::*method)(void* userData, const EventRegistration* eventRegistration), int priority = EVENT_PRIORITY_DEFAULT);
+
    /// If passed a handler object or function, all registrations for that handler
    /// will be unregistered.
    template<typename T> inline void Unregister(T handler)
@@ -225,6 +257,9 @@ public:
    {
       UnregisterHandlerHelper(eventID, (void*)handler);
    }
+   /// Unregister the given listener function or object from the given event.
+   /// This is defined in EventManagerAtoms.h.
+   template<typename T> inline void Unregister(StringAtom eventName, T handler);
 
    /// Call all listeners for the given event in descending order of priority.
    /// 'userData' will be passed to listeners that accept it.
@@ -250,6 +285,16 @@ public:
    /// If a listener returned non-zero, return that value here.  If not, return zero.
    int TriggerWithEarlyOut(const EventID* eventID, void* userData = NULL);
 
+   /// Same as the other Trigger and TriggerWithEarlyOut, but identify the
+   /// event by a StringAtom.  These are defined in EventManagerAtoms.h.
+   inline void Trigger(StringAtom eventName, void* userData = NULL);
+   inline int TriggerWithEarlyOut(StringAtom eventName, void* userData = NULL);
+
+   /// Return an EventID for the event with the given name.  Its hash is
+   /// looked up by the atom's ID rather than computed from the name, and its
+   /// name is the interned string.  This is defined in EventManagerAtoms.h.
+   static inline EventID EventIDGet(StringAtom eventName);
+
    /// Schedule the given event to be triggered on the first EventManager
    /// Update on or after the given time. 'eventTime' should correspond to
    /// a value to be expected from theClick->TickCountGet().
@@ -0,0 +1,163 @@
+#ifndef __FROG__EVENTMANAGERATOMS_H__
+#define __FROG__EVENTMANAGERATOMS_H__
+
+#include "FrogMemory.h"
+#include "Table.h"
+#include "StringAtom.h"
+#include "EventManager.h"
+
+namespace Webfoot {
+
+//=============================================================================
+
+/// \internal Cache of EventID hashes by StringAtom ID, so EventIDs can be
+/// made from atoms without walking the name.  The name is cached too, in
+/// case the atoms were freed and handed out again for other strings.  Like
+/// EventManager, this is not thread-safe.
+class EventAtomHashCache
+{
+public:
+   EventAtomHashCache() { entries.Init(theAllocatorMallocFree); }
+
+   /// Return the EventID hash for the given atom.
+   unsigned HashGet(StringAtom atom, const char* name)
+   {
+      int index = (int)atom.IDGet();
+      if(index >= entries.SizeGet())
+      {
+         Entry emptyEntry;
+         emptyEntry.name = NULL;
+         emptyEntry.hash = 0;
+         entries.Reserve(index + 1);
+         while(entries.SizeGet() <= index)
+            entries.Add(emptyEntry);
+      }
+      Entry& entry = entries[index];
+      if(entry.name != name)
+      {
+         entry.name = name;
+         entry.hash = EventID::GetHash(name);
+      }
+      return entry.hash;
+   }
+
+   /// Return the shared instance.
+   static EventAtomHashCache* InstanceGet()
+   {
+      static EventAtomHashCache instance;
+      return &instance;
+   }
+
+protected:
+   /// Cached hash of one atom.
+   struct Entry
+   {
+      /// Interned name when the hash was computed.
+      const char* name;
+      /// EventID hash of 'name'.
+      unsigned hash;
+   };
+
+   /// Entries indexed by atom ID.
+   Table<Entry> entries;
+};
+
+//=============================================================================
+
+inline EventID EventManager::EventIDGet(StringAtom eventName)
+{
+   const char* name = eventName.StringGet();
+   return EventID(name, EventAtomHashCache::InstanceGet()->HashGet(eventName, name));
+}
+
+//-----------------------------------------------------------------------------
+
+inline void EventManager::Reserve(StringAtom eventName, int reserveCount)
+{
+   EventID eventID = EventIDGet(eventName);
+   Reserve(&eventID, reserveCount);
+}
+
+//-----------------------------------------------------------------------------
+
+inline void EventManager::Unreserve(StringAtom eventName)
+{
+   EventID eventID = EventIDGet(eventName);
+   Unreserve(&eventID);
+}
+
+//-----------------------------------------------------------------------------
+
+template<typename T> inline void EventManager::Unregister(StringAtom eventName, T handler)
+{
+   EventID eventID = EventIDGet(eventName);
+   UnregisterHandlerHelper(&eventID, (void*)handler);
+}
+
+//-----------------------------------------------------------------------------
+
+inline void EventManager::Trigger(StringAtom eventName, void* userData)
+{
+   EventID eventID = EventIDGet(eventName);
+   Trigger(&eventID, userData);
+}
+
+//-----------------------------------------------------------------------------
+
+inline int EventManager::TriggerWithEarlyOut(StringAtom eventName, void* userData)
+{
+   EventID eventID = EventIDGet(eventName);
+   return TriggerWithEarlyOut(&eventID, userData);
+}
+
+//-----------------------------------------------------------------------------
+
+template<typename R> inline EventRegistration* EventManager::Register(StringAtom eventName, R (*function)(), int priority)
+{
+   EventID eventID = EventIDGet(eventName);
+   return Register(&eventID, function, priority);
+}
+template<typename R> inline EventRegistration* EventManager::Register(StringAtom eventName, R (*function)(void*), int priority)
+{
+   EventID eventID = EventIDGet(eventName);
+   return Register(&eventID, function, priority);
+}
+template<typename R> inline EventRegistration* EventManager::Register(StringAtom eventName, R (*function)(const EventRegistration*), int priority)
+{
+   EventID eventID = EventIDGet(eventName);
+   return Register(&eventID, function, priority);
+}
+template<typename R> inline EventRegistration* EventManager::Register(StringAtom eventName, R (*function)(void*, const EventRegistration*), int priority)
+{
+   EventID eventID = EventIDGet(eventName);
+   return Register(&eventID, function, priority);
+}
+
+//-----------------------------------------------------------------------------
+
+template<typename T, typename R> inline EventRegistration* EventManager::Register(StringAtom eventName, T* object, R (T::*method)(), int priority)
+{
+   EventID eventID = EventIDGet(eventName);
+   return Register(&eventID, object, method, priority);
+}
+template<typename T, typename R> inline EventRegistration* EventManager::Register(StringAtom eventName, T* object, R (T::*method)(void*), int priority)
+{
+   EventID eventID = EventIDGet(eventName);
+   return Register(&eventID, object, method, priority);
+}
+template<typename T, typename R> inline EventRegistration* EventManager::Register(StringAtom eventName, T* object, R (T::*method)(const EventRegistration*), int priority)
+{
+   EventID eventID = EventIDGet(eventName);
+   return Register(&eventID, object, method, priority);
+}
+template<typename T, typename R> inline EventRegistration* EventManager::Register(StringAtom eventName, T* object, R (T::*method)(void*, const EventRegistration*), int priority)
+{
+   EventID eventID = EventIDGet(eventName);
+   return Register(&eventID, object, method, priority);
+}
+
+//=============================================================================
+
+} // namespace Webfoot {
+
+#endif //#ifndef __FROG__EVENTMANAGERATOMS_H__
@@ -22,17 +22,27 @@ struct EventID
       name = eventName;
       hash = GetHash(eventName);
    }
+   /// Use a hash that has already been computed with GetHash.  EventIDs that
+   /// share the same name pointer, like those made from StringAtoms in
+   /// EventManagerAtoms.h, are compared without comparing the strings.
+   EventID(const char* eventName, unsigned eventHash)
+   {
+      name = eventName;
+      hash = eventHash;
+   }
    
    bool operator< (const EventID& other) const
    {
       if(hash < other.hash) return true;
       if(other.hash < hash) return false;
+      if(name == other.name) return false;
       return strcmp(name, other.name) < 0; 
    }
 
    bool operator== (const EventID& other) const
    {
       if(hash != other.hash) return false;
+      if(name == other.name) return true;
       return strcmp(name, other.name) == 0; 
    }
 
@@ -0,0 +1,278 @@
+#ifndef __FROG__FILEARCHIVE_H__
+#define __FROG__FILEARCHIVE_H__
+
+#include <string.h>
+#include "FrogMemory.h"
+#include "Port.h"
+#include "Debug.h"
+#include "Table.h"
+#include "File.h"
+#include "CompressionLZ4.h"
+#include "zlib.h"
+
+namespace Webfoot {
+
+class FileManagerArchive;
+
+//Number used to identify an archive file
+#define FILE_ARCHIVE_SIGNATURE        0xF206A5C1
+//Version of the archive format written by FileArchiveWriter
+#define FILE_ARCHIVE_VERSION          1
+//Default size of the chunks entries are split into before compression
+#define FILE_ARCHIVE_CHUNK_SIZE_DEFAULT (256 * 1024)
+
+/// Ways the chunks of an archive entry can be stored.
+enum FileArchiveCodec
+{
+   /// Stored as-is.
+   FILE_ARCHIVE_CODEC_STORE,
+   /// LZ4 block format, which is fast to decompress.
+   FILE_ARCHIVE_CODEC_LZ4,
+   /// zlib format, which is smaller but slower to decompress.
+   FILE_ARCHIVE_CODEC_DEFLATE,
+   /// Number of codecs.
+   FILE_ARCHIVE_CODEC_COUNT
+};
+
+#if __PRAGMA_PACK__
+#pragma pack (push, 1)
+#endif
+
+typedef struct __GCC_PACKED__
+        {
+        uint32 signature;
+        uint32 version;
+        uint32 chunkSize;
+        uint32 entryCount;
+        uint32 chunkCount;
+        uint32 namesSize;
+        uint64 tablesOffset;
+        } FILE_ARCHIVE_HEADER;
+
+typedef struct __GCC_PACKED__
+        {
+        uint32 nameHash;
+        uint32 nameOffset;
+        uint64 size;
+        uint32 firstChunk;
+        uint32 chunkCount;
+        } FILE_ARCHIVE_ENTRY;
+
+typedef struct __GCC_PACKED__
+        {
+        uint64 offset;
+        uint32 compressedSize;
+        uchar  codec;
+        } FILE_ARCHIVE_CHUNK;
+
+#if __PRAGMA_PACK__
+#pragma pack (pop)
+#endif
+
+//==============================================================================
+
+/// Return the hash of the given entry name as stored in an archive.  This is
+/// the 32-bit FNV-1a hash of the bytes of the name.
+inline uint32 FileArchiveNameHash(const char* name)
+{
+   uint32 hash = 2166136261U;
+   for(; *name; name++)
+      hash = (hash ^ (unsigned char)*name) * 16777619U;
+   return hash;
+}
+
+//------------------------------------------------------------------------------
+
+/// Decompress a chunk of 'sourceSize' bytes stored with the given codec into
+/// exactly 'destinationSize' bytes.  Return true if successful.
+inline bool FileArchiveChunkDecompress(int codec, const void* source, size_t sourceSize,
+   void* destination, size_t destinationSize)
+{
+   switch(codec)
+   {
+      case FILE_ARCHIVE_CODEC_STORE:
+         if(sourceSize != destinationSize)
+            return false;
+         memcpy(destination, source, sourceSize);
+         return true;
+      case FILE_ARCHIVE_CODEC_LZ4:
+         return LZ4Decompress(source, sourceSize, destination, destinationSize);
+      case FILE_ARCHIVE_CODEC_DEFLATE:
+      {
+         uLongf decompressedSize = (uLongf)destinationSize;
+         return (uncompress((Bytef*)destination, &decompressedSize, (const Bytef*)source, (uLong)sourceSize) == Z_OK)
+            && (decompressedSize == destinationSize);
+      }
+      default:
+         return false;
+   }
+}
+
+//==============================================================================
+
+/// File that reads an entry of an archive opened by FileManagerArchive.
+/// Entries are split into chunks that are compressed separately, so seeking
+/// is free and reading only decompresses the chunks that are touched.  The
+/// most recently decompressed chunk is kept so small sequential reads don't
+/// decompress anything twice.  Chunks that are stored as-is are read
+/// straight into the caller's buffer.
+class FileArchive : public File
+{
+public:
+   FileArchive()
+   {
+      source = NULL;
+      chunks = NULL;
+      chunkSize = 0;
+      size = 0;
+      position = 0;
+      endFlag = false;
+      chunkCachedIndex = -1;
+   }
+   virtual ~FileArchive() {}
+
+   /// Read the given number of bytes from the file.
+   /// Return the number of bytes that were actually read.
+   virtual size_t Read(void* destination, size_t readLength);
+
+   /// Return the length of the file.
+   virtual int64 SizeGet() { return (int64)size; }
+
+   /// Return the current position in the file in bytes.
+   virtual int64 Tell() { return (int64)position; }
+
+   /// Seek to the given part of the file relative to the given origin.
+   /// Nothing is read or decompressed until the next Read.
+   /// Return true if successful.
+   virtual bool Seek(int64 seekOffset, FILE_ORIGIN origin)
+   {
+      int64 newPosition = seekOffset;
+      if(origin == CURRENT)
+         newPosition += (int64)position;
+      else if(origin == BACK)
+         newPosition += (int64)size;
+      if((newPosition < 0) || (newPosition > (int64)size))
+         return false;
+      position = (uint64)newPosition;
+      endFlag = false;
+      return true;
+   }
+
+   /// Return true if the end-of-file flag is set.  This happens
+   /// when you try to read past the end of the file.  The flag is
+   /// reset to false by calling Seek.
+   virtual bool EndCheck() { return endFlag; }
+
+   typedef File Inherited;
+
+protected:
+   /// Decompress the given chunk of this entry into 'chunkCached'.
+   /// Return true if successful.
+   bool ChunkLoad(int chunkIndex, size_t chunkLength);
+
+   /// File for the archive itself, opened only for this object.
+   File* source;
+   /// Chunks of this entry.
+   const FILE_ARCHIVE_CHUNK* chunks;
+   /// Uncompressed size of every chunk but the last.
+   size_t chunkSize;
+   /// Uncompressed length of the entry.
+   uint64 size;
+   /// Current position in the entry.
+   uint64 position;
+   /// True if a read went past the end of the file.
+   bool endFlag;
+   /// Index of the chunk in 'chunkCached', or -1 if there isn't one.
+   int chunkCachedIndex;
+   /// Most recently decompressed chunk.
+   Table<unsigned char> chunkCached;
+   /// Compressed data of the chunk being loaded.
+   Table<unsigned char> chunkCompressed;
+
+   friend class FileManagerArchive;
+};
+
+//==============================================================================
+
+inline size_t FileArchive::Read(void* destination, size_t readLength)
+{
+   uint64 available = size - position;
+   if((uint64)readLength > available)
+   {
+      readLength = (size_t)available;
+      endFlag = true;
+   }
+
+   unsigned char* output = (unsigned char*)destination;
+   size_t readTotal = 0;
+   while(readTotal < readLength)
+   {
+      int chunkIndex = (int)(position / chunkSize);
+      size_t chunkPosition = (size_t)(position % chunkSize);
+      uint64 chunkStart = (uint64)chunkIndex * chunkSize;
+      size_t chunkLength = ((size - chunkStart) < (uint64)chunkSize) ? (size_t)(size - chunkStart) : chunkSize;
+      size_t count = chunkLength - chunkPosition;
+      if(count > readLength - readTotal)
+         count = readLength - readTotal;
+
+      const FILE_ARCHIVE_CHUNK& chunk = chunks[chunkIndex];
+      if(chunk.codec == FILE_ARCHIVE_CODEC_STORE)
+      {
+         // A stored chunk must be exactly as long as its data, or the read
+         // would run into whatever follows it in the archive.
+         if(chunk.compressedSize != chunkLength)
+         {
+            WarningPrintf("FileArchive::Read -- Stored chunk %d has the wrong size.\n", chunkIndex);
+            endFlag = true;
+            break;
+         }
+         if(!source->Seek((int64)(chunk.offset + chunkPosition), FRONT)
+            || (source->Read(output + readTotal, count) != count))
+         {
+            endFlag = true;
+            break;
+         }
+      }
+      else
+      {
+         if(!ChunkLoad(chunkIndex, chunkLength))
+         {
+            endFlag = true;
+            break;
+         }
+         memcpy(output + readTotal, &chunkCached[(int)chunkPosition], count);
+      }
+      readTotal += count;
+      position += count;
+   }
+   return readTotal;
+}
+
+//------------------------------------------------------------------------------
+
+inline bool FileArchive::ChunkLoad(int chunkIndex, size_t chunkLength)
+{
+   if(chunkCachedIndex == chunkIndex)
+      return true;
+
+   const FILE_ARCHIVE_CHUNK& chunk = chunks[chunkIndex];
+   chunkCompressed.SizeSet((int)chunk.compressedSize);
+   chunkCached.SizeSet((int)chunkLength);
+   chunkCachedIndex = -1;
+   if(!source->Seek((int64)chunk.offset, FRONT)
+      || (source->Read(&chunkCompressed[0], chunk.compressedSize) != chunk.compressedSize)
+      || !FileArchiveChunkDecompress(chunk.codec, &chunkCompressed[0], chunk.compressedSize,
+         &chunkCached[0], chunkLength))
+   {
+      WarningPrintf("FileArchive::ChunkLoad -- Unable to read chunk %d.\n", chunkIndex);
+      return false;
+   }
+   chunkCachedIndex = chunkIndex;
+   return true;
+}
+
+//------------------------------------------------------------------------------
+
+} //namespace Webfoot {
+
+#endif //#ifndef __FROG__FILEARCHIVE_H__
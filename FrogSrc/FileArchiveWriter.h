@@ -0,0 +1,304 @@
+#ifndef __FROG__FILEARCHIVEWRITER_H__
+#define __FROG__FILEARCHIVEWRITER_H__
+
+#include <string.h>
+#include "FrogMemory.h"
+#include "Utility.h"
+#include "Debug.h"
+#include "Table.h"
+#include "File.h"
+#include "ThreadPool.h"
+#include "FileArchive.h"
+
+namespace Webfoot {
+
+/// Number of chunks FileArchiveWriter compresses at once per thread.  Higher
+/// values keep the threads busier but use more memory.
+#define FILE_ARCHIVE_WRITER_CHUNKS_PER_THREAD 4
+
+//==============================================================================
+
+/// FileArchiveWriter builds archives for FileManagerArchive.  A packer tool
+/// adds each entry with the codec it should be compressed with, then calls
+/// Write.  Chunks are compressed on all processors by a ThreadPool and
+/// written in order, so the output doesn't depend on the number of threads.
+/// A chunk that doesn't get smaller when compressed is stored as-is.
+///
+/// Use FILE_ARCHIVE_CODEC_LZ4 for data that is loaded often or read with
+/// many seeks, and FILE_ARCHIVE_CODEC_DEFLATE for data where size matters more
+/// than loading time.  Data that is already compressed, like PNG or Ogg
+/// files, should use FILE_ARCHIVE_CODEC_STORE.
+class FileArchiveWriter
+{
+public:
+   /// Prepare to collect entries that will be split into chunks of the given
+   /// uncompressed size.  Memory is drawn from the given heap.
+   void Init(size_t _chunkSize = FILE_ARCHIVE_CHUNK_SIZE_DEFAULT, HeapID _heapID = HEAP_DEFAULT)
+   {
+      assert(_chunkSize > 0);
+      chunkSize = _chunkSize;
+      heapID = _heapID;
+      entries.Init(theAllocatorHeaps[heapID]);
+   }
+
+   /// Clean up.
+   void Deinit()
+   {
+      for(int entryIndex = 0; entryIndex < entries.SizeGet(); entryIndex++)
+         StringDelete(entries[entryIndex].name);
+      entries.Deinit();
+   }
+
+   /// Add an entry with the given name and contents, to be compressed with
+   /// the given codec.  The data is not copied, so it must remain valid until
+   /// Write returns.  If more than one entry has the same name, the first one
+   /// is used.  Return true if successful.
+   bool Add(const char* name, const void* data, size_t size, FileArchiveCodec codec = FILE_ARCHIVE_CODEC_LZ4)
+   {
+      if(!name || (!data && size) || (codec < 0) || (codec >= FILE_ARCHIVE_CODEC_COUNT))
+         return false;
+      Entry entry;
+      entry.name = StringClone(name, heapID);
+      if(!entry.name)
+         return false;
+      entry.nameHash = FileArchiveNameHash(name);
+      entry.data = (const unsigned char*)data;
+      entry.size = size;
+      entry.codec = codec;
+      entry.order = entries.SizeGet();
+      entries.Add(entry);
+      return true;
+   }
+
+   /// Write the archive to the given file, which should be new and opened for
+   /// writing, since the header is written at the beginning of the file.
+   /// Compress on the given number of worker threads in addition to the
+   /// calling thread.  If 'threadCount' is negative, use all processors.
+   /// Return true if successful.
+   bool Write(File* file, int threadCount = -1);
+
+protected:
+   /// An entry to be written.
+   struct Entry
+   {
+      const char* name;
+      uint32 nameHash;
+      const unsigned char* data;
+      size_t size;
+      int codec;
+      /// Index of the entry in the order it was added.
+      int order;
+   };
+
+   /// A chunk to be compressed by a worker thread.
+   struct ChunkJob
+   {
+      /// Uncompressed data of the chunk.
+      const unsigned char* source;
+      /// Size of 'source' in bytes.
+      size_t sourceSize;
+      /// Codec requested for the chunk.
+      int codec;
+      /// Buffer for the compressed data.
+      unsigned char* output;
+      /// Size of 'output' in bytes.
+      size_t outputCapacity;
+      /// Codec actually used.  If this is FILE_ARCHIVE_CODEC_STORE, the chunk
+      /// should be written from 'source'.
+      int outputCodec;
+      /// Number of bytes of 'output' that were used.
+      size_t outputSize;
+   };
+
+   /// Compress the given ChunkJob.  This is called by the ThreadPool.
+   static void ChunkCompress(void* userData);
+   /// Comparator for sorting entries into the order of the entry table.
+   static bool EntryLessCheck(const Entry& a, const Entry& b)
+   {
+      if(a.nameHash != b.nameHash)
+         return a.nameHash < b.nameHash;
+      int nameComparison = strcmp(a.name, b.name);
+      if(nameComparison)
+         return nameComparison < 0;
+      return a.order < b.order;
+   }
+
+   /// Uncompressed size of every chunk but the last of each entry.
+   size_t chunkSize;
+   /// Heap used for the entries and temporary buffers.
+   HeapID heapID;
+   /// Entries added so far.
+   Table<Entry> entries;
+};
+
+//==============================================================================
+
+inline void FileArchiveWriter::ChunkCompress(void* userData)
+{
+   ChunkJob* job = (ChunkJob*)userData;
+   job->outputCodec = FILE_ARCHIVE_CODEC_STORE;
+   job->outputSize = job->sourceSize;
+
+   size_t compressedSize = 0;
+   if(job->codec == FILE_ARCHIVE_CODEC_LZ4)
+   {
+      compressedSize = LZ4Compress(job->source, job->sourceSize, job->output, job->outputCapacity);
+   }
+   else if(job->codec == FILE_ARCHIVE_CODEC_DEFLATE)
+   {
+      uLongf deflateSize = (uLongf)job->outputCapacity;
+      if(compress2(job->output, &deflateSize, job->source, (uLong)job->sourceSize, Z_DEFAULT_COMPRESSION) == Z_OK)
+         compressedSize = (size_t)deflateSize;
+   }
+
+   if(compressedSize && (compressedSize < job->sourceSize))
+   {
+      job->outputCodec = job->codec;
+      job->outputSize = compressedSize;
+   }
+}
+
+//------------------------------------------------------------------------------
+
+inline bool FileArchiveWriter::Write(File* file, int threadCount)
+{
+   assert(file);
+
+   // Sort the entries into the order of the entry table, and drop all but the
+   // first of any entries with the same name.
+   Table<Entry> sortedEntries;
+   sortedEntries.Init(entries, theAllocatorHeaps[heapID]);
+   sortedEntries.Sort(EntryLessCheck);
+   for(int entryIndex = sortedEntries.SizeGet() - 1; entryIndex > 0; entryIndex--)
+   {
+      if((sortedEntries[entryIndex].nameHash == sortedEntries[entryIndex - 1].nameHash)
+         && !strcmp(sortedEntries[entryIndex].name, sortedEntries[entryIndex - 1].name))
+      {
+         sortedEntries.RemoveIndex(entryIndex);
+      }
+   }
+
+   // Build the entry table, the names, and a job for each chunk.
+   Table<FILE_ARCHIVE_ENTRY> archiveEntries;
+   archiveEntries.Init(theAllocatorHeaps[heapID]);
+   Table<char> names;
+   names.Init(theAllocatorHeaps[heapID]);
+   Table<ChunkJob> jobs;
+   jobs.Init(theAllocatorHeaps[heapID]);
+   for(int entryIndex = 0; entryIndex < sortedEntries.SizeGet(); entryIndex++)
+   {
+      const Entry& entry = sortedEntries[entryIndex];
+      FILE_ARCHIVE_ENTRY archiveEntry;
+      archiveEntry.nameHash = entry.nameHash;
+      archiveEntry.nameOffset = (uint32)names.SizeGet();
+      archiveEntry.size = (uint64)entry.size;
+      archiveEntry.firstChunk = (uint32)jobs.SizeGet();
+      archiveEntry.chunkCount = (uint32)((entry.size + chunkSize - 1) / chunkSize);
+      archiveEntries.Add(archiveEntry);
+      names.AddCount(entry.name, (int)strlen(entry.name) + 1);
+
+      for(size_t chunkStart = 0; chunkStart < entry.size; chunkStart += chunkSize)
+      {
+         ChunkJob job;
+         job.source = entry.data + chunkStart;
+         job.sourceSize = ((entry.size - chunkStart) < chunkSize) ? (entry.size - chunkStart) : chunkSize;
+         job.codec = entry.codec;
+         job.output = NULL;
+         job.outputCapacity = 0;
+         job.outputCodec = FILE_ARCHIVE_CODEC_STORE;
+         job.outputSize = 0;
+         jobs.Add(job);
+      }
+   }
+
+   FILE_ARCHIVE_HEADER header;
+   header.signature = FILE_ARCHIVE_SIGNATURE;
+   header.version = FILE_ARCHIVE_VERSION;
+   header.chunkSize = (uint32)chunkSize;
+   header.entryCount = (uint32)archiveEntries.SizeGet();
+   header.chunkCount = (uint32)jobs.SizeGet();
+   header.namesSize = (uint32)names.SizeGet();
+   header.tablesOffset = 0;
+   bool success = file->Seek(0, File::FRONT) && (file->Write(header) == sizeof(header));
+
+   // Compress a batch of chunks at a time to limit the memory used for
+   // compressed data, and write each batch in order once it's done.  Buffers
+   // are allocated here rather than by the jobs, since heaps aren't
+   // necessarily thread-safe.
+   ThreadPool threadPool;
+   threadPool.Init(threadCount, heapID);
+   int batchSize = (threadPool.ThreadCountGet() + 1) * FILE_ARCHIVE_WRITER_CHUNKS_PER_THREAD;
+   size_t outputCapacity = LZ4CompressBoundGet(chunkSize);
+   if(outputCapacity < (size_t)compressBound((uLong)chunkSize))
+      outputCapacity = (size_t)compressBound((uLong)chunkSize);
+   Table<unsigned char*> outputs;
+   outputs.Init(theAllocatorHeaps[heapID]);
+   for(int outputIndex = 0; success && (outputIndex < batchSize) && (outputIndex < jobs.SizeGet()); outputIndex++)
+   {
+      unsigned char* output = (unsigned char*)FrogMallocEx(outputCapacity, heapID, FROG_MEM_ALIGN);
+      if(output)
+         outputs.Add(output);
+      else
+         success = false;
+   }
+
+   Table<FILE_ARCHIVE_CHUNK> archiveChunks;
+   archiveChunks.Init(theAllocatorHeaps[heapID]);
+   for(int batchStart = 0; success && (batchStart < jobs.SizeGet()); batchStart += batchSize)
+   {
+      int batchEnd = ((jobs.SizeGet() - batchStart) < batchSize) ? jobs.SizeGet() : (batchStart + batchSize);
+      for(int jobIndex = batchStart; jobIndex < batchEnd; jobIndex++)
+      {
+         jobs[jobIndex].output = outputs[jobIndex - batchStart];
+         jobs[jobIndex].outputCapacity = outputCapacity;
+         threadPool.Add(ChunkCompress, &jobs[jobIndex]);
+      }
+      threadPool.Wait();
+
+      for(int jobIndex = batchStart; success && (jobIndex < batchEnd); jobIndex++)
+      {
+         const ChunkJob& job = jobs[jobIndex];
+         FILE_ARCHIVE_CHUNK chunk;
+         chunk.offset = (uint64)file->Tell();
+         chunk.compressedSize = (uint32)job.outputSize;
+         chunk.codec = (uchar)job.outputCodec;
+         archiveChunks.Add(chunk);
+         const unsigned char* data = (job.outputCodec == FILE_ARCHIVE_CODEC_STORE) ? job.source : job.output;
+         success = file->Write(data, job.outputSize) == job.outputSize;
+      }
+   }
+   threadPool.Deinit();
+   for(int outputIndex = 0; outputIndex < outputs.SizeGet(); outputIndex++)
+      FrogFree(outputs[outputIndex]);
+   outputs.Deinit();
+
+   // Write the tables, then go back and fill in where they are.
+   if(success)
+   {
+      header.tablesOffset = (uint64)file->Tell();
+      size_t entriesSize = sizeof(FILE_ARCHIVE_ENTRY) * archiveEntries.SizeGet();
+      size_t chunksSize = sizeof(FILE_ARCHIVE_CHUNK) * archiveChunks.SizeGet();
+      size_t namesSize = (size_t)names.SizeGet();
+      success = (!entriesSize || (file->Write(&archiveEntries[0], entriesSize) == entriesSize))
+         && (!chunksSize || (file->Write(&archiveChunks[0], chunksSize) == chunksSize))
+         && (!namesSize || (file->Write(&names[0], namesSize) == namesSize))
+         && file->Seek(0, File::FRONT)
+         && (file->Write(header) == sizeof(header))
+         && file->Seek(0, File::BACK);
+   }
+
+   archiveChunks.Deinit();
+   jobs.Deinit();
+   names.Deinit();
+   archiveEntries.Deinit();
+   sortedEntries.Deinit();
+   if(!success)
+      WarningPrintf("FileArchiveWriter::Write -- Unable to write the archive.\n");
+   return success;
+}
+
+//------------------------------------------------------------------------------
+
+} //namespace Webfoot {
+
+#endif //#ifndef __FROG__FILEARCHIVEWRITER_H__
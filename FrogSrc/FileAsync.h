@@ -0,0 +1,546 @@
+#ifndef __FROG__FILEASYNC_H__
+#define __FROG__FILEASYNC_H__
+
+#include "FrogMemory.h"
+#include "Debug.h"
+#include "Table.h"
+#include "File.h"
+#include "FileStdio.h"
+#include "Thread.h"
+#include "ThreadUtilities.h"
+
+#if PLATFORM_IS_LINUX || PLATFORM_IS_MACOSX
+   #include <unistd.h>
+   /// True if reads from a FileStdio can use pread, which doesn't touch the
+   /// file position, so they can run at the same time.
+   #define FILE_ASYNC_PREAD_SUPPORTED 1
+#else
+   #define FILE_ASYNC_PREAD_SUPPORTED 0
+#endif
+
+namespace Webfoot {
+
+class FileAsync;
+class FileAsyncManager;
+
+/// Default number of I/O threads used by FileAsyncManager.
+#define FILE_ASYNC_THREAD_COUNT_DEFAULT 2
+/// Stack size used for the I/O threads.
+#define FILE_ASYNC_STACK_SIZE (64 * 1024)
+
+//==============================================================================
+
+/// A read of part of a FileAsync that happens on an I/O thread.  Start it with
+/// FileAsync::ReadQueue, then poll PendingCheck or call
+/// FileAsync::ReadRequestWait.  The object must stay alive and untouched until
+/// the read is finished.  A request can be reused once it's finished.
+class FileReadRequest
+{
+public:
+   FileReadRequest() { file = NULL; data = NULL; length = 0; position = 0; lengthRead = 0; priority = File::PRIORITY_NORMAL; sequence = 0; state = STATE_IDLE; }
+
+   /// Return true if the read has been queued and hasn't finished.
+   bool PendingCheck();
+   /// Return the number of bytes that were read.  Only call this once the
+   /// read has finished.
+   size_t LengthReadGet() { return lengthRead; }
+
+protected:
+   /// Stages of a request.
+   enum State
+   {
+      /// Not queued, or finished.
+      STATE_IDLE,
+      /// Waiting for an I/O thread.
+      STATE_QUEUED,
+      /// Being read.
+      STATE_RUNNING
+   };
+
+   /// File to read from.
+   FileAsync* file;
+   /// Where to put the data.
+   void* data;
+   /// Number of bytes to read.
+   size_t length;
+   /// Position in the file to read from.
+   int64 position;
+   /// Number of bytes that were actually read.
+   size_t lengthRead;
+   /// Priority of the file when the request was queued.
+   File::Priority priority;
+   /// Order in which the request was queued, for requests of equal priority.
+   uint32 sequence;
+   /// Current stage of the request.  This is protected by the mutex of
+   /// FileAsyncManager.
+   State state;
+
+   friend class FileAsync;
+   friend class FileAsyncManager;
+};
+
+//==============================================================================
+
+/// FileAsyncManager runs FileReadRequests on a small pool of I/O threads.  The
+/// highest priority request is started first, and requests of the same
+/// priority are started in the order they were queued.  If a request is
+/// waited on before an I/O thread has started it, it is run on the waiting
+/// thread instead.  Until Init is called, requests are run as soon as they
+/// are queued, like the default File::ReadAsync.  If no I/O thread is
+/// running, as on platforms without threads, requests are run when they are
+/// polled or waited on.
+class FileAsyncManager
+{
+public:
+   FileAsyncManager() { initialized = false; quitting = false; sequenceNext = 0; threadsRunningCount = 0; requestFinishedWaitCount = 0; }
+
+   /// Start the given number of I/O threads.  Memory is drawn from the given heap.
+   void Init(int threadCount = FILE_ASYNC_THREAD_COUNT_DEFAULT, HeapID heapID = HEAP_DEFAULT);
+   /// Finish any queued requests and stop the I/O threads.
+   void Deinit();
+
+   /// Return true if the I/O threads are running.
+   bool InitializedCheck() { return initialized; }
+
+   /// Return the singleton instance.
+   static FileAsyncManager* InstanceGet()
+   {
+      static FileAsyncManager instance;
+      return &instance;
+   }
+
+protected:
+   /// Queue the given request.
+   void Add(FileReadRequest* request);
+   /// Wait for the given request to finish, running it on the calling thread
+   /// if it hasn't been started yet.
+   void Wait(FileReadRequest* request);
+   /// Wait for all requests for the given file to finish.
+   void FileWait(FileAsync* file);
+   /// Return true if the given request is queued or running.
+   bool PendingCheck(FileReadRequest* request);
+
+   /// Return the index in 'queue' of the request to start next, or -1 if the
+   /// queue is empty.  The mutex must be locked.
+   int NextIndexGet();
+   /// Run the request at the given index of 'queue'.  The mutex must be
+   /// locked, and it is unlocked while the request runs.
+   void QueueIndexRun(int queueIndex);
+   /// Wait for any request to finish.  The mutex must be locked.
+   void RequestFinishedWait();
+   /// Entry point for the I/O threads.
+   static void WorkerRun(void* userData);
+
+   /// True between Init and Deinit.
+   bool initialized;
+   /// True if the I/O threads should stop once the queue is empty.
+   bool quitting;
+   /// Sequence number for the next request.
+   uint32 sequenceNext;
+   /// Number of I/O threads that have actually started.
+   int threadsRunningCount;
+   /// Number of threads waiting on 'requestFinishedCondition'.
+   int requestFinishedWaitCount;
+   /// Requests that haven't been started.
+   Table<FileReadRequest*> queue;
+   /// I/O threads.
+   Table<Thread*> threads;
+   /// Protects the queue and the state of requests.
+   Mutex mutex;
+   /// Notified when a request is queued or the threads should stop.
+   ConditionVariable requestAddedCondition;
+   /// Notified when a request finishes.
+   ConditionVariable requestFinishedCondition;
+
+   friend class FileReadRequest;
+   friend class FileAsync;
+};
+
+/// Singleton instance
+static FileAsyncManager* const theFileAsyncManager = FileAsyncManager::InstanceGet();
+
+//==============================================================================
+
+/// FileAsync wraps another File, like a FileStdio or FileDat, and makes
+/// ReadAsync actually asynchronous by handing reads to theFileAsyncManager.
+/// Besides the single read allowed by the File interface, any number of
+/// FileReadRequests can be queued with ReadQueue, so a stream can have several
+/// pages in flight at once.  Reads for the same file are usually performed one
+/// at a time, since they share the wrapped file's position.  Where pread is
+/// available, reads from a FileStdio are performed at the same time instead.
+///
+/// Synchronous calls like Read and Seek wait for all outstanding requests
+/// first, so mixing the two is safe, if slow.  The wrapped file still belongs
+/// to its FileManager, so close it there after calling Deinit.
+class FileAsync : public File
+{
+public:
+   FileAsync()
+   {
+      file = NULL;
+      priority = PRIORITY_NORMAL;
+      requestsCount = 0;
+#if FILE_ASYNC_PREAD_SUPPORTED
+      fileDescriptor = -1;
+#endif
+   }
+   virtual ~FileAsync() {}
+
+   /// Wrap the given file, which should stay open until after Deinit.
+   void Init(File* _file)
+   {
+      assert(_file);
+      file = _file;
+#if FILE_ASYNC_PREAD_SUPPORTED
+      FileStdio* fileStdio = dynamic_cast<FileStdio*>(file);
+      fileDescriptor = (fileStdio && fileStdio->GetFileHandle()) ? fileno(fileStdio->GetFileHandle()) : -1;
+#endif
+      priority = PRIORITY_NORMAL;
+      requestsCount = 0;
+      fileMutex.Init();
+   }
+   /// Wait for any outstanding reads and stop using the wrapped file.
+   void Deinit()
+   {
+      if(file)
+         theFileAsyncManager->FileWait(this);
+      fileMutex.Deinit();
+      file = NULL;
+   }
+
+   /// Read the given number of bytes from the file.
+   /// Return the number of bytes that were actually read.
+   virtual size_t Read(void* data, size_t length) { RequestsWait(); Guard guard(&fileMutex); return file->Read(data, length); }
+   /// Write the given number of bytes from 'data' to the file.
+   /// Return the number that were actually written.
+   virtual size_t Write(const void* data, size_t length) { RequestsWait(); Guard guard(&fileMutex); return file->Write(data, length); }
+   /// Flush any pending reads or writes.
+   /// Return true if successful or not applicable.
+   virtual bool Flush() { RequestsWait(); Guard guard(&fileMutex); return file->Flush(); }
+   /// Return the length of the file.
+   /// Return -1 if a problem is encountered.
+   virtual int64 SizeGet() { RequestsWait(); Guard guard(&fileMutex); return file->SizeGet(); }
+   /// Return the current position in the file in bytes.
+   /// Return -1 if a problem is encountered.
+   virtual int64 Tell() { RequestsWait(); Guard guard(&fileMutex); return file->Tell(); }
+   /// Seek to the given part of the file relative to the given origin.
+   /// Return true if successful.
+   virtual bool Seek(int64 offset, FILE_ORIGIN origin) { RequestsWait(); Guard guard(&fileMutex); return file->Seek(offset, origin); }
+   /// Return true if the end-of-file flag is set.
+   virtual bool EndCheck() { RequestsWait(); Guard guard(&fileMutex); return file->EndCheck(); }
+
+   /// Set the priority of reads queued from now on.  Reads with higher
+   /// priority are started before those with lower priority, regardless of
+   /// which file they're for.
+   virtual void PrioritySet(Priority _priority) { priority = _priority; }
+   /// Return the priority given to new reads.
+   Priority PriorityGet() { return priority; }
+
+   /// Start reading 'length' bytes from 'sourcePosition' into 'data' on an
+   /// I/O thread.  Don't touch 'data' until ReadPendingCheck returns false.
+   /// The current position of the file is not affected.  Unlike the default
+   /// implementation, there are no alignment requirements.
+   virtual void ReadAsync(void* data, size_t length, int64 sourcePosition)
+   {
+      ReadRequestWait(&request);
+      ReadQueue(&request, data, length, sourcePosition);
+   }
+   /// Return true if the read started by ReadAsync has not yet completed.
+   virtual bool ReadPendingCheck() { return request.PendingCheck(); }
+   /// Return the number of bytes read by the last ReadAsync once it's done.
+   size_t ReadAsyncLengthGet() { return request.LengthReadGet(); }
+
+   /// Queue a read of 'length' bytes from 'sourcePosition' into 'data' using
+   /// the given request, which must not already be pending.  Any number of
+   /// requests can be queued for the same file.  Poll
+   /// FileReadRequest::PendingCheck or call ReadRequestWait to find out when
+   /// it's done.
+   void ReadQueue(FileReadRequest* readRequest, void* data, size_t length, int64 sourcePosition)
+   {
+      assert(file);
+      assert(readRequest);
+      readRequest->file = this;
+      readRequest->data = data;
+      readRequest->length = length;
+      readRequest->position = sourcePosition;
+      readRequest->lengthRead = 0;
+      readRequest->priority = priority;
+      theFileAsyncManager->Add(readRequest);
+   }
+   /// Block until the given request is finished.
+   void ReadRequestWait(FileReadRequest* readRequest) { theFileAsyncManager->Wait(readRequest); }
+   /// Block until all requests for this file are finished.
+   void RequestsWait() { theFileAsyncManager->FileWait(this); }
+
+   /// Return the wrapped file.
+   File* FileGet() { return file; }
+
+   typedef File Inherited;
+
+protected:
+   /// Perform the given request on the calling thread.
+   void RequestRun(FileReadRequest* readRequest)
+   {
+#if FILE_ASYNC_PREAD_SUPPORTED
+      if(fileDescriptor >= 0)
+      {
+         size_t lengthRead = 0;
+         while(lengthRead < readRequest->length)
+         {
+            ssize_t result = pread(fileDescriptor, (char*)readRequest->data + lengthRead,
+               readRequest->length - lengthRead, (off_t)(readRequest->position + (int64)lengthRead));
+            if(result <= 0)
+               break;
+            lengthRead += (size_t)result;
+         }
+         readRequest->lengthRead = lengthRead;
+         return;
+      }
+#endif
+      Guard guard(&fileMutex);
+      int64 oldPosition = file->Tell();
+      if(file->Seek(readRequest->position, FRONT))
+         readRequest->lengthRead = file->Read(readRequest->data, readRequest->length);
+      file->Seek(oldPosition, FRONT);
+   }
+
+   /// Wrapped file.
+   File* file;
+   /// Priority given to new requests.
+   Priority priority;
+   /// Request used by ReadAsync.
+   FileReadRequest request;
+   /// Number of requests for this file that are queued or running.  This is
+   /// protected by the mutex of FileAsyncManager.
+   int requestsCount;
+   /// Held while the wrapped file is in use.
+   Mutex fileMutex;
+#if FILE_ASYNC_PREAD_SUPPORTED
+   /// Descriptor of the wrapped file if it's a FileStdio, or -1.
+   int fileDescriptor;
+#endif
+
+   friend class FileAsyncManager;
+};
+
+//==============================================================================
+
+inline bool FileReadRequest::PendingCheck()
+{
+   return theFileAsyncManager->PendingCheck(this);
+}
+
+//==============================================================================
+
+inline void FileAsyncManager::Init(int threadCount, HeapID heapID)
+{
+   assert(!initialized);
+   quitting = false;
+   threadsRunningCount = 0;
+   requestFinishedWaitCount = 0;
+   mutex.Init();
+   requestAddedCondition.Init();
+   requestFinishedCondition.Init();
+   queue.Init(theAllocatorHeaps[heapID]);
+   threads.Init(theAllocatorHeaps[heapID]);
+   initialized = true;
+
+   for(int threadIndex = 0; threadIndex < threadCount; threadIndex++)
+   {
+      Thread* thread = frog_new_ex(heapID) Thread();
+      thread->Init(WorkerRun, this, Thread::PRIORITY_DEFAULT, FILE_ASYNC_STACK_SIZE, heapID);
+      threads.Add(thread);
+   }
+}
+
+//------------------------------------------------------------------------------
+
+inline void FileAsyncManager::Deinit()
+{
+   if(!initialized)
+      return;
+
+   mutex.Lock();
+   while(queue.SizeGet())
+      QueueIndexRun(NextIndexGet());
+   quitting = true;
+   mutex.Unlock();
+   // Notify may only wake one waiting thread on some platforms.
+   for(int threadIndex = 0; threadIndex < threads.SizeGet(); threadIndex++)
+      requestAddedCondition.Notify();
+
+   for(int threadIndex = 0; threadIndex < threads.SizeGet(); threadIndex++)
+   {
+      threads[threadIndex]->Join();
+      threads[threadIndex]->Deinit();
+      frog_delete threads[threadIndex];
+   }
+   threads.Deinit();
+   queue.Deinit();
+   requestFinishedCondition.Deinit();
+   requestAddedCondition.Deinit();
+   mutex.Deinit();
+   initialized = false;
+}
+
+//------------------------------------------------------------------------------
+
+inline void FileAsyncManager::Add(FileReadRequest* request)
+{
+   // Without I/O threads, the request is run when it's waited on.
+   if(!initialized)
+   {
+      request->file->requestsCount++;
+      request->state = FileReadRequest::STATE_QUEUED;
+      request->file->RequestRun(request);
+      request->file->requestsCount--;
+      request->state = FileReadRequest::STATE_IDLE;
+      return;
+   }
+
+   mutex.Lock();
+   assert(request->state == FileReadRequest::STATE_IDLE);
+   request->state = FileReadRequest::STATE_QUEUED;
+   request->sequence = sequenceNext++;
+   request->file->requestsCount++;
+   queue.Add(request);
+   mutex.Unlock();
+   requestAddedCondition.Notify();
+}
+
+//------------------------------------------------------------------------------
+
+inline void FileAsyncManager::Wait(FileReadRequest* request)
+{
+   if(!initialized)
+      return;
+
+   mutex.Lock();
+   while(request->state != FileReadRequest::STATE_IDLE)
+   {
+      if(request->state == FileReadRequest::STATE_QUEUED)
+         QueueIndexRun(queue.FindIndex(request));
+      else
+         RequestFinishedWait();
+   }
+   mutex.Unlock();
+}
+
+//------------------------------------------------------------------------------
+
+inline void FileAsyncManager::FileWait(FileAsync* file)
+{
+   if(!initialized)
+      return;
+
+   mutex.Lock();
+   while(file->requestsCount)
+   {
+      // Run this file's requests here rather than waiting for a thread.
+      int queueIndex = -1;
+      for(int index = 0; index < queue.SizeGet(); index++)
+      {
+         if((queue[index]->file == file) && ((queueIndex < 0) || (queue[index]->sequence < queue[queueIndex]->sequence)))
+            queueIndex = index;
+      }
+      if(queueIndex >= 0)
+         QueueIndexRun(queueIndex);
+      else
+         RequestFinishedWait();
+   }
+   mutex.Unlock();
+}
+
+//------------------------------------------------------------------------------
+
+inline bool FileAsyncManager::PendingCheck(FileReadRequest* request)
+{
+   if(!initialized)
+      return false;
+   mutex.Lock();
+   if((request->state == FileReadRequest::STATE_QUEUED) && !threadsRunningCount)
+      QueueIndexRun(queue.FindIndex(request));
+   bool pending = request->state != FileReadRequest::STATE_IDLE;
+   mutex.Unlock();
+   return pending;
+}
+
+//------------------------------------------------------------------------------
+
+inline int FileAsyncManager::NextIndexGet()
+{
+   int nextIndex = -1;
+   for(int queueIndex = 0; queueIndex < queue.SizeGet(); queueIndex++)
+   {
+      FileReadRequest* request = queue[queueIndex];
+      if(nextIndex < 0)
+      {
+         nextIndex = queueIndex;
+         continue;
+      }
+      FileReadRequest* next = queue[nextIndex];
+      if((request->priority > next->priority)
+         || ((request->priority == next->priority) && (request->sequence < next->sequence)))
+      {
+         nextIndex = queueIndex;
+      }
+   }
+   return nextIndex;
+}
+
+//------------------------------------------------------------------------------
+
+inline void FileAsyncManager::QueueIndexRun(int queueIndex)
+{
+   assert((queueIndex >= 0) && (queueIndex < queue.SizeGet()));
+   FileReadRequest* request = queue[queueIndex];
+   queue.RemoveIndexUnordered(queueIndex);
+   request->state = FileReadRequest::STATE_RUNNING;
+   mutex.Unlock();
+
+   request->file->RequestRun(request);
+
+   mutex.Lock();
+   request->file->requestsCount--;
+   request->state = FileReadRequest::STATE_IDLE;
+   // Several threads may be waiting for different requests, and Notify may
+   // only wake one of them, so wake them all to check.
+   for(int waitIndex = 0; waitIndex < requestFinishedWaitCount; waitIndex++)
+      requestFinishedCondition.Notify();
+}
+
+//------------------------------------------------------------------------------
+
+inline void FileAsyncManager::RequestFinishedWait()
+{
+   requestFinishedWaitCount++;
+   requestFinishedCondition.Wait(&mutex);
+   requestFinishedWaitCount--;
+}
+
+//------------------------------------------------------------------------------
+
+inline void FileAsyncManager::WorkerRun(void* userData)
+{
+   FileAsyncManager* manager = (FileAsyncManager*)userData;
+   manager->mutex.Lock();
+   manager->threadsRunningCount++;
+   while(true)
+   {
+      int queueIndex = manager->NextIndexGet();
+      if(queueIndex >= 0)
+         manager->QueueIndexRun(queueIndex);
+      else if(manager->quitting)
+         break;
+      else
+         manager->requestAddedCondition.Wait(&manager->mutex);
+   }
+   manager->threadsRunningCount--;
+   manager->mutex.Unlock();
+}
+
+//------------------------------------------------------------------------------
+
+} //namespace Webfoot {
+
+#endif //#ifndef __FROG__FILEASYNC_H__
@@ -53,6 +53,7 @@ protected:
    FileManagerDat* parent;
 
    friend class FileManagerDat;
+   friend class FileManagerDatMapped;
 };
 
 //==============================================================================
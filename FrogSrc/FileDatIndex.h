@@ -0,0 +1,304 @@
+#ifndef __FROG__FILEDATINDEX_H__
+#define __FROG__FILEDATINDEX_H__
+
+#include <string.h>
+#include "FrogMemory.h"
+#include "Utility.h"
+#include "Debug.h"
+#include "Table.h"
+#include "File.h"
+#include "FileManagerDat.h"
+
+namespace Webfoot {
+
+//Number used to identify the name index section of a resource file
+#define WT_IO_DAT_INDEX_SIGNATURE 0xD1CEFACE
+//Value of 'nameOffset' for an empty bucket in the name index
+#define WT_IO_DAT_INDEX_EMPTY     0xFFFFFFFF
+
+#if __PRAGMA_PACK__
+#pragma pack (push, 1)
+#endif
+
+typedef struct __GCC_PACKED__
+        {
+        uint32 signature;
+        uint32 bucketCount;
+        uint32 entryCount;
+        uint32 namesSize;
+        } WT_IO_DAT_INDEX_HEADER;
+
+typedef struct __GCC_PACKED__
+        {
+        uint32 hash;
+        uint32 nameOffset;
+        WT_IO_DAT_INFO info;
+        } WT_IO_DAT_INDEX_BUCKET;
+
+typedef struct __GCC_PACKED__
+        {
+        uint32 indexOffset;
+        uint32 signature;
+        } WT_IO_DAT_INDEX_TRAILER;
+
+#if __PRAGMA_PACK__
+#pragma pack (pop)
+#endif
+
+//==============================================================================
+
+/// FileDatIndex looks up entries of a resource file by name using the
+/// optional name index section, so a lookup is a hash and usually a single
+/// string compare rather than a search of the table of contents.
+///
+/// The index section is appended to the end of an archive by
+/// FileDatIndexWriter and is ignored by code that doesn't know about it.  It
+/// consists of a WT_IO_DAT_INDEX_HEADER, a power-of-2 number of
+/// WT_IO_DAT_INDEX_BUCKETs forming a linear-probing hash table that is at
+/// most half full, the null-terminated names, and finally a
+/// WT_IO_DAT_INDEX_TRAILER with the offset of the header.  Each bucket holds
+/// a copy of the entry's WT_IO_DAT_INFO.  Names are hashed with
+/// FileDatIndex::NameHash and are matched exactly.
+class FileDatIndex
+{
+public:
+   FileDatIndex() { Clear(); }
+
+   /// Look for an index section at the end of the given archive, which must
+   /// be entirely in memory, like a mapped file.  Return true if a valid index
+   /// was found.  Otherwise, the index is left empty so callers can fall back
+   /// to searching the table of contents.
+   bool Init(const void* archiveData, size_t archiveSize)
+   {
+      Clear();
+      const unsigned char* archive = (const unsigned char*)archiveData;
+      if(!archive || (archiveSize < sizeof(WT_IO_DAT_INDEX_TRAILER)))
+         return false;
+
+      WT_IO_DAT_INDEX_TRAILER trailer;
+      memcpy(&trailer, archive + archiveSize - sizeof(WT_IO_DAT_INDEX_TRAILER), sizeof(trailer));
+      if(trailer.signature != WT_IO_DAT_INDEX_SIGNATURE)
+         return false;
+      size_t indexOffset = trailer.indexOffset;
+      if(indexOffset + sizeof(WT_IO_DAT_INDEX_HEADER) > archiveSize - sizeof(WT_IO_DAT_INDEX_TRAILER))
+         return false;
+
+      WT_IO_DAT_INDEX_HEADER header;
+      memcpy(&header, archive + indexOffset, sizeof(header));
+      if((header.signature != WT_IO_DAT_INDEX_SIGNATURE) || !header.bucketCount
+         || !PowerOf2Check(header.bucketCount) || (header.entryCount >= header.bucketCount)
+         || (header.bucketCount > archiveSize / sizeof(WT_IO_DAT_INDEX_BUCKET)))
+      {
+         return false;
+      }
+      size_t bucketsOffset = indexOffset + sizeof(WT_IO_DAT_INDEX_HEADER);
+      size_t namesOffset = bucketsOffset + ((size_t)header.bucketCount * sizeof(WT_IO_DAT_INDEX_BUCKET));
+      if((namesOffset + header.namesSize != archiveSize - sizeof(WT_IO_DAT_INDEX_TRAILER))
+         || (header.namesSize && archive[namesOffset + header.namesSize - 1]))
+      {
+         WarningPrintf("FileDatIndex::Init -- The name index is malformed and will be ignored.\n");
+         return false;
+      }
+
+      buckets = (const WT_IO_DAT_INDEX_BUCKET*)(archive + bucketsOffset);
+      bucketCount = header.bucketCount;
+      entryCount = header.entryCount;
+      names = (const char*)(archive + namesOffset);
+      namesSize = header.namesSize;
+      return true;
+   }
+
+   /// Forget the index.  This does not free anything, since the index lives
+   /// in the archive's memory.
+   void Clear()
+   {
+      buckets = NULL;
+      bucketCount = 0;
+      entryCount = 0;
+      names = NULL;
+      namesSize = 0;
+   }
+
+   /// Return true if a valid index was found by Init.
+   bool ValidCheck() { return buckets != NULL; }
+   /// Return the number of entries in the index.
+   int EntryCountGet() { return (int)entryCount; }
+
+   /// Return the information for the entry with the given name, or NULL if
+   /// there isn't one.  The pointer is into the archive's memory and may not
+   /// be aligned.
+   const WT_IO_DAT_INFO* InfoGet(const char* name)
+   {
+      if(!buckets || !name)
+         return NULL;
+      uint32 hash = NameHash(name);
+      uint32 mask = bucketCount - 1;
+      uint32 bucketIndex = hash & mask;
+      for(uint32 probeCount = 0; probeCount < bucketCount; probeCount++)
+      {
+         const WT_IO_DAT_INDEX_BUCKET* bucket = &buckets[bucketIndex];
+         if(bucket->nameOffset == WT_IO_DAT_INDEX_EMPTY)
+            return NULL;
+         if((bucket->hash == hash) && (bucket->nameOffset < namesSize) && !strcmp(names + bucket->nameOffset, name))
+            return &bucket->info;
+         bucketIndex = (bucketIndex + 1) & mask;
+      }
+      return NULL;
+   }
+
+   /// Return the hash of the given name as stored in the index.  This is the
+   /// 32-bit FNV-1a hash of the bytes of the name.
+   static uint32 NameHash(const char* name)
+   {
+      uint32 hash = 2166136261U;
+      for(; *name; name++)
+         hash = (hash ^ (unsigned char)*name) * 16777619U;
+      return hash;
+   }
+
+protected:
+   /// Hash table of entries.
+   const WT_IO_DAT_INDEX_BUCKET* buckets;
+   /// Number of buckets.  This is a power of 2.
+   uint32 bucketCount;
+   /// Number of buckets in use.
+   uint32 entryCount;
+   /// Null-terminated names referred to by the buckets.
+   const char* names;
+   /// Size of 'names' in bytes.
+   uint32 namesSize;
+};
+
+//==============================================================================
+
+/// FileDatIndexWriter builds the name index section described in
+/// FileDatIndex.  A packer tool adds each entry with the name that will be
+/// passed to Open and the WT_IO_DAT_INFO it wrote to the table of contents,
+/// then calls Write with the archive file positioned at its end.  For
+/// archives that have already been built, Tools/FileDatIndexAppend.cpp does
+/// the same using a list of names.
+class FileDatIndexWriter
+{
+public:
+   /// Prepare to collect entries.  Memory is drawn from the given heap.
+   void Init(HeapID _heapID = HEAP_DEFAULT)
+   {
+      heapID = _heapID;
+      entries.Init(theAllocatorHeaps[heapID]);
+   }
+
+   /// Clean up.
+   void Deinit()
+   {
+      for(int entryIndex = 0; entryIndex < entries.SizeGet(); entryIndex++)
+         StringDelete(entries[entryIndex].name);
+      entries.Deinit();
+   }
+
+   /// Add an entry to the index.  If more than one entry has the same name,
+   /// the first one is used.  Return true if successful.
+   bool Add(const char* name, const WT_IO_DAT_INFO& info)
+   {
+      if(!name)
+         return false;
+      Entry entry;
+      entry.name = StringClone(name, heapID);
+      if(!entry.name)
+         return false;
+      entry.info = info;
+      entries.Add(entry);
+      return true;
+   }
+
+   /// Write the index section to the current position of the given file,
+   /// which should be the end of the archive.  Return true if successful.
+   bool Write(File* file);
+
+protected:
+   /// An entry to be written.
+   struct Entry
+   {
+      const char* name;
+      WT_IO_DAT_INFO info;
+   };
+
+   /// Heap used for the entries.
+   HeapID heapID;
+   /// Entries added so far.
+   Table<Entry> entries;
+};
+
+//==============================================================================
+
+inline bool FileDatIndexWriter::Write(File* file)
+{
+   assert(file);
+   int64 indexOffset = file->Tell();
+   if((indexOffset < 0) || (indexOffset > (int64)0xFFFFFFFFU))
+      return false;
+
+   // Keep the table at most half full so probes stay short.
+   int bucketCount = PowerOf2Ceil(entries.SizeGet() * 2 + 1);
+   int mask = bucketCount - 1;
+   Table<WT_IO_DAT_INDEX_BUCKET> buckets;
+   buckets.Init(theAllocatorHeaps[heapID]);
+   buckets.SizeSet(bucketCount);
+   for(int bucketIndex = 0; bucketIndex < bucketCount; bucketIndex++)
+      buckets[bucketIndex].nameOffset = WT_IO_DAT_INDEX_EMPTY;
+
+   Table<char> names;
+   names.Init(theAllocatorHeaps[heapID]);
+   uint32 entryCount = 0;
+   for(int entryIndex = 0; entryIndex < entries.SizeGet(); entryIndex++)
+   {
+      const Entry& entry = entries[entryIndex];
+      uint32 hash = FileDatIndex::NameHash(entry.name);
+      int bucketIndex = (int)(hash & (uint32)mask);
+      bool duplicate = false;
+      while(buckets[bucketIndex].nameOffset != WT_IO_DAT_INDEX_EMPTY)
+      {
+         if((buckets[bucketIndex].hash == hash) && !strcmp(&names[(int)buckets[bucketIndex].nameOffset], entry.name))
+         {
+            duplicate = true;
+            break;
+         }
+         bucketIndex = (bucketIndex + 1) & mask;
+      }
+      if(duplicate)
+         continue;
+
+      WT_IO_DAT_INDEX_BUCKET& bucket = buckets[bucketIndex];
+      bucket.hash = hash;
+      bucket.nameOffset = (uint32)names.SizeGet();
+      bucket.info = entry.info;
+      names.AddCount(entry.name, (int)strlen(entry.name) + 1);
+      entryCount++;
+   }
+
+   WT_IO_DAT_INDEX_HEADER header;
+   header.signature = WT_IO_DAT_INDEX_SIGNATURE;
+   header.bucketCount = (uint32)bucketCount;
+   header.entryCount = entryCount;
+   header.namesSize = (uint32)names.SizeGet();
+
+   WT_IO_DAT_INDEX_TRAILER trailer;
+   trailer.indexOffset = (uint32)indexOffset;
+   trailer.signature = WT_IO_DAT_INDEX_SIGNATURE;
+
+   size_t bucketsSize = sizeof(WT_IO_DAT_INDEX_BUCKET) * bucketCount;
+   size_t namesSize = (size_t)names.SizeGet();
+   bool success = (file->Write(&header, sizeof(header)) == sizeof(header))
+      && (file->Write(&buckets[0], bucketsSize) == bucketsSize)
+      && (!namesSize || (file->Write(&names[0], namesSize) == namesSize))
+      && (file->Write(&trailer, sizeof(trailer)) == sizeof(trailer));
+
+   names.Deinit();
+   buckets.Deinit();
+   return success;
+}
+
+//------------------------------------------------------------------------------
+
+} //namespace Webfoot {
+
+#endif //#ifndef __FROG__FILEDATINDEX_H__
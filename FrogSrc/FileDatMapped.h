@@ -0,0 +1,88 @@
+#ifndef __FROG__FILEDATMAPPED_H__
+#define __FROG__FILEDATMAPPED_H__
+
+#include <string.h>
+#include "FrogMemory.h"
+#include "File.h"
+
+namespace Webfoot {
+
+class FileManagerDatMapped;
+
+//==============================================================================
+
+/// File that reads an entry of a resource file directly from the memory
+/// where FileManagerDatMapped mapped the archive.  Reading is a copy from the
+/// mapping, and DataGet gives access to the bytes without copying at all.
+class FileDatMapped : public File
+{
+public:
+   FileDatMapped() { data = NULL; length = 0; offset = 0; endFlag = false; }
+   virtual ~FileDatMapped() {}
+
+   /// Read the given number of bytes from the file.
+   /// Return the number of bytes that were actually read.
+   virtual size_t Read(void* destination, size_t readLength)
+   {
+      size_t available = (size_t)(length - offset);
+      if(readLength > available)
+      {
+         readLength = available;
+         endFlag = true;
+      }
+      memcpy(destination, data + offset, readLength);
+      offset += readLength;
+      return readLength;
+   }
+
+   /// Return the length of the file.
+   virtual int64 SizeGet() { return (int64)length; }
+
+   /// Return the current position in the file in bytes.
+   virtual int64 Tell() { return (int64)offset; }
+
+   /// Seek to the given part of the file relative to the given origin.
+   /// Return true if successful.
+   virtual bool Seek(int64 seekOffset, FILE_ORIGIN origin)
+   {
+      int64 newOffset = seekOffset;
+      if(origin == CURRENT)
+         newOffset += (int64)offset;
+      else if(origin == BACK)
+         newOffset += (int64)length;
+      if((newOffset < 0) || (newOffset > (int64)length))
+         return false;
+      offset = (size_t)newOffset;
+      endFlag = false;
+      return true;
+   }
+
+   /// Return true if the end-of-file flag is set.  This happens
+   /// when you try to read past the end of the file.  The flag is
+   /// reset to false by calling Seek.
+   virtual bool EndCheck() { return endFlag; }
+
+   /// Return a pointer to the contents of the file.  This remains valid
+   /// until the file is closed.
+   const void* DataGet() { return data; }
+
+   typedef File Inherited;
+
+protected:
+   /// Start of the file within the mapping.
+   const unsigned char* data;
+   /// Length of the file in bytes.
+   size_t length;
+   /// Current position in the file.
+   size_t offset;
+   /// True if a read went past the end of the file.
+   bool endFlag;
+
+   friend class FileManagerDatMapped;
+};
+
+//==============================================================================
+
+} //namespace Webfoot {
+
+#endif //#ifndef __FROG__FILEDATMAPPED_H__
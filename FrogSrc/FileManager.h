@@ -232,6 +232,9 @@ public:
    /// Sets the root path for the filesystem.  This is not supported by all
    /// FileManager implementations.
    virtual bool RootPathSet(const char* _rootPath);
+   /// Return the root path for the filesystem, or an empty string if there
+   /// isn't one.  This is not used by all FileManager implementations.
+   const char* RootPathGet() { return rootPath; }
 
    /// Sync changes to the underlying storage system.  This is not necessary
    /// on most platforms and FileManager implementations.
@@ -0,0 +1,277 @@
+#ifndef __FROG__FILEMANAGERARCHIVE_H__
+#define __FROG__FILEMANAGERARCHIVE_H__
+
+#include <string.h>
+#include "FrogMemory.h"
+#include "Utility.h"
+#include "Debug.h"
+#include "File.h"
+#include "FileManager.h"
+#include "FileArchive.h"
+
+namespace Webfoot {
+
+//==============================================================================
+
+/// FileManagerArchive reads archives written by FileArchiveWriter.  Each entry
+/// is split into chunks of a fixed uncompressed size, and each chunk is stored
+/// as-is or compressed with LZ4 or zlib, as chosen per entry when the archive
+/// was written.  Opened files support random access through Seek.
+///
+/// An archive starts with a FILE_ARCHIVE_HEADER.  The chunk data follows, and
+/// the tables are at the end: the FILE_ARCHIVE_ENTRYs sorted by name hash and
+/// then by name, the FILE_ARCHIVE_CHUNKs, and the null-terminated names.
+/// Paths should use '/' as the separator rather than '\\'.
+class FileManagerArchive : public FileManager
+{
+public:
+   FileManagerArchive()
+   {
+      parentFileManager = NULL;
+      archiveFilename = NULL;
+      tables = NULL;
+      entries = NULL;
+      chunks = NULL;
+      names = NULL;
+      entryCount = 0;
+      chunkSize = 0;
+      heapID = HEAP_DEFAULT;
+   }
+   virtual ~FileManagerArchive() {}
+
+   /// Initialize the manager to use the given archive that exists in the
+   /// given parentFileManager.  The tables are loaded into the given heap.
+   /// Return true if successful.
+   bool Init(FileManager* _parentFileManager, const char* _archiveFilename, HeapID _heapID = HEAP_DEFAULT);
+   /// Clean up the FileManager itself.  All files should be closed first.
+   virtual void Deinit();
+
+   /// Open a new file object with the given options.
+   /// Create the object in the specified heap.
+   /// Do not use FileManager::WRITE in 'options' for this class.
+   /// Return NULL if unsuccessful.
+   virtual File* Open(const char* filename, int options = READ, HeapID _heapID = HEAP_TEMP);
+   /// Close the given file and free any memory allocated for it.
+   /// Return true if successful.
+   virtual bool Close(File* file);
+
+   /// If the given path corresponds to an existing file, return true.
+   /// It does not return true for folders.
+   virtual bool ExistsCheck(const char* path) { return EntryFind(path) != NULL; }
+   /// Return true if the given path corresponds to a file in the archive.
+   virtual bool FileCheck(const char* path) { return EntryFind(path) != NULL; }
+
+   /// Return the number of entries in the archive.
+   int EntryCountGet() { return entryCount; }
+
+   FileManager* ParentFileManagerGet() { return parentFileManager; }
+
+   typedef FileManager Inherited;
+
+protected:
+   /// Return the entry with the given name, or NULL if there isn't one.
+   const FILE_ARCHIVE_ENTRY* EntryFind(const char* filename);
+   /// Return true if the loaded tables are consistent with each other and the
+   /// header.
+   bool TablesValidCheck(const FILE_ARCHIVE_HEADER& header);
+
+   /// FileManager that contains the archive.
+   FileManager* parentFileManager;
+   /// Filename of the archive within 'parentFileManager'.
+   const char* archiveFilename;
+   /// Single allocation holding the entries, chunks, and names.
+   void* tables;
+   /// Entries sorted by name hash and then by name.
+   const FILE_ARCHIVE_ENTRY* entries;
+   /// Chunks of all the entries.
+   const FILE_ARCHIVE_CHUNK* chunks;
+   /// Null-terminated names referred to by the entries.
+   const char* names;
+   /// Number of entries.
+   int entryCount;
+   /// Uncompressed size of every chunk but the last of each entry.
+   size_t chunkSize;
+   /// Heap used for the tables.
+   HeapID heapID;
+};
+
+//==============================================================================
+
+inline bool FileManagerArchive::Init(FileManager* _parentFileManager, const char* _archiveFilename, HeapID _heapID)
+{
+   assert(_parentFileManager);
+   assert(_archiveFilename);
+   parentFileManager = _parentFileManager;
+   heapID = _heapID;
+
+   File* file = parentFileManager->Open(_archiveFilename, READ, heapID);
+   if(!file)
+   {
+      WarningPrintf("FileManagerArchive::Init -- Unable to open '%s'.\n", _archiveFilename);
+      return false;
+   }
+
+   FILE_ARCHIVE_HEADER header;
+   int64 archiveSize = file->SizeGet();
+   bool success = (file->Read(header) == sizeof(header))
+      && (header.signature == FILE_ARCHIVE_SIGNATURE)
+      && (header.version == FILE_ARCHIVE_VERSION)
+      && header.chunkSize
+      && (archiveSize > 0)
+      && (header.tablesOffset <= (uint64)archiveSize);
+   size_t entriesSize = (size_t)header.entryCount * sizeof(FILE_ARCHIVE_ENTRY);
+   size_t chunksSize = (size_t)header.chunkCount * sizeof(FILE_ARCHIVE_CHUNK);
+   size_t tablesSize = entriesSize + chunksSize + header.namesSize;
+   if(success)
+      success = (header.tablesOffset + tablesSize == (uint64)archiveSize);
+   if(success && tablesSize)
+   {
+      tables = FrogMallocEx(tablesSize, heapID, FROG_MEM_ALIGN);
+      success = tables && file->Seek((int64)header.tablesOffset, File::FRONT)
+         && (file->Read(tables, tablesSize) == tablesSize);
+   }
+   parentFileManager->Close(file);
+
+   if(success)
+   {
+      entries = (const FILE_ARCHIVE_ENTRY*)tables;
+      chunks = (const FILE_ARCHIVE_CHUNK*)((char*)tables + entriesSize);
+      names = (const char*)tables + entriesSize + chunksSize;
+      entryCount = (int)header.entryCount;
+      chunkSize = header.chunkSize;
+      success = TablesValidCheck(header);
+   }
+   if(success)
+      archiveFilename = StringClone(_archiveFilename, heapID);
+   if(!success || !archiveFilename)
+   {
+      WarningPrintf("FileManagerArchive::Init -- '%s' is not a valid archive.\n", _archiveFilename);
+      Deinit();
+      return false;
+   }
+   return true;
+}
+
+//------------------------------------------------------------------------------
+
+inline void FileManagerArchive::Deinit()
+{
+   if(tables)
+      FrogFree(tables);
+   if(archiveFilename)
+      StringDelete(archiveFilename);
+   tables = NULL;
+   entries = NULL;
+   chunks = NULL;
+   names = NULL;
+   entryCount = 0;
+   archiveFilename = NULL;
+   parentFileManager = NULL;
+   Inherited::Deinit();
+}
+
+//------------------------------------------------------------------------------
+
+inline File* FileManagerArchive::Open(const char* filename, int options, HeapID _heapID)
+{
+   if(options != READ)
+   {
+      WarningPrintf("FileManagerArchive::Open -- Archives can only be opened for reading.\n");
+      return NULL;
+   }
+   const FILE_ARCHIVE_ENTRY* entry = EntryFind(filename);
+   if(!entry)
+      return NULL;
+
+   // Each file gets its own handle to the archive so files don't disturb
+   // each other's positions.
+   File* source = parentFileManager->Open(archiveFilename, READ, _heapID);
+   if(!source)
+      return NULL;
+
+   FileArchive* file = frog_new_ex(_heapID) FileArchive();
+   file->source = source;
+   file->chunks = chunks + entry->firstChunk;
+   file->chunkSize = chunkSize;
+   file->size = entry->size;
+   file->chunkCached.Init(theAllocatorHeaps[_heapID]);
+   file->chunkCompressed.Init(theAllocatorHeaps[_heapID]);
+   return file;
+}
+
+//------------------------------------------------------------------------------
+
+inline bool FileManagerArchive::Close(File* file)
+{
+   if(!file)
+      return false;
+   FileArchive* fileArchive = (FileArchive*)file;
+   bool success = parentFileManager->Close(fileArchive->source);
+   fileArchive->chunkCached.Deinit();
+   fileArchive->chunkCompressed.Deinit();
+   frog_delete fileArchive;
+   return success;
+}
+
+//------------------------------------------------------------------------------
+
+inline const FILE_ARCHIVE_ENTRY* FileManagerArchive::EntryFind(const char* filename)
+{
+   if(!filename || !entries)
+      return NULL;
+   uint32 hash = FileArchiveNameHash(filename);
+
+   // Find the first entry with the hash, then check the names of each entry
+   // that shares it.
+   int low = 0;
+   int high = entryCount;
+   while(low < high)
+   {
+      int middle = low + ((high - low) / 2);
+      if(entries[middle].nameHash < hash)
+         low = middle + 1;
+      else
+         high = middle;
+   }
+   for(int entryIndex = low; (entryIndex < entryCount) && (entries[entryIndex].nameHash == hash); entryIndex++)
+   {
+      if(!strcmp(names + entries[entryIndex].nameOffset, filename))
+         return &entries[entryIndex];
+   }
+   return NULL;
+}
+
+//------------------------------------------------------------------------------
+
+inline bool FileManagerArchive::TablesValidCheck(const FILE_ARCHIVE_HEADER& header)
+{
+   if(header.namesSize && names[header.namesSize - 1])
+      return false;
+   for(int entryIndex = 0; entryIndex < entryCount; entryIndex++)
+   {
+      const FILE_ARCHIVE_ENTRY& entry = entries[entryIndex];
+      uint64 expectedChunkCount = (entry.size + chunkSize - 1) / chunkSize;
+      if((entry.nameOffset >= header.namesSize) || (entry.chunkCount != expectedChunkCount)
+         || (entry.firstChunk > header.chunkCount) || (entry.chunkCount > header.chunkCount - entry.firstChunk)
+         || ((entryIndex > 0) && (entries[entryIndex - 1].nameHash > entry.nameHash)))
+      {
+         return false;
+      }
+   }
+   for(uint32 chunkIndex = 0; chunkIndex < header.chunkCount; chunkIndex++)
+   {
+      const FILE_ARCHIVE_CHUNK& chunk = chunks[chunkIndex];
+      if((chunk.codec >= FILE_ARCHIVE_CODEC_COUNT) || (chunk.offset > header.tablesOffset)
+         || (chunk.compressedSize > header.tablesOffset - chunk.offset))
+      {
+         return false;
+      }
+   }
+   return true;
+}
+
+//------------------------------------------------------------------------------
+
+} //namespace Webfoot {
+
+#endif //#ifndef __FROG__FILEMANAGERARCHIVE_H__
@@ -0,0 +1,329 @@
+#ifndef __FROG__FILEMANAGERDATMAPPED_H__
+#define __FROG__FILEMANAGERDATMAPPED_H__
+
+#include "FrogMemory.h"
+#include "Utility.h"
+#include "Debug.h"
+#include "File.h"
+#include "FileDat.h"
+#include "FileDatMapped.h"
+#include "FileManagerDat.h"
+#include "FileDatIndex.h"
+#include "FlatHashMap.h"
+
+#if PLATFORM_IS_LINUX || PLATFORM_IS_MACOSX
+   #include <fcntl.h>
+   #include <unistd.h>
+   #include <sys/mman.h>
+   #include <sys/stat.h>
+   /// True if FileManagerDatMapped can map resource files into memory on this platform.
+   #define FILE_MANAGER_DAT_MAPPED_SUPPORTED 1
+#else
+   #define FILE_MANAGER_DAT_MAPPED_SUPPORTED 0
+#endif
+
+namespace Webfoot {
+
+//==============================================================================
+
+/// FileManagerDatMapped is a FileManagerDat that also maps the whole resource
+/// file into memory.  Entries that are stored as-is, with an 'xorage' of 0,
+/// are opened as FileDatMapped objects that read straight from the mapping
+/// rather than through the parent FileManager.  FileLoadView goes further and
+/// returns a pointer into the mapping without allocating or copying anything.
+/// Other entries, and everything on platforms where mapping isn't supported,
+/// are handled by FileManagerDat as usual.
+///
+/// Since the mapping is made by the operating system, Init needs the path of
+/// the resource file as the operating system sees it in addition to the
+/// usual parameters.  The table of contents is still read by FileManagerDat.
+///
+/// If the archive ends with a name index section written by
+/// FileDatIndexWriter, such as by the FileDatIndexAppend tool, names are
+/// looked up in it first.  Names in the index are matched exactly against
+/// the filename, with the root path, if any, and a '/' prepended.  Names that
+/// aren't in the index, and all names for older archives, are resolved by
+/// FileManagerDat.
+class FileManagerDatMapped : public FileManagerDat
+{
+public:
+   FileManagerDatMapped()
+   {
+      mapping = NULL;
+      mappingSize = 0;
+      viewCount = 0;
+      heapID = HEAP_DEFAULT;
+   }
+   virtual ~FileManagerDatMapped() {}
+
+   /// Initialize the manager to use the given resource file that exists in the
+   /// given parentFileManager.  'mappedPath' is the path of the same file to
+   /// use when mapping it into memory.  If the mapping can't be made, this
+   /// still succeeds but behaves like a FileManagerDat.  Return true if
+   /// successful.
+   bool Init(FileManager* _parentFileManager, const char* _resourceFilename, const char* mappedPath,
+      HeapID _heapID = HEAP_DEFAULT, const char* _rootPath = NULL);
+   /// Clean up the FileManager itself.  All views should be unloaded first.
+   virtual void Deinit();
+
+   /// Open a new file object with the given options.
+   /// Create the object in the specified heap.
+   /// Do not use FileManager::WRITE in 'options' for this class.
+   /// Return NULL if unsuccessful.
+   virtual File* Open(const char* filename, int options = READ, HeapID _heapID = HEAP_TEMP);
+   /// Close the given file and free any memory allocated for it.
+   /// Return true if successful.
+   virtual bool Close(File* file);
+
+   /// If the given path corresponds to an existing file, return true.
+   /// It does not return true for folders.
+   virtual bool ExistsCheck(const char* path) { return EntryInfoGet(path) != NULL; }
+
+   /// Free data obtained with the heap/alignment form of FileLoad or with
+   /// FileLoadView.
+   virtual void FileUnload(void* data)
+   {
+      if(MappingContainsCheck(data))
+         FileUnloadView(data);
+      else
+         Inherited::FileUnload(data);
+   }
+
+   /// Return a pointer to the contents of the given file within the mapping
+   /// and write its length to 'length'.  The data must not be modified.
+   /// Release it with FileUnloadView or FileUnload when finished; this doesn't
+   /// free anything, but it keeps track of outstanding views.  Return NULL if
+   /// the file doesn't exist or can't be viewed directly, in which case use
+   /// FileLoad instead.
+   const void* FileLoadView(const char* filename, size_t* length)
+   {
+      const unsigned char* data = EntryDataGet(EntryInfoGet(filename), length);
+      if(data)
+         viewCount++;
+      return data;
+   }
+   /// Release a pointer obtained from FileLoadView.
+   void FileUnloadView(const void* data)
+   {
+      if(!data)
+         return;
+      assert(MappingContainsCheck(data));
+      assert(viewCount > 0);
+      viewCount--;
+   }
+
+   /// Return true if the resource file is mapped into memory.
+   bool MappedCheck() { return mapping != NULL; }
+   /// Return true if the archive has a name index.
+   bool IndexedCheck() { return index.ValidCheck(); }
+   /// Return the number of views and mapped files that are currently open.
+   int ViewCountGet() { return viewCount; }
+
+   typedef FileManagerDat Inherited;
+
+protected:
+   /// Return the information for the given file, or NULL if it doesn't
+   /// exist.  Names not found in the name index are looked up through
+   /// FileManagerDat, and the results are cached, including for names that
+   /// don't exist, so each filename is only looked up through it once.
+   const WT_IO_DAT_INFO* EntryInfoGet(const char* filename);
+   /// Return a pointer to the data of the given entry within the mapping and
+   /// write its length to 'length'.  Return NULL if the entry isn't stored
+   /// as-is or there is no mapping.
+   const unsigned char* EntryDataGet(const WT_IO_DAT_INFO* info, size_t* length);
+   /// Return true if the given pointer is within the mapping.
+   bool MappingContainsCheck(const void* data)
+   {
+      return mapping && ((const unsigned char*)data >= mapping) && ((const unsigned char*)data < mapping + mappingSize);
+   }
+
+   typedef FlatHashMap<const char*, const WT_IO_DAT_INFO*> EntryInfoMap;
+
+   /// Start of the mapped resource file, or NULL if it isn't mapped.
+   unsigned char* mapping;
+   /// Size of the mapping in bytes.
+   size_t mappingSize;
+   /// Number of outstanding views and open FileDatMapped objects.
+   int viewCount;
+   /// Heap used for the cache of entry indices.
+   HeapID heapID;
+   /// Map of filenames to their entries in the table of contents, or to NULL
+   /// for names that aren't in the archive.
+   EntryInfoMap entryInfos;
+   /// Name index at the end of the mapped archive, if any.
+   FileDatIndex index;
+};
+
+//==============================================================================
+
+inline bool FileManagerDatMapped::Init(FileManager* _parentFileManager, const char* _resourceFilename,
+   const char* mappedPath, HeapID _heapID, const char* _rootPath)
+{
+   if(!Inherited::Init(_parentFileManager, _resourceFilename, _heapID, _rootPath))
+      return false;
+
+   heapID = _heapID;
+   viewCount = 0;
+   mapping = NULL;
+   mappingSize = 0;
+   entryInfos.Init(StringHash, StringsEqualCheck, theAllocatorHeaps[heapID]);
+
+#if FILE_MANAGER_DAT_MAPPED_SUPPORTED
+   int fileDescriptor = mappedPath ? ::open(mappedPath, O_RDONLY) : -1;
+   if(fileDescriptor >= 0)
+   {
+      struct stat fileStatus;
+      if((fstat(fileDescriptor, &fileStatus) == 0) && (fileStatus.st_size > 0))
+      {
+         void* newMapping = ::mmap(NULL, (size_t)fileStatus.st_size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+         if(newMapping != MAP_FAILED)
+         {
+            mapping = (unsigned char*)newMapping;
+            mappingSize = (size_t)fileStatus.st_size;
+         }
+      }
+      // The mapping stays valid after the descriptor is closed.
+      ::close(fileDescriptor);
+   }
+   if(!mapping)
+      WarningPrintf("FileManagerDatMapped::Init -- Unable to map '%s'.  Files will be read normally.\n", mappedPath ? mappedPath : "");
+#else
+   (void)mappedPath;
+#endif
+
+   index.Init(mapping, mappingSize);
+   return true;
+}
+
+//------------------------------------------------------------------------------
+
+inline void FileManagerDatMapped::Deinit()
+{
+   assert(viewCount == 0);
+
+   for(EntryInfoMap::Iterator iterator = entryInfos.Begin(); iterator.WithinCheck(); iterator.Next())
+   {
+      const char* filename = iterator.Key();
+      StringDelete(filename);
+   }
+   entryInfos.Deinit();
+   index.Clear();
+
+#if FILE_MANAGER_DAT_MAPPED_SUPPORTED
+   if(mapping)
+      ::munmap(mapping, mappingSize);
+#endif
+   mapping = NULL;
+   mappingSize = 0;
+   viewCount = 0;
+
+   Inherited::Deinit();
+}
+
+//------------------------------------------------------------------------------
+
+inline File* FileManagerDatMapped::Open(const char* filename, int options, HeapID _heapID)
+{
+   if(mapping && (options == READ))
+   {
+      const WT_IO_DAT_INFO* info = EntryInfoGet(filename);
+      if(!info)
+         return NULL;
+      size_t length;
+      const unsigned char* data = EntryDataGet(info, &length);
+      if(data)
+      {
+         FileDatMapped* file = frog_new_ex(_heapID) FileDatMapped();
+         file->data = data;
+         file->length = length;
+         viewCount++;
+         return file;
+      }
+   }
+   return Inherited::Open(filename, options, _heapID);
+}
+
+//------------------------------------------------------------------------------
+
+inline bool FileManagerDatMapped::Close(File* file)
+{
+   FileDatMapped* fileDatMapped = dynamic_cast<FileDatMapped*>(file);
+   if(!fileDatMapped)
+      return Inherited::Close(file);
+   assert(viewCount > 0);
+   viewCount--;
+   frog_delete fileDatMapped;
+   return true;
+}
+
+//------------------------------------------------------------------------------
+
+inline const WT_IO_DAT_INFO* FileManagerDatMapped::EntryInfoGet(const char* filename)
+{
+   if(!filename)
+      return NULL;
+
+   // The index only has the names it was written with, so a miss still has
+   // to go through FileManagerDat, which also matches short names.
+   if(index.ValidCheck())
+   {
+      const WT_IO_DAT_INFO* info = NULL;
+      if(!rootPath[0])
+      {
+         info = index.InfoGet(filename);
+      }
+      else
+      {
+         char path[FROG_PATH_MAX+1];
+         size_t rootPathLength = strlen(rootPath);
+         const char* separator = (rootPath[rootPathLength-1] == '/') ? "" : "/";
+         if(FrogSnprintf(path, sizeof(path), "%s%s%s", rootPath, separator, filename))
+            info = index.InfoGet(path);
+      }
+      if(info)
+         return info;
+   }
+
+   EntryInfoMap::Iterator iterator = entryInfos.Find(filename);
+   if(iterator.WithinCheck())
+      return iterator.Value();
+
+   // Let FileManagerDat find the entry, since it knows how names are matched.
+   // Names it can't find are cached as NULL so that checking for a missing
+   // file again doesn't cost another Open.
+   const WT_IO_DAT_INFO* info = NULL;
+   FileDat* file = (FileDat*)Inherited::Open(filename, READ, heapID);
+   if(file)
+   {
+      int entryIndex = file->hresource - 1;
+      Inherited::Close(file);
+      if(entryIndex >= 0)
+         info = wt_io_resource_fat[entryIndex].info;
+   }
+
+   const char* filenameClone = StringClone(filename, heapID);
+   if(filenameClone)
+      entryInfos.Add(filenameClone, info);
+   return info;
+}
+
+//------------------------------------------------------------------------------
+
+inline const unsigned char* FileManagerDatMapped::EntryDataGet(const WT_IO_DAT_INFO* info, size_t* length)
+{
+   if(!mapping || !info || info->xorage)
+      return NULL;
+   size_t offset = (size_t)info->offset;
+   size_t entryLength = (size_t)info->length;
+   if((offset >= mappingSize) || (entryLength > mappingSize - offset))
+      return NULL;
+   if(length)
+      *length = entryLength;
+   return mapping + offset;
+}
+
+//------------------------------------------------------------------------------
+
+} //namespace Webfoot {
+
+#endif //#ifndef __FROG__FILEMANAGERDATMAPPED_H__
@@ -0,0 +1,904 @@
+#ifndef __FROG__FILEMANAGERSTDIOSCANNED_H__
+#define __FROG__FILEMANAGERSTDIOSCANNED_H__
+
+#include <string.h>
+#include <ctype.h>
+#include "FrogMemory.h"
+#include "Utility.h"
+#include "Debug.h"
+#include "Table.h"
+#include "FlatMap.h"
+#include "HeapDelegateArena.h"
+#include "FrogString.h"
+#include "ThreadUtilities.h"
+#include "File.h"
+#include "FileManager.h"
+#include "FileManagerStdio.h"
+
+#if PLATFORM_IS_WINDOWS
+   #include <windows.h>
+#else
+   #include <dirent.h>
+   #include <sys/stat.h>
+#endif
+
+#if PLATFORM_IS_LINUX
+   #include <unistd.h>
+   #include <sys/inotify.h>
+   /// True if FileManagerStdioScanned can watch for changes made by other
+   /// programs on this platform.
+   #define FILE_MANAGER_STDIO_SCANNED_WATCH_SUPPORTED 1
+#else
+   #define FILE_MANAGER_STDIO_SCANNED_WATCH_SUPPORTED 0
+#endif
+
+namespace Webfoot {
+
+//==============================================================================
+
+/// FileManagerStdioScanned is a FileManagerStdio that answers ExistsCheck,
+/// FileCheck, FolderCheck, and FolderContentsGet from an in-memory copy of the
+/// directory tree under its root.  The tree is built with a single walk the
+/// first time it's needed, which replaces the many 'stat' calls made when
+/// GraphicsPathExistsCheck and similar functions probe for files in several
+/// folders.
+///
+/// Changes made through this FileManager update the affected entries of the
+/// tree.  Changes made by other programs aren't noticed unless watching is
+/// enabled with WatchEnabledSet and Update is called regularly.  Watching is
+/// only supported where FILE_MANAGER_STDIO_SCANNED_WATCH_SUPPORTED is 1.
+/// Otherwise, call Invalidate when the files may have changed.
+///
+/// Folders that are symbolic links, or whose paths are too long, are not
+/// scanned, so they can't lead the walk in circles.  Paths inside them, and
+/// paths that are outside the root, like those with "..", are passed to
+/// FileManagerStdio.  If the root itself can't be scanned, everything is
+/// passed to FileManagerStdio until the next Invalidate.
+///
+/// The tree is guarded by a mutex, since even lookups can build or sort it,
+/// so the manager can be installed as theFiles while other threads, like
+/// the workers of LoaderThreaded, use it.  The tree is built while the lock
+/// is held, but queries that the tree can't answer go to the operating
+/// system after it's released.
+class FileManagerStdioScanned : public FileManagerStdio
+{
+public:
+   FileManagerStdioScanned()
+   {
+      heapID = HEAP_DEFAULT;
+      treeBuilt = false;
+      treeFailed = false;
+      watchEnabled = false;
+      unscannedCount = 0;
+      syscallsSavedCount = 0;
+      scanSyscallCount = 0;
+#if FILE_MANAGER_STDIO_SCANNED_WATCH_SUPPORTED
+      watchDescriptor = -1;
+#endif
+   }
+   virtual ~FileManagerStdioScanned() {}
+
+   /// Initialize the manager to use the given root in the native file system.
+   /// If no root path is specified, it will use the working directory.  Make
+   /// allocations for the tree from the given heap.  Return true if
+   /// successful.
+   bool Init(const char* _rootPath = NULL, HeapID _heapID = HEAP_DEFAULT);
+   /// Clean up the FileManager itself.
+   virtual void Deinit();
+
+   /// Open a new file object with the given options.
+   /// Create the object in the specified heap.
+   /// Return NULL if unsuccessful.
+   virtual File* Open(const char* filename, int options = READ, HeapID _heapID = HEAP_TEMP);
+
+   /// If the given path corresponds to an existing file or folder, return true.
+   virtual bool ExistsCheck(const char* path);
+   /// Return true if the given path corresponds to a file in the file system,
+   /// as opposed to a folder or nothing at all.
+   virtual bool FileCheck(const char* path);
+   /// Return true if the given path corresponds to a folder in the file system,
+   /// as opposed to a file or nothing at all.
+   virtual bool FolderCheck(const char* path);
+
+   /// Remove the given file from the file system.  Return true if successful.
+   virtual bool FileRemove(const char* path);
+   /// Remove the given folder from the file system.  Return true if successful.
+   virtual bool FolderRemove(const char* path);
+   /// Change the name of the given file.  Return true if successful.
+   virtual bool FileRename(const char* newPath, const char* oldPath);
+   /// Change the name of the given folder.  Return true if successful.
+   virtual bool FolderRename(const char* newPath, const char* oldPath);
+   /// Copy the given file to the new location.  Return true if successful.
+   virtual bool FileCopy(const char* newPath, const char* oldPath, HeapID _heapID = HEAP_TEMP);
+   /// Create the given folder.  Return true if successful.
+   virtual bool FolderCreate(const char* path, bool createParents = false);
+
+   /// Return a table of the files and folders in the given folder.  This is not
+   /// recursive.  This will return NULL if unsuccessful.  When you're done with
+   /// the table returned by this function, pass it to FolderContentsTableFree.
+   virtual Table<const char*>* FolderContentsGet(const char* path,
+      HeapID _heapID = HEAP_DEFAULT, HeapID heapTempID = HEAP_TEMP);
+
+   /// Sets the root path for the filesystem.
+   virtual bool RootPathSet(const char* _rootPath) { Invalidate(); return Inherited::RootPathSet(_rootPath); }
+
+   /// Forget the tree so that it's rebuilt the next time it's needed.  This
+   /// also allows another attempt if building it failed.
+   void Invalidate() { Guard guard(&treeMutex); TreeInvalidate(); }
+   /// If watching is enabled, check for changes made by other programs and
+   /// invalidate the tree if there are any.  Call this regularly, like once
+   /// per frame.
+   void Update();
+   /// Set whether to watch the folders for changes made by other programs.
+   /// This has no effect if FILE_MANAGER_STDIO_SCANNED_WATCH_SUPPORTED is 0.
+   void WatchEnabledSet(bool _watchEnabled) { Guard guard(&treeMutex); watchEnabled = _watchEnabled; TreeInvalidate(); }
+   /// Return true if watching is enabled.
+   bool WatchEnabledCheck() { return watchEnabled; }
+
+   /// Return the number of queries that were answered from the tree rather
+   /// than with calls to the operating system.
+   int SyscallsSavedCountGet() { return syscallsSavedCount; }
+   /// Return the number of calls to the operating system made while building
+   /// the tree.
+   int ScanSyscallCountGet() { return scanSyscallCount; }
+   /// Return the number of files and folders in the tree, including the root.
+   int EntryCountGet() { return entryMap.SizeGet(); }
+   /// Return the number of folders in the tree whose contents are left to
+   /// the operating system.
+   int UnscannedCountGet() { return unscannedCount; }
+
+   typedef FileManagerStdio Inherited;
+
+protected:
+   /// A file or folder in the tree.
+   struct Entry
+   {
+      /// Path relative to the root.
+      const char* path;
+      /// Last component of 'path'.
+      const char* name;
+      /// Index of the folder that contains this, or -1 for the root.
+      int parent;
+      /// For folders, index of the first child, or -1 if there are none.
+      int childFirst;
+      /// Index of the next child of the same folder, or -1.
+      int siblingNext;
+      /// True if this is a folder.
+      bool folder;
+      /// For folders, false if the children aren't in the tree, so questions
+      /// about them go to the operating system.
+      bool scanned;
+   };
+
+   typedef FlatMap<const char*, int> EntryMap;
+
+   /// Return the index of the entry for the given path, -1 if it doesn't
+   /// exist, or -2 if the tree can't answer for it.  'treeMutex' must be
+   /// locked.
+   int EntryFind(const char* path);
+   /// Lock 'treeMutex' and call EntryFind.  If the entry exists and 'folder'
+   /// isn't NULL, set it to whether the entry is a folder.  Count the query
+   /// as saved if the tree could answer it.
+   int EntryFindLocked(const char* path, bool* folder);
+   /// Return a table of the names of the children of the folder at the
+   /// given index, allocated as described in FolderContentsGet.
+   Table<const char*>* ChildrenGet(int entryIndex, HeapID _heapID);
+   /// Return the index of the entry with the given normalized path, or -1 if
+   /// it isn't in the tree.
+   int EntryIndexGet(const char* normalizedPath);
+   /// Shorten the given normalized path to its nearest ancestor in the tree,
+   /// and return the index of that ancestor.
+   int AncestorFind(char* normalizedPath);
+   /// Build the tree if it isn't already built.  Return true if successful.
+   bool TreeCheck();
+   /// Same as Invalidate, but 'treeMutex' must already be locked.
+   void TreeInvalidate() { treeBuilt = false; treeFailed = false; }
+   /// Forget the contents of the tree.
+   void TreeClear();
+   /// Scan the folders from the given index to the end of 'entries', along
+   /// with the folders found inside them.
+   void FoldersScan(int entryIndexFirst);
+   /// Add the contents of the folder at the given index to the tree.  Return
+   /// true if successful.
+   bool FolderScan(int entryIndex);
+   /// Add an entry with the given name to the folder at 'parentIndex', or add
+   /// the root if 'parentIndex' is -1.  Return the index of the new entry, or
+   /// -1 if unsuccessful.
+   int EntryAdd(int parentIndex, const char* name, size_t nameLength, bool folder);
+   /// Note that the folder at the given index won't be scanned.
+   void UnscannedSet(int entryIndex);
+   /// Add the given path to the tree after it was created through this
+   /// FileManager.  If 'createParents' is true, add any missing folders
+   /// that contain it too.  Return the index of the new entry, or -1 if
+   /// nothing was added.
+   int EntryInsert(const char* path, bool folder, bool createParents = false);
+   /// Remove the given path, and everything in it, from the tree after it was
+   /// removed through this FileManager.
+   void EntryRemove(const char* path);
+   /// Remove the entry at the given index, and everything in it, from
+   /// 'entryMap'.
+   void SubtreeForget(int entryIndex);
+   /// Write the version of 'path' that's used as a key to 'buffer'.  Return
+   /// false if the path can't be answered by the tree.
+   static bool PathNormalize(char* buffer, size_t bufferSize, const char* path);
+   /// Comparator for paths, which ignores case where the file system does.
+   static bool PathComparator(const char* const& pathA, const char* const& pathB);
+
+   /// Locked while the tree is used, including by lookups.
+   Mutex treeMutex;
+   /// Heap for the tree.
+   HeapID heapID;
+   /// True if 'entries' reflects the file system.
+   bool treeBuilt;
+   /// True if the root couldn't be scanned, so everything goes to the
+   /// operating system until the next Invalidate.
+   bool treeFailed;
+   /// True if folders should be watched for outside changes.
+   bool watchEnabled;
+   /// All files and folders, starting with the root.  Entries that have been
+   /// removed stay here, but they're no longer in 'entryMap' or linked to a
+   /// folder.
+   Table<Entry> entries;
+   /// Storage for the paths of the entries, which doesn't move as it grows.
+   Arena names;
+   /// Map of the normalized paths to indices in 'entries'.
+   EntryMap entryMap;
+   /// Number of folders in the tree that weren't scanned.
+   int unscannedCount;
+   /// Number of queries answered without the operating system.
+   int syscallsSavedCount;
+   /// Number of operating system calls made while building the tree.
+   int scanSyscallCount;
+#if FILE_MANAGER_STDIO_SCANNED_WATCH_SUPPORTED
+   /// inotify instance used for watching, or -1.
+   int watchDescriptor;
+#endif
+};
+
+//==============================================================================
+
+inline bool FileManagerStdioScanned::Init(const char* _rootPath, HeapID _heapID)
+{
+   heapID = _heapID;
+   treeBuilt = false;
+   treeFailed = false;
+   unscannedCount = 0;
+   syscallsSavedCount = 0;
+   scanSyscallCount = 0;
+   entries.Init(theAllocatorHeaps[heapID]);
+   names.Init(heapID);
+   entryMap.Init(PathComparator, theAllocatorHeaps[heapID]);
+   treeMutex.Init();
+   return Inherited::Init(_rootPath);
+}
+
+//------------------------------------------------------------------------------
+
+inline void FileManagerStdioScanned::Deinit()
+{
+   {
+      Guard guard(&treeMutex);
+      TreeClear();
+      entryMap.Deinit();
+      names.Deinit();
+      entries.Deinit();
+   }
+   treeMutex.Deinit();
+   Inherited::Deinit();
+}
+
+//------------------------------------------------------------------------------
+
+inline File* FileManagerStdioScanned::Open(const char* filename, int options, HeapID _heapID)
+{
+   if(options == READ)
+   {
+      // Skip the attempt to open files that are known not to exist.
+      bool missing;
+      {
+         Guard guard(&treeMutex);
+         missing = (EntryFind(filename) == -1);
+         if(missing)
+            syscallsSavedCount++;
+      }
+      if(missing)
+         return fileManagerFallback ? fileManagerFallback->Open(filename, options, _heapID) : NULL;
+      return Inherited::Open(filename, options, _heapID);
+   }
+
+   File* file = Inherited::Open(filename, options, _heapID);
+   if(file && (options & (WRITE | APPEND)))
+   {
+      Guard guard(&treeMutex);
+      EntryInsert(filename, false);
+   }
+   return file;
+}
+
+//------------------------------------------------------------------------------
+
+inline bool FileManagerStdioScanned::ExistsCheck(const char* path)
+{
+   int entryIndex = EntryFindLocked(path, NULL);
+   if(entryIndex == -2)
+      return Inherited::ExistsCheck(path);
+   if(entryIndex >= 0)
+      return true;
+   return fileManagerFallback ? fileManagerFallback->ExistsCheck(path) : false;
+}
+
+//------------------------------------------------------------------------------
+
+inline bool FileManagerStdioScanned::FileCheck(const char* path)
+{
+   bool folder = false;
+   int entryIndex = EntryFindLocked(path, &folder);
+   if(entryIndex == -2)
+      return Inherited::FileCheck(path);
+   if(entryIndex >= 0)
+      return !folder;
+   return fileManagerFallback ? fileManagerFallback->FileCheck(path) : false;
+}
+
+//------------------------------------------------------------------------------
+
+inline bool FileManagerStdioScanned::FolderCheck(const char* path)
+{
+   bool folder = false;
+   int entryIndex = EntryFindLocked(path, &folder);
+   if(entryIndex == -2)
+      return Inherited::FolderCheck(path);
+   if(entryIndex >= 0)
+      return folder;
+   return fileManagerFallback ? fileManagerFallback->FolderCheck(path) : false;
+}
+
+//------------------------------------------------------------------------------
+
+inline bool FileManagerStdioScanned::FileRemove(const char* path)
+{
+   if(!Inherited::FileRemove(path))
+      return false;
+   Guard guard(&treeMutex);
+   EntryRemove(path);
+   return true;
+}
+
+//------------------------------------------------------------------------------
+
+inline bool FileManagerStdioScanned::FolderRemove(const char* path)
+{
+   if(!Inherited::FolderRemove(path))
+      return false;
+   Guard guard(&treeMutex);
+   EntryRemove(path);
+   return true;
+}
+
+//------------------------------------------------------------------------------
+
+inline bool FileManagerStdioScanned::FileRename(const char* newPath, const char* oldPath)
+{
+   if(!Inherited::FileRename(newPath, oldPath))
+      return false;
+   Guard guard(&treeMutex);
+   EntryRemove(oldPath);
+   EntryInsert(newPath, false);
+   return true;
+}
+
+//------------------------------------------------------------------------------
+
+inline bool FileManagerStdioScanned::FolderRename(const char* newPath, const char* oldPath)
+{
+   if(!Inherited::FolderRename(newPath, oldPath))
+      return false;
+   Guard guard(&treeMutex);
+   EntryRemove(oldPath);
+   // The folder keeps its contents, so they need to be scanned again under
+   // the new name.
+   int entryIndex = EntryInsert(newPath, true);
+   if(entryIndex >= 0)
+      FoldersScan(entryIndex);
+   return true;
+}
+
+//------------------------------------------------------------------------------
+
+inline bool FileManagerStdioScanned::FileCopy(const char* newPath, const char* oldPath, HeapID _heapID)
+{
+   if(!Inherited::FileCopy(newPath, oldPath, _heapID))
+      return false;
+   Guard guard(&treeMutex);
+   EntryInsert(newPath, false);
+   return true;
+}
+
+//------------------------------------------------------------------------------
+
+inline bool FileManagerStdioScanned::FolderCreate(const char* path, bool createParents)
+{
+   if(!Inherited::FolderCreate(path, createParents))
+   {
+      // Some of the parents may have been created before the failure.
+      if(createParents)
+         Invalidate();
+      return false;
+   }
+   Guard guard(&treeMutex);
+   EntryInsert(path, true, createParents);
+   return true;
+}
+
+//------------------------------------------------------------------------------
+
+inline Table<const char*>* FileManagerStdioScanned::FolderContentsGet(const char* path,
+   HeapID _heapID, HeapID heapTempID)
+{
+   {
+      Guard guard(&treeMutex);
+      int entryIndex = EntryFind(path);
+      if((entryIndex != -2) && ((entryIndex < 0) || entries[entryIndex].scanned))
+      {
+         if((entryIndex < 0) || !entries[entryIndex].folder)
+            return NULL;
+         syscallsSavedCount++;
+         return ChildrenGet(entryIndex, _heapID);
+      }
+   }
+   return Inherited::FolderContentsGet(path, _heapID, heapTempID);
+}
+
+//------------------------------------------------------------------------------
+
+inline Table<const char*>* FileManagerStdioScanned::ChildrenGet(int entryIndex, HeapID _heapID)
+{
+   Table<const char*>* contents = frog_new_ex(_heapID) Table<const char*>();
+   contents->Init(theAllocatorHeaps[_heapID]);
+   for(int childIndex = entries[entryIndex].childFirst; childIndex >= 0; childIndex = entries[childIndex].siblingNext)
+   {
+      const char* name = StringClone(entries[childIndex].name, _heapID);
+      if(name)
+         contents->Add(name);
+   }
+   return contents;
+}
+
+//------------------------------------------------------------------------------
+
+inline void FileManagerStdioScanned::Update()
+{
+#if FILE_MANAGER_STDIO_SCANNED_WATCH_SUPPORTED
+   Guard guard(&treeMutex);
+   if(watchDescriptor < 0)
+      return;
+
+   // Any event at all means something changed, so there's no need to look
+   // at the details.
+   char eventBuffer[4096];
+   bool changed = false;
+   while(::read(watchDescriptor, eventBuffer, sizeof(eventBuffer)) > 0)
+      changed = true;
+   if(changed)
+      TreeInvalidate();
+#endif
+}
+
+//------------------------------------------------------------------------------
+
+inline int FileManagerStdioScanned::EntryFind(const char* path)
+{
+   char normalizedPath[FROG_PATH_MAX+1];
+   if(!path || !PathNormalize(normalizedPath, sizeof(normalizedPath), path) || !TreeCheck())
+      return -2;
+   int entryIndex = EntryIndexGet(normalizedPath);
+   if((entryIndex == -1) && unscannedCount && normalizedPath[0])
+   {
+      // Nothing is known about the contents of folders that weren't scanned.
+      int ancestorIndex = AncestorFind(normalizedPath);
+      if(!entries[ancestorIndex].scanned)
+         return -2;
+   }
+   return entryIndex;
+}
+
+//------------------------------------------------------------------------------
+
+inline int FileManagerStdioScanned::EntryFindLocked(const char* path, bool* folder)
+{
+   Guard guard(&treeMutex);
+   int entryIndex = EntryFind(path);
+   if(entryIndex != -2)
+      syscallsSavedCount++;
+   if(folder && (entryIndex >= 0))
+      *folder = entries[entryIndex].folder;
+   return entryIndex;
+}
+
+//------------------------------------------------------------------------------
+
+inline int FileManagerStdioScanned::EntryIndexGet(const char* normalizedPath)
+{
+   EntryMap::Iterator iterator = entryMap.Find(normalizedPath);
+   return iterator.WithinCheck() ? iterator.Value() : -1;
+}
+
+//------------------------------------------------------------------------------
+
+inline int FileManagerStdioScanned::AncestorFind(char* normalizedPath)
+{
+   // The root is always in the tree, so this stops there at the latest.
+   for(;;)
+   {
+      char* separator = strrchr(normalizedPath, '/');
+      if(separator)
+         *separator = '\0';
+      else
+         normalizedPath[0] = '\0';
+      int entryIndex = EntryIndexGet(normalizedPath);
+      if((entryIndex >= 0) || !normalizedPath[0])
+         return entryIndex;
+   }
+}
+
+//------------------------------------------------------------------------------
+
+inline bool FileManagerStdioScanned::TreeCheck()
+{
+   if(treeBuilt)
+      return true;
+   if(treeFailed)
+      return false;
+   TreeClear();
+
+#if FILE_MANAGER_STDIO_SCANNED_WATCH_SUPPORTED
+   if(watchEnabled)
+   {
+      watchDescriptor = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+      scanSyscallCount++;
+   }
+#endif
+
+   // Without the root, the tree can't answer anything, so don't try again
+   // until something changes.
+   if((EntryAdd(-1, "", 0, true) != 0) || !FolderScan(0))
+   {
+      TreeClear();
+      treeFailed = true;
+      return false;
+   }
+   FoldersScan(1);
+   treeBuilt = true;
+   return true;
+}
+
+//------------------------------------------------------------------------------
+
+inline void FileManagerStdioScanned::TreeClear()
+{
+   entryMap.Clear();
+   entries.Clear();
+   names.Deinit();
+   names.Init(heapID);
+   unscannedCount = 0;
+   treeBuilt = false;
+#if FILE_MANAGER_STDIO_SCANNED_WATCH_SUPPORTED
+   if(watchDescriptor >= 0)
+      ::close(watchDescriptor);
+   watchDescriptor = -1;
+#endif
+}
+
+//------------------------------------------------------------------------------
+
+inline void FileManagerStdioScanned::FoldersScan(int entryIndexFirst)
+{
+   // Scan breadth-first.  New entries are added to the end, so the loop
+   // reaches them too.
+   for(int folderIndex = entryIndexFirst; folderIndex < entries.SizeGet(); folderIndex++)
+   {
+      if(entries[folderIndex].folder && entries[folderIndex].scanned && !FolderScan(folderIndex))
+         UnscannedSet(folderIndex);
+   }
+}
+
+//------------------------------------------------------------------------------
+
+inline bool FileManagerStdioScanned::FolderScan(int entryIndex)
+{
+   char nativePath[FROG_PATH_MAX+1];
+   const char* relativePath = entries[entryIndex].path;
+   if(!RootPathApply(nativePath, sizeof(nativePath), relativePath[0] ? relativePath : "."))
+      return false;
+
+#if PLATFORM_IS_WINDOWS
+   char pattern[FROG_PATH_MAX+1];
+   if(!FrogSnprintf(pattern, sizeof(pattern), "%s/*", nativePath))
+      return false;
+   WIN32_FIND_DATAA findData;
+   HANDLE findHandle = ::FindFirstFileA(pattern, &findData);
+   scanSyscallCount++;
+   if(findHandle == INVALID_HANDLE_VALUE)
+      return false;
+   do
+   {
+      const char* name = findData.cFileName;
+      if(strcmp(name, ".") && strcmp(name, ".."))
+      {
+         bool folder = (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+         int childIndex = EntryAdd(entryIndex, name, strlen(name), folder);
+         // Junctions and symbolic links can lead back up the tree.
+         if(folder && (childIndex >= 0) && (findData.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT))
+            UnscannedSet(childIndex);
+      }
+      scanSyscallCount++;
+   } while(::FindNextFileA(findHandle, &findData));
+   ::FindClose(findHandle);
+#else
+   DIR* directory = ::opendir(nativePath);
+   scanSyscallCount++;
+   if(!directory)
+      return false;
+#if FILE_MANAGER_STDIO_SCANNED_WATCH_SUPPORTED
+   if(watchDescriptor >= 0)
+   {
+      ::inotify_add_watch(watchDescriptor, nativePath, IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF);
+      scanSyscallCount++;
+   }
+#endif
+   for(;;)
+   {
+      struct dirent* directoryEntry = ::readdir(directory);
+      scanSyscallCount++;
+      if(!directoryEntry)
+         break;
+      const char* name = directoryEntry->d_name;
+      if(!strcmp(name, ".") || !strcmp(name, ".."))
+         continue;
+
+      // Some file systems don't report the type, so fall back to 'lstat'.
+      // Symbolic links need a 'stat' to find what they point to.
+      bool folder = (directoryEntry->d_type == DT_DIR);
+      bool link = (directoryEntry->d_type == DT_LNK);
+      if((directoryEntry->d_type == DT_UNKNOWN) || link)
+      {
+         char childPath[FROG_PATH_MAX+1];
+         struct stat fileStatus;
+         if(FrogSnprintf(childPath, sizeof(childPath), "%s/%s", nativePath, name))
+         {
+            if(!link)
+            {
+               if(!::lstat(childPath, &fileStatus))
+               {
+                  folder = S_ISDIR(fileStatus.st_mode);
+                  link = S_ISLNK(fileStatus.st_mode);
+               }
+               scanSyscallCount++;
+            }
+            if(link)
+            {
+               if(!::stat(childPath, &fileStatus))
+                  folder = S_ISDIR(fileStatus.st_mode);
+               scanSyscallCount++;
+            }
+         }
+      }
+      int childIndex = EntryAdd(entryIndex, name, strlen(name), folder);
+      // A linked folder can lead back up the tree, so leave it to the
+      // operating system.
+      if(folder && link && (childIndex >= 0))
+         UnscannedSet(childIndex);
+   }
+   ::closedir(directory);
+#endif
+
+   return true;
+}
+
+//------------------------------------------------------------------------------
+
+inline int FileManagerStdioScanned::EntryAdd(int parentIndex, const char* name, size_t nameLength, bool folder)
+{
+   const char* parentPath = (parentIndex >= 0) ? entries[parentIndex].path : "";
+   size_t parentPathLength = strlen(parentPath);
+   size_t separatorLength = parentPathLength ? 1 : 0;
+   // Paths that are too long couldn't be looked up anyway.
+   if(parentPathLength + separatorLength + nameLength > FROG_PATH_MAX)
+   {
+      if(parentIndex >= 0)
+         UnscannedSet(parentIndex);
+      return -1;
+   }
+   char* path = (char*)names.Allocate(parentPathLength + separatorLength + nameLength + 1);
+   if(!path)
+      return -1;
+   memcpy(path, parentPath, parentPathLength);
+   if(separatorLength)
+      path[parentPathLength] = '/';
+   memcpy(path + parentPathLength + separatorLength, name, nameLength);
+   path[parentPathLength + separatorLength + nameLength] = '\0';
+
+   Entry entry;
+   entry.path = path;
+   entry.name = path + parentPathLength + separatorLength;
+   entry.parent = parentIndex;
+   entry.childFirst = -1;
+   entry.siblingNext = -1;
+   entry.folder = folder;
+   entry.scanned = true;
+   int entryIndex = entries.SizeGet();
+   if(parentIndex >= 0)
+   {
+      entry.siblingNext = entries[parentIndex].childFirst;
+      entries[parentIndex].childFirst = entryIndex;
+   }
+   entries.Add(entry);
+   // The map is sorted once by the next lookup.
+   entryMap.AddUnsorted(entry.path, entryIndex);
+   return entryIndex;
+}
+
+//------------------------------------------------------------------------------
+
+inline void FileManagerStdioScanned::UnscannedSet(int entryIndex)
+{
+   if(entries[entryIndex].scanned)
+   {
+      entries[entryIndex].scanned = false;
+      unscannedCount++;
+   }
+}
+
+//------------------------------------------------------------------------------
+
+inline int FileManagerStdioScanned::EntryInsert(const char* path, bool folder, bool createParents)
+{
+   if(!treeBuilt)
+      return -1;
+   char normalizedPath[FROG_PATH_MAX+1];
+   if(!PathNormalize(normalizedPath, sizeof(normalizedPath), path))
+   {
+      // The path may still lead back inside the root, like "../Root/a".
+      TreeInvalidate();
+      return -1;
+   }
+   if(!normalizedPath[0])
+      return -1;
+   int entryIndex = EntryIndexGet(normalizedPath);
+   if(entryIndex >= 0)
+   {
+      // Something replaced a file with a folder or the other way around.
+      if(entries[entryIndex].folder != folder)
+         TreeInvalidate();
+      return -1;
+   }
+
+   char ancestorPath[FROG_PATH_MAX+1];
+   memcpy(ancestorPath, normalizedPath, strlen(normalizedPath) + 1);
+   int parentIndex = AncestorFind(ancestorPath);
+   if(!entries[parentIndex].scanned)
+      return -1;
+
+   // Add each missing component below the nearest ancestor.
+   size_t componentStart = ancestorPath[0] ? strlen(ancestorPath) + 1 : 0;
+   for(;;)
+   {
+      const char* componentEnd = strchr(normalizedPath + componentStart, '/');
+      if(componentEnd && !createParents)
+      {
+         // The parent exists, so the tree is out of date.
+         TreeInvalidate();
+         return -1;
+      }
+      size_t componentLength = componentEnd ? (size_t)(componentEnd - normalizedPath) - componentStart
+         : strlen(normalizedPath + componentStart);
+      entryIndex = EntryAdd(parentIndex, normalizedPath + componentStart, componentLength, componentEnd ? true : folder);
+      if((entryIndex < 0) || !componentEnd)
+         return entryIndex;
+      parentIndex = entryIndex;
+      componentStart += componentLength + 1;
+   }
+}
+
+//------------------------------------------------------------------------------
+
+inline void FileManagerStdioScanned::EntryRemove(const char* path)
+{
+   if(!treeBuilt)
+      return;
+   char normalizedPath[FROG_PATH_MAX+1];
+   if(!PathNormalize(normalizedPath, sizeof(normalizedPath), path))
+   {
+      TreeInvalidate();
+      return;
+   }
+   int entryIndex = EntryIndexGet(normalizedPath);
+   if(entryIndex < 0)
+      return;
+   if(entryIndex == 0)
+   {
+      TreeInvalidate();
+      return;
+   }
+
+   // Unlink it from its folder.
+   int* link = &entries[entries[entryIndex].parent].childFirst;
+   while(*link != entryIndex)
+      link = &entries[*link].siblingNext;
+   *link = entries[entryIndex].siblingNext;
+   SubtreeForget(entryIndex);
+}
+
+//------------------------------------------------------------------------------
+
+inline void FileManagerStdioScanned::SubtreeForget(int entryIndex)
+{
+   for(int childIndex = entries[entryIndex].childFirst; childIndex >= 0; childIndex = entries[childIndex].siblingNext)
+      SubtreeForget(childIndex);
+   if(!entries[entryIndex].scanned)
+      unscannedCount--;
+   const char* key = entries[entryIndex].path;
+   entryMap.Remove(key);
+}
+
+//------------------------------------------------------------------------------
+
+inline bool FileManagerStdioScanned::PathNormalize(char* buffer, size_t bufferSize, const char* path)
+{
+   // Absolute paths and drive letters are outside the root.
+   if((path[0] == '/') || (path[0] == '\\') || strchr(path, ':'))
+      return false;
+
+   size_t length = 0;
+   while(*path)
+   {
+      // Find the next component.
+      while((*path == '/') || (*path == '\\'))
+         path++;
+      const char* componentEnd = path;
+      while(*componentEnd && (*componentEnd != '/') && (*componentEnd != '\\'))
+         componentEnd++;
+      size_t componentLength = componentEnd - path;
+
+      if((componentLength == 2) && (path[0] == '.') && (path[1] == '.'))
+         return false;
+      if(componentLength && !((componentLength == 1) && (path[0] == '.')))
+      {
+         if(length + (length ? 1 : 0) + componentLength + 1 > bufferSize)
+            return false;
+         if(length)
+            buffer[length++] = '/';
+         memcpy(buffer + length, path, componentLength);
+         length += componentLength;
+      }
+      path = componentEnd;
+   }
+   if(!bufferSize)
+      return false;
+   buffer[length] = '\0';
+   return true;
+}
+
+//------------------------------------------------------------------------------
+
+inline bool FileManagerStdioScanned::PathComparator(const char* const& pathA, const char* const& pathB)
+{
+#if PLATFORM_IS_WINDOWS || PLATFORM_IS_MACOSX
+   const unsigned char* a = (const unsigned char*)pathA;
+   const unsigned char* b = (const unsigned char*)pathB;
+   while(*a && (tolower(*a) == tolower(*b)))
+   {
+      a++;
+      b++;
+   }
+   return tolower(*a) < tolower(*b);
+#else
+   return strcmp(pathA, pathB) < 0;
+#endif
+}
+
+//------------------------------------------------------------------------------
+
+} //namespace Webfoot {
+
+#endif //#ifndef __FROG__FILEMANAGERSTDIOSCANNED_H__
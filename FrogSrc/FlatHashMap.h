@@ -0,0 +1,627 @@
+#ifndef __FROG__FLATHASHMAP_H__
+#define __FROG__FLATHASHMAP_H__
+
+#include "FrogMemory.h"
+#include <new>
+#include <string.h>
+#include <assert.h>
+#include "Allocator.h"
+#include "Table.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+   #include <emmintrin.h>
+   /// True if FlatHashMap should use SSE2 to check a group of control bytes at once.
+   #define FLAT_HASH_MAP_SSE2 1
+#else
+   #define FLAT_HASH_MAP_SSE2 0
+#endif
+
+namespace Webfoot {
+
+template<typename KeyType, typename ValueType, typename HashFunctionType, typename KeysEqualFunctionType> class FlatHashMap;
+
+/// Number of control bytes FlatHashMap checks at once while probing.  The
+/// number of slots is always a power of 2 at least this big.
+#define FLAT_HASH_MAP_GROUP_SIZE 16
+/// Number of slots that must be full, out of every 8, before a FlatHashMap grows.
+#define FLAT_HASH_MAP_LOAD_EIGHTHS_MAX 7
+
+//===============================================================================
+
+/// \brief An iterator for the FlatHashMap class
+///
+/// FlatHashMapIterator has the same interface as HashTableIterator.  It visits
+/// the items in slot order, which is unrelated to the order in which they
+/// were added.  Adding items can invalidate it, as can removing items other
+/// than by passing this iterator to FlatHashMap::Remove.
+template<typename KeyType, typename ValueType, typename HashFunctionType = size_t(*)(const KeyType& key),
+   typename KeysEqualFunctionType = bool(*)(const KeyType& keyA, const KeyType& keyB)>
+class FlatHashMapIterator
+{
+public:
+   /// Set the iterator to begin at the given slot of the specified FlatHashMap.
+   /// -1 is one before the beginning, and the number of slots is one past the end.
+   void Init(FlatHashMap<KeyType,ValueType,HashFunctionType,KeysEqualFunctionType>* _flatHashMap, int _slotIndex)
+   {
+      flatHashMap = _flatHashMap;
+      slotIndex = _slotIndex;
+   }
+
+   /// Go to the next item in the sequence.
+   void Next()
+   {
+      assert(flatHashMap);
+      slotIndex = flatHashMap->SlotNextGet(slotIndex);
+   }
+
+   /// Go to the previous item in the sequence.
+   void Previous()
+   {
+      assert(flatHashMap);
+      slotIndex = flatHashMap->SlotPreviousGet(slotIndex);
+   }
+
+   /// Return true if there is another item in the sequence after this position.
+   bool NextCheck()
+   {
+      assert(flatHashMap);
+      return flatHashMap && (slotIndex != flatHashMap->SlotEndGet());
+   }
+
+   /// Return true if there is another item in the sequence before this position.
+   bool PreviousCheck()
+   {
+      assert(flatHashMap);
+      return flatHashMap && (slotIndex != -1);
+   }
+
+   /// Return a reference to the key at the current position.
+   const KeyType& Key()
+   {
+      assert(WithinCheck());
+      return flatHashMap->slots[slotIndex].key;
+   }
+
+   /// Return a reference to the value at the current position.
+   ValueType& Value()
+   {
+      assert(WithinCheck());
+      return flatHashMap->slots[slotIndex].value;
+   }
+
+   /// Return true if the iterator is within the sequence.  Return false if it
+   /// is past the end or before the beginning.  This does not guarantee that
+   /// the item at the current position was not removed from the sequence.
+   bool WithinCheck()
+   {
+      assert(flatHashMap);
+      return (slotIndex >= 0) && (slotIndex < flatHashMap->SlotEndGet());
+   }
+
+   /// Return a copy of this iterator.
+   FlatHashMapIterator<KeyType,ValueType,HashFunctionType,KeysEqualFunctionType> Clone()
+   {
+      FlatHashMapIterator<KeyType,ValueType,HashFunctionType,KeysEqualFunctionType> clone;
+      clone.Init(flatHashMap, slotIndex);
+      return clone;
+   }
+
+protected:
+   /// Index of the current slot.
+   int slotIndex;
+   /// The map over which this will be iterating.
+   FlatHashMap<KeyType,ValueType,HashFunctionType,KeysEqualFunctionType>* flatHashMap;
+
+   friend class FlatHashMap<KeyType,ValueType,HashFunctionType,KeysEqualFunctionType>;
+};
+
+//===============================================================================
+
+/// FlatHashMap has the same interface as HashTable, but it stores its items
+/// directly in a single array using open addressing, so a lookup typically
+/// touches one cache line of control bytes and one slot rather than following
+/// a chain of nodes.  Each slot has a control byte that is either empty,
+/// deleted, or 7 bits of the hash of the slot's key.  Probing checks
+/// FLAT_HASH_MAP_GROUP_SIZE control bytes at a time, using SSE2 where
+/// available, and only compares keys whose 7 bits match.
+///
+/// Unlike HashTable, iteration order is unrelated to the order in which items
+/// were added, and growing the map moves the items, so don't keep pointers to
+/// keys or values across calls to Add or operator[].  Keys and values are
+/// moved with TableMove when the map grows.  Be sure to call Deinit when
+/// you're finished with the collection.
+///
+///  FlatHashMap<const char*,int> testMap;
+///  testMap.Init(StringHash, StringsEqualCheck);
+template<typename KeyType, typename ValueType, typename HashFunctionType = size_t(*)(const KeyType& key),
+   typename KeysEqualFunctionType = bool(*)(const KeyType& keyA, const KeyType& keyB)>
+class FlatHashMap
+{
+public:
+   /// The iterator type for this class.
+   typedef FlatHashMapIterator<KeyType,ValueType,HashFunctionType,KeysEqualFunctionType> Iterator;
+
+   FlatHashMap()
+   {
+      size = 0;
+      reserveSize = 0;
+      slotCount = 0;
+      growthLeft = 0;
+      hashFunction = NULL;
+      keysEqualFunction = NULL;
+      allocator = NULL;
+      slots = NULL;
+      controls = NULL;
+   }
+
+   /// Initialize a new, empty collection.
+   void Init(HashFunctionType _hashFunction, KeysEqualFunctionType _keysEqualFunction,
+      Allocator* _allocator = theAllocatorDefault)
+   {
+      hashFunction = _hashFunction;
+      keysEqualFunction = _keysEqualFunction;
+      allocator = _allocator;
+      size = 0;
+      reserveSize = 0;
+      slotCount = 0;
+      growthLeft = 0;
+      slots = NULL;
+      controls = NULL;
+   }
+
+   /// Clean up the collection.
+   void Deinit()
+   {
+      Clear();
+      if(allocator && slots)
+         allocator->Deallocate((void*)slots);
+      slots = NULL;
+      controls = NULL;
+      slotCount = 0;
+      growthLeft = 0;
+      reserveSize = 0;
+      hashFunction = NULL;
+      keysEqualFunction = NULL;
+      allocator = NULL;
+   }
+
+   /// Add the given key/value pair.  Return true if successful and false if
+   /// there was already an item in the collection with the specified key.
+   bool Add(const KeyType& key, const ValueType& value)
+   {
+      size_t hash = HashGet(key);
+      if(SlotFind(key, hash) >= 0)
+         return false;
+      int slotIndex = SlotClaim(hash);
+      if(slotIndex < 0)
+         return false;
+      SlotConstruct(slotIndex, key, value);
+      return true;
+   }
+
+   /// Remove the entry with the given key.  Return true if successful.
+   bool Remove(const KeyType& key)
+   {
+      int slotIndex = SlotFind(key, HashGet(key));
+      if(slotIndex < 0)
+         return false;
+      SlotRemove(slotIndex);
+      return true;
+   }
+
+   /// Remove the item at the current position of the iterator.
+   /// If successful, return true and set the iterator to the subsequent item.
+   bool Remove(Iterator& iterator)
+   {
+      if((iterator.flatHashMap != this) || !iterator.WithinCheck() || !ControlFullCheck(controls[iterator.slotIndex]))
+         return false;
+      SlotRemove(iterator.slotIndex);
+      iterator.Next();
+      return true;
+   }
+
+   /// Remove all the entries in the collection.
+   /// This does not deallocate any memory.
+   void Clear()
+   {
+      if(!slots)
+         return;
+      for(int slotIndex = 0; slotIndex < slotCount; slotIndex++)
+      {
+         if(ControlFullCheck(controls[slotIndex]))
+            slots[slotIndex].~Slot();
+      }
+      memset(controls, CONTROL_EMPTY, slotCount + FLAT_HASH_MAP_GROUP_SIZE);
+      size = 0;
+      growthLeft = GrowthLimitGet(slotCount);
+   }
+
+   /// Return a reference to the value for the given key.  If there is no
+   /// entry with that key yet, a new one is added.  If memory for the new
+   /// entry can't be allocated, a reference to a placeholder value that
+   /// isn't in the collection is returned instead.
+   ValueType& ValueGet(const KeyType& key) { return (*this)[key]; }
+   /// Same as ValueGet
+   ValueType& operator[](const KeyType& key)
+   {
+      size_t hash = HashGet(key);
+      int slotIndex = SlotFind(key, hash);
+      if(slotIndex < 0)
+      {
+         slotIndex = SlotClaim(hash);
+         if(slotIndex < 0)
+         {
+            placeholderValue = ValueType();
+            return placeholderValue;
+         }
+         SlotConstruct(slotIndex, key, ValueType());
+      }
+      return slots[slotIndex].value;
+   }
+
+   /// Return the number of items in the collection.
+   int SizeGet() const { return size; }
+   /// Return true if the collection is empty.
+   bool EmptyCheck() const { return size == 0; }
+   /// Return true if no more elements can be added without allocating more memory.
+   bool FullCheck() const { return growthLeft == 0; }
+   /// Return the current number of items for which space is allocated.
+   int CapacityGet() const { return size + growthLeft; }
+
+   /// Return an iterator at the position of the item with the given key.
+   /// If the item is not found, the iterator will be pointing one item past
+   /// the end of the collection.
+   Iterator Find(const KeyType& key)
+   {
+      int slotIndex = size ? SlotFind(key, HashGet(key)) : -1;
+      Iterator iterator;
+      iterator.Init(this, (slotIndex >= 0) ? slotIndex : SlotEndGet());
+      return iterator;
+   }
+
+   /// Return an iterator pointing the the first element in the collection.
+   /// If the collection is empty, it will be pointing one element past the end.
+   Iterator Begin()
+   {
+      Iterator iterator;
+      iterator.Init(this, SlotNextGet(-1));
+      return iterator;
+   }
+
+   /// Return an iterator pointing the the last element in the collection.
+   /// If the collection is empty, it will be pointing one element before the beginning.
+   Iterator BeginBack()
+   {
+      Iterator iterator;
+      iterator.Init(this, SlotPreviousGet(SlotEndGet()));
+      return iterator;
+   }
+
+   /// Make sure at least the given number of items can be held without
+   /// growing.  If this is called a subsequent time with a lower value, the
+   /// slots are reallocated to a smaller size if the current items allow.
+   void ReserveSizeSet(int _reserveSize)
+   {
+      reserveSize = _reserveSize;
+      int newSlotCount = SlotCountForSizeGet(std::max(reserveSize, size));
+      if(newSlotCount != slotCount)
+         Rehash(newSlotCount);
+   }
+
+   /// Return the minimum number of items this collection is currently keeping allocated.
+   int ReserveSizeGet() { return reserveSize; }
+
+protected:
+   /// Storage for an item.
+   struct Slot
+   {
+      Slot(const KeyType& _key, const ValueType& _value) : key(_key), value(_value) {}
+
+      KeyType key;
+      ValueType value;
+   };
+
+   enum
+   {
+      /// Control byte for a slot that has never held an item since the last rehash.
+      CONTROL_EMPTY = 0x80,
+      /// Control byte for a slot whose item was removed.
+      CONTROL_DELETED = 0xFE
+   };
+
+   /// Return true if the given control byte marks a slot with an item.
+   static bool ControlFullCheck(unsigned char control) { return (control & 0x80) == 0; }
+
+   /// Return the hash of the given key with the bits mixed, since hash
+   /// functions like pointer hashes often leave the low bits poorly distributed.
+   size_t HashGet(const KeyType& key)
+   {
+      size_t hash = hashFunction(key);
+      hash ^= hash >> 15;
+      hash *= (size_t)0x2C1B3C6DU;
+      hash ^= hash >> 12;
+      return hash;
+   }
+   /// Return the part of the hash used to choose the first group to probe.
+   static size_t Hash1Get(size_t hash) { return hash >> 7; }
+   /// Return the part of the hash stored in the control byte.
+   static unsigned char Hash2Get(size_t hash) { return (unsigned char)(hash & 0x7F); }
+
+   /// Return a bit mask with a bit set for each of the FLAT_HASH_MAP_GROUP_SIZE
+   /// control bytes starting at 'group' that equal 'control'.
+   static unsigned int GroupMatchGet(const unsigned char* group, unsigned char control)
+   {
+   #if FLAT_HASH_MAP_SSE2
+      __m128i groupBytes = _mm_loadu_si128((const __m128i*)group);
+      return (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(groupBytes, _mm_set1_epi8((char)control)));
+   #else
+      unsigned int mask = 0;
+      for(int byteIndex = 0; byteIndex < FLAT_HASH_MAP_GROUP_SIZE; byteIndex++)
+      {
+         if(group[byteIndex] == control)
+            mask |= 1U << byteIndex;
+      }
+      return mask;
+   #endif
+   }
+   /// Return a bit mask with a bit set for each of the FLAT_HASH_MAP_GROUP_SIZE
+   /// control bytes starting at 'group' that are empty or deleted.
+   static unsigned int GroupAvailableGet(const unsigned char* group)
+   {
+   #if FLAT_HASH_MAP_SSE2
+      // Only empty and deleted have the high bit set.
+      return (unsigned int)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)group));
+   #else
+      unsigned int mask = 0;
+      for(int byteIndex = 0; byteIndex < FLAT_HASH_MAP_GROUP_SIZE; byteIndex++)
+      {
+         if(!ControlFullCheck(group[byteIndex]))
+            mask |= 1U << byteIndex;
+      }
+      return mask;
+   #endif
+   }
+   /// Return the index of the lowest set bit in a non-zero value.
+   static int LowestBitIndexGet(unsigned int value)
+   {
+      static const int deBruijnBitIndices[32] =
+      {
+         0, 1, 28, 2, 29, 14, 24, 3, 30, 22, 20, 15, 25, 17, 4, 8,
+         31, 27, 13, 23, 21, 19, 16, 7, 26, 12, 18, 6, 11, 5, 10, 9
+      };
+      return deBruijnBitIndices[((value & (0U - value)) * 0x077CB531U) >> 27];
+   }
+
+   /// Return the most items that can be held by the given number of slots.
+   static int GrowthLimitGet(int _slotCount) { return (_slotCount / 8) * FLAT_HASH_MAP_LOAD_EIGHTHS_MAX; }
+   /// Return the number of slots to use for the given number of items.
+   static int SlotCountForSizeGet(int _size)
+   {
+      if(_size <= 0)
+         return 0;
+      int _slotCount = FLAT_HASH_MAP_GROUP_SIZE;
+      while(GrowthLimitGet(_slotCount) < _size)
+         _slotCount *= 2;
+      return _slotCount;
+   }
+
+   /// Set the control byte for the given slot, including the copy past the end
+   /// that lets groups near the end be read without wrapping.
+   void ControlSet(int slotIndex, unsigned char control)
+   {
+      controls[slotIndex] = control;
+      if(slotIndex < FLAT_HASH_MAP_GROUP_SIZE)
+         controls[slotCount + slotIndex] = control;
+   }
+
+   /// Return the index of the slot with the given key, or -1 if there isn't one.
+   int SlotFind(const KeyType& key, size_t hash)
+   {
+      if(!slotCount)
+         return -1;
+      size_t mask = (size_t)slotCount - 1;
+      size_t offset = Hash1Get(hash) & mask;
+      unsigned char hash2 = Hash2Get(hash);
+      for(size_t probeDistance = FLAT_HASH_MAP_GROUP_SIZE; ; probeDistance += FLAT_HASH_MAP_GROUP_SIZE)
+      {
+         const unsigned char* group = &controls[offset];
+         for(unsigned int matches = GroupMatchGet(group, hash2); matches; matches &= matches - 1)
+         {
+            int slotIndex = (int)((offset + LowestBitIndexGet(matches)) & mask);
+            if(keysEqualFunction(slots[slotIndex].key, key))
+               return slotIndex;
+         }
+         // An empty slot in the group means the key would have been placed there.
+         if(GroupMatchGet(group, CONTROL_EMPTY))
+            return -1;
+         if(probeDistance > (size_t)slotCount)
+            return -1;
+         offset = (offset + probeDistance) & mask;
+      }
+   }
+
+   /// Return the index of an available slot for an item with the given hash,
+   /// growing if needed, and mark it as used.  The caller must then construct
+   /// the item.  Return -1 if memory can't be allocated.
+   int SlotClaim(size_t hash)
+   {
+      int slotIndex = SlotAvailableFind(hash);
+      if((slotIndex < 0) || ((controls[slotIndex] == CONTROL_EMPTY) && !growthLeft))
+      {
+         // Grow if the map is getting full.  Otherwise, there are enough
+         // deleted slots that rehashing at the same size will make room.
+         Rehash((size * 2 >= GrowthLimitGet(slotCount)) ? SlotCountForSizeGet((size + 1) * 2) : slotCount);
+         slotIndex = SlotAvailableFind(hash);
+         if((slotIndex < 0) || ((controls[slotIndex] == CONTROL_EMPTY) && !growthLeft))
+            return -1;
+      }
+      if(controls[slotIndex] == CONTROL_EMPTY)
+         growthLeft--;
+      ControlSet(slotIndex, Hash2Get(hash));
+      size++;
+      return slotIndex;
+   }
+
+   /// Return the first empty or deleted slot along the probe sequence for the
+   /// given hash, or -1 if there are no slots.
+   int SlotAvailableFind(size_t hash)
+   {
+      if(!slotCount)
+         return -1;
+      size_t mask = (size_t)slotCount - 1;
+      size_t offset = Hash1Get(hash) & mask;
+      for(size_t probeDistance = FLAT_HASH_MAP_GROUP_SIZE; ; probeDistance += FLAT_HASH_MAP_GROUP_SIZE)
+      {
+         unsigned int available = GroupAvailableGet(&controls[offset]);
+         if(available)
+            return (int)((offset + LowestBitIndexGet(available)) & mask);
+         offset = (offset + probeDistance) & mask;
+      }
+   }
+
+   /// Construct the item in a slot returned by SlotClaim.
+   void SlotConstruct(int slotIndex, const KeyType& key, const ValueType& value)
+   {
+      try
+      {
+         new((void*)&slots[slotIndex]) Slot(key, value);
+      }
+      catch(...)
+      {
+         ControlSet(slotIndex, CONTROL_DELETED);
+         size--;
+         throw;
+      }
+   }
+
+   /// Destroy the item in the given slot and mark it as deleted.
+   void SlotRemove(int slotIndex)
+   {
+      slots[slotIndex].~Slot();
+      // If the run of non-empty slots around this one is shorter than a
+      // group, no probe could have passed over it, so it can be made empty
+      // again rather than deleted.
+      size_t mask = (size_t)slotCount - 1;
+      unsigned int emptyAfter = GroupMatchGet(&controls[slotIndex], CONTROL_EMPTY);
+      unsigned int emptyBefore = GroupMatchGet(&controls[((size_t)slotIndex - FLAT_HASH_MAP_GROUP_SIZE) & mask], CONTROL_EMPTY);
+      int runAfter = emptyAfter ? LowestBitIndexGet(emptyAfter) : FLAT_HASH_MAP_GROUP_SIZE;
+      int runBefore = 0;
+      while((runBefore < FLAT_HASH_MAP_GROUP_SIZE) && !(emptyBefore & (1U << (FLAT_HASH_MAP_GROUP_SIZE - 1 - runBefore))))
+         runBefore++;
+      if(runAfter + runBefore < FLAT_HASH_MAP_GROUP_SIZE)
+      {
+         ControlSet(slotIndex, CONTROL_EMPTY);
+         growthLeft++;
+      }
+      else
+      {
+         ControlSet(slotIndex, CONTROL_DELETED);
+      }
+      size--;
+   }
+
+   /// Return the index of the next full slot after the given one, or
+   /// SlotEndGet() if there isn't one.
+   int SlotNextGet(int slotIndex)
+   {
+      for(slotIndex++; slotIndex < slotCount; slotIndex++)
+      {
+         if(ControlFullCheck(controls[slotIndex]))
+            return slotIndex;
+      }
+      return SlotEndGet();
+   }
+   /// Return the index of the previous full slot before the given one, or -1
+   /// if there isn't one.
+   int SlotPreviousGet(int slotIndex)
+   {
+      for(slotIndex--; slotIndex >= 0; slotIndex--)
+      {
+         if(ControlFullCheck(controls[slotIndex]))
+            return slotIndex;
+      }
+      return -1;
+   }
+   /// Return the slot index used for one past the end.
+   int SlotEndGet() { return slotCount; }
+
+   /// Reallocate the slots with the given count and move all the items.
+   void Rehash(int newSlotCount);
+
+   /// Number of items in the collection
+   int size;
+   /// Keep room for at least this many items.
+   int reserveSize;
+   /// Number of slots.  This is 0 or a power of 2 of at least FLAT_HASH_MAP_GROUP_SIZE.
+   int slotCount;
+   /// Number of empty slots that can be filled before growing.
+   int growthLeft;
+   /// Pointer to a function or functor used to hash keys.
+   HashFunctionType hashFunction;
+   /// Pointer to a function or functor used to test whether two keys are
+   /// equivalent.
+   KeysEqualFunctionType keysEqualFunction;
+   /// Pointer to the allocator used for the slots.
+   Allocator* allocator;
+   /// Array of slots for items.  The control bytes are in the same allocation.
+   Slot* slots;
+   /// Control byte for each slot, followed by copies of the first
+   /// FLAT_HASH_MAP_GROUP_SIZE bytes.
+   unsigned char* controls;
+   /// Returned by operator[] when a new entry can't be added.
+   ValueType placeholderValue;
+
+   friend class FlatHashMapIterator<KeyType, ValueType, HashFunctionType, KeysEqualFunctionType>;
+};
+
+//===============================================================================
+
+template<typename KeyType, typename ValueType, typename HashFunctionType, typename KeysEqualFunctionType>
+void FlatHashMap<KeyType,ValueType,HashFunctionType,KeysEqualFunctionType>::Rehash(int newSlotCount)
+{
+   assert(allocator);
+   assert(newSlotCount >= SlotCountForSizeGet(size));
+
+   Slot* oldSlots = slots;
+   unsigned char* oldControls = controls;
+   int oldSlotCount = slotCount;
+
+   if(newSlotCount)
+   {
+      Slot* newSlots = (Slot*)allocator->Allocate((sizeof(Slot) * newSlotCount) + newSlotCount + FLAT_HASH_MAP_GROUP_SIZE);
+      if(!newSlots)
+         return;
+      slots = newSlots;
+      controls = (unsigned char*)(newSlots + newSlotCount);
+      memset(controls, CONTROL_EMPTY, newSlotCount + FLAT_HASH_MAP_GROUP_SIZE);
+   }
+   else
+   {
+      slots = NULL;
+      controls = NULL;
+   }
+   slotCount = newSlotCount;
+   growthLeft = GrowthLimitGet(slotCount) - size;
+
+   // Move each item to its place in the new slots.
+   for(int oldSlotIndex = 0; oldSlotIndex < oldSlotCount; oldSlotIndex++)
+   {
+      if(!ControlFullCheck(oldControls[oldSlotIndex]))
+         continue;
+      Slot& oldSlot = oldSlots[oldSlotIndex];
+      size_t hash = HashGet(oldSlot.key);
+      int slotIndex = SlotAvailableFind(hash);
+      ControlSet(slotIndex, Hash2Get(hash));
+      new((void*)&slots[slotIndex]) Slot(TableMove(oldSlot.key), TableMove(oldSlot.value));
+      oldSlot.~Slot();
+   }
+
+   if(oldSlots)
+      allocator->Deallocate((void*)oldSlots);
+}
+
+//-------------------------------------------------------------------------------
+
+} //namespace Webfoot {
+
+#endif //#ifndef __FROG__FLATHASHMAP_H__
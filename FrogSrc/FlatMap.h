@@ -0,0 +1,468 @@
+#ifndef __FROG__FLATMAP_H__
+#define __FROG__FLATMAP_H__
+
+#include "FrogMemory.h"
+#include <algorithm>
+#include <assert.h>
+#include "Allocator.h"
+#include "Table.h"
+#include "Map.h"
+
+namespace Webfoot {
+
+template<typename KeyType, typename ValueType, typename ComparatorType, bool eytzingerLayout> class FlatMap;
+
+//===============================================================================
+
+/// \brief An iterator for the FlatMap class
+///
+/// FlatMapIterator has the same interface as MapIterator and visits the items
+/// in sorted order.  Adding or removing items invalidates it, unless the item
+/// was removed using this iterator as the parameter to FlatMap::Remove.
+template<typename KeyType, typename ValueType, typename ComparatorType = bool(*)(const KeyType& keyA, const KeyType& keyB),
+   bool eytzingerLayout = false>
+class FlatMapIterator
+{
+public:
+   /// Set the iterator to begin at the given index of the specified FlatMap.
+   /// -1 is one before the beginning, and the size is one past the end.
+   void Init(FlatMap<KeyType,ValueType,ComparatorType,eytzingerLayout>* _flatMap, int _index)
+   {
+      flatMap = _flatMap;
+      index = _index;
+   }
+
+   /// Go to the next item in the sequence.
+   void Next()
+   {
+      assert(flatMap);
+      assert(index < flatMap->SizeGet());
+      index++;
+   }
+
+   /// Go to the previous item in the sequence.
+   void Previous()
+   {
+      assert(flatMap);
+      assert(index >= 0);
+      index--;
+   }
+
+   /// Return true if there is another item in the sequence after this position.
+   bool NextCheck()
+   {
+      assert(flatMap);
+      return flatMap && (index < flatMap->SizeGet());
+   }
+
+   /// Return true if there is another item in the sequence before this position.
+   bool PreviousCheck()
+   {
+      assert(flatMap);
+      return flatMap && (index >= 0);
+   }
+
+   /// Return a reference to the key at the current position.
+   const KeyType& Key()
+   {
+      assert(WithinCheck());
+      return flatMap->entries[index].key;
+   }
+
+   /// Return a reference to the value at the current position.
+   ValueType& Value()
+   {
+      assert(WithinCheck());
+      return flatMap->entries[index].value;
+   }
+
+   /// Return true if the iterator is within the sequence.  Return false if it
+   /// is past the end or before the beginning.
+   bool WithinCheck()
+   {
+      assert(flatMap);
+      return (index >= 0) && (index < flatMap->SizeGet());
+   }
+
+   /// Return a copy of this iterator.
+   FlatMapIterator<KeyType,ValueType,ComparatorType,eytzingerLayout> Clone()
+   {
+      FlatMapIterator<KeyType,ValueType,ComparatorType,eytzingerLayout> clone;
+      clone.Init(flatMap, index);
+      return clone;
+   }
+
+protected:
+   /// Index of the current item in sorted order.
+   int index;
+   /// The map over which this will be iterating.
+   FlatMap<KeyType,ValueType,ComparatorType,eytzingerLayout>* flatMap;
+
+   friend class FlatMap<KeyType,ValueType,ComparatorType,eytzingerLayout>;
+};
+
+//===============================================================================
+
+/// An item in a FlatMap.
+template<typename KeyType, typename ValueType>
+struct FlatMapEntry
+{
+   FlatMapEntry(const KeyType& _key, const ValueType& _value) : key(_key), value(_value) {}
+
+   KeyType key;
+   ValueType value;
+};
+
+/// A FlatMapEntry can be relocated if both its key and value can be.
+template<typename KeyType, typename ValueType>
+struct TableRelocatable<FlatMapEntry<KeyType, ValueType> >
+{
+   enum { value = TableRelocatable<KeyType>::value && TableRelocatable<ValueType>::value };
+};
+
+//===============================================================================
+
+/// FlatMap has the same interface as Map, but it keeps its items in a single
+/// sorted array rather than a tree of separately allocated nodes.  This makes
+/// it a good fit for dictionaries that are built once, typically during
+/// loading, and then only read.  Lookups are binary searches over contiguous
+/// memory, and iterating is a walk through an array.
+///
+/// Add and Remove keep the array sorted, so each one can shift every item
+/// after it.  When adding many items at once, use AddUnsorted for each and
+/// let the array be sorted once by the next lookup, or call Sort explicitly.
+/// Since the items move around, don't keep pointers to keys or values across
+/// changes to the collection.
+///
+/// If 'eytzingerLayout' is true, a second copy of the keys is kept in
+/// breadth-first order of the implied search tree, so the first few levels
+/// of every search share the same cache lines.  This uses more memory and is
+/// only worthwhile for large collections with small keys.  Be sure to call
+/// Deinit when you're finished with the collection.
+///
+///  FlatMap<const char*, int> testMap;
+///  testMap.Init(StringComparator);
+template<typename KeyType, typename ValueType, typename ComparatorType = bool(*)(const KeyType& keyA, const KeyType& keyB),
+   bool eytzingerLayout = false>
+class FlatMap
+{
+public:
+   /// The iterator type for this class.
+   typedef FlatMapIterator<KeyType,ValueType,ComparatorType,eytzingerLayout> Iterator;
+   /// The type used to store each item.
+   typedef FlatMapEntry<KeyType,ValueType> Entry;
+
+   FlatMap()
+   {
+      reserveSize = 0;
+      sortedSize = 0;
+      eytzingerCurrent = false;
+   }
+
+   /// Initialize a new, empty collection.  If you need to use something other than '<'
+   /// for the comparator, specify it here.
+   void Init(ComparatorType _compare = MapComparatorDefault<KeyType>, Allocator* _allocator = theAllocatorDefault)
+   {
+      compare = _compare;
+      entries.Init(_allocator);
+      eytzingerNodes.Init(_allocator);
+      reserveSize = 0;
+      sortedSize = 0;
+      eytzingerCurrent = false;
+   }
+
+   /// Clean up the collection.
+   void Deinit()
+   {
+      entries.Deinit();
+      eytzingerNodes.Deinit();
+      reserveSize = 0;
+      sortedSize = 0;
+      eytzingerCurrent = false;
+   }
+
+   /// Add the given key/value pair.  Return true if successful and false if
+   /// there was already an item in the collection with the specified key.
+   bool Add(const KeyType& key, const ValueType& value)
+   {
+      Sort();
+      int index = LowerBoundGet(key);
+      if((index < entries.SizeGet()) && !compare(key, entries[index].key))
+         return false;
+      entries.Emplace(index, key, value);
+      sortedSize++;
+      eytzingerCurrent = false;
+      return true;
+   }
+
+   /// Add the given key/value pair without keeping the collection sorted.
+   /// The collection is sorted once by the next call that needs it.  If the
+   /// same key is added more than once, the first value is kept, just as if
+   /// Add had been used.
+   void AddUnsorted(const KeyType& key, const ValueType& value)
+   {
+      entries.EmplaceBack(key, value);
+   }
+
+   /// Remove the entry with the given key.  Return true if successful.
+   bool Remove(const KeyType& key)
+   {
+      int index = IndexGet(key);
+      if(index < 0)
+         return false;
+      entries.RemoveIndex(index);
+      sortedSize--;
+      eytzingerCurrent = false;
+      return true;
+   }
+
+   /// Remove the item at the current position of the iterator.
+   /// If successful, return true and set the iterator to the subsequent item.
+   bool Remove(Iterator& iterator)
+   {
+      if((iterator.flatMap != this) || !iterator.WithinCheck())
+         return false;
+      // The subsequent item slides into the current position.
+      entries.RemoveIndex(iterator.index);
+      sortedSize--;
+      eytzingerCurrent = false;
+      return true;
+   }
+
+   /// Remove all the entries in the map.
+   /// This does not deallocate any memory.
+   void Clear()
+   {
+      entries.Clear();
+      eytzingerNodes.Clear();
+      sortedSize = 0;
+      eytzingerCurrent = false;
+   }
+
+   /// Return a reference to the value for the given key.  If there is no
+   /// entry with that key yet, a new one is added.
+   ValueType& ValueGet(const KeyType& key)
+   {
+      int index = IndexGet(key);
+      if(index < 0)
+      {
+         index = LowerBoundGet(key);
+         entries.Emplace(index, key, ValueType());
+         sortedSize++;
+         eytzingerCurrent = false;
+      }
+      return entries[index].value;
+   }
+
+   /// Same as ValueGet
+   ValueType& operator[](const KeyType& key) { return ValueGet(key); }
+
+   /// Return the number of items in the collection.
+   int SizeGet() { Sort(); return entries.SizeGet(); }
+   /// Return true if the collection is empty.
+   bool EmptyCheck() const { return entries.EmptyCheck(); }
+   /// Return true if no more elements can be added without allocating more memory.
+   bool FullCheck() { return entries.FullCheck(); }
+   /// Return the current number of items for which space is allocated.
+   int CapacityGet() { return entries.CapacityGet(); }
+
+   /// Return an iterator at the position of the item with the given key.
+   /// If the item is not found, the iterator will be pointing one item past
+   /// the end of the collection.
+   Iterator Find(const KeyType& key)
+   {
+      int index = IndexGet(key);
+      Iterator iterator;
+      iterator.Init(this, (index >= 0) ? index : entries.SizeGet());
+      return iterator;
+   }
+
+   /// Return an iterator pointing the the first element in the collection.
+   /// If the collection is empty, it will be pointing one element past the end.
+   Iterator Begin()
+   {
+      Sort();
+      Iterator iterator;
+      iterator.Init(this, 0);
+      return iterator;
+   }
+
+   /// Return an iterator pointing the the last element in the collection.
+   /// If the collection is empty, it will be pointing one element before the beginning.
+   Iterator BeginBack()
+   {
+      Sort();
+      Iterator iterator;
+      iterator.Init(this, entries.SizeGet() - 1);
+      return iterator;
+   }
+
+   /// Sort the items added with AddUnsorted and drop any with duplicate keys.
+   /// This happens automatically when needed, so it only needs to be called
+   /// to control when the cost is paid, like at the end of loading.
+   void Sort();
+
+   /// Keep at least the given number of items allocated.
+   /// If this is called a subsequent time with a lower value, the array is
+   /// reallocated to a smaller size if the current items allow.
+   void ReserveSizeSet(int _reserveSize)
+   {
+      reserveSize = _reserveSize;
+      entries.CapacitySet(std::max(reserveSize, entries.SizeGet()));
+   }
+
+   /// Return the minimum number of items this collection is currently keeping allocated.
+   int ReserveSizeGet() { return reserveSize; }
+
+protected:
+   /// A copy of a key in the Eytzinger layout along with the index of its item.
+   struct EytzingerNode
+   {
+      KeyType key;
+      int index;
+   };
+
+   /// Functor for sorting entries by key with 'compare'.
+   struct EntryLess
+   {
+      EntryLess(ComparatorType _compare) : compare(_compare) {}
+      bool operator()(const Entry& entryA, const Entry& entryB) const { return compare(entryA.key, entryB.key); }
+      ComparatorType compare;
+   };
+
+   /// Return the index of the first item whose key is not less than the given
+   /// key, or the size if there isn't one.  The items must be sorted.
+   int LowerBoundGet(const KeyType& key)
+   {
+      int lower = 0;
+      int count = entries.SizeGet();
+      while(count > 0)
+      {
+         int half = count / 2;
+         if(compare(entries[lower + half].key, key))
+         {
+            lower += half + 1;
+            count -= half + 1;
+         }
+         else
+         {
+            count = half;
+         }
+      }
+      return lower;
+   }
+
+   /// Return the index of the item with the given key, or -1 if there isn't one.
+   int IndexGet(const KeyType& key)
+   {
+      Sort();
+      int index;
+      if(eytzingerLayout)
+      {
+         if(!eytzingerCurrent)
+            EytzingerBuild();
+         index = EytzingerLowerBoundGet(key);
+      }
+      else
+      {
+         index = LowerBoundGet(key);
+      }
+      if((index < entries.SizeGet()) && !compare(key, entries[index].key))
+         return index;
+      return -1;
+   }
+
+   /// Rebuild 'eytzingerNodes' from the sorted items.
+   void EytzingerBuild()
+   {
+      eytzingerNodes.SizeSet(0);
+      eytzingerNodes.Reserve(entries.SizeGet() + 1);
+      for(int nodeIndex = eytzingerNodes.SizeGet(); nodeIndex < entries.SizeGet() + 1; nodeIndex++)
+         eytzingerNodes.EmplaceBack();
+      EytzingerFill(0, 1);
+      eytzingerCurrent = true;
+   }
+
+   /// Fill the subtree of 'eytzingerNodes' rooted at 'nodeIndex' with items
+   /// starting at 'entryIndex'.  Return the index of the next item to use.
+   int EytzingerFill(int entryIndex, int nodeIndex)
+   {
+      if(nodeIndex <= entries.SizeGet())
+      {
+         entryIndex = EytzingerFill(entryIndex, nodeIndex * 2);
+         eytzingerNodes[nodeIndex].key = entries[entryIndex].key;
+         eytzingerNodes[nodeIndex].index = entryIndex;
+         entryIndex++;
+         entryIndex = EytzingerFill(entryIndex, (nodeIndex * 2) + 1);
+      }
+      return entryIndex;
+   }
+
+   /// Same as LowerBoundGet, but search 'eytzingerNodes'.
+   int EytzingerLowerBoundGet(const KeyType& key)
+   {
+      int nodeCount = entries.SizeGet();
+      int nodeIndex = 1;
+      while(nodeIndex <= nodeCount)
+         nodeIndex = (nodeIndex * 2) + (compare(eytzingerNodes[nodeIndex].key, key) ? 1 : 0);
+      // Undo the right turns taken after the last left turn, and the left
+      // turn itself, to get back to the last node not less than the key.
+      while(nodeIndex & 1)
+         nodeIndex >>= 1;
+      nodeIndex >>= 1;
+      return nodeIndex ? eytzingerNodes[nodeIndex].index : nodeCount;
+   }
+
+   /// Items in the collection.  The first 'sortedSize' are sorted.
+   Table<Entry> entries;
+   /// Copies of the keys in the Eytzinger layout, starting at index 1.  This
+   /// is only used if 'eytzingerLayout' is true.
+   Table<EytzingerNode> eytzingerNodes;
+   /// Number of items at the beginning of 'entries' that are known to be sorted.
+   int sortedSize;
+   /// True if 'eytzingerNodes' matches 'entries'.
+   bool eytzingerCurrent;
+   /// Keep at least this many items allocated.
+   int reserveSize;
+   /// Pointer to a function or functor used to compare the keys in the collection.
+   ComparatorType compare;
+
+   friend class FlatMapIterator<KeyType,ValueType,ComparatorType,eytzingerLayout>;
+};
+
+//===============================================================================
+
+template<typename KeyType, typename ValueType, typename ComparatorType, bool eytzingerLayout>
+void FlatMap<KeyType,ValueType,ComparatorType,eytzingerLayout>::Sort()
+{
+   if(sortedSize == entries.SizeGet())
+      return;
+
+   // The sort is stable, so the first of any items with equal keys is the
+   // one that was added first.
+   Entry* data = &entries[0];
+   std::stable_sort(data + sortedSize, data + entries.SizeGet(), EntryLess(compare));
+   std::inplace_merge(data, data + sortedSize, data + entries.SizeGet(), EntryLess(compare));
+
+   // Drop the later duplicates.
+   int keptCount = 1;
+   for(int index = 1; index < entries.SizeGet(); index++)
+   {
+      if(!compare(entries[keptCount - 1].key, entries[index].key))
+         continue;
+      if(keptCount != index)
+         entries[keptCount] = TableMove(entries[index]);
+      keptCount++;
+   }
+   while(entries.SizeGet() > keptCount)
+      entries.RemoveBack();
+
+   sortedSize = entries.SizeGet();
+   eytzingerCurrent = false;
+}
+
+//-------------------------------------------------------------------------------
+
+} //namespace Webfoot {
+
+#endif //#ifndef __FROG__FLATMAP_H__
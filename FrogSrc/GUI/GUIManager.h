@@ -26,6 +26,7 @@ class JSONValue;
 class Sound;
 class Font;
 class SpriteWidget;
+class StringAtom;
 
 // Some platforms use multi-touch by default.
 #if PLATFORM_IS_IOS || PLATFORM_IS_ANDROID || PLATFORM_IS_WII || PLATFORM_IS_EMSCRIPTEN
@@ -496,6 +497,10 @@ public:
    /// "Foo" in a layer named "Bar", its path is "Bar.Foo.Example".
    /// If the widget is not found, return NULL.
    Widget* WidgetGetByPath(const char* path);
+   /// Same as the other WidgetGetByPath, but take the path as a StringAtom.
+   /// The path is still split and compared as text.  This is defined in
+   /// GUIManagerAtoms.h.
+   inline Widget* WidgetGetByPath(StringAtom path);
 
    /// Given a widget and an array of widget paths, return the index of the
    /// widget in the array of paths.  Return -1 if none of the specified paths
@@ -0,0 +1,21 @@
+#ifndef __FROG__GUIMANAGERATOMS_H__
+#define __FROG__GUIMANAGERATOMS_H__
+
+#include "FrogMemory.h"
+#include "StringAtom.h"
+#include "GUI/GUIManager.h"
+
+namespace Webfoot {
+
+//=============================================================================
+
+inline Widget* GUIManager::WidgetGetByPath(StringAtom path)
+{
+   return WidgetGetByPath(path.StringGet());
+}
+
+//=============================================================================
+
+} // namespace Webfoot {
+
+#endif //#ifndef __FROG__GUIMANAGERATOMS_H__
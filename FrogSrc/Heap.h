@@ -1,7 +1,9 @@
 #ifndef __FROG__HEAP_H__
 #define __FROG__HEAP_H__
 
+#include <stddef.h>
 #include "FrogMemory.h"
+#include "HeapWalk.h"
 
 namespace Webfoot {
 
@@ -98,6 +100,9 @@ public:
    /// Return the size of the largest contiguous free block in bytes.
    size_t MaxFreeContiguousSizeGet();
 
+   /// Report each block of the heap to 'visitor' in address order.
+   inline void Walk(HeapWalkVisitor* visitor);
+
 protected:
    /// Bottom-most address for the heap
    unsigned char* heapBottom;
@@ -136,6 +141,32 @@ protected:
 
 //===============================================================================
 
+void Heap::Walk(HeapWalkVisitor* visitor)
+{
+   // Blocks are linked in address order through 'next' and 'last', as
+   // documented for HeapBlockHeader.  Find the first block by following
+   // 'last' back from a free block, since that doesn't depend on where Init
+   // places it.
+   HeapBlockHeader* header = freeListHead;
+   if(header)
+   {
+      while(header->last)
+         header = header->last;
+   }
+   else
+   {
+      header = (HeapBlockHeader*)heapBottom;
+   }
+
+   while(header)
+   {
+      visitor->RunVisit(header, offsetof(HeapBlockHeader, data) + header->length, header->used != 0);
+      header = header->next;
+   }
+}
+
+//===============================================================================
+
 } //namespace Webfoot {
 
 #endif //#ifndef __FROG__HEAP_H__
@@ -0,0 +1,509 @@
+#ifndef __FROG__HEAPBINNED_H__
+#define __FROG__HEAPBINNED_H__
+
+#include "FrogMemory.h"
+#include "Debug.h"
+#include "HeapWalk.h"
+
+namespace Webfoot {
+
+/// Number of size classes at the low end of a HeapBinnedBase that each hold
+/// exactly one length.
+#define HEAP_BINNED_EXACT_BIN_COUNT 16
+/// Base-2 logarithm of HEAP_BINNED_EXACT_BIN_COUNT
+#define HEAP_BINNED_EXACT_BIN_COUNT_LOG2 4
+/// Base-2 logarithm of the number of size classes into which each power of 2
+/// above the exact bins is divided.
+#define HEAP_BINNED_SUBDIVISION_COUNT_LOG2 2
+
+//===============================================================================
+
+/// HeapBinnedBase is the shared implementation behind HeapBinned and
+/// HeapSmallBinned.  It has the same interface as Heap and HeapSmall, but
+/// rather than keeping a single address-sorted free list, free blocks are
+/// kept in segregated lists by size class.  Finding the size class for a
+/// request is O(1), and a bitmap of non-empty classes makes finding the next
+/// class with a usable block O(1) as well.  Within a class, the block that is
+/// closest in size to the request is used.
+///
+/// All offsets and lengths are stored as a number of 'unitSize'-byte units
+/// from the bottom of the heap in an 'OffsetType'.  Each block has this header:
+///
+/// +---------+---------+---------+----+
+/// | next    | length  | last    |used|
+/// +---------+---------+---------+----+
+///
+/// length does NOT include the header.  If used == 0, the first unit(s) of
+/// the data area hold the 'nextFree' and 'lastFree' links for the block's
+/// size class.  Size class lists are not sorted.
+template<typename OffsetType, size_t unitSize>
+class HeapBinnedBase
+{
+public:
+   /// Initialize the heap to use the given block of memory.  If '_heapBottom'
+   /// is not aligned to 'unitSize', the beginning of the block will be skipped.
+   void Init(void* _heapBottom, size_t _totalSize);
+
+   /// Allocate from the free block in the heap that is closest to the requested size.
+   void* Allocate(size_t size) { return AllocateHelper(size, ALLOCATE_BEST_FIT); }
+   /// Allocate from the bottom-most free block in the heap that is big enough.
+   /// Unlike Allocate, this must consider every free block big enough for the request.
+   void* AllocateBottom(size_t size) { return AllocateHelper(size, ALLOCATE_BOTTOM); }
+   /// Allocate from the top-most free block in heap that is big enough.
+   /// Unlike Allocate, this must consider every free block big enough for the request.
+   void* AllocateTop(size_t size) { return AllocateHelper(size, ALLOCATE_TOP); }
+   /// Free the given memory allocated from this address.  This does not check
+   /// to make sure the allocation came from this heap.
+   void Deallocate(void* p);
+
+   /// Return the address of the bottom of the heap.
+   void* HeapBottomGet() { return (void*)heapBottom; }
+   /// Return the address of the top of the heap.
+   void* HeapTopGet() { return (void*)heapTop; }
+
+   /// Return true if 'ptr' points to an address in the heap.
+   /// This does not necessarily mean it was returned by an Allocate function.
+   bool Contains(void* ptr)
+   {
+      return ((ptr >= heapBottom) && (ptr <= heapTop));
+   }
+
+   /// Return the total amount of free memory in bytes.
+   size_t MemoryFreeGet() { return unitsFree * unitSize; }
+   /// Return the total number of bytes used, including overhead.
+   size_t MemoryUsedGet() { return MemoryTotalGet() - MemoryFreeGet(); }
+   /// Return the total number of bytes including used and free memory.
+   size_t MemoryTotalGet() { return sizeTotal; }
+   /// Return the total number of free blocks.
+   size_t FreeBlockCountGet() { return freeBlockCount; }
+   /// Return the size of the largest contiguous free block in bytes.
+   size_t MaxFreeContiguousSizeGet();
+
+   /// Report each block of the heap to 'visitor' in address order.
+   void Walk(HeapWalkVisitor* visitor);
+
+protected:
+   /// Header at the beginning of every block.
+   struct BlockHeader
+   {
+      OffsetType next;
+      OffsetType length;
+      OffsetType last;
+      unsigned char used;
+   };
+
+   /// Links stored at the beginning of the data area of a free block.
+   struct FreeLinks
+   {
+      OffsetType nextFree;
+      OffsetType lastFree;
+   };
+
+   enum
+   {
+      /// Number of units taken by a BlockHeader
+      HEADER_UNITS = (sizeof(BlockHeader) + unitSize - 1) / unitSize,
+      /// Minimum length of a block in units, so a free block can hold its links.
+      LINK_UNITS = (sizeof(FreeLinks) + unitSize - 1) / unitSize,
+      /// Total number of size classes
+      BIN_COUNT = HEAP_BINNED_EXACT_BIN_COUNT + ((sizeof(OffsetType) * 8) - HEAP_BINNED_EXACT_BIN_COUNT_LOG2) * (1 << HEAP_BINNED_SUBDIVISION_COUNT_LOG2),
+      /// Number of 32-bit words in the bitmap of non-empty size classes
+      BIN_BITMAP_WORD_COUNT = (BIN_COUNT + 31) / 32
+   };
+
+   /// Ways in which AllocateHelper can choose a block.
+   enum AllocationMode
+   {
+      ALLOCATE_BEST_FIT,
+      ALLOCATE_BOTTOM,
+      ALLOCATE_TOP
+   };
+
+   /// Value of an offset that doesn't refer to any block.
+   static OffsetType OffsetNullGet() { return (OffsetType)~(OffsetType)0; }
+
+   /// Return the header of the block at the given offset.
+   BlockHeader* HeaderGet(size_t offset) { return (BlockHeader*)(heapBottom + (offset * unitSize)); }
+   /// Return the free list links of the free block at the given offset.
+   FreeLinks* FreeLinksGet(size_t offset) { return (FreeLinks*)(heapBottom + ((offset + HEADER_UNITS) * unitSize)); }
+
+   /// Return the size class for a block with the given data length in units.
+   static int BinIndexGet(size_t length);
+   /// Return the index of the lowest set bit in a non-zero value.
+   static int LowestBitIndexGet(unsigned int value);
+   /// Return the index of the highest set bit in a non-zero value.
+   static int HighestBitIndexGet(size_t value);
+   /// Return the first non-empty size class at or above 'binIndex'.
+   /// Return -1 if there isn't one.
+   int BinNonEmptyFind(int binIndex);
+
+   /// Add the free block at the given offset to the list for its size class.
+   void BinAdd(size_t offset);
+   /// Remove the free block at the given offset from the list for its size class.
+   void BinRemove(size_t offset);
+
+   /// Find a block for 'size' bytes according to 'mode' and convert it to used.
+   void* AllocateHelper(size_t size, AllocationMode mode);
+   /// Mark 'length' units of the free block at 'offset' as used, splitting off
+   /// the rest as a new free block when it is big enough.  If 'fromTop' is true,
+   /// the used part comes from the top of the block.  Return the data address.
+   void* Carve(size_t offset, size_t length, bool fromTop);
+
+   /// Bottom-most address for the heap
+   unsigned char* heapBottom;
+   /// Top-most address for the heap
+   unsigned char* heapTop;
+   /// Size of the region allotted to the heap excluding the class itself.
+   size_t sizeTotal;
+   /// Current number of units in the data areas of free blocks.
+   size_t unitsFree;
+   /// Current number of free blocks.
+   size_t freeBlockCount;
+   /// First free block in each size class.
+   OffsetType binHeads[BIN_COUNT];
+   /// A bit is set for each size class that has at least one free block.
+   unsigned int binBitmap[BIN_BITMAP_WORD_COUNT];
+};
+
+//===============================================================================
+
+/// HeapBinned is a general-purpose memory heap with the same interface as
+/// Heap.  It uses segregated size-class free lists, so the time for Allocate
+/// doesn't grow with the number of free blocks the way it does for Heap.
+/// Offsets are stored as size_t, so it can manage as much memory as Heap.
+class HeapBinned : public HeapBinnedBase<size_t, FROG_MEM_ALIGN>
+{
+};
+
+//===============================================================================
+
+template<typename OffsetType, size_t unitSize>
+void HeapBinnedBase<OffsetType, unitSize>::Init(void* _heapBottom, size_t _totalSize)
+{
+   sizeTotal = _totalSize;
+   unitsFree = 0;
+   freeBlockCount = 0;
+   for(int binIndex = 0; binIndex < BIN_COUNT; binIndex++)
+      binHeads[binIndex] = OffsetNullGet();
+   for(int wordIndex = 0; wordIndex < BIN_BITMAP_WORD_COUNT; wordIndex++)
+      binBitmap[wordIndex] = 0;
+
+   // Skip any unaligned bytes at the beginning.
+   size_t misalignment = ((size_t)_heapBottom) % unitSize;
+   size_t alignmentSkip = misalignment ? (unitSize - misalignment) : 0;
+   heapBottom = (unsigned char*)_heapBottom + alignmentSkip;
+   heapTop = (unsigned char*)_heapBottom + _totalSize;
+   size_t totalUnits = (_totalSize > alignmentSkip) ? ((_totalSize - alignmentSkip) / unitSize) : 0;
+   totalUnits = std::min(totalUnits, (size_t)(OffsetNullGet() - 1));
+
+   assert(totalUnits >= (HEADER_UNITS + LINK_UNITS));
+   if(totalUnits < (HEADER_UNITS + LINK_UNITS))
+   {
+      heapTop = heapBottom;
+      return;
+   }
+
+   // Start with one free block that covers everything.
+   BlockHeader* header = HeaderGet(0);
+   header->next = OffsetNullGet();
+   header->last = OffsetNullGet();
+   header->length = (OffsetType)(totalUnits - HEADER_UNITS);
+   header->used = 0;
+   unitsFree = header->length;
+   freeBlockCount = 1;
+   BinAdd(0);
+}
+
+//------------------------------------------------------------------------------
+
+template<typename OffsetType, size_t unitSize>
+void HeapBinnedBase<OffsetType, unitSize>::Deallocate(void* p)
+{
+   if(!p)
+      return;
+
+   size_t offset = ((size_t)((unsigned char*)p - heapBottom) / unitSize) - HEADER_UNITS;
+   BlockHeader* header = HeaderGet(offset);
+   assert(header->used);
+   header->used = 0;
+   unitsFree += header->length;
+   freeBlockCount++;
+
+   // Merge with the following block if it's free.
+   if(header->next != OffsetNullGet())
+   {
+      BlockHeader* nextHeader = HeaderGet(header->next);
+      if(!nextHeader->used)
+      {
+         BinRemove(header->next);
+         header->length = (OffsetType)(header->length + HEADER_UNITS + nextHeader->length);
+         header->next = nextHeader->next;
+         if(header->next != OffsetNullGet())
+            HeaderGet(header->next)->last = (OffsetType)offset;
+         unitsFree += HEADER_UNITS;
+         freeBlockCount--;
+      }
+   }
+
+   // Merge with the preceding block if it's free.
+   if(header->last != OffsetNullGet())
+   {
+      size_t lastOffset = header->last;
+      BlockHeader* lastHeader = HeaderGet(lastOffset);
+      if(!lastHeader->used)
+      {
+         BinRemove(lastOffset);
+         lastHeader->length = (OffsetType)(lastHeader->length + HEADER_UNITS + header->length);
+         lastHeader->next = header->next;
+         if(lastHeader->next != OffsetNullGet())
+            HeaderGet(lastHeader->next)->last = (OffsetType)lastOffset;
+         unitsFree += HEADER_UNITS;
+         freeBlockCount--;
+         offset = lastOffset;
+      }
+   }
+
+   BinAdd(offset);
+}
+
+//------------------------------------------------------------------------------
+
+template<typename OffsetType, size_t unitSize>
+size_t HeapBinnedBase<OffsetType, unitSize>::MaxFreeContiguousSizeGet()
+{
+   // Find the highest non-empty size class.
+   for(int wordIndex = BIN_BITMAP_WORD_COUNT - 1; wordIndex >= 0; wordIndex--)
+   {
+      if(!binBitmap[wordIndex])
+         continue;
+
+      int binIndex = (wordIndex * 32) + HighestBitIndexGet(binBitmap[wordIndex]);
+      size_t maxLength = 0;
+      for(size_t offset = binHeads[binIndex]; offset != OffsetNullGet(); offset = FreeLinksGet(offset)->nextFree)
+         maxLength = std::max(maxLength, (size_t)HeaderGet(offset)->length);
+      return maxLength * unitSize;
+   }
+   return 0;
+}
+
+//------------------------------------------------------------------------------
+
+template<typename OffsetType, size_t unitSize>
+void HeapBinnedBase<OffsetType, unitSize>::Walk(HeapWalkVisitor* visitor)
+{
+   if(heapTop == heapBottom)
+      return;
+   for(size_t offset = 0; offset != OffsetNullGet(); offset = HeaderGet(offset)->next)
+   {
+      BlockHeader* header = HeaderGet(offset);
+      visitor->RunVisit(header, (HEADER_UNITS + header->length) * unitSize, header->used != 0);
+   }
+}
+
+//------------------------------------------------------------------------------
+
+template<typename OffsetType, size_t unitSize>
+int HeapBinnedBase<OffsetType, unitSize>::BinIndexGet(size_t length)
+{
+   if(length < HEAP_BINNED_EXACT_BIN_COUNT)
+      return (int)length;
+
+   // Beyond the exact bins, each power of 2 is split into evenly spaced classes
+   // based on the bits just below the highest set bit.
+   int highestBit = HighestBitIndexGet(length);
+   int subdivision = (int)(length >> (highestBit - HEAP_BINNED_SUBDIVISION_COUNT_LOG2)) & ((1 << HEAP_BINNED_SUBDIVISION_COUNT_LOG2) - 1);
+   return HEAP_BINNED_EXACT_BIN_COUNT + ((highestBit - HEAP_BINNED_EXACT_BIN_COUNT_LOG2) << HEAP_BINNED_SUBDIVISION_COUNT_LOG2) + subdivision;
+}
+
+//------------------------------------------------------------------------------
+
+template<typename OffsetType, size_t unitSize>
+int HeapBinnedBase<OffsetType, unitSize>::LowestBitIndexGet(unsigned int value)
+{
+   // De Bruijn sequence lookup for the isolated lowest bit.
+   static const int deBruijnBitPositions[32] =
+   {
+      0, 1, 28, 2, 29, 14, 24, 3, 30, 22, 20, 15, 25, 17, 4, 8,
+      31, 27, 13, 23, 21, 19, 16, 7, 26, 12, 18, 6, 11, 5, 10, 9
+   };
+   assert(value);
+   return deBruijnBitPositions[((unsigned int)((value & (0 - value)) * 0x077CB531U)) >> 27];
+}
+
+//------------------------------------------------------------------------------
+
+template<typename OffsetType, size_t unitSize>
+int HeapBinnedBase<OffsetType, unitSize>::HighestBitIndexGet(size_t value)
+{
+   assert(value);
+   int bitIndex = 0;
+   for(int shift = (int)(sizeof(size_t) * 4); shift > 0; shift >>= 1)
+   {
+      if(value >> shift)
+      {
+         value >>= shift;
+         bitIndex += shift;
+      }
+   }
+   return bitIndex;
+}
+
+//------------------------------------------------------------------------------
+
+template<typename OffsetType, size_t unitSize>
+int HeapBinnedBase<OffsetType, unitSize>::BinNonEmptyFind(int binIndex)
+{
+   if(binIndex >= BIN_COUNT)
+      return -1;
+
+   int wordIndex = binIndex / 32;
+   unsigned int word = binBitmap[wordIndex] & (~0U << (binIndex % 32));
+   while(!word)
+   {
+      wordIndex++;
+      if(wordIndex >= BIN_BITMAP_WORD_COUNT)
+         return -1;
+      word = binBitmap[wordIndex];
+   }
+   return (wordIndex * 32) + LowestBitIndexGet(word);
+}
+
+//------------------------------------------------------------------------------
+
+template<typename OffsetType, size_t unitSize>
+void HeapBinnedBase<OffsetType, unitSize>::BinAdd(size_t offset)
+{
+   int binIndex = BinIndexGet(HeaderGet(offset)->length);
+   FreeLinks* links = FreeLinksGet(offset);
+   links->lastFree = OffsetNullGet();
+   links->nextFree = binHeads[binIndex];
+   if(links->nextFree != OffsetNullGet())
+      FreeLinksGet(links->nextFree)->lastFree = (OffsetType)offset;
+   binHeads[binIndex] = (OffsetType)offset;
+   binBitmap[binIndex / 32] |= (1U << (binIndex % 32));
+}
+
+//------------------------------------------------------------------------------
+
+template<typename OffsetType, size_t unitSize>
+void HeapBinnedBase<OffsetType, unitSize>::BinRemove(size_t offset)
+{
+   int binIndex = BinIndexGet(HeaderGet(offset)->length);
+   FreeLinks* links = FreeLinksGet(offset);
+   if(links->lastFree != OffsetNullGet())
+      FreeLinksGet(links->lastFree)->nextFree = links->nextFree;
+   else
+      binHeads[binIndex] = links->nextFree;
+   if(links->nextFree != OffsetNullGet())
+      FreeLinksGet(links->nextFree)->lastFree = links->lastFree;
+
+   if(binHeads[binIndex] == OffsetNullGet())
+      binBitmap[binIndex / 32] &= ~(1U << (binIndex % 32));
+}
+
+//------------------------------------------------------------------------------
+
+template<typename OffsetType, size_t unitSize>
+void* HeapBinnedBase<OffsetType, unitSize>::AllocateHelper(size_t size, AllocationMode mode)
+{
+   size_t length = std::max((size + unitSize - 1) / unitSize, (size_t)LINK_UNITS);
+   if(length > unitsFree)
+      return NULL;
+
+   size_t nullOffset = OffsetNullGet();
+   size_t chosenOffset = nullOffset;
+   size_t chosenLength = 0;
+   int binIndex = BinNonEmptyFind(BinIndexGet(length));
+   while(binIndex >= 0)
+   {
+      for(size_t offset = binHeads[binIndex]; offset != nullOffset; offset = FreeLinksGet(offset)->nextFree)
+      {
+         size_t blockLength = HeaderGet(offset)->length;
+         if(blockLength < length)
+            continue;
+
+         bool better;
+         if(chosenOffset == nullOffset)
+            better = true;
+         else if(mode == ALLOCATE_BEST_FIT)
+            better = blockLength < chosenLength;
+         else if(mode == ALLOCATE_BOTTOM)
+            better = offset < chosenOffset;
+         else
+            better = offset > chosenOffset;
+
+         if(better)
+         {
+            chosenOffset = offset;
+            chosenLength = blockLength;
+            if((mode == ALLOCATE_BEST_FIT) && (blockLength == length))
+               break;
+         }
+      }
+
+      // For a best fit, every block in any higher class is bigger than anything
+      // in this one, so stop at the first class with a usable block.
+      if((mode == ALLOCATE_BEST_FIT) && (chosenOffset != nullOffset))
+         break;
+      binIndex = BinNonEmptyFind(binIndex + 1);
+   }
+
+   if(chosenOffset == nullOffset)
+      return NULL;
+   return Carve(chosenOffset, length, mode != ALLOCATE_BOTTOM);
+}
+
+//------------------------------------------------------------------------------
+
+template<typename OffsetType, size_t unitSize>
+void* HeapBinnedBase<OffsetType, unitSize>::Carve(size_t offset, size_t length, bool fromTop)
+{
+   BinRemove(offset);
+   BlockHeader* header = HeaderGet(offset);
+   size_t remainingLength = header->length - length;
+
+   if(remainingLength < (size_t)(HEADER_UNITS + LINK_UNITS))
+   {
+      // Not enough left over for another block, so use the whole thing.
+      header->used = 1;
+      unitsFree -= header->length;
+      freeBlockCount--;
+      return heapBottom + ((offset + HEADER_UNITS) * unitSize);
+   }
+
+   // Split the block in two.
+   size_t lowerLength = fromTop ? (remainingLength - HEADER_UNITS) : length;
+   size_t upperOffset = offset + HEADER_UNITS + lowerLength;
+   BlockHeader* upperHeader = HeaderGet(upperOffset);
+   upperHeader->length = (OffsetType)(header->length - lowerLength - HEADER_UNITS);
+   upperHeader->next = header->next;
+   upperHeader->last = (OffsetType)offset;
+   if(upperHeader->next != OffsetNullGet())
+      HeaderGet(upperHeader->next)->last = (OffsetType)upperOffset;
+   header->next = (OffsetType)upperOffset;
+   header->length = (OffsetType)lowerLength;
+   unitsFree -= length + HEADER_UNITS;
+
+   size_t usedOffset;
+   if(fromTop)
+   {
+      upperHeader->used = 1;
+      header->used = 0;
+      BinAdd(offset);
+      usedOffset = upperOffset;
+   }
+   else
+   {
+      header->used = 1;
+      upperHeader->used = 0;
+      BinAdd(upperOffset);
+      usedOffset = offset;
+   }
+   return heapBottom + ((usedOffset + HEADER_UNITS) * unitSize);
+}
+
+//===============================================================================
+
+} //namespace Webfoot {
+
+#endif //#ifndef __FROG__HEAPBINNED_H__
@@ -76,6 +76,9 @@ public:
    virtual bool LogCheck();
    /// Print a list of all the currently logged allocations.
    virtual void LogPrint();
+   /// Return the collection of allocations logged by this delegate, sorted by
+   /// address.  It is only kept up to date while logging is enabled.
+   Map<void*, AllocationEntry>* AllocationLogGet() { return &allocationLog; }
    
    /// Return true if this heap delegate is simply referencing another.
    virtual bool HeapDelegateReferencingCheck() { return false; }
@@ -0,0 +1,310 @@
+#ifndef __FROG__HEAPDELEGATEARENA_H__
+#define __FROG__HEAPDELEGATEARENA_H__
+
+#include "FrogMemory.h"
+#include "HeapDelegate.h"
+#include "Debug.h"
+#include "ThreadUtilities.h"
+
+namespace Webfoot {
+
+//Default size of each block of memory an Arena gets from its backing heap.
+#define ARENA_CHUNK_SIZE_DEFAULT (64 * 1024)
+
+//==============================================================================
+
+/// Arena hands out memory from a few large blocks taken from a backing heap.
+/// Allocating just moves a pointer, and individual frees only update a
+/// count.  Deinit returns all the blocks at once, whether or not everything
+/// allocated from the arena has been freed.  This makes it suitable for large
+/// trees of small objects, like parsed documents, that are discarded
+/// together.
+///
+/// Code that only knows about HeapIDs can be directed at an Arena with a
+/// HeapDelegateArena and an ArenaGuard.  An Arena is not thread-safe, so only
+/// one thread should use it at a time.
+class Arena
+{
+public:
+   Arena()
+   {
+      chunkHead = NULL;
+      allocationCount = 0;
+   }
+
+   /// Prepare the arena to get memory from the given heap in blocks of the
+   /// given size.
+   void Init(HeapID _backingHeapID = HEAP_DEFAULT, size_t _chunkSize = ARENA_CHUNK_SIZE_DEFAULT)
+   {
+      backingHeapID = _backingHeapID;
+      chunkSize = _chunkSize;
+      chunkHead = NULL;
+      allocationCount = 0;
+   }
+
+   /// Free all the memory used by the arena, including anything that hasn't
+   /// been deallocated yet.  Nothing allocated from the arena may be used
+   /// afterward, and that includes deallocating it.
+   void Deinit()
+   {
+      while(chunkHead)
+      {
+         Chunk* next = chunkHead->next;
+         theMemory->Deallocate(chunkHead);
+         chunkHead = next;
+      }
+      allocationCount = 0;
+   }
+
+   /// Return a block of at least the given size.  Return NULL if unsuccessful.
+   void* Allocate(size_t size)
+   {
+      size = RoundUp(size);
+      if(!chunkHead || (chunkHead->size - chunkHead->used < size))
+      {
+         if(!ChunkAdd(size))
+            return NULL;
+      }
+      void* block = (unsigned char*)(chunkHead + 1) + chunkHead->used;
+      chunkHead->used += size;
+      allocationCount++;
+      return block;
+   }
+
+   /// Note that a block from this arena is no longer in use.  The memory
+   /// isn't reused until Deinit.
+   void Deallocate(void* /*ptr*/)
+   {
+      assert(allocationCount > 0);
+      allocationCount--;
+   }
+
+   /// Make sure at least the given number of bytes can be allocated before
+   /// another block is needed from the backing heap.  Call this before
+   /// filling the arena when the total size can be estimated.
+   bool Reserve(size_t size)
+   {
+      size = RoundUp(size);
+      if(chunkHead && (chunkHead->size - chunkHead->used >= size))
+         return true;
+      return ChunkAdd(size);
+   }
+
+   /// Return the number of blocks allocated from the arena that haven't been
+   /// deallocated.
+   size_t AllocationCountGet() { return allocationCount; }
+   /// Return the number of bytes handed out so far.
+   size_t MemoryUsedGet()
+   {
+      size_t used = 0;
+      for(Chunk* chunk = chunkHead; chunk; chunk = chunk->next)
+         used += chunk->used;
+      return used;
+   }
+   /// Return the number of bytes taken from the backing heap, not counting
+   /// overhead.
+   size_t MemoryTotalGet()
+   {
+      size_t total = 0;
+      for(Chunk* chunk = chunkHead; chunk; chunk = chunk->next)
+         total += chunk->size;
+      return total;
+   }
+   /// Return the number of blocks taken from the backing heap.
+   int ChunkCountGet()
+   {
+      int count = 0;
+      for(Chunk* chunk = chunkHead; chunk; chunk = chunk->next)
+         count++;
+      return count;
+   }
+
+protected:
+   /// Header at the beginning of each block from the backing heap.  The
+   /// usable memory follows it.
+   struct Chunk
+   {
+      /// Block that was in use before this one.
+      Chunk* next;
+      /// Number of usable bytes in the block.
+      size_t size;
+      /// Number of usable bytes handed out so far.
+      size_t used;
+      /// Keeps the usable memory aligned.
+      size_t padding;
+   };
+
+   /// Return the given size rounded up to keep allocations aligned.
+   static size_t RoundUp(size_t size) { return (size + FROG_MEM_ALIGN - 1) & ~(size_t)(FROG_MEM_ALIGN - 1); }
+
+   /// Start a new block big enough for at least 'size' bytes.  Return true if
+   /// successful.
+   bool ChunkAdd(size_t size)
+   {
+      size_t newChunkSize = (size > chunkSize) ? size : chunkSize;
+      Chunk* chunk = (Chunk*)theMemory->Allocate(sizeof(Chunk) + newChunkSize, backingHeapID);
+      if(!chunk)
+         return false;
+      chunk->next = chunkHead;
+      chunk->size = newChunkSize;
+      chunk->used = 0;
+      chunkHead = chunk;
+      return true;
+   }
+
+   /// Heap from which the blocks are allocated.
+   HeapID backingHeapID;
+   /// Minimum size of each block.
+   size_t chunkSize;
+   /// Most recent block.  This is the only one that is still being filled.
+   Chunk* chunkHead;
+   /// Number of outstanding allocations.
+   size_t allocationCount;
+};
+
+//==============================================================================
+
+/// While an ArenaGuard exists, allocations from a HeapDelegateArena on the
+/// same thread go to the given Arena.  Guards can be nested.
+class ArenaGuard
+{
+public:
+   ArenaGuard(Arena* arena)
+   {
+      arenaPrevious = CurrentGet();
+      CurrentGet() = arena;
+   }
+
+   ~ArenaGuard()
+   {
+      CurrentGet() = arenaPrevious;
+   }
+
+   /// Return a reference to the calling thread's current Arena.
+   static Arena*& CurrentGet()
+   {
+      static thread_local Arena* current = NULL;
+      return current;
+   }
+
+protected:
+   /// Arena that was current before this guard.
+   Arena* arenaPrevious;
+};
+
+//==============================================================================
+
+/// HeapDelegateArena forwards each allocation to the Arena bound to the
+/// calling thread with an ArenaGuard.  Allocations made without an
+/// ArenaGuard, like when a tree built in an arena is modified later, go to
+/// the fallback delegate, so code using the heap keeps working either way.
+///
+/// The table of heaps in Memory has a fixed size, so there is no HeapID of
+/// its own for this.  Instead, the project installs it in ProjectMemoryInit
+/// on a HeapID it has no other use for, with the delegate that was there as
+/// the fallback, and passes that HeapID to functions like
+/// JSONParserStreaming::ArenaLoad.  The Arenas used with it must not get
+/// their memory from that same HeapID.
+///
+///  static HeapDelegateArena arenaHeap;
+///  ...
+///  arenaHeap.Init(theMemory->HeapDelegateGet(HEAP_DEBUG));
+///  theMemory->HeapDelegateSet(HEAP_DEBUG, &arenaHeap);
+class HeapDelegateArena : public HeapDelegate
+{
+public:
+   virtual ~HeapDelegateArena() {}
+
+   /// Initialize the delegate to use the given delegate when no Arena is
+   /// bound.
+   void Init(HeapDelegate* _fallbackDelegate, bool _threadSafe = true)
+   {
+      assert(_fallbackDelegate);
+      assert(_fallbackDelegate != this);
+      Inherited::Init(_threadSafe);
+      fallbackDelegate = _fallbackDelegate;
+      memoryUsed = 0;
+   }
+
+   /// Allocate the given amount of memory in bytes.
+   /// Return NULL if no memory is allocated.
+   virtual void* Allocate(size_t size)
+   {
+      Arena* arena = ArenaGuard::CurrentGet();
+      BlockHeader* header;
+      if(arena)
+         header = (BlockHeader*)arena->Allocate(sizeof(BlockHeader) + size);
+      else
+         header = (BlockHeader*)fallbackDelegate->Allocate(sizeof(BlockHeader) + size);
+      if(!header)
+         return NULL;
+      header->arena = arena;
+      header->size = size;
+
+      Guard guard(&(this->mutex), this->threadSafe);
+      memoryUsed += size;
+      PostAllocate(header + 1);
+      return header + 1;
+   }
+
+   /// Free the given allocation.  If it came from an Arena, that Arena must
+   /// not have been deinitialized yet.
+   virtual bool Deallocate(void* ptr)
+   {
+      BlockHeader* header = (BlockHeader*)ptr - 1;
+      {
+         Guard guard(&(this->mutex), this->threadSafe);
+         PreDeallocate(ptr);
+         memoryUsed -= header->size;
+      }
+      if(header->arena)
+         header->arena->Deallocate(header);
+      else
+         fallbackDelegate->Deallocate(header);
+      return true;
+   }
+
+   /// Allocate from the top of the delegate.
+   /// Return NULL if no memory is allocated.
+   virtual void* AllocateTop(size_t size) { return Allocate(size); }
+   /// Allocate from the bottom of the delegate.
+   /// Return NULL if no memory is allocated.
+   virtual void* AllocateBottom(size_t size) { return Allocate(size); }
+
+   /// The delegate has no memory of its own, so this returns 0.
+   virtual size_t MemoryFreeGet() { return 0; }
+   /// Return the number of bytes in outstanding allocations, not including
+   /// overhead.
+   virtual size_t MemoryUsedGet() { return memoryUsed; }
+   /// Return the number of bytes in outstanding allocations, not including
+   /// overhead.
+   virtual size_t MemoryTotalGet() { return memoryUsed; }
+   /// The delegate has no memory of its own, so this returns 0.
+   virtual size_t FreeBlockCountGet() { return 0; }
+   /// The delegate has no memory of its own, so this returns 0.
+   virtual size_t MaxFreeContiguousSizeGet() { return 0; }
+
+   typedef HeapDelegate Inherited;
+
+protected:
+   /// Header placed in front of every allocation.
+   struct BlockHeader
+   {
+      /// Arena that holds the allocation, or NULL if it came from the
+      /// fallback delegate.
+      Arena* arena;
+      /// Size of the allocation in bytes, not including this header.
+      size_t size;
+   };
+
+   /// Delegate used when no Arena is bound.
+   HeapDelegate* fallbackDelegate;
+   /// Number of bytes in outstanding allocations.
+   size_t memoryUsed;
+};
+
+//==============================================================================
+
+} //namespace Webfoot {
+
+#endif //#ifndef __FROG__HEAPDELEGATEARENA_H__
@@ -12,8 +12,8 @@ namespace Webfoot {
 
 /// HeapDelegateExpandable works just like HeapDelegateStatic except that when
 /// all its heaps are full, it will fall back on malloc and free for individual allocations.
-template<int smallHeapCount>
-class HeapDelegateExpandable : public HeapDelegateStatic<smallHeapCount>
+template<int smallHeapCount, typename RegularHeapType = Heap, typename SmallHeapType = HeapSmall>
+class HeapDelegateExpandable : public HeapDelegateStatic<smallHeapCount, RegularHeapType, SmallHeapType>
 {
 public:
    virtual ~HeapDelegateExpandable() {}
@@ -64,7 +64,7 @@ public:
       return ptr;
    }
 
-   typedef HeapDelegateStatic<smallHeapCount> Inherited;
+   typedef HeapDelegateStatic<smallHeapCount, RegularHeapType, SmallHeapType> Inherited;
 
 protected:
    /// When the inherited heaps are full, use this to allocate the memory.
@@ -0,0 +1,280 @@
+#ifndef __FROG__HEAPDELEGATEFRAME_H__
+#define __FROG__HEAPDELEGATEFRAME_H__
+
+#include <string.h>
+#include "FrogMemory.h"
+#include "HeapDelegate.h"
+#include "Allocator.h"
+#include "Debug.h"
+#include "ThreadUtilities.h"
+#include "Clock.h"
+
+namespace Webfoot {
+
+#ifdef _DEBUG
+   /// If true, HeapDelegateFrame fills freed memory with
+   /// HEAP_DELEGATE_FRAME_POISON_BYTE and reports allocations that are still
+   /// outstanding at the end of a main loop iteration.
+   #define HEAP_DELEGATE_FRAME_DEBUG 1
+#else
+   #define HEAP_DELEGATE_FRAME_DEBUG 0
+#endif
+
+/// Value written over memory in a HeapDelegateFrame after it is freed when
+/// HEAP_DELEGATE_FRAME_DEBUG is set.
+#define HEAP_DELEGATE_FRAME_POISON_BYTE 0xDD
+
+class HeapDelegateFrame;
+
+//==============================================================================
+
+/// AllocatorFrame allocates from a HeapDelegateFrame.  Everything allocated
+/// with it must be freed before the end of the current main loop iteration.
+/// Each HeapDelegateFrame has one, returned by its AllocatorGet.
+class AllocatorFrame : public Allocator
+{
+public:
+   AllocatorFrame() { heapDelegate = NULL; }
+   virtual ~AllocatorFrame() {}
+
+   /// Return a pointer to a block of memory 'size' bytes in length.
+   virtual void* Allocate(size_t size);
+   /// Free a block of memory allocated with this allocator's 'Allocate' function.
+   virtual void Deallocate(void* ptr);
+
+   /// Set the arena from which to draw memory.
+   void HeapDelegateSet(HeapDelegateFrame* _heapDelegate) { heapDelegate = _heapDelegate; }
+
+protected:
+   /// Arena from which to draw memory.
+   HeapDelegateFrame* heapDelegate;
+};
+
+//==============================================================================
+
+/// HeapDelegateFrame is a linear arena for allocations that don't live past
+/// the current main loop iteration, such as temporary strings and sort
+/// buffers.  Allocating just moves a pointer, and freeing does nothing to the
+/// arena.  The whole arena is reset the first time it is used after
+/// theClock->Update() starts a new iteration, or when FrameReset is called.
+/// It is not meant to be shared between threads.
+///
+/// It doesn't have a HeapID of its own, since the table of heaps in Memory
+/// has a fixed size.  Instead, the project owns the arena, gives it memory in
+/// ProjectMemoryInit, and passes its AllocatorGet() to anything that takes an
+/// Allocator, like the 'tempAllocator' of Table::SortStable.
+///
+///  static HeapDelegateFrame frameHeap;
+///  static unsigned char frameHeapMemory[256 * 1024];
+///  ...
+///  frameHeap.Init(frameHeapMemory, sizeof(frameHeapMemory));
+///  ...
+///  table.SortStable(frameHeap.AllocatorGet());
+///
+/// Allocations still outstanding when the arena is reset are abandoned and
+/// counted, see AbandonedCountGet.  To have that checked promptly, call
+/// FrameReset at the end of each main loop iteration rather than relying on
+/// the reset at the next allocation.  When HEAP_DELEGATE_FRAME_DEBUG is set,
+/// freed allocations are poisoned, and each reset with allocations
+/// outstanding is reported as an error.
+///
+/// Freeing an allocation after the arena was reset is a caller error.  The
+/// arena can't always tell, since the memory may already hold a live
+/// allocation from the current iteration, and freeing it would release that
+/// allocation instead.  Only pointers past the end of the memory used in the
+/// current iteration are recognized and ignored.
+class HeapDelegateFrame : public HeapDelegate
+{
+public:
+   HeapDelegateFrame() { allocator.HeapDelegateSet(this); }
+   virtual ~HeapDelegateFrame() {}
+
+   /// Initialize the arena to use the given block of memory.
+   void Init(void* _heapBottom, size_t _size, bool _threadSafe = false)
+   {
+      Inherited::Init(_threadSafe);
+      size_t misalignment = ((size_t)_heapBottom) % FROG_MEM_ALIGN;
+      heapBottom = (unsigned char*)_heapBottom + (misalignment ? (FROG_MEM_ALIGN - misalignment) : 0);
+      heapTop = (unsigned char*)_heapBottom + _size;
+      if(heapTop < heapBottom)
+         heapTop = heapBottom;
+      current = heapBottom;
+      frameNumber = 0;
+      frameLoopCount = 0;
+      frameLoopCountKnown = false;
+      peakUsed = 0;
+      abandonedCount = 0;
+   }
+
+   /// Allocate the given amount of memory in bytes.
+   /// Return NULL if no memory is allocated.
+   virtual void* Allocate(size_t size)
+   {
+      Guard guard(&(this->mutex), this->threadSafe);
+      FrameCheck();
+
+      size_t blockSize = sizeof(BlockHeader) + RoundUp(size);
+      if((size_t)(heapTop - current) < blockSize)
+         return NULL;
+
+      BlockHeader* header = (BlockHeader*)current;
+      header->size = size;
+      current += blockSize;
+      peakUsed = std::max(peakUsed, (size_t)(current - heapBottom));
+      PostAllocate(header + 1);
+      return header + 1;
+   }
+
+   /// Free the given allocation.  The memory isn't reused until the arena is reset.
+   /// Return false if the allocation isn't from this arena.
+   virtual bool Deallocate(void* ptr)
+   {
+      Guard guard(&(this->mutex), this->threadSafe);
+      if(!Contains(ptr))
+         return false;
+
+      if(ptr >= current)
+      {
+         // Nothing has been allocated there since the arena was reset, so
+         // this must be left over from an earlier iteration.  Its header
+         // can't be trusted.
+      #if HEAP_DELEGATE_FRAME_DEBUG
+         ErrorPrintf("HeapDelegateFrame::Deallocate -- Allocation at %p survived past the end of its frame.\n", ptr);
+         assert(ptr < current);
+      #endif //#if HEAP_DELEGATE_FRAME_DEBUG
+         return true;
+      }
+
+      BlockHeader* header = (BlockHeader*)ptr - 1;
+   #if HEAP_DELEGATE_FRAME_DEBUG
+      memset(ptr, HEAP_DELEGATE_FRAME_POISON_BYTE, header->size);
+   #endif //#if HEAP_DELEGATE_FRAME_DEBUG
+
+      PreDeallocate(ptr);
+
+      // If this was the most recent allocation, the space can be reused right away.
+      if((unsigned char*)ptr + RoundUp(header->size) == current)
+         current = (unsigned char*)header;
+      return true;
+   }
+
+   /// Allocate from the top of the delegate.
+   /// Return NULL if no memory is allocated.
+   virtual void* AllocateTop(size_t size) { return Allocate(size); }
+   /// Allocate from the bottom of the delegate.
+   /// Return NULL if no memory is allocated.
+   virtual void* AllocateBottom(size_t size) { return Allocate(size); }
+
+   /// Reset the arena so all its memory is available again, and count any
+   /// allocations that are still outstanding as abandoned.  This is done
+   /// automatically the first time the arena is used in each main loop
+   /// iteration, but it can be called explicitly at other well-defined
+   /// points, like the end of an iteration.
+   void FrameReset()
+   {
+      Guard guard(&(this->mutex), this->threadSafe);
+      if(allocationCount)
+      {
+         abandonedCount += allocationCount;
+      #if HEAP_DELEGATE_FRAME_DEBUG
+         ErrorPrintf("HeapDelegateFrame::FrameReset -- %d allocations survived past the end of frame %d.\n",
+            (int)allocationCount, (int)frameNumber);
+      #endif //#if HEAP_DELEGATE_FRAME_DEBUG
+      }
+   #if HEAP_DELEGATE_FRAME_DEBUG
+      memset(heapBottom, HEAP_DELEGATE_FRAME_POISON_BYTE, current - heapBottom);
+   #endif //#if HEAP_DELEGATE_FRAME_DEBUG
+      allocationCount = 0;
+      current = heapBottom;
+      frameNumber++;
+   }
+
+   /// Return the allocator that draws from this arena.
+   Allocator* AllocatorGet() { return &allocator; }
+
+   /// Return the most memory used in a single frame so far in bytes.
+   size_t PeakUsedGet() { return peakUsed; }
+   /// Return the total number of allocations that were still outstanding
+   /// when the arena was reset.  This should stay 0.
+   size_t AbandonedCountGet() { return abandonedCount; }
+
+   /// Return true if 'ptr' points to an address in the arena.
+   bool Contains(void* ptr) { return (ptr >= heapBottom) && (ptr < heapTop); }
+
+   /// Return the total amount of free memory the delegate in bytes.
+   virtual size_t MemoryFreeGet() { return heapTop - current; }
+   /// Return the total number of bytes used, including overhead.
+   virtual size_t MemoryUsedGet() { return current - heapBottom; }
+   /// Return the total number of bytes in the delegate including used and free memory.
+   virtual size_t MemoryTotalGet() { return heapTop - heapBottom; }
+   /// Return the total number of free blocks in the delegate.
+   virtual size_t FreeBlockCountGet() { return (current < heapTop) ? 1 : 0; }
+   /// Return the size of the largest contiguous free block in the delegate in bytes.
+   virtual size_t MaxFreeContiguousSizeGet() { return MemoryFreeGet(); }
+
+   typedef HeapDelegate Inherited;
+
+protected:
+   /// Header placed in front of every allocation.
+   struct BlockHeader
+   {
+      /// Size of the allocation in bytes, not including this header.
+      size_t size;
+   };
+
+   /// Return the given size rounded up to keep allocations aligned.
+   static size_t RoundUp(size_t size) { return (size + FROG_MEM_ALIGN - 1) & ~(size_t)(FROG_MEM_ALIGN - 1); }
+
+   /// Reset the arena if a new main loop iteration has started since it was last used.
+   void FrameCheck()
+   {
+      uint32 loopCount = theClock->LoopCountGet();
+      if(frameLoopCountKnown && (loopCount != frameLoopCount))
+         FrameReset();
+      frameLoopCount = loopCount;
+      frameLoopCountKnown = true;
+   }
+
+   /// Bottom-most address for the arena
+   unsigned char* heapBottom;
+   /// Top-most address for the arena
+   unsigned char* heapTop;
+   /// Address at which the next allocation will be made
+   unsigned char* current;
+   /// Number of times the arena has been reset.
+   size_t frameNumber;
+   /// Value of theClock->LoopCountGet() when the arena was last used.
+   uint32 frameLoopCount;
+   /// True if 'frameLoopCount' has been set.
+   bool frameLoopCountKnown;
+   /// The most memory used in a single frame so far in bytes.
+   size_t peakUsed;
+   /// See 'AbandonedCountGet'.
+   size_t abandonedCount;
+   /// Allocator returned by 'AllocatorGet'.
+   AllocatorFrame allocator;
+};
+
+//==============================================================================
+
+inline void* AllocatorFrame::Allocate(size_t size)
+{
+   assert(heapDelegate);
+   return heapDelegate->Allocate(size);
+}
+
+//------------------------------------------------------------------------------
+
+inline void AllocatorFrame::Deallocate(void* ptr)
+{
+   if(!ptr)
+      return;
+   assert(heapDelegate && heapDelegate->Contains(ptr));
+   heapDelegate->Deallocate(ptr);
+}
+
+//------------------------------------------------------------------------------
+
+} //namespace Webfoot {
+
+#endif //#ifndef __FROG__HEAPDELEGATEFRAME_H__
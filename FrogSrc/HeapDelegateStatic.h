@@ -5,6 +5,8 @@
 #include "HeapDelegate.h"
 #include "Heap.h"
 #include "HeapSmall.h"
+#include "HeapBinned.h"
+#include "HeapSmallBinned.h"
 #include "Debug.h"
 #include "ThreadUtilities.h"
 
@@ -21,8 +23,10 @@ namespace Webfoot {
 /// HeapDelegateStatic is a HeapDelegate that does not change size after it
 /// is initialized.
 /// 'smallHeapCount' is the number of 256KB small allocation heaps that will
-/// be used by this delegate.
-template<int smallHeapCount>
+/// be used by this delegate.  'RegularHeapType' and 'SmallHeapType' select the
+/// heap implementations.  For example, use HeapBinned and HeapSmallBinned to
+/// find free blocks by size class rather than by walking a single free list.
+template<int smallHeapCount, typename RegularHeapType = Heap, typename SmallHeapType = HeapSmall>
 class HeapDelegateStatic : public HeapDelegate
 {
 public:
@@ -108,9 +112,26 @@ public:
       return maxFreeContiguousSize;
    }
 
+   /// Report the blocks of the small heaps, then the regular heap, to
+   /// 'visitor'.  HeapSmall's block layout is private to its implementation,
+   /// so small heaps of that type are skipped.  The delegate is locked during
+   /// the walk, so the visitor must not allocate from it.
+   void Walk(HeapWalkVisitor* visitor)
+   {
+      Guard guard(&(this->mutex), this->threadSafe);
+      for(int smallHeapIndex = 0; smallHeapIndex < smallHeapCount; smallHeapIndex++)
+         HeapWalk(&smallHeaps[smallHeapIndex], visitor);
+      HeapWalk(&regularHeap, visitor);
+   }
+
    typedef HeapDelegate Inherited;
 
 protected:
+   /// Report the blocks of the given heap to 'visitor'.
+   template<typename HeapType>
+   static void HeapWalk(HeapType* heap, HeapWalkVisitor* visitor) { heap->Walk(visitor); }
+   /// HeapSmall can't be walked.
+   static void HeapWalk(HeapSmall*, HeapWalkVisitor*) {}
 
    /// Use the given name for debug messages from this heap.
    /// The string will not be copied, so pass a persistent string.
@@ -165,15 +186,15 @@ protected:
 #endif //#ifdef _DEBUG
 
    /// Heap used for allocations not appropriate for the small heaps.
-   Heap regularHeap;
+   RegularHeapType regularHeap;
    /// Heaps reserved for particularly small allocations.
-   HeapSmall smallHeaps[smallHeapCount];
+   SmallHeapType smallHeaps[smallHeapCount];
 };
 
 //------------------------------------------------------------------------------
 
-template<int smallHeapCount>
-void HeapDelegateStatic<smallHeapCount>::Init(void* heapBottom, size_t size,
+template<int smallHeapCount, typename RegularHeapType, typename SmallHeapType>
+void HeapDelegateStatic<smallHeapCount, RegularHeapType, SmallHeapType>::Init(void* heapBottom, size_t size,
    bool _threadSafe, const char* _debugName, size_t _smallAllocationThreshold)
 {
    Inherited::Init(_threadSafe);
@@ -223,15 +244,15 @@ void HeapDelegateStatic<smallHeapCount>::Init(void* heapBottom, size_t size,
 
 //------------------------------------------------------------------------------
 
-template<int smallHeapCount>
-bool HeapDelegateStatic<smallHeapCount>::Deallocate(void* ptr)
+template<int smallHeapCount, typename RegularHeapType, typename SmallHeapType>
+bool HeapDelegateStatic<smallHeapCount, RegularHeapType, SmallHeapType>::Deallocate(void* ptr)
 {
    Guard guard(&(this->mutex), this->threadSafe);
 
    // First, see if it's in the small heaps.
    for(int smallHeapIndex = 0; smallHeapIndex < smallHeapCount; smallHeapIndex++)
    {
-      HeapSmall* smallHeap = &(smallHeaps[smallHeapIndex]);
+      SmallHeapType* smallHeap = &(smallHeaps[smallHeapIndex]);
       if(smallHeap->Contains(ptr))
       {
          PreDeallocate(ptr);
@@ -253,8 +274,8 @@ bool HeapDelegateStatic<smallHeapCount>::Deallocate(void* ptr)
 
 //------------------------------------------------------------------------------
 
-template<int smallHeapCount>
-void* HeapDelegateStatic<smallHeapCount>::AllocateTop(size_t size)
+template<int smallHeapCount, typename RegularHeapType, typename SmallHeapType>
+void* HeapDelegateStatic<smallHeapCount, RegularHeapType, SmallHeapType>::AllocateTop(size_t size)
 {
    Guard guard(&(this->mutex), this->threadSafe);
 
@@ -263,7 +284,7 @@ void* HeapDelegateStatic<smallHeapCount>::AllocateTop(size_t size)
    {
       for(int smallHeapIndex = (smallHeapCount - 1); smallHeapIndex >= 0; smallHeapIndex--)
       {
-         HeapSmall* smallHeap = &(smallHeaps[smallHeapIndex]);
+         SmallHeapType* smallHeap = &(smallHeaps[smallHeapIndex]);
          ptr = smallHeap->AllocateTop(size);
          if(ptr)
          {
@@ -285,8 +306,8 @@ void* HeapDelegateStatic<smallHeapCount>::AllocateTop(size_t size)
 
 //------------------------------------------------------------------------------
 
-template<int smallHeapCount>
-void* HeapDelegateStatic<smallHeapCount>::AllocateBottom(size_t size)
+template<int smallHeapCount, typename RegularHeapType, typename SmallHeapType>
+void* HeapDelegateStatic<smallHeapCount, RegularHeapType, SmallHeapType>::AllocateBottom(size_t size)
 {
    Guard guard(&(this->mutex), this->threadSafe);
 
@@ -295,7 +316,7 @@ void* HeapDelegateStatic<smallHeapCount>::AllocateBottom(size_t size)
    {
       for(int smallHeapIndex = 0; smallHeapIndex < smallHeapCount; smallHeapIndex++)
       {
-         HeapSmall* smallHeap = &(smallHeaps[smallHeapIndex]);
+         SmallHeapType* smallHeap = &(smallHeaps[smallHeapIndex]);
          ptr = smallHeap->AllocateBottom(size);
          if(ptr)
          {
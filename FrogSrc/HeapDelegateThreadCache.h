@@ -0,0 +1,492 @@
+#ifndef __FROG__HEAPDELEGATETHREADCACHE_H__
+#define __FROG__HEAPDELEGATETHREADCACHE_H__
+
+#include <new>
+#include "FrogMemory.h"
+#include "HeapDelegate.h"
+#include "ThreadUtilities.h"
+
+namespace Webfoot {
+
+/// Allocations of at most this many bytes are served from the per-thread caches.
+#define HEAP_DELEGATE_THREAD_CACHE_SIZE_MAX 256
+/// Size classes of the per-thread caches are this many bytes apart.
+#define HEAP_DELEGATE_THREAD_CACHE_GRANULARITY 16
+/// Maximum number of HeapDelegateThreadCache instances that can be initialized at once.
+#define HEAP_DELEGATE_THREAD_CACHE_INSTANCE_COUNT_MAX 4
+/// Default number of blocks to get from the referenced delegate when a cache is empty.
+#define HEAP_DELEGATE_THREAD_CACHE_REFILL_COUNT_DEFAULT 16
+/// Default number of blocks a cache can hold for a single size class before
+/// half of them are returned to the referenced delegate.
+#define HEAP_DELEGATE_THREAD_CACHE_CAPACITY_DEFAULT 64
+
+//==============================================================================
+
+/// HeapDelegateThreadCache sits in front of a different HeapDelegate and keeps
+/// a small cache of free blocks, or "magazine", for each size class on each
+/// thread that uses it.  Small allocations and frees made by the thread that
+/// owns the cache don't lock anything.  The referenced delegate, and its
+/// mutex, are only used when a cache needs to be refilled or flushed and for
+/// allocations too big to cache.  Blocks freed by a different thread are
+/// handed back to the owning thread's cache, which picks them up the next time
+/// it runs out.
+///
+/// Like HeapDelegateTemp, statistics like MemoryFreeGet simply return the
+/// value from the referenced delegate, and blocks sitting in caches count as
+/// used there.  Each allocation has a two-pointer prefix to record its owner.
+/// A thread should call ThreadCacheFlush before it exits so its cached
+/// blocks aren't held until Deinit.
+///
+/// The referenced delegate is only used while holding this delegate's mutex,
+/// and a refill or flush does all its work under a single lock, so the
+/// referenced delegate can be initialized without thread safety of its own.
+class HeapDelegateThreadCache : public HeapDelegate
+{
+public:
+   HeapDelegateThreadCache() { delegateReference = NULL; cacheList = NULL; slotIndex = -1; generation = 0; }
+   virtual ~HeapDelegateThreadCache() {}
+
+   /// Initialize the class to allocate from the given delegate.  When a
+   /// thread's cache for a size class is empty, 'refillCount' blocks are
+   /// requested at once.  When it holds more than 'cacheCapacity', half are
+   /// returned.
+   void Init(HeapDelegate* _delegateReference, bool _threadSafe = true,
+      int _refillCount = HEAP_DELEGATE_THREAD_CACHE_REFILL_COUNT_DEFAULT,
+      int _cacheCapacity = HEAP_DELEGATE_THREAD_CACHE_CAPACITY_DEFAULT);
+   /// Return all cached blocks to the referenced delegate.  Only call this once
+   /// the other threads that used this delegate have stopped.
+   virtual void Deinit();
+
+   /// Allocate the given amount of memory in bytes.
+   /// Return NULL if no memory is allocated.
+   virtual void* Allocate(size_t size);
+   /// Free the given allocation.  This assumes the allocation was made by
+   /// this HeapDelegate.  Return true if, as far as the delegate knows,
+   /// the memory has been freed successfully.  Do not call this on a pointer
+   /// unless you're sure it came from this delegate.
+   virtual bool Deallocate(void* ptr);
+
+   /// Allocate from the top of the delegate.  This bypasses the caches.
+   /// Return NULL if no memory is allocated.
+   virtual void* AllocateTop(size_t size)
+   {
+      Guard guard(&(this->mutex), this->threadSafe);
+      return UncachedBlockPrepare(delegateReference->AllocateTop(size + sizeof(BlockPrefix)));
+   }
+   /// Allocate from the bottom of the delegate.  This bypasses the caches.
+   /// Return NULL if no memory is allocated.
+   virtual void* AllocateBottom(size_t size)
+   {
+      Guard guard(&(this->mutex), this->threadSafe);
+      return UncachedBlockPrepare(delegateReference->AllocateBottom(size + sizeof(BlockPrefix)));
+   }
+
+   /// Return the calling thread's cached blocks to the referenced delegate.
+   /// Blocks other threads have freed back to this thread are included.
+   void ThreadCacheFlush();
+
+   /// Return true since this heap delegate is simply referencing another.
+   virtual bool HeapDelegateReferencingCheck() { return true; }
+
+   /// Return the total amount of free memory the delegate in bytes.
+   virtual size_t MemoryFreeGet() { return delegateReference->MemoryFreeGet(); }
+   /// Return the total number of bytes used, including overhead.
+   virtual size_t MemoryUsedGet() { return delegateReference->MemoryUsedGet(); }
+   /// Return the total number of bytes in the delegate including used and free memory.
+   virtual size_t MemoryTotalGet() { return delegateReference->MemoryTotalGet(); }
+   /// Return the total number of free blocks in the delegate.
+   virtual size_t FreeBlockCountGet() { return delegateReference->FreeBlockCountGet(); }
+   /// Return the size of the largest contiguous free block in the delegate in bytes.
+   virtual size_t MaxFreeContiguousSizeGet() { return delegateReference->MaxFreeContiguousSizeGet(); }
+   /// Return the current number of outstanding allocations from the delegate.
+   virtual size_t AllocationCountGet() { return delegateReference->AllocationCountGet(); }
+   /// Return the maximum number of outstanding allocations from the delegate so far.
+   virtual size_t AllocationCountMaxGet() { return delegateReference->AllocationCountMaxGet(); }
+   #if FROG_TRACK_MEMORY_USED_MAX
+      /// Return the maximum number of bytes allocated at any one time so far.
+      virtual size_t MemoryUsedMaxGet() { return delegateReference->MemoryUsedMaxGet(); }
+   #endif
+
+   /// Return the number of allocations served from a thread's cache.
+   size_t CacheHitCountGet() { return CounterSumGet(&ThreadCache::cacheHitCount); }
+   /// Return the number of times a thread's cache was refilled from the referenced delegate.
+   size_t RefillCountGet() { return CounterSumGet(&ThreadCache::refillCount); }
+   /// Return the number of times a thread's cache returned blocks to the referenced delegate.
+   size_t FlushCountGet() { return CounterSumGet(&ThreadCache::flushCount); }
+   /// Return the number of blocks freed by a thread other than the one that allocated them.
+   size_t CrossThreadFreeCountGet() { return CounterSumGet(&ThreadCache::crossThreadFreeCount); }
+
+   typedef HeapDelegate Inherited;
+
+protected:
+   enum
+   {
+      /// Number of size classes for cached blocks.
+      SIZE_CLASS_COUNT = HEAP_DELEGATE_THREAD_CACHE_SIZE_MAX / HEAP_DELEGATE_THREAD_CACHE_GRANULARITY,
+      /// 'sizeClass' of a block that isn't cached.
+      SIZE_CLASS_UNCACHED = SIZE_CLASS_COUNT
+   };
+
+   struct ThreadCache;
+
+   /// Header placed in front of every allocation.  It is two pointers in
+   /// size to keep the allocation aligned.
+   struct BlockPrefix
+   {
+      /// Cache of the thread that made the allocation or NULL if it isn't cached.
+      ThreadCache* owner;
+      /// Size class of the allocation.
+      size_t sizeClass;
+   };
+
+   /// A free block stored in a cache reuses the space after its prefix as a link.
+   struct CachedBlock
+   {
+      BlockPrefix prefix;
+      CachedBlock* next;
+   };
+
+   /// Collection of cached blocks for a single thread.
+   struct ThreadCache
+   {
+      /// Top free block of each size class.
+      CachedBlock* magazineHeads[SIZE_CLASS_COUNT];
+      /// Number of blocks in each magazine.
+      int magazineCounts[SIZE_CLASS_COUNT];
+      /// Blocks freed by other threads that haven't been picked up yet.
+      CachedBlock* remoteHead;
+      /// Protects 'remoteHead'.
+      Mutex remoteMutex;
+      /// Next cache in the delegate's list of all caches.
+      ThreadCache* nextCache;
+      /// Number of allocations served from this cache.
+      size_t cacheHitCount;
+      /// Number of times this cache was refilled.
+      size_t refillCount;
+      /// Number of times this cache returned blocks.
+      size_t flushCount;
+      /// Number of blocks this thread freed for other threads.
+      size_t crossThreadFreeCount;
+   };
+
+   /// A thread's reference to its cache for one instance.
+   struct ThreadCacheSlot
+   {
+      /// The thread's cache.
+      ThreadCache* cache;
+      /// Value of the instance's 'generation' when 'cache' was created.  If
+      /// it doesn't match, 'cache' was freed by Deinit.
+      uint32 generation;
+   };
+
+   /// Return the calling thread's array of caches, one for each initialized instance.
+   static ThreadCacheSlot* ThreadCacheSlotsGet()
+   {
+      static thread_local ThreadCacheSlot threadCacheSlots[HEAP_DELEGATE_THREAD_CACHE_INSTANCE_COUNT_MAX];
+      return threadCacheSlots;
+   }
+   /// Return the number of instances that have been assigned a slot so far.
+   static int& SlotCountGet()
+   {
+      static int slotCount = 0;
+      return slotCount;
+   }
+
+   /// Return the calling thread's cache, or NULL if it doesn't have one.
+   ThreadCache* ThreadCacheFind()
+   {
+      ThreadCacheSlot* slot = &ThreadCacheSlotsGet()[slotIndex];
+      return (slot->generation == generation) ? slot->cache : NULL;
+   }
+   /// Return the calling thread's cache, creating it if needed.
+   /// Return NULL if it can't be created.
+   ThreadCache* ThreadCacheGet();
+   /// Move any blocks freed by other threads into the magazines of the given cache.
+   void RemoteFreesCollect(ThreadCache* cache);
+   /// Get more blocks of the given size class for the given cache.
+   void Refill(ThreadCache* cache, int sizeClass);
+   /// Return the given number of blocks from a magazine to the referenced delegate.
+   void Flush(ThreadCache* cache, int sizeClass, int count);
+   /// Fill in the prefix of a block that isn't cached and return the address
+   /// to give the application.
+   void* UncachedBlockPrepare(void* ptr)
+   {
+      if(!ptr)
+         return NULL;
+      BlockPrefix* prefix = (BlockPrefix*)ptr;
+      prefix->owner = NULL;
+      prefix->sizeClass = SIZE_CLASS_UNCACHED;
+      return prefix + 1;
+   }
+   /// Return the sum of the given counter for all caches.
+   size_t CounterSumGet(size_t ThreadCache::* counter)
+   {
+      Guard guard(&(this->mutex), this->threadSafe);
+      size_t sum = 0;
+      for(ThreadCache* cache = cacheList; cache; cache = cache->nextCache)
+         sum += cache->*counter;
+      return sum;
+   }
+
+   /// The delegate from which this class will allocate.
+   HeapDelegate* delegateReference;
+   /// All caches created for this delegate.
+   ThreadCache* cacheList;
+   /// Index of this instance in each thread's array of caches.
+   int slotIndex;
+   /// Changed by each Init and Deinit, so the threads' references to caches
+   /// freed by Deinit are ignored.
+   uint32 generation;
+   /// Number of blocks requested when refilling a magazine.
+   int refillCount;
+   /// Maximum number of blocks in a magazine.
+   int cacheCapacity;
+};
+
+//------------------------------------------------------------------------------
+
+inline void HeapDelegateThreadCache::Init(HeapDelegate* _delegateReference, bool _threadSafe,
+   int _refillCount, int _cacheCapacity)
+{
+   Inherited::Init(_threadSafe);
+   assert(_delegateReference);
+   assert(_refillCount > 0);
+   assert(_cacheCapacity >= _refillCount);
+   delegateReference = _delegateReference;
+   refillCount = _refillCount;
+   cacheCapacity = _cacheCapacity;
+   cacheList = NULL;
+   generation++;
+
+   if(slotIndex < 0)
+   {
+      assert(SlotCountGet() < HEAP_DELEGATE_THREAD_CACHE_INSTANCE_COUNT_MAX);
+      slotIndex = SlotCountGet()++;
+   }
+}
+
+//------------------------------------------------------------------------------
+
+inline void HeapDelegateThreadCache::Deinit()
+{
+   // Every thread's reference to its cache becomes invalid here, not just
+   // the calling thread's.
+   ThreadCache* caches;
+   {
+      Guard guard(&(this->mutex), this->threadSafe);
+      caches = cacheList;
+      cacheList = NULL;
+      generation++;
+   }
+
+   while(caches)
+   {
+      ThreadCache* cache = caches;
+      caches = cache->nextCache;
+
+      RemoteFreesCollect(cache);
+      for(int sizeClass = 0; sizeClass < SIZE_CLASS_COUNT; sizeClass++)
+         Flush(cache, sizeClass, cache->magazineCounts[sizeClass]);
+      cache->remoteMutex.Deinit();
+      cache->~ThreadCache();
+      Guard guard(&(this->mutex), this->threadSafe);
+      delegateReference->Deallocate(cache);
+   }
+
+   Inherited::Deinit();
+}
+
+//------------------------------------------------------------------------------
+
+inline void* HeapDelegateThreadCache::Allocate(size_t size)
+{
+   ThreadCache* cache = (size && (size <= HEAP_DELEGATE_THREAD_CACHE_SIZE_MAX)) ? ThreadCacheGet() : NULL;
+   if(!cache)
+   {
+      Guard guard(&(this->mutex), this->threadSafe);
+      return UncachedBlockPrepare(delegateReference->Allocate(size + sizeof(BlockPrefix)));
+   }
+
+   int sizeClass = (int)((size - 1) / HEAP_DELEGATE_THREAD_CACHE_GRANULARITY);
+   if(!cache->magazineHeads[sizeClass])
+   {
+      RemoteFreesCollect(cache);
+      if(!cache->magazineHeads[sizeClass])
+      {
+         Refill(cache, sizeClass);
+         if(!cache->magazineHeads[sizeClass])
+            return NULL;
+      }
+   }
+   else
+   {
+      cache->cacheHitCount++;
+   }
+
+   CachedBlock* block = cache->magazineHeads[sizeClass];
+   cache->magazineHeads[sizeClass] = block->next;
+   cache->magazineCounts[sizeClass]--;
+   return &(block->prefix) + 1;
+}
+
+//------------------------------------------------------------------------------
+
+inline bool HeapDelegateThreadCache::Deallocate(void* ptr)
+{
+   if(!ptr)
+      return true;
+
+   CachedBlock* block = (CachedBlock*)((BlockPrefix*)ptr - 1);
+   ThreadCache* owner = block->prefix.owner;
+   // A thread that has never allocated from this delegate doesn't get a
+   // cache just for freeing.
+   ThreadCache* cache = owner ? ThreadCacheFind() : NULL;
+   if(!cache)
+   {
+      Guard guard(&(this->mutex), this->threadSafe);
+      return delegateReference->Deallocate(block);
+   }
+
+   if(cache == owner)
+   {
+      int sizeClass = (int)block->prefix.sizeClass;
+      block->next = cache->magazineHeads[sizeClass];
+      cache->magazineHeads[sizeClass] = block;
+      cache->magazineCounts[sizeClass]++;
+      if(cache->magazineCounts[sizeClass] > cacheCapacity)
+         Flush(cache, sizeClass, cacheCapacity / 2);
+   }
+   else
+   {
+      // Hand the block back to the thread that owns it.
+      Guard guard(&(owner->remoteMutex), this->threadSafe);
+      block->next = owner->remoteHead;
+      owner->remoteHead = block;
+      cache->crossThreadFreeCount++;
+   }
+   return true;
+}
+
+//------------------------------------------------------------------------------
+
+inline void HeapDelegateThreadCache::ThreadCacheFlush()
+{
+   ThreadCache* cache = ThreadCacheFind();
+   if(!cache)
+      return;
+
+   RemoteFreesCollect(cache);
+   for(int sizeClass = 0; sizeClass < SIZE_CLASS_COUNT; sizeClass++)
+      Flush(cache, sizeClass, cache->magazineCounts[sizeClass]);
+}
+
+//------------------------------------------------------------------------------
+
+inline HeapDelegateThreadCache::ThreadCache* HeapDelegateThreadCache::ThreadCacheGet()
+{
+   ThreadCache* existingCache = ThreadCacheFind();
+   if(existingCache)
+      return existingCache;
+
+   Guard guard(&(this->mutex), this->threadSafe);
+   void* cacheMemory = delegateReference->AllocateBottom(sizeof(ThreadCache));
+   if(!cacheMemory)
+      return NULL;
+   ThreadCache* cache = new(cacheMemory) ThreadCache;
+   for(int sizeClass = 0; sizeClass < SIZE_CLASS_COUNT; sizeClass++)
+   {
+      cache->magazineHeads[sizeClass] = NULL;
+      cache->magazineCounts[sizeClass] = 0;
+   }
+   cache->remoteHead = NULL;
+   cache->remoteMutex.Init();
+   cache->cacheHitCount = 0;
+   cache->refillCount = 0;
+   cache->flushCount = 0;
+   cache->crossThreadFreeCount = 0;
+
+   cache->nextCache = cacheList;
+   cacheList = cache;
+   ThreadCacheSlot* slot = &ThreadCacheSlotsGet()[slotIndex];
+   slot->cache = cache;
+   slot->generation = generation;
+   return cache;
+}
+
+//------------------------------------------------------------------------------
+
+inline void HeapDelegateThreadCache::RemoteFreesCollect(ThreadCache* cache)
+{
+   CachedBlock* block;
+   {
+      Guard guard(&(cache->remoteMutex), this->threadSafe);
+      block = cache->remoteHead;
+      cache->remoteHead = NULL;
+   }
+
+   while(block)
+   {
+      CachedBlock* nextBlock = block->next;
+      int sizeClass = (int)block->prefix.sizeClass;
+      block->next = cache->magazineHeads[sizeClass];
+      cache->magazineHeads[sizeClass] = block;
+      cache->magazineCounts[sizeClass]++;
+      block = nextBlock;
+   }
+}
+
+//------------------------------------------------------------------------------
+
+inline void HeapDelegateThreadCache::Refill(ThreadCache* cache, int sizeClass)
+{
+   size_t blockSize = sizeof(BlockPrefix) + ((sizeClass + 1) * HEAP_DELEGATE_THREAD_CACHE_GRANULARITY);
+   Guard guard(&(this->mutex), this->threadSafe);
+   for(int blockIndex = 0; blockIndex < refillCount; blockIndex++)
+   {
+      CachedBlock* block = (CachedBlock*)delegateReference->Allocate(blockSize);
+      if(!block)
+         break;
+      block->prefix.owner = cache;
+      block->prefix.sizeClass = sizeClass;
+      block->next = cache->magazineHeads[sizeClass];
+      cache->magazineHeads[sizeClass] = block;
+      cache->magazineCounts[sizeClass]++;
+   }
+   cache->refillCount++;
+}
+
+//------------------------------------------------------------------------------
+
+inline void HeapDelegateThreadCache::Flush(ThreadCache* cache, int sizeClass, int count)
+{
+   if(count <= 0)
+      return;
+
+   // Detach the blocks first, so the lock is only needed while they're freed.
+   CachedBlock* blocks = cache->magazineHeads[sizeClass];
+   CachedBlock* lastBlock = NULL;
+   for(int blockIndex = 0; (blockIndex < count) && cache->magazineHeads[sizeClass]; blockIndex++)
+   {
+      lastBlock = cache->magazineHeads[sizeClass];
+      cache->magazineHeads[sizeClass] = lastBlock->next;
+      cache->magazineCounts[sizeClass]--;
+   }
+   if(!lastBlock)
+      return;
+   lastBlock->next = NULL;
+
+   Guard guard(&(this->mutex), this->threadSafe);
+   while(blocks)
+   {
+      CachedBlock* nextBlock = blocks->next;
+      delegateReference->Deallocate(blocks);
+      blocks = nextBlock;
+   }
+   cache->flushCount++;
+}
+
+//==============================================================================
+
+} //namespace Webfoot {
+
+#endif //#ifndef __FROG__HEAPDELEGATETHREADCACHE_H__
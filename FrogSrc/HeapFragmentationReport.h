@@ -0,0 +1,377 @@
+#ifndef __FROG__HEAPFRAGMENTATIONREPORT_H__
+#define __FROG__HEAPFRAGMENTATIONREPORT_H__
+
+#include "FrogMemory.h"
+#include "HeapWalk.h"
+#include "HeapDelegate.h"
+#include "Table.h"
+#include "Bitmap.h"
+#include "BitmapLoaderPNG.h"
+#include "Debug.h"
+
+namespace Webfoot {
+
+/// Number of buckets in the free run histogram of a HeapFragmentationReport.
+/// Bucket 'n' counts free runs of at least 2^n bytes and less than 2^(n+1).
+#define HEAP_FRAGMENTATION_REPORT_HISTOGRAM_BUCKET_COUNT (sizeof(size_t) * 8)
+/// Default width and height of the image saved by HeapFragmentationReport::ImageSave.
+#define HEAP_FRAGMENTATION_REPORT_IMAGE_SIZE_DEFAULT 512
+
+//==============================================================================
+
+/// HeapFragmentationReport builds a map of the used blocks and free runs of
+/// one or more heaps, along with a histogram of free run sizes and a fragmentation
+/// index.  The index is 1 - (largest free run / total free memory), so 0 means
+/// all the free memory is contiguous, and values near 1 mean a big allocation
+/// can fail even though plenty of memory is free in total.  Call Add for each
+/// heap or HeapDelegateStatic to include, and OwnersAttach to label used
+/// blocks with the call sites from a delegate's allocation log.  Used blocks
+/// are kept separate, so each one has its own owner, while adjacent free
+/// blocks are combined into a single free run.  The report can be
+/// printed or saved as a PNG so it can be compared over a long session.
+///
+/// The report's own memory comes from theAllocatorMallocFree so building it
+/// doesn't disturb the heaps being measured.
+class HeapFragmentationReport : public HeapWalkVisitor
+{
+public:
+   /// A single used block or a contiguous run of free memory.
+   struct Run
+   {
+      /// Address of the beginning of the run.
+      void* address;
+      /// Size of the run in bytes, including block headers.
+      size_t size;
+      /// True if the run holds allocations.
+      bool used;
+      /// Number of logged allocations found in the run by OwnersAttach.
+      /// This is at most 1 for heaps that report each block separately.
+      int loggedCount;
+      /// Source file of the logged allocation in the run, or NULL if unknown.
+      const char* ownerFile;
+      /// Line number of the logged allocation in the run.
+      int ownerLine;
+      /// Size in bytes of the logged allocation in the run.
+      size_t ownerSize;
+   };
+
+   virtual ~HeapFragmentationReport() {}
+
+   void Init()
+   {
+      runs.Init(theAllocatorMallocFree);
+      Clear();
+   }
+
+   void Deinit()
+   {
+      runs.Deinit();
+   }
+
+   /// Forget all runs and statistics.
+   void Clear();
+
+   /// Add the blocks of the given heap to the report.  'HeapType' can be any
+   /// class with a Walk method, like Heap, HeapBinned, or HeapDelegateStatic.
+   template<typename HeapType>
+   void Add(HeapType* heap)
+   {
+      heap->Walk(this);
+      StatisticsUpdate();
+   }
+
+   /// Label each used block with the logged allocation from the given
+   /// delegate that falls within it.  This only has an effect while logging
+   /// is enabled for the delegate.  Other threads should not be using the
+   /// delegate while this is called.
+   void OwnersAttach(HeapDelegate* heapDelegate);
+
+   virtual void RunVisit(void* address, size_t size, bool used);
+
+   /// Print a summary, the free run histogram, and the used blocks with
+   /// known owners that sit next to free runs.
+   void Print();
+
+   /// Save an image of the report as a PNG file of the given dimensions.
+   /// Each pixel represents an equal share of the memory, with used memory in
+   /// red, free memory in green, and pixels that are partially used blended.
+   /// The filename should include the extension.  Return true if successful.
+   bool ImageSave(const char* filename, FileManager* fileManager = theFiles,
+      int width = HEAP_FRAGMENTATION_REPORT_IMAGE_SIZE_DEFAULT,
+      int height = HEAP_FRAGMENTATION_REPORT_IMAGE_SIZE_DEFAULT, HeapID tempHeap = HEAP_TEMP);
+
+   /// Return the number of runs in the report.
+   int RunCountGet() { return runs.SizeGet(); }
+   /// Return the run at the given index.  Runs are sorted by address.
+   Run& RunGet(int index) { return runs[index]; }
+
+   /// Return the total number of bytes covered by the report.
+   size_t MemoryTotalGet() { return memoryUsed + memoryFree; }
+   /// Return the number of bytes in used runs.
+   size_t MemoryUsedGet() { return memoryUsed; }
+   /// Return the number of bytes in free runs.
+   size_t MemoryFreeGet() { return memoryFree; }
+   /// Return the number of free runs.
+   size_t FreeRunCountGet() { return freeRunCount; }
+   /// Return the size of the largest free run in bytes.
+   size_t FreeRunSizeMaxGet() { return freeRunSizeMax; }
+   /// Return 1 - (largest free run / total free memory), or 0 if nothing is free.
+   float FragmentationIndexGet() { return memoryFree ? (1.0f - ((float)freeRunSizeMax / (float)memoryFree)) : 0.0f; }
+   /// Return the number of free runs in the given histogram bucket.
+   size_t HistogramCountGet(int bucketIndex) { return histogramCounts[bucketIndex]; }
+   /// Return the total size of the free runs in the given histogram bucket.
+   size_t HistogramBytesGet(int bucketIndex) { return histogramBytes[bucketIndex]; }
+
+protected:
+   /// Sort the runs and recompute the statistics.
+   void StatisticsUpdate();
+   /// Return the index of the run that contains 'address', or -1 if there isn't one.
+   int RunFind(void* address);
+   /// Comparator for sorting runs by address.
+   static bool RunAddressLess(const Run& runA, const Run& runB) { return runA.address < runB.address; }
+
+   /// Runs of used and free memory.
+   Table<Run> runs;
+   /// Total size of the used runs.
+   size_t memoryUsed;
+   /// Total size of the free runs.
+   size_t memoryFree;
+   /// Number of free runs.
+   size_t freeRunCount;
+   /// Size of the largest free run.
+   size_t freeRunSizeMax;
+   /// Number of free runs in each power-of-2 size bucket.
+   size_t histogramCounts[HEAP_FRAGMENTATION_REPORT_HISTOGRAM_BUCKET_COUNT];
+   /// Total size of the free runs in each power-of-2 size bucket.
+   size_t histogramBytes[HEAP_FRAGMENTATION_REPORT_HISTOGRAM_BUCKET_COUNT];
+};
+
+//==============================================================================
+
+inline void HeapFragmentationReport::Clear()
+{
+   runs.Clear();
+   memoryUsed = 0;
+   memoryFree = 0;
+   freeRunCount = 0;
+   freeRunSizeMax = 0;
+   for(int bucketIndex = 0; bucketIndex < (int)HEAP_FRAGMENTATION_REPORT_HISTOGRAM_BUCKET_COUNT; bucketIndex++)
+   {
+      histogramCounts[bucketIndex] = 0;
+      histogramBytes[bucketIndex] = 0;
+   }
+}
+
+//------------------------------------------------------------------------------
+
+inline void HeapFragmentationReport::RunVisit(void* address, size_t size, bool used)
+{
+   if(!size)
+      return;
+
+   // Combine free memory with the previous run if it's also free and directly
+   // before this one.  Used blocks stay separate so they can be attributed
+   // individually.
+   if(!used && runs.SizeGet())
+   {
+      Run& previous = runs[runs.SizeGet() - 1];
+      if(!previous.used && (((unsigned char*)previous.address + previous.size) == address))
+      {
+         previous.size += size;
+         return;
+      }
+   }
+
+   Run run;
+   run.address = address;
+   run.size = size;
+   run.used = used;
+   run.loggedCount = 0;
+   run.ownerFile = NULL;
+   run.ownerLine = 0;
+   run.ownerSize = 0;
+   runs.Add(run);
+}
+
+//------------------------------------------------------------------------------
+
+inline void HeapFragmentationReport::StatisticsUpdate()
+{
+   runs.Sort(RunAddressLess);
+
+   memoryUsed = 0;
+   memoryFree = 0;
+   freeRunCount = 0;
+   freeRunSizeMax = 0;
+   for(int bucketIndex = 0; bucketIndex < (int)HEAP_FRAGMENTATION_REPORT_HISTOGRAM_BUCKET_COUNT; bucketIndex++)
+   {
+      histogramCounts[bucketIndex] = 0;
+      histogramBytes[bucketIndex] = 0;
+   }
+
+   for(int runIndex = 0; runIndex < runs.SizeGet(); runIndex++)
+   {
+      Run& run = runs[runIndex];
+      if(run.used)
+      {
+         memoryUsed += run.size;
+         continue;
+      }
+
+      memoryFree += run.size;
+      freeRunCount++;
+      freeRunSizeMax = std::max(freeRunSizeMax, run.size);
+      int bucketIndex = 0;
+      while((run.size >> (bucketIndex + 1)) && (bucketIndex < (int)HEAP_FRAGMENTATION_REPORT_HISTOGRAM_BUCKET_COUNT - 1))
+         bucketIndex++;
+      histogramCounts[bucketIndex]++;
+      histogramBytes[bucketIndex] += run.size;
+   }
+}
+
+//------------------------------------------------------------------------------
+
+inline int HeapFragmentationReport::RunFind(void* address)
+{
+   // Binary search for the last run that starts at or before 'address'.
+   int low = 0;
+   int high = runs.SizeGet() - 1;
+   int found = -1;
+   while(low <= high)
+   {
+      int middle = (low + high) / 2;
+      if(runs[middle].address <= address)
+      {
+         found = middle;
+         low = middle + 1;
+      }
+      else
+      {
+         high = middle - 1;
+      }
+   }
+   if((found >= 0) && (address < (void*)((unsigned char*)runs[found].address + runs[found].size)))
+      return found;
+   return -1;
+}
+
+//------------------------------------------------------------------------------
+
+inline void HeapFragmentationReport::OwnersAttach(HeapDelegate* heapDelegate)
+{
+   Map<void*, AllocationEntry>* allocationLog = heapDelegate->AllocationLogGet();
+   Map<void*, AllocationEntry>::Iterator iterator = allocationLog->Begin();
+   for(; iterator.WithinCheck(); iterator.Next())
+   {
+      int runIndex = RunFind(iterator.Key());
+      if((runIndex < 0) || !runs[runIndex].used)
+         continue;
+
+      Run& run = runs[runIndex];
+      AllocationEntry& entry = iterator.Value();
+      run.loggedCount++;
+      if(entry.size >= run.ownerSize)
+      {
+         run.ownerFile = entry.file;
+         run.ownerLine = entry.line;
+         run.ownerSize = entry.size;
+      }
+   }
+}
+
+//------------------------------------------------------------------------------
+
+inline void HeapFragmentationReport::Print()
+{
+   DebugPrintf("HeapFragmentationReport -- %u bytes used, %u bytes free in %u runs, largest free run %u bytes, fragmentation index %.3f\n",
+      (unsigned int)memoryUsed, (unsigned int)memoryFree, (unsigned int)freeRunCount,
+      (unsigned int)freeRunSizeMax, FragmentationIndexGet());
+
+   DebugPrintf("   Free runs by size:\n");
+   for(int bucketIndex = 0; bucketIndex < (int)HEAP_FRAGMENTATION_REPORT_HISTOGRAM_BUCKET_COUNT; bucketIndex++)
+   {
+      if(!histogramCounts[bucketIndex])
+         continue;
+      DebugPrintf("   %10u+ bytes: %6u runs, %10u bytes\n", (unsigned int)((size_t)1 << bucketIndex),
+         (unsigned int)histogramCounts[bucketIndex], (unsigned int)histogramBytes[bucketIndex]);
+   }
+
+   // Used blocks that border free runs are what keep the free memory apart.
+   DebugPrintf("   Used blocks next to free runs:\n");
+   for(int runIndex = 0; runIndex < runs.SizeGet(); runIndex++)
+   {
+      Run& run = runs[runIndex];
+      if(!run.used || !run.ownerFile)
+         continue;
+      bool freeBefore = (runIndex > 0) && !runs[runIndex - 1].used;
+      bool freeAfter = (runIndex < runs.SizeGet() - 1) && !runs[runIndex + 1].used;
+      if(!freeBefore && !freeAfter)
+         continue;
+      DebugPrintf("   %p: %u bytes, %d logged allocations, largest %u bytes from %s(%d)\n", run.address,
+         (unsigned int)run.size, run.loggedCount, (unsigned int)run.ownerSize, run.ownerFile, run.ownerLine);
+   }
+}
+
+//------------------------------------------------------------------------------
+
+inline bool HeapFragmentationReport::ImageSave(const char* filename, FileManager* fileManager,
+   int width, int height, HeapID tempHeap)
+{
+   assert((width > 0) && (height > 0));
+   Bitmap bitmap;
+   if(!bitmap.Allocate(Point2I::Create(width, height), Bitmap::FORMAT_RGB8, theAllocatorMallocFree))
+      return false;
+
+   size_t pixelCount = (size_t)width * (size_t)height;
+   size_t bytesPerPixel = std::max((size_t)1, (MemoryTotalGet() + pixelCount - 1) / pixelCount);
+   unsigned char* pixel = (unsigned char*)bitmap.DataGet();
+   int runIndex = 0;
+   size_t runOffset = 0;
+   for(size_t pixelIndex = 0; pixelIndex < pixelCount; pixelIndex++, pixel += 3)
+   {
+      // Find how much of the memory represented by this pixel is used.
+      size_t bytesRemaining = bytesPerPixel;
+      size_t bytesCovered = 0;
+      size_t bytesUsed = 0;
+      while(bytesRemaining && (runIndex < runs.SizeGet()))
+      {
+         Run& run = runs[runIndex];
+         size_t bytesTaken = std::min(bytesRemaining, run.size - runOffset);
+         if(run.used)
+            bytesUsed += bytesTaken;
+         bytesCovered += bytesTaken;
+         bytesRemaining -= bytesTaken;
+         runOffset += bytesTaken;
+         if(runOffset == run.size)
+         {
+            runIndex++;
+            runOffset = 0;
+         }
+      }
+
+      if(!bytesCovered)
+      {
+         // Past the end of the report
+         pixel[0] = 32;
+         pixel[1] = 32;
+         pixel[2] = 32;
+      }
+      else
+      {
+         float usedFraction = (float)bytesUsed / (float)bytesCovered;
+         pixel[0] = (unsigned char)(32.0f + (208.0f * usedFraction));
+         pixel[1] = (unsigned char)(200.0f - (160.0f * usedFraction));
+         pixel[2] = 40;
+      }
+   }
+
+   bool success = theBitmapLoaderPNG->Save(&bitmap, filename, fileManager, tempHeap);
+   bitmap.Deinit();
+   return success;
+}
+
+//==============================================================================
+
+} //namespace Webfoot {
+
+#endif //#ifndef __FROG__HEAPFRAGMENTATIONREPORT_H__
@@ -0,0 +1,35 @@
+#ifndef __FROG__HEAPSMALLBINNED_H__
+#define __FROG__HEAPSMALLBINNED_H__
+
+#include "FrogMemory.h"
+#include "HeapSmall.h"
+#include "HeapBinned.h"
+
+namespace Webfoot {
+
+//===============================================================================
+
+/// HeapSmallBinned has the same interface and limits as HeapSmall, but it
+/// uses the segregated size-class free lists of HeapBinnedBase.  Offsets and
+/// lengths are stored as 16-bit numbers of HEAP_SMALL_BLOCK_SIZE-byte blocks,
+/// so the overhead per allocation is 8 bytes.  The heap itself can't hold more
+/// than HEAP_SMALL_SIZE_MAX bytes.
+class HeapSmallBinned : public HeapBinnedBase<unsigned short, HEAP_SMALL_BLOCK_SIZE>
+{
+public:
+   /// Initialize the heap to use the given block of memory.
+   /// '_heapBottom' must be 4-byte aligned.
+   void Init(void* _heapBottom, size_t _totalSize)
+   {
+      assert(_totalSize <= HEAP_SMALL_SIZE_MAX);
+      Inherited::Init(_heapBottom, _totalSize);
+   }
+
+   typedef HeapBinnedBase<unsigned short, HEAP_SMALL_BLOCK_SIZE> Inherited;
+};
+
+//===============================================================================
+
+} //namespace Webfoot {
+
+#endif //#ifndef __FROG__HEAPSMALLBINNED_H__
@@ -0,0 +1,29 @@
+#ifndef __FROG__HEAPWALK_H__
+#define __FROG__HEAPWALK_H__
+
+#include "FrogMemory.h"
+
+namespace Webfoot {
+
+//===============================================================================
+
+/// Interface for objects that receive the runs of memory found by the Walk
+/// methods of the heaps and heap delegates.  Runs are reported in address
+/// order within each heap.  Adjacent runs of the same kind are not
+/// necessarily combined.
+class HeapWalkVisitor
+{
+public:
+   virtual ~HeapWalkVisitor() {}
+
+   /// Called for each run of 'size' bytes starting at 'address'.  'used' is
+   /// true if the run holds allocations and false if it is free.  Sizes
+   /// include block headers.
+   virtual void RunVisit(void* address, size_t size, bool used) = 0;
+};
+
+//===============================================================================
+
+} //namespace Webfoot {
+
+#endif //#ifndef __FROG__HEAPWALK_H__
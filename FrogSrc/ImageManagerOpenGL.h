@@ -2,6 +2,8 @@
 #define __FROG__IMAGEMANAGEROPENGL_H__
 
 #include "FrogMemory.h"
+#include "Debug.h"
+#include "Utility.h"
 #include "Point2.h"
 #include "Allocator.h"
 #include "Bitmap.h"
@@ -9,6 +11,7 @@
 #include "FileManager.h"
 #include "Image.h"
 #include "ImageManagerCommon.h"
+#include "Screen.h"
 
 namespace Webfoot {
 
@@ -32,6 +35,19 @@ public:
    Image* Load(const char* filename, int options = 0, Allocator* dataAllocator = NULL,
       HeapID objectHeap = HEAP_DEFAULT, FileManager* fileManager = theFiles,
       HeapID tempHeap = HEAP_TEMP);
+
+   /// Register an Image for the given file made from a Bitmap that was
+   /// already loaded with theBitmaps->Load, so the file can be read and
+   /// decoded elsewhere, like on a worker thread.  Only KEEP_BITMAP_DATA and
+   /// SKIP_PREMULTIPLY_ALPHA are supported in 'options', and unless the
+   /// latter is given, the alpha of 'bitmap' should already be premultiplied.
+   /// The Image takes ownership of 'bitmap', and if the file is already
+   /// loaded, 'bitmap' is freed and the existing Image's reference count is
+   /// incremented instead.  Bitmaps that would need to be split into several
+   /// textures are not supported.  Free the Image with Unload.  Return NULL
+   /// if unsuccessful, in which case 'bitmap' is freed too.
+   Image* BitmapAdd(const char* filename, Bitmap* bitmap, int options = 0,
+      HeapID objectHeap = HEAP_DEFAULT, FileManager* fileManager = theFiles);
    
    /// Singleton instance
    static ImageManagerOpenGL instance;
@@ -63,6 +79,57 @@ static ImageManagerOpenGL * const theImages = &ImageManagerOpenGL::instance;
 
 //==============================================================================
 
+inline Image* ImageManagerOpenGL::BitmapAdd(const char* filename, Bitmap* bitmap, int options,
+   HeapID objectHeap, FileManager* fileManager)
+{
+   assert(filename);
+   assert(bitmap);
+   Image* image = (Image*)images.Increment(filename, fileManager);
+   if(image)
+   {
+      theBitmaps->Unload(bitmap);
+      return image;
+   }
+
+   bool legalCheck = !(options & (GENERATE_MIPMAPS | POINT_FILTERING))
+      && (bitmap->WidthGet() <= IMAGE_SEGMENT_EDGE_MAX) && (bitmap->HeightGet() <= IMAGE_SEGMENT_EDGE_MAX);
+#if FROG_OPENGL_ES
+   legalCheck = legalCheck && PowerOf2Check(bitmap->WidthGet()) && PowerOf2Check(bitmap->HeightGet());
+#else
+   legalCheck = legalCheck && (bitmap->WidthGet() <= theScreen->TextureSizeMax32Get())
+      && (bitmap->HeightGet() <= theScreen->TextureSizeMax32Get());
+#endif //#if FROG_OPENGL_ES
+   Texture* texture = legalCheck ? theScreen->TextureCreate(objectHeap) : NULL;
+   if(!texture || !texture->Init(objectHeap) || !texture->BitmapSet(bitmap))
+   {
+      if(texture)
+      {
+         texture->Deinit();
+         frog_delete texture;
+      }
+      theBitmaps->Unload(bitmap);
+      return NULL;
+   }
+
+   // As with an Image loaded from a bitmap that didn't need to be split, the
+   // Image has the only segment of the texture and unloads it along with
+   // itself.
+   ImageSegment segment;
+   segment.texture = texture;
+   segment.textureSubset = Box2F::Create(0.0f, 0.0f, (float)bitmap->WidthGet(), (float)bitmap->HeightGet());
+   segment.position = Point2F::Create(0.0f, 0.0f);
+   segment.shouldUnloadTexture = true;
+   image = theScreen->ImageCreate(objectHeap);
+   image->Init(1, objectHeap);
+   image->SegmentSet(&segment, 0);
+   if(!(options & KEEP_BITMAP_DATA))
+      image->UnnecessaryBitmapDataDeallocate();
+   images.Add(filename, fileManager, image);
+   return image;
+}
+
+//==============================================================================
+
 } //namespace Webfoot {
 
 #endif //#ifndef __FROG__IMAGEMANAGEROPENGL_H__
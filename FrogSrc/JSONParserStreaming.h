@@ -0,0 +1,226 @@
+#ifndef __FROG__JSONPARSERSTREAMING_H__
+#define __FROG__JSONPARSERSTREAMING_H__
+
+#include "FrogMemory.h"
+#include "Debug.h"
+#include "FrogString.h"
+#include "File.h"
+#include "FileManager.h"
+#include "JSONValue.h"
+#include "JSONParser.h"
+#include "HeapDelegateArena.h"
+#include "api/yajl_parse.h"
+
+namespace Webfoot {
+
+//Number of bytes read from the file and passed to YAJL at a time.
+#define JSON_PARSER_STREAMING_CHUNK_SIZE (16 * 1024)
+//Rough ratio of the memory used by a tree of JSONValues to the size of the
+//JSON text.  This is used to reserve space in an Arena before parsing.
+#define JSON_PARSER_STREAMING_ARENA_RATIO 4
+
+//==============================================================================
+
+/// JSONParserStreaming builds the same trees of JSONValues as JSONParser, but
+/// it reads the file a chunk at a time rather than loading all the text
+/// first, so the text and the tree are never in memory together.
+///
+/// The ArenaLoad functions also put every node and string of the tree in the
+/// given Arena, by way of the HeapDelegateArena the project installed on
+/// 'arenaHeapID'.  The fastest way to free the tree is to skip its Deinit and
+/// just Deinit the Arena.  It can also be freed the usual way with Deinit and
+/// delete, but only before the Arena is deinitialized.  After Arena::Deinit,
+/// the root and everything in it must not be touched at all, including to
+/// free it.  Allocations made by later changes to the tree, without an
+/// ArenaGuard, come from the fallback delegate of the HeapDelegateArena, so a
+/// tree that will be changed should be freed the usual way before the Arena
+/// is deinitialized.
+///
+///  Arena arena;
+///  arena.Init();
+///  JSONValue* specs = JSONParserStreaming().ArenaLoad("Levels/Level1", &arena, HEAP_DEBUG);
+///  ...
+///  arena.Deinit();
+///  specs = NULL;
+class JSONParserStreaming : public JSONParser
+{
+public:
+   /// Load the given file from the given manager and return it parsed into a
+   /// tree of JSONValues.  Do not include the ".json" extension in the
+   /// filename.  Long-term allocations will be made with '_heapID', and
+   /// short-term allocations will be made with '_tempHeapID'.  Deinit and
+   /// delete the returned JSONValue when you are done with it and its
+   /// descendants.
+   JSONValue* Load(const char* filename, FileManager* fileManager = theFiles,
+      HeapID _heapID = HEAP_DEFAULT, HeapID _tempHeapID = HEAP_TEMP);
+   /// Parse the given JSON file, beginning at the current position.
+   /// Long-term allocations will be made with '_heapID', and short-term
+   /// allocations will be made with '_tempHeapID'.  Deinit and delete the
+   /// returned JSONValue when you are done with it and its descendants.
+   /// 'filename' is for debugging purposes.
+   JSONValue* Load(File* file, HeapID _heapID = HEAP_DEFAULT,
+      HeapID _tempHeapID = HEAP_TEMP, const char* filename = NULL);
+
+   /// Same as Load, except the tree is built in the given Arena.
+   /// 'arenaHeapID' must be a heap with a HeapDelegateArena installed.  Do
+   /// not include the ".json" extension in the filename.
+   JSONValue* ArenaLoad(const char* filename, Arena* arena, HeapID arenaHeapID,
+      FileManager* fileManager = theFiles, HeapID _tempHeapID = HEAP_TEMP);
+   /// Same as Load, except the tree is built in the given Arena.
+   /// 'arenaHeapID' must be a heap with a HeapDelegateArena installed.
+   /// 'filename' is for debugging purposes.
+   JSONValue* ArenaLoad(File* file, Arena* arena, HeapID arenaHeapID,
+      HeapID _tempHeapID = HEAP_TEMP, const char* filename = NULL);
+
+   typedef JSONParser Inherited;
+
+protected:
+   /// Open the JSON file with the given name, excluding the extension.
+   /// Return NULL if unsuccessful.
+   static File* FileOpen(const char* filename, FileManager* fileManager, HeapID _tempHeapID);
+};
+
+//==============================================================================
+
+inline JSONValue* JSONParserStreaming::Load(const char* filename, FileManager* fileManager,
+   HeapID _heapID, HeapID _tempHeapID)
+{
+   File* file = FileOpen(filename, fileManager, _tempHeapID);
+   if(!file)
+      return NULL;
+   JSONValue* value = Load(file, _heapID, _tempHeapID, filename);
+   fileManager->Close(file);
+   return value;
+}
+
+//------------------------------------------------------------------------------
+
+inline JSONValue* JSONParserStreaming::Load(File* file, HeapID _heapID,
+   HeapID _tempHeapID, const char* filename)
+{
+   assert(file);
+   heapID = _heapID;
+   tempHeapID = _tempHeapID;
+   nextKey[0] = '\0';
+   root = NULL;
+
+   unsigned char* buffer = (unsigned char*)FrogMallocEx(JSON_PARSER_STREAMING_CHUNK_SIZE, tempHeapID, FROG_MEM_ALIGN);
+   if(!buffer)
+      return NULL;
+   valueStack.Init(theAllocatorHeaps[tempHeapID]);
+
+   // The tree is built by the same callbacks JSONParser uses.
+   yajl_callbacks callbacks =
+   {
+      YAJLNullCallback,
+      YAJLBooleanCallback,
+      YAJLIntegerCallback,
+      YAJLDoubleCallback,
+      NULL,
+      YAJLStringCallback,
+      YAJLStartObjectCallback,
+      YAJLStartObjectKeyCallback,
+      YAJLEndObjectCallback,
+      YAJLStartArrayCallback,
+      YAJLEndArrayCallback
+   };
+   yajl_alloc_funcs allocFuncs =
+   {
+      YALJMalloc,
+      YALJRealloc,
+      YALJFree,
+      (void*)(size_t)tempHeapID
+   };
+   yajl_handle handle = yajl_alloc(&callbacks, &allocFuncs, (JSONParser*)this);
+   yajl_config(handle, yajl_allow_comments, 1);
+
+   // Some Files return less than was asked for before the end, so only stop
+   // once nothing more can be read.
+   yajl_status status = yajl_status_ok;
+   size_t bytesRead = 0;
+   for(;;)
+   {
+      size_t chunkRead = file->Read(buffer, JSON_PARSER_STREAMING_CHUNK_SIZE);
+      if(!chunkRead)
+         break;
+      bytesRead = chunkRead;
+      status = yajl_parse(handle, buffer, bytesRead);
+      if(status != yajl_status_ok)
+         break;
+   }
+   if(status == yajl_status_ok)
+      status = yajl_complete_parse(handle);
+
+   if(status != yajl_status_ok)
+   {
+      unsigned char* errorString = yajl_get_error(handle, 1, buffer, bytesRead);
+      WarningPrintf("JSONParserStreaming::Load -- Error parsing %s: %s\n",
+         filename ? filename : "JSON file", errorString ? (const char*)errorString : "");
+      if(errorString)
+         yajl_free_error(handle, errorString);
+      if(root)
+      {
+         root->Deinit();
+         frog_delete root;
+         root = NULL;
+      }
+   }
+
+   yajl_free(handle);
+   valueStack.Deinit();
+   FrogFree(buffer);
+
+   JSONValue* result = root;
+   root = NULL;
+   return result;
+}
+
+//------------------------------------------------------------------------------
+
+inline JSONValue* JSONParserStreaming::ArenaLoad(const char* filename, Arena* arena,
+   HeapID arenaHeapID, FileManager* fileManager, HeapID _tempHeapID)
+{
+   File* file = FileOpen(filename, fileManager, _tempHeapID);
+   if(!file)
+      return NULL;
+   JSONValue* value = ArenaLoad(file, arena, arenaHeapID, _tempHeapID, filename);
+   fileManager->Close(file);
+   return value;
+}
+
+//------------------------------------------------------------------------------
+
+inline JSONValue* JSONParserStreaming::ArenaLoad(File* file, Arena* arena,
+   HeapID arenaHeapID, HeapID _tempHeapID, const char* filename)
+{
+   assert(arena);
+   assert((arenaHeapID >= 0) && (arenaHeapID < HEAP_COUNT));
+   // Try to get the whole tree in one block.
+   int64 fileSize = file->SizeGet();
+   if(fileSize > 0)
+      arena->Reserve((size_t)fileSize * JSON_PARSER_STREAMING_ARENA_RATIO);
+
+   ArenaGuard arenaGuard(arena);
+   return Load(file, arenaHeapID, _tempHeapID, filename);
+}
+
+//------------------------------------------------------------------------------
+
+inline File* JSONParserStreaming::FileOpen(const char* filename, FileManager* fileManager, HeapID _tempHeapID)
+{
+   assert(filename);
+   assert(fileManager);
+   char path[FROG_PATH_MAX+1];
+   if(!FrogSnprintf(path, sizeof(path), "%s.json", filename))
+   {
+      WarningPrintf("JSONParserStreaming::Load -- Path too long for %s\n", filename);
+      return NULL;
+   }
+   return fileManager->Open(path, FileManager::READ, _tempHeapID);
+}
+
+//------------------------------------------------------------------------------
+
+} //namespace Webfoot {
+
+#endif //#ifndef __FROG__JSONPARSERSTREAMING_H__
@@ -19,6 +19,7 @@ namespace Webfoot {
 #define JSON_PARENT_KEY_DEFAULT "Inherited"
 
 class JSONParser;
+class StringAtom;
 
 //==============================================================================
 
@@ -254,6 +255,9 @@ public:
    /// write to the dummy value.  If you need to know whether a given entry is
    /// actually defined or what type it is, use NullCheck, NumberCheck, etc.
    JSONValue& Get(const char* key);
+   /// Same as the other Get for objects, but take the key as a StringAtom.
+   /// Keys are still compared as text.  This is defined in JSONValueAtoms.h.
+   inline JSONValue& Get(StringAtom key);
 
    /// Assuming this is an array, return the item at the given index.  If it
    /// does not already exist, create it as a JSONValue of type null.
@@ -417,6 +421,9 @@ public:
       JSONValue* value = ElementGet(key);
       return !value || value->NullCheck();
    }
+   /// Same as the other NullCheck for objects, but take the key as a
+   /// StringAtom.  This is defined in JSONValueAtoms.h.
+   inline bool NullCheck(StringAtom key);
    
    /// Return true if this represents a boolean.
    bool BooleanCheck() { return _valueType == TYPE_BOOLEAN; }
@@ -0,0 +1,28 @@
+#ifndef __FROG__JSONVALUEATOMS_H__
+#define __FROG__JSONVALUEATOMS_H__
+
+#include "FrogMemory.h"
+#include "StringAtom.h"
+#include "JSONValue.h"
+
+namespace Webfoot {
+
+//=============================================================================
+
+inline JSONValue& JSONValue::Get(StringAtom key)
+{
+   return Get(key.StringGet());
+}
+
+//-----------------------------------------------------------------------------
+
+inline bool JSONValue::NullCheck(StringAtom key)
+{
+   return NullCheck(key.StringGet());
+}
+
+//=============================================================================
+
+} // namespace Webfoot {
+
+#endif //#ifndef __FROG__JSONVALUEATOMS_H__
@@ -0,0 +1,1419 @@
+#ifndef __FROG__LOADERTHREADED_H__
+#define __FROG__LOADERTHREADED_H__
+
+#include <string.h>
+#include "FrogMemory.h"
+#include "Utility.h"
+#include "Debug.h"
+#include "Table.h"
+#include "FlatMap.h"
+#include "JSONValue.h"
+#include "JSONWriter.h"
+#include "JSONParser.h"
+#include "FrogString.h"
+#include "FileManager.h"
+#include "FlatHashMap.h"
+#include "Bitmap.h"
+#include "BitmapManager.h"
+#include "Image.h"
+#include "ImageManager.h"
+#include "Texture.h"
+#include "TextureManager.h"
+#include "Screen.h"
+#include "Clock.h"
+#include "Thread.h"
+#include "ThreadUtilities.h"
+#include "ThreadPool.h"
+#include "SpriteAnimation.h"
+#include "SpriteResourceFile.h"
+#include "SpriteManager.h"
+#include "LoaderIterative.h"
+
+namespace Webfoot {
+
+class LoaderThreaded;
+
+/// Default number of milliseconds LoaderThreaded spends committing resources
+/// during a call to Update.
+#define LOADER_THREADED_COMMIT_BUDGET_DEFAULT 8
+/// Number of resources LoaderThreaded prepares ahead of the one being
+/// committed for each thread, including the main thread.
+#define LOADER_THREADED_PREPARES_PER_THREAD 2
+/// Key for the name other resources use to depend on a resource.
+#define LOADER_THREADED_ID_KEY "ID"
+/// Key for the array of IDs of the resources a resource depends on.
+#define LOADER_THREADED_DEPENDENCIES_KEY "Dependencies"
+/// Key for the filename of a resource, which is used to find duplicates.
+#define LOADER_THREADED_FILENAME_KEY "Filename"
+/// Size of the buffer for the type and filename used to find duplicates.
+#define LOADER_THREADED_FILE_KEY_LENGTH_MAX 512
+
+//==============================================================================
+
+/// Handles the loading and unloading of a particular type of resource for
+/// LoaderThreaded.  Loading is split into two stages.  Prepare runs on a
+/// worker thread and should do the slow work that doesn't need the main
+/// thread, like reading files, decoding images, and parsing.  CommitStep runs
+/// on the main thread and should do the rest, like uploading textures and
+/// registering the resource with its manager.
+///
+/// Unlike LoaderIterativeDelegate, a new instance is created for each
+/// resource, since several can be in progress at once.  Register a function
+/// that creates them with LoaderThreaded::DelegateRegister.
+///
+/// Prepare must not use OpenGL or any manager that isn't thread-safe, and any
+/// memory it allocates must come from a heap that is thread-safe.
+class LoaderThreadedDelegate
+{
+public:
+   LoaderThreadedDelegate()
+   {
+      specifications = NULL;
+      loader = NULL;
+      prepared = false;
+      prepareStartTick = 0;
+      prepareEndTick = 0;
+      readTime = 0;
+   }
+   virtual ~LoaderThreadedDelegate() {}
+
+   /// Prepare to load the given resource.  This is called on the main thread
+   /// before Prepare.
+   virtual void Init(JSONValue* _specifications) { specifications = _specifications; }
+   /// Called on the main thread to perform cleanup once the resource is
+   /// committed or cancelled.
+   virtual void Deinit() { specifications = NULL; }
+
+   /// Do the thread-safe part of loading.  This is called once on a worker
+   /// thread, or on the main thread if there are no workers.
+   virtual void Prepare() {}
+   /// Do part of the main-thread work of loading and return true once the
+   /// resource is completely loaded.  This is called repeatedly after Prepare,
+   /// and the loader stops calling it once the frame's budget is spent, so
+   /// keep each call short.
+   virtual bool CommitStep() = 0;
+
+   /// Unload anything loaded since Init, including anything made by Prepare.
+   /// This is called on the main thread after Prepare has finished.
+   virtual void Cancel() = 0;
+
+   /// Called to unload the given resource.  This function should block until
+   /// unloading is complete.  This is not intended to be used along with
+   /// the other methods, like Init, CommitStep, and Deinit.
+   virtual void Unload(JSONValue* _specifications) = 0;
+
+protected:
+   /// Call this from Prepare with the number of milliseconds spent reading
+   /// files, so the timing report can tell reading apart from decoding.
+   void ReadTimeAdd(uint32 milliseconds) { readTime += milliseconds; }
+
+   /// Specifications of the resource being loaded.
+   JSONValue* specifications;
+
+private:
+   /// Loader that is using this delegate.
+   LoaderThreaded* loader;
+   /// True once Prepare has returned.  This is protected by the loader's mutex.
+   bool prepared;
+   /// Tick count when Prepare was called.
+   uint32 prepareStartTick;
+   /// Tick count when Prepare returned.
+   uint32 prepareEndTick;
+   /// Milliseconds of Prepare that were spent reading files.
+   uint32 readTime;
+
+   friend class LoaderThreaded;
+};
+
+/// Function that creates a new delegate for LoaderThreaded in the given heap.
+typedef LoaderThreadedDelegate* (*LoaderThreadedDelegateCreateFunction)(HeapID heapID);
+
+//==============================================================================
+
+/// Lets LoaderThreaded use a LoaderIterativeDelegate, which does all its
+/// work on the main thread.  The work is still spread across frames by the
+/// commit budget, and it overlaps with other resources being prepared.
+class LoaderThreadedDelegateIterative : public LoaderThreadedDelegate
+{
+public:
+   LoaderThreadedDelegateIterative(LoaderIterativeDelegate* _iterativeDelegate)
+   {
+      iterativeDelegate = _iterativeDelegate;
+      started = false;
+   }
+   virtual ~LoaderThreadedDelegateIterative() {}
+
+   /// Called on the main thread to perform cleanup once the resource is
+   /// committed or cancelled.
+   virtual void Deinit()
+   {
+      if(started)
+         iterativeDelegate->Deinit();
+      started = false;
+      Inherited::Deinit();
+   }
+
+   /// Continue loading with the LoaderIterativeDelegate.  It isn't
+   /// initialized until the first call, since it can only load one
+   /// resource at a time.
+   virtual bool CommitStep()
+   {
+      if(!started)
+      {
+         iterativeDelegate->Init(specifications);
+         started = true;
+      }
+      iterativeDelegate->Update();
+      return iterativeDelegate->FinishedCheck();
+   }
+
+   /// Unload anything loaded since Init.
+   virtual void Cancel()
+   {
+      if(started)
+         iterativeDelegate->Cancel();
+   }
+
+   /// Called to unload the given resource.
+   virtual void Unload(JSONValue* _specifications) { iterativeDelegate->Unload(_specifications); }
+
+   typedef LoaderThreadedDelegate Inherited;
+
+protected:
+   /// Delegate that does the actual work.
+   LoaderIterativeDelegate* iterativeDelegate;
+   /// True if 'iterativeDelegate' has been initialized for this resource.
+   bool started;
+};
+
+//==============================================================================
+
+/// Loads a Texture for LoaderThreaded.  The file is read and decoded on a
+/// worker, and only the upload happens during the commit stage.  The
+/// specifications are the same as for LoaderIterativeDelegateTexture.
+/// Textures that fail to decode are loaded with theTextures->Load during the
+/// commit stage, so the usual warnings are shown.
+class LoaderThreadedDelegateTexture : public LoaderThreadedDelegate
+{
+public:
+   LoaderThreadedDelegateTexture()
+   {
+      filename = NULL;
+      bitmap = NULL;
+      texture = NULL;
+   }
+   virtual ~LoaderThreadedDelegateTexture() {}
+
+   /// Prepare to load the given resource.
+   virtual void Init(JSONValue* _specifications)
+   {
+      Inherited::Init(_specifications);
+      filename = (const char*)_specifications->Get(LOADER_ITERATIVE_TEXTURE_FILENAME_KEY);
+      bitmap = NULL;
+      texture = NULL;
+   }
+   /// Called on the main thread to perform cleanup once the resource is
+   /// committed or cancelled.
+   virtual void Deinit()
+   {
+      if(bitmap)
+         theBitmaps->Unload(bitmap);
+      bitmap = NULL;
+      texture = NULL;
+      filename = NULL;
+      Inherited::Deinit();
+   }
+
+   /// Read and decode the file.
+   virtual void Prepare()
+   {
+      if(!filename)
+         return;
+      // Cache files are written by the main thread's loads, not the workers'.
+      bitmap = theBitmaps->Load(filename, BitmapManager::LOAD_OPTION_DO_NOT_CREATE_CACHE_FILE);
+      if(bitmap)
+         bitmap->PremultiplyAlpha();
+   }
+   /// Upload the decoded bitmap and register it with theTextures.
+   virtual bool CommitStep()
+   {
+      if(!filename)
+         return true;
+      if(bitmap)
+      {
+         texture = theTextures->BitmapAdd(filename, bitmap);
+         bitmap = NULL;
+      }
+      else
+      {
+         texture = theTextures->Load(filename);
+      }
+      return true;
+   }
+
+   /// Unload anything loaded since Init.
+   virtual void Cancel()
+   {
+      if(texture)
+         theTextures->Unload(texture);
+      texture = NULL;
+   }
+
+   /// Called to unload the given resource.
+   virtual void Unload(JSONValue* _specifications)
+   {
+      const char* unloadFilename = (const char*)_specifications->Get(LOADER_ITERATIVE_TEXTURE_FILENAME_KEY);
+      if(unloadFilename)
+         theTextures->Unload(unloadFilename);
+   }
+
+   /// Return a new instance allocated from the given heap.
+   static LoaderThreadedDelegate* Create(HeapID heapID) { return frog_new_ex(heapID) LoaderThreadedDelegateTexture(); }
+
+   typedef LoaderThreadedDelegate Inherited;
+
+protected:
+   /// Name of the file to load, or NULL if none was given.
+   const char* filename;
+   /// Bitmap decoded by Prepare and not yet uploaded.
+   Bitmap* bitmap;
+   /// Texture loaded by CommitStep.
+   Texture* texture;
+};
+
+//==============================================================================
+
+/// Loads a SpriteResourceFile for LoaderThreaded.  Before the resource file
+/// itself is loaded, a worker parses its specifications and reads and decodes
+/// the images of its frames.  During the commit stage, the frames are
+/// uploaded one per step and registered with theImages, so that when
+/// LoaderIterativeDelegateSpriteResourceFile loads the animations, their
+/// Images are found already loaded.  The loader's own references to the
+/// Images are released once the animations are loaded.
+///
+/// The specifications parsed by the worker are kept until the resource file
+/// is committed, so the main thread doesn't need to parse them to know which
+/// frames belong to which animations.  SpriteResourceFile::Init only takes a
+/// filename, though, so the resource file still reads its own copy.
+///
+/// Frames are only prepared for animations given as a single filename or as
+/// an object with a "Filename" and a "FrameCount", where the frames of a
+/// numbered sequence are named by SpriteAnimation::SequenceFrameFilenameGet.
+/// Once the animations are loaded, each prepared frame is compared with the
+/// Image its animation actually uses, and a warning is shown if any were
+/// prepared for nothing.  Frames of animations that generate mipmaps, use
+/// point filtering, or skip premultiplying alpha, frames that would be split
+/// into several textures, and any frames when the Screen has ImageScales, are
+/// left entirely to LoaderIterativeDelegateSpriteResourceFile.
+class LoaderThreadedDelegateSpriteResourceFile : public LoaderThreadedDelegateIterative
+{
+public:
+   LoaderThreadedDelegateSpriteResourceFile(HeapID _heapID)
+      : LoaderThreadedDelegateIterative(&spriteResourceFileDelegate)
+   {
+      heapID = _heapID;
+      framesEnabled = false;
+      frameCommittedCount = 0;
+      resourceSpecifications = NULL;
+   }
+   virtual ~LoaderThreadedDelegateSpriteResourceFile() {}
+
+   /// Prepare to load the given resource.
+   virtual void Init(JSONValue* _specifications)
+   {
+      Inherited::Init(_specifications);
+      frames.Init(theAllocatorHeaps[heapID]);
+      frameCommittedCount = 0;
+      resourceSpecifications = NULL;
+      // Images with ImageScales are loaded from different files depending on
+      // the scale, so leave those to theImages.
+      framesEnabled = !theScreen->ImageScaleCountGet();
+   }
+   /// Called on the main thread to perform cleanup once the resource is
+   /// committed or cancelled.
+   virtual void Deinit()
+   {
+      FramesRelease();
+      frames.Deinit();
+      if(resourceSpecifications)
+      {
+         resourceSpecifications->Deinit();
+         frog_delete resourceSpecifications;
+      }
+      resourceSpecifications = NULL;
+      Inherited::Deinit();
+   }
+
+   /// Parse the specifications and decode the frames.
+   virtual void Prepare()
+   {
+      const char* filename = (const char*)specifications->Get(LOADER_ITERATIVE_SPRITE_SPRITE_RESOURCE_FILE_FILENAME_KEY);
+      if(!framesEnabled || !filename)
+         return;
+      JSONParser parser;
+      resourceSpecifications = parser.GraphicsPathLoad(filename, theFiles, heapID, heapID);
+      if(!resourceSpecifications || !resourceSpecifications->ObjectCheck())
+         return;
+      for(JSONValue::ObjectIterator iterator = resourceSpecifications->ObjectBegin(); iterator.WithinCheck(); iterator.Next())
+         AnimationPrepare(iterator.Key(), iterator.Value());
+   }
+   /// Upload one frame per call, then load the resource file itself.
+   virtual bool CommitStep()
+   {
+      if(frameCommittedCount < frames.SizeGet())
+      {
+         Frame& frame = frames[frameCommittedCount++];
+         frame.image = theImages->BitmapAdd(frame.filename, frame.bitmap, frame.options);
+         frame.bitmap = NULL;
+         return false;
+      }
+      if(!Inherited::CommitStep())
+         return false;
+      FramesCheck();
+      FramesRelease();
+      return true;
+   }
+
+   /// Unload anything loaded since Init.
+   virtual void Cancel()
+   {
+      FramesRelease();
+      Inherited::Cancel();
+   }
+
+   /// Return a new instance allocated from the given heap.
+   static LoaderThreadedDelegate* Create(HeapID heapID) { return frog_new_ex(heapID) LoaderThreadedDelegateSpriteResourceFile(heapID); }
+
+   typedef LoaderThreadedDelegateIterative Inherited;
+
+protected:
+   /// Image of a frame prepared ahead of the resource file.
+   struct Frame
+   {
+      /// Name of the image file, without the extension.
+      char filename[FROG_PATH_MAX+1];
+      /// ImageManagerCommon::Options for the image.
+      int options;
+      /// Bitmap decoded by Prepare and not yet uploaded.
+      Bitmap* bitmap;
+      /// Image registered by CommitStep.  This holds a reference that is
+      /// released once the resource file is loaded.
+      Image* image;
+      /// Name of the animation the frame was prepared for.  This points
+      /// into 'resourceSpecifications'.
+      const char* animationName;
+      /// Index of the frame in that animation.
+      int frameIndex;
+   };
+
+   /// Add the frames of the animation with the given name and
+   /// specifications to 'frames'.  This is called on a worker thread.
+   void AnimationPrepare(const char* animationName, JSONValue* animationSpecifications)
+   {
+      const char* animationFilename = (const char*)*animationSpecifications;
+      int frameCount = 1;
+      int options = 0;
+      if(animationSpecifications->ObjectCheck())
+      {
+         if((bool)animationSpecifications->Get("GenerateMipmaps") || (bool)animationSpecifications->Get("PointFiltering")
+            || (animationSpecifications->BooleanCheck("PremultiplyAlpha") && !(bool)animationSpecifications->Get("PremultiplyAlpha")))
+         {
+            return;
+         }
+         if((bool)animationSpecifications->Get("KeepBitmapData"))
+            options |= ImageManager::KEEP_BITMAP_DATA;
+         animationFilename = (const char*)animationSpecifications->Get("Filename");
+         if(animationSpecifications->NumberCheck("FrameCount"))
+            frameCount = (int)animationSpecifications->Get("FrameCount");
+      }
+      if(!animationFilename)
+         return;
+
+      for(int frameIndex = 0; frameIndex < frameCount; frameIndex++)
+      {
+         Frame frame;
+         bool success = (frameCount > 1)
+            ? SpriteAnimation::SequenceFrameFilenameGet(frame.filename, sizeof(frame.filename), animationFilename, frameIndex + 1)
+            : FrogSnprintf(frame.filename, sizeof(frame.filename), "%s", animationFilename);
+         if(!success || FramePreparedCheck(frame.filename))
+            continue;
+         frame.options = options;
+         frame.image = NULL;
+         frame.animationName = animationName;
+         frame.frameIndex = frameIndex;
+         // Frames that can't be found here, like those cut from a larger
+         // image, are left for the resource file to load.
+         frame.bitmap = theBitmaps->ExistsCheck(frame.filename)
+            ? theBitmaps->Load(frame.filename, BitmapManager::LOAD_OPTION_DO_NOT_CREATE_CACHE_FILE) : NULL;
+         if(!frame.bitmap)
+            return;
+         frame.bitmap->PremultiplyAlpha();
+         frames.Add(frame);
+      }
+   }
+
+   /// Return true if a frame with the given filename is already in 'frames'.
+   bool FramePreparedCheck(const char* filename)
+   {
+      for(int frameIndex = 0; frameIndex < frames.SizeGet(); frameIndex++)
+      {
+         if(!strcmp(frames[frameIndex].filename, filename))
+            return true;
+      }
+      return false;
+   }
+
+   /// Warn if any of the uploaded frames aren't used by the animations of the
+   /// resource file, which means they were named differently than the
+   /// animations expected.
+   void FramesCheck()
+   {
+      const char* filename = (const char*)specifications->Get(LOADER_ITERATIVE_SPRITE_SPRITE_RESOURCE_FILE_FILENAME_KEY);
+      SpriteResourceFile* resourceFile = filename ? theSprites->ResourceFileGet(filename) : NULL;
+      if(!resourceFile)
+         return;
+      int unusedCount = 0;
+      for(int frameIndex = 0; frameIndex < frames.SizeGet(); frameIndex++)
+      {
+         Frame& frame = frames[frameIndex];
+         if(!frame.image)
+            continue;
+         SpriteAnimation* animation = resourceFile->AnimationGet(frame.animationName);
+         if(!animation || (frame.frameIndex >= animation->FrameCountGet())
+            || (animation->FrameGetByIndex(frame.frameIndex)->image != frame.image))
+         {
+            unusedCount++;
+         }
+      }
+      if(unusedCount)
+      {
+         WarningPrintf("LoaderThreadedDelegateSpriteResourceFile::FramesCheck -- %d of the %d frames prepared for %s were not used by its animations.\n",
+            unusedCount, frames.SizeGet(), filename);
+      }
+   }
+
+   /// Free any bitmaps that weren't uploaded and release the references to
+   /// the Images that were.
+   void FramesRelease()
+   {
+      for(int frameIndex = 0; frameIndex < frames.SizeGet(); frameIndex++)
+      {
+         Frame& frame = frames[frameIndex];
+         if(frame.bitmap)
+            theBitmaps->Unload(frame.bitmap);
+         if(frame.image)
+            theImages->Unload(frame.image);
+         frame.bitmap = NULL;
+         frame.image = NULL;
+      }
+      frameCommittedCount = frames.SizeGet();
+   }
+
+   /// Heap for this object's allocations.
+   HeapID heapID;
+   /// False if frames shouldn't be prepared ahead of the resource file.
+   bool framesEnabled;
+   /// Frames prepared ahead of the resource file.
+   Table<Frame> frames;
+   /// Number of 'frames' that CommitStep has uploaded.
+   int frameCommittedCount;
+   /// Specifications of the resource file parsed by Prepare, or NULL.
+   JSONValue* resourceSpecifications;
+   /// Delegate that loads the resource file itself.
+   LoaderIterativeDelegateSpriteResourceFile spriteResourceFileDelegate;
+};
+
+//==============================================================================
+
+/// LoaderThreaded loads lists of resources over the course of multiple
+/// frames, like LoaderIterative, while doing as much of the work as possible
+/// on other threads.  It accepts the same JSON lists and handles the same
+/// built-in types.
+///
+/// Rather than loading strictly in order, the resources form a dependency
+/// graph.  A resource can start once everything it depends on has been
+/// committed, so independent resources are prepared on a ThreadPool several
+/// at a time.  Commits happen on the main thread one at a time, and Update
+/// stops committing once its budget for the frame is spent, so a loading
+/// screen can keep its frame rate.  A resource depends on:
+///   - The resources named in its "Dependencies" array, where each name is the
+///     "ID" of a resource earlier in the lists.
+///   - Every earlier resource of a type its own type depends on, as set with
+///     DependencyTypeAdd.  By default, GUI layers depend on sprite resource
+///     files and fonts.
+///   - An earlier resource of the same type with the same "Filename".  The
+///     duplicate isn't loaded again.  The original is loaded and unloaded once.
+///
+/// Textures and sprite resource files are read and decoded on the workers,
+/// and only uploaded during the commit stage.  The other built-in types still
+/// use their LoaderIterativeDelegates, which do all their work during the
+/// commit stage.  Register a LoaderThreadedDelegate for a type to move its
+/// work onto the workers.
+///
+/// To find the critical path of a load, call TimingReportSave once it's
+/// finished.  For each resource, the report shows how long it waited, read,
+/// decoded, and uploaded.
+///
+/// \code
+/// class LoaderThreadedDelegateLevel : public LoaderThreadedDelegate
+/// {
+///    ...
+///    virtual void Prepare() { levelData = LevelParse((const char*)specifications->Get("Filename")); }
+///    virtual bool CommitStep() { return LevelTextureNextUpload(levelData); }
+///    ...
+///    static LoaderThreadedDelegate* Create(HeapID heapID) { return frog_new_ex(heapID) LoaderThreadedDelegateLevel(); }
+/// };
+///
+/// loader.Init();
+/// loader.DelegateRegister("Level", LoaderThreadedDelegateLevel::Create);
+/// loader.ListAdd(levelLoadList);
+/// ...
+/// // Each frame
+/// loader.Update();
+/// \endcode
+class LoaderThreaded
+{
+public:
+   LoaderThreaded() { initialized = false; }
+
+   /// Prepare the loader and start the given number of worker threads.  If
+   /// 'threadCount' is negative, use one fewer than the number of processors.
+   void Init(HeapID _heapID = HEAP_TEMP, int threadCount = -1);
+   /// Clean up.  Any resources that have been started but not committed are
+   /// cancelled.
+   void Deinit();
+   /// Call this regularly to proceed with loading.  Do not call this while
+   /// unloading.
+   void Update();
+
+   /// Add the given list of specifications to the queue of resources to load.
+   /// This will not make an internal copy, so don't clean up the
+   /// specifications until the loader is deinitialized.
+   void ListAdd(JSONValue* _specifications);
+
+   /// If you want to cancel or undo loading before calling Deinit, call this
+   /// method to unload anything that was loaded since Init.
+   void Cancel();
+
+   /// Unload all items in the lists.  This method is synchronous, so it will
+   /// return when unloading is complete.  This is not intended to be used
+   /// in the same Init/Deinit session as 'Update'.
+   void Unload();
+
+   /// Return true if loading is complete.
+   bool FinishedCheck() { return itemsCommittedCount >= items.SizeGet(); }
+   /// Return a value between 0 and 100 (inclusive) for a very rough estimate
+   /// of the percentage of loading that has been completed.
+   float ProgressGet()
+   {
+      if(!items.SizeGet())
+         return LOADER_ITERATIVE_PROGRESS_MAX;
+      return LOADER_ITERATIVE_PROGRESS_MAX * (float)itemsCommittedCount / (float)items.SizeGet();
+   }
+
+   /// Register a function that creates delegates for the given type.
+   void DelegateRegister(const char* name, LoaderThreadedDelegateCreateFunction createFunction);
+   /// Register a LoaderIterativeDelegate for the given type.  It will do all
+   /// its work on the main thread.
+   void DelegateRegister(const char* name, LoaderIterativeDelegate* iterativeDelegate);
+   /// Make resources of type 'typeName' depend on all earlier resources of
+   /// type 'dependencyTypeName'.  This only affects lists added afterward.
+   void DependencyTypeAdd(const char* typeName, const char* dependencyTypeName);
+
+   /// Set the number of milliseconds to spend committing resources during a
+   /// call to Update.  At least one step is committed per call regardless.
+   void CommitBudgetSet(unsigned int _commitBudget) { commitBudget = _commitBudget; }
+   /// Return the number of milliseconds to spend committing resources during
+   /// a call to Update.
+   unsigned int CommitBudgetGet() { return commitBudget; }
+
+   /// Fill the given JSONValue, which should already be initialized, with a
+   /// report of how long each resource spent in each stage of loading.  All
+   /// times are in milliseconds.  Starts and finishes are relative to the
+   /// first call to Update.
+   void TimingReportBuild(JSONValue* report);
+   /// Save a timing report, as from TimingReportBuild, to the given file.  Do
+   /// not include the ".json" extension in the filename.  Return true if
+   /// successful.
+   bool TimingReportSave(const char* filename, FileManager* fileManager = theFiles);
+
+   /// Return true if this is between calls to Init and Deinit.
+   bool InitializedCheck() { return initialized; }
+
+protected:
+   /// How to load a type of resource.
+   struct Registration
+   {
+      /// Function for creating delegates, or NULL.
+      LoaderThreadedDelegateCreateFunction createFunction;
+      /// Delegate to use if 'createFunction' is NULL.
+      LoaderIterativeDelegate* iterativeDelegate;
+   };
+
+   /// Stage of loading for an item.
+   enum ItemState
+   {
+      /// Waiting for dependencies to be committed.
+      ITEM_STATE_WAITING,
+      /// Ready to start, but limited by the number of items in flight.
+      ITEM_STATE_READY,
+      /// Being prepared, or waiting to be committed.
+      ITEM_STATE_STARTED,
+      /// Being committed.
+      ITEM_STATE_COMMITTING,
+      /// Finished.
+      ITEM_STATE_COMMITTED
+   };
+
+   /// A resource to be loaded.
+   struct Item
+   {
+      /// Specifications of the resource.
+      JSONValue* specifications;
+      /// Value of the type key, or NULL.
+      const char* typeName;
+      /// Value of the ID key, or NULL.
+      const char* id;
+      /// Delegate loading the resource, or NULL if it isn't in progress.
+      LoaderThreadedDelegate* delegate;
+      /// Stage of loading.
+      ItemState state;
+      /// Index of the item this duplicates, or -1 if it isn't a duplicate.
+      int originalIndex;
+      /// Index of the first Dependency for which this is the dependent, or -1.
+      int dependencyFirst;
+      /// Index of the first Dependency for which this is the dependency, or -1.
+      int dependentFirst;
+      /// Number of dependencies that haven't been committed.
+      int dependenciesPendingCount;
+      /// Tick count when the dependencies had all been committed.
+      uint32 readyTick;
+      /// Tick count when Prepare was called.
+      uint32 prepareStartTick;
+      /// Tick count when Prepare returned.
+      uint32 prepareEndTick;
+      /// Milliseconds of Prepare that were spent reading files.
+      uint32 readTime;
+      /// Tick count when the first CommitStep was called.
+      uint32 commitStartTick;
+      /// Tick count when the item was committed.
+      uint32 committedTick;
+      /// Milliseconds spent in CommitStep.
+      uint32 uploadTime;
+   };
+
+   /// Edge of the dependency graph.  Each one is in two singly linked lists:
+   /// the dependencies of the dependent item and the dependents of the
+   /// dependency item.
+   struct Dependency
+   {
+      /// Item that must be committed first.
+      int dependencyIndex;
+      /// Item that waits.
+      int dependentIndex;
+      /// Next Dependency with the same dependent, or -1.
+      int dependencyNext;
+      /// Next Dependency with the same dependency, or -1.
+      int dependentNext;
+   };
+
+   /// Pair of types for DependencyTypeAdd.
+   struct DependencyType
+   {
+      const char* typeName;
+      const char* dependencyTypeName;
+   };
+
+   typedef FlatMap<const char*, Registration> RegistrationMap;
+   typedef FlatHashMap<const char*, int> FileItemMap;
+
+   /// Add the given registration for the given type.
+   void RegistrationAdd(const char* name, const Registration& registration);
+   /// Return a new delegate for the given specifications, or NULL if the
+   /// type isn't registered.
+   LoaderThreadedDelegate* DelegateCreate(JSONValue* _specifications);
+   /// Add the dependencies of the item at the given index on earlier items.
+   void DependenciesAdd(int itemIndex);
+   /// Make the item at 'dependentIndex' depend on the one at
+   /// 'dependencyIndex', unless it already does.
+   void DependencyAdd(int dependentIndex, int dependencyIndex);
+   /// Start the given item if the number in flight allows, or queue it.
+   void ItemReady(int itemIndex);
+   /// Record that the item at the given index is loaded and release its
+   /// dependents.
+   void ItemCommitted(int itemIndex);
+   /// Start items from the ready queue until enough are in flight.
+   void PreparesStart();
+   /// Return the index of the lowest started item that has finished Prepare,
+   /// or -1 if there isn't one.
+   int PreparedIndexGet();
+   /// Clean up and free the given delegate.
+   void DelegateDestroy(LoaderThreadedDelegate* delegate)
+   {
+      delegate->Deinit();
+      frog_delete delegate;
+   }
+   /// Free the keys of 'itemsByFile' and empty it.
+   void ItemsByFileClear();
+   /// Return the milliseconds from the first Update to the given tick count.
+   uint32 TickRelativeGet(uint32 tickCount) { return (tickCount > startTick) ? (tickCount - startTick) : 0; }
+   /// Called by the ThreadPool to prepare an item.
+   static void PrepareRun(void* userData);
+
+   /// True if this is between calls to Init and Deinit.
+   bool initialized;
+   /// Heap from which relatively long-term allocations of this class are made.
+   HeapID heapID;
+   /// Milliseconds to spend committing during a call to Update.
+   unsigned int commitBudget;
+   /// True once Update has been called.
+   bool started;
+   /// Tick count at the first call to Update.
+   uint32 startTick;
+   /// All resources from the lists, in order.
+   Table<Item> items;
+   /// Edges of the dependency graph.
+   Table<Dependency> dependencies;
+   /// Types whose resources depend on all earlier resources of other types.
+   Table<DependencyType> dependencyTypes;
+   /// Indices of items that are ready but not started, in the order they
+   /// became ready.
+   Table<int> itemsReady;
+   /// Index in 'itemsReady' of the next item to start.
+   int itemsReadyHead;
+   /// Indices of items in the order they were committed.
+   Table<int> itemsCommitOrder;
+   /// Number of items that have been committed.
+   int itemsCommittedCount;
+   /// Number of items that have been started but not committed.
+   int itemsInFlightCount;
+   /// Maximum number of items that can be started but not committed.
+   int itemsInFlightMax;
+   /// Index of the item being committed, or -1.
+   int itemCommittingIndex;
+   /// Index below which all items have been committed.
+   int itemUncommittedFirst;
+   /// Index of the first item with each type and filename, keyed by
+   /// "<type>:<filename>", for finding duplicates.
+   FileItemMap itemsByFile;
+   /// Map of type names to how they're loaded.
+   RegistrationMap registrations;
+   /// Workers for the prepare stage.
+   ThreadPool threadPool;
+   /// Protects the 'prepared' flags of the delegates.
+   Mutex mutex;
+
+   /// Delegate instance for loading sounds.
+   LoaderIterativeDelegateSound delegateSound;
+   /// Delegate instance for loading fonts.
+   LoaderIterativeDelegateFont delegateFont;
+   /// Delegate instance for loading GUI layers.
+   LoaderIterativeDelegateGUILayer delegateGUILayer;
+   /// Delegate instance for loading texture resource files.
+   LoaderIterativeDelegateTextureResourceFile delegateTextureResourceFile;
+};
+
+//==============================================================================
+
+inline void LoaderThreaded::Init(HeapID _heapID, int threadCount)
+{
+   assert(!initialized);
+   heapID = _heapID;
+   commitBudget = LOADER_THREADED_COMMIT_BUDGET_DEFAULT;
+   started = false;
+   startTick = 0;
+   itemsReadyHead = 0;
+   itemsCommittedCount = 0;
+   itemsInFlightCount = 0;
+   itemCommittingIndex = -1;
+   itemUncommittedFirst = 0;
+   items.Init(theAllocatorHeaps[heapID]);
+   dependencies.Init(theAllocatorHeaps[heapID]);
+   dependencyTypes.Init(theAllocatorHeaps[heapID]);
+   itemsReady.Init(theAllocatorHeaps[heapID]);
+   itemsCommitOrder.Init(theAllocatorHeaps[heapID]);
+   itemsByFile.Init(StringHash, StringsEqualCheck, theAllocatorHeaps[heapID]);
+   registrations.Init(StringComparator, theAllocatorHeaps[heapID]);
+   mutex.Init();
+   threadPool.Init(threadCount, heapID);
+   itemsInFlightMax = (threadPool.ThreadCountGet() + 1) * LOADER_THREADED_PREPARES_PER_THREAD;
+   initialized = true;
+
+   DelegateRegister(LOADER_ITERATIVE_SOUND_TYPE_NAME, &delegateSound);
+   DelegateRegister(LOADER_ITERATIVE_FONT_TYPE_NAME, &delegateFont);
+   DelegateRegister(LOADER_ITERATIVE_SPRITE_RESOURCE_FILE_TYPE_NAME, LoaderThreadedDelegateSpriteResourceFile::Create);
+   DelegateRegister(LOADER_ITERATIVE_GUI_LAYER_TYPE_NAME, &delegateGUILayer);
+   DelegateRegister(LOADER_ITERATIVE_TEXTURE_TYPE_NAME, LoaderThreadedDelegateTexture::Create);
+   DelegateRegister(LOADER_ITERATIVE_TEXTURE_RESOURCE_FILE_TYPE_NAME, &delegateTextureResourceFile);
+
+   DependencyTypeAdd(LOADER_ITERATIVE_GUI_LAYER_TYPE_NAME, LOADER_ITERATIVE_SPRITE_RESOURCE_FILE_TYPE_NAME);
+   DependencyTypeAdd(LOADER_ITERATIVE_GUI_LAYER_TYPE_NAME, LOADER_ITERATIVE_FONT_TYPE_NAME);
+}
+
+//------------------------------------------------------------------------------
+
+inline void LoaderThreaded::Deinit()
+{
+   if(!initialized)
+      return;
+
+   // Let any prepares finish before cleaning up after them.
+   threadPool.Wait();
+   for(int itemIndex = items.SizeGet() - 1; itemIndex >= 0; itemIndex--)
+   {
+      if(items[itemIndex].delegate)
+      {
+         items[itemIndex].delegate->Cancel();
+         DelegateDestroy(items[itemIndex].delegate);
+      }
+   }
+   threadPool.Deinit();
+   mutex.Deinit();
+
+   for(RegistrationMap::Iterator iterator = registrations.Begin(); iterator.WithinCheck(); iterator.Next())
+   {
+      const char* name = iterator.Key();
+      StringDelete(name);
+   }
+   for(int dependencyTypeIndex = 0; dependencyTypeIndex < dependencyTypes.SizeGet(); dependencyTypeIndex++)
+   {
+      StringDelete(dependencyTypes[dependencyTypeIndex].typeName);
+      StringDelete(dependencyTypes[dependencyTypeIndex].dependencyTypeName);
+   }
+   registrations.Deinit();
+   ItemsByFileClear();
+   itemsByFile.Deinit();
+   itemsCommitOrder.Deinit();
+   itemsReady.Deinit();
+   dependencyTypes.Deinit();
+   dependencies.Deinit();
+   items.Deinit();
+   initialized = false;
+}
+
+//------------------------------------------------------------------------------
+
+inline void LoaderThreaded::Update()
+{
+   assert(initialized);
+   uint32 updateStartTick = theClock->TickCountGet();
+   bool stepTaken = false;
+   if(!started)
+   {
+      started = true;
+      startTick = updateStartTick;
+   }
+
+   PreparesStart();
+   while(!FinishedCheck())
+   {
+      if(stepTaken && ((theClock->TickCountGet() - updateStartTick) >= commitBudget))
+         break;
+
+      if(itemCommittingIndex < 0)
+      {
+         int itemIndex = PreparedIndexGet();
+         if(itemIndex < 0)
+         {
+            // Without workers, the main thread does the preparing.  Otherwise,
+            // wait for a later frame rather than blocking.
+            if(!threadPool.ThreadCountGet() && threadPool.JobRunTry())
+            {
+               stepTaken = true;
+               continue;
+            }
+            break;
+         }
+         Item& item = items[itemIndex];
+         item.prepareStartTick = item.delegate->prepareStartTick;
+         item.prepareEndTick = item.delegate->prepareEndTick;
+         item.readTime = item.delegate->readTime;
+         item.commitStartTick = theClock->TickCountGet();
+         item.state = ITEM_STATE_COMMITTING;
+         itemCommittingIndex = itemIndex;
+      }
+
+      stepTaken = true;
+      Item& item = items[itemCommittingIndex];
+      uint32 stepStartTick = theClock->TickCountGet();
+      bool committed = item.delegate->CommitStep();
+      item.uploadTime += theClock->TickCountGet() - stepStartTick;
+      if(committed)
+      {
+         int itemIndex = itemCommittingIndex;
+         itemCommittingIndex = -1;
+         DelegateDestroy(item.delegate);
+         item.delegate = NULL;
+         itemsInFlightCount--;
+         ItemCommitted(itemIndex);
+         PreparesStart();
+      }
+   }
+}
+
+//------------------------------------------------------------------------------
+
+inline void LoaderThreaded::ListAdd(JSONValue* _specifications)
+{
+   assert(initialized);
+   if(!_specifications)
+      return;
+   int specificationCount = _specifications->SizeGet();
+   for(int specificationIndex = 0; specificationIndex < specificationCount; specificationIndex++)
+   {
+      Item item;
+      item.specifications = &_specifications->Get(specificationIndex);
+      item.typeName = (const char*)item.specifications->Get(LOADER_ITERATIVE_TYPE_KEY);
+      item.id = (const char*)item.specifications->Get(LOADER_THREADED_ID_KEY);
+      item.delegate = NULL;
+      item.state = ITEM_STATE_WAITING;
+      item.originalIndex = -1;
+      item.dependencyFirst = -1;
+      item.dependentFirst = -1;
+      item.dependenciesPendingCount = 0;
+      item.readyTick = 0;
+      item.prepareStartTick = 0;
+      item.prepareEndTick = 0;
+      item.readTime = 0;
+      item.commitStartTick = 0;
+      item.committedTick = 0;
+      item.uploadTime = 0;
+      items.Add(item);
+
+      int itemIndex = items.SizeGet() - 1;
+      DependenciesAdd(itemIndex);
+      if(!items[itemIndex].dependenciesPendingCount)
+         ItemReady(itemIndex);
+   }
+}
+
+//------------------------------------------------------------------------------
+
+inline void LoaderThreaded::Cancel()
+{
+   assert(initialized);
+   threadPool.Wait();
+
+   // Undo in the opposite order things were loaded, starting with anything
+   // in progress.
+   for(int itemIndex = items.SizeGet() - 1; itemIndex >= 0; itemIndex--)
+   {
+      Item& item = items[itemIndex];
+      if(item.delegate)
+      {
+         item.delegate->Cancel();
+         DelegateDestroy(item.delegate);
+         item.delegate = NULL;
+      }
+   }
+   for(int commitIndex = itemsCommitOrder.SizeGet() - 1; commitIndex >= 0; commitIndex--)
+   {
+      Item& item = items[itemsCommitOrder[commitIndex]];
+      if(item.originalIndex >= 0)
+         continue;
+      LoaderThreadedDelegate* delegate = DelegateCreate(item.specifications);
+      if(delegate)
+      {
+         delegate->Unload(item.specifications);
+         frog_delete delegate;
+      }
+   }
+
+   items.Clear();
+   dependencies.Clear();
+   itemsReady.Clear();
+   itemsCommitOrder.Clear();
+   ItemsByFileClear();
+   itemsReadyHead = 0;
+   itemsCommittedCount = 0;
+   itemsInFlightCount = 0;
+   itemCommittingIndex = -1;
+   itemUncommittedFirst = 0;
+}
+
+//------------------------------------------------------------------------------
+
+inline void LoaderThreaded::Unload()
+{
+   assert(initialized);
+   for(int itemIndex = items.SizeGet() - 1; itemIndex >= 0; itemIndex--)
+   {
+      if(items[itemIndex].originalIndex >= 0)
+         continue;
+      LoaderThreadedDelegate* delegate = DelegateCreate(items[itemIndex].specifications);
+      if(delegate)
+      {
+         delegate->Unload(items[itemIndex].specifications);
+         frog_delete delegate;
+      }
+   }
+}
+
+//------------------------------------------------------------------------------
+
+inline void LoaderThreaded::DelegateRegister(const char* name, LoaderThreadedDelegateCreateFunction createFunction)
+{
+   assert(createFunction);
+   Registration registration;
+   registration.createFunction = createFunction;
+   registration.iterativeDelegate = NULL;
+   RegistrationAdd(name, registration);
+}
+
+//------------------------------------------------------------------------------
+
+inline void LoaderThreaded::DelegateRegister(const char* name, LoaderIterativeDelegate* iterativeDelegate)
+{
+   assert(iterativeDelegate);
+   Registration registration;
+   registration.createFunction = NULL;
+   registration.iterativeDelegate = iterativeDelegate;
+   RegistrationAdd(name, registration);
+}
+
+//------------------------------------------------------------------------------
+
+inline void LoaderThreaded::DependencyTypeAdd(const char* typeName, const char* dependencyTypeName)
+{
+   assert(initialized);
+   assert(typeName);
+   assert(dependencyTypeName);
+   DependencyType dependencyType;
+   dependencyType.typeName = StringClone(typeName, heapID);
+   dependencyType.dependencyTypeName = StringClone(dependencyTypeName, heapID);
+   if(dependencyType.typeName && dependencyType.dependencyTypeName)
+   {
+      dependencyTypes.Add(dependencyType);
+   }
+   else
+   {
+      if(dependencyType.typeName)
+         StringDelete(dependencyType.typeName);
+      if(dependencyType.dependencyTypeName)
+         StringDelete(dependencyType.dependencyTypeName);
+   }
+}
+
+//------------------------------------------------------------------------------
+
+inline void LoaderThreaded::ItemsByFileClear()
+{
+   for(FileItemMap::Iterator iterator = itemsByFile.Begin(); iterator.WithinCheck(); iterator.Next())
+   {
+      const char* fileKey = iterator.Key();
+      StringDelete(fileKey);
+   }
+   itemsByFile.Clear();
+}
+
+//------------------------------------------------------------------------------
+
+inline void LoaderThreaded::RegistrationAdd(const char* name, const Registration& registration)
+{
+   assert(initialized);
+   assert(name);
+   RegistrationMap::Iterator iterator = registrations.Find(name);
+   if(iterator.WithinCheck())
+   {
+      iterator.Value() = registration;
+      return;
+   }
+   const char* nameClone = StringClone(name, heapID);
+   if(nameClone)
+      registrations.Add(nameClone, registration);
+}
+
+//------------------------------------------------------------------------------
+
+inline LoaderThreadedDelegate* LoaderThreaded::DelegateCreate(JSONValue* _specifications)
+{
+   const char* typeName = (const char*)_specifications->Get(LOADER_ITERATIVE_TYPE_KEY);
+   if(!typeName)
+   {
+      WarningPrintf("LoaderThreaded::DelegateCreate -- A resource has no '%s'.\n", LOADER_ITERATIVE_TYPE_KEY);
+      return NULL;
+   }
+   RegistrationMap::Iterator iterator = registrations.Find(typeName);
+   if(!iterator.WithinCheck())
+   {
+      WarningPrintf("LoaderThreaded::DelegateCreate -- No delegate is registered for the type '%s'.\n", typeName);
+      return NULL;
+   }
+   const Registration& registration = iterator.Value();
+   if(registration.createFunction)
+      return registration.createFunction(heapID);
+   return frog_new_ex(heapID) LoaderThreadedDelegateIterative(registration.iterativeDelegate);
+}
+
+//------------------------------------------------------------------------------
+
+inline void LoaderThreaded::DependenciesAdd(int itemIndex)
+{
+   Item& item = items[itemIndex];
+
+   // An earlier item of the same type with the same file is loaded only once.
+   const char* filename = (const char*)item.specifications->Get(LOADER_THREADED_FILENAME_KEY);
+   char fileKey[LOADER_THREADED_FILE_KEY_LENGTH_MAX];
+   if(item.typeName && filename && FrogSnprintf(fileKey, sizeof(fileKey), "%s:%s", item.typeName, filename))
+   {
+      FileItemMap::Iterator iterator = itemsByFile.Find(fileKey);
+      if(iterator.WithinCheck())
+      {
+         item.originalIndex = iterator.Value();
+         DependencyAdd(itemIndex, item.originalIndex);
+         return;
+      }
+      const char* fileKeyClone = StringClone(fileKey, heapID);
+      if(fileKeyClone)
+         itemsByFile.Add(fileKeyClone, itemIndex);
+   }
+
+   // Dependencies named explicitly
+   JSONValue* dependencyIDs = item.specifications->NullCheck(LOADER_THREADED_DEPENDENCIES_KEY) ? NULL : (JSONValue*)item.specifications->Get(LOADER_THREADED_DEPENDENCIES_KEY);
+   int dependencyIDCount = dependencyIDs ? dependencyIDs->SizeGet() : 0;
+   for(int dependencyIDIndex = 0; dependencyIDIndex < dependencyIDCount; dependencyIDIndex++)
+   {
+      const char* dependencyID = (const char*)dependencyIDs->Get(dependencyIDIndex);
+      int dependencyIndex = itemIndex - 1;
+      while((dependencyIndex >= 0) && !(dependencyID && items[dependencyIndex].id && !strcmp(items[dependencyIndex].id, dependencyID)))
+         dependencyIndex--;
+      if(dependencyIndex >= 0)
+         DependencyAdd(itemIndex, dependencyIndex);
+      else
+         WarningPrintf("LoaderThreaded::DependenciesAdd -- No earlier resource has the ID '%s'.\n", dependencyID ? dependencyID : "");
+   }
+
+   // Dependencies by type
+   if(!item.typeName)
+      return;
+   for(int dependencyTypeIndex = 0; dependencyTypeIndex < dependencyTypes.SizeGet(); dependencyTypeIndex++)
+   {
+      const DependencyType& dependencyType = dependencyTypes[dependencyTypeIndex];
+      if(strcmp(dependencyType.typeName, item.typeName))
+         continue;
+      for(int dependencyIndex = 0; dependencyIndex < itemIndex; dependencyIndex++)
+      {
+         const char* dependencyTypeName = items[dependencyIndex].typeName;
+         if(dependencyTypeName && !strcmp(dependencyTypeName, dependencyType.dependencyTypeName))
+            DependencyAdd(itemIndex, dependencyIndex);
+      }
+   }
+}
+
+//------------------------------------------------------------------------------
+
+inline void LoaderThreaded::DependencyAdd(int dependentIndex, int dependencyIndex)
+{
+   Item& dependent = items[dependentIndex];
+   for(int edgeIndex = dependent.dependencyFirst; edgeIndex >= 0; edgeIndex = dependencies[edgeIndex].dependencyNext)
+   {
+      if(dependencies[edgeIndex].dependencyIndex == dependencyIndex)
+         return;
+   }
+
+   Item& dependency = items[dependencyIndex];
+   Dependency edge;
+   edge.dependencyIndex = dependencyIndex;
+   edge.dependentIndex = dependentIndex;
+   edge.dependencyNext = dependent.dependencyFirst;
+   edge.dependentNext = dependency.dependentFirst;
+   dependencies.Add(edge);
+   dependent.dependencyFirst = dependencies.SizeGet() - 1;
+   dependency.dependentFirst = dependencies.SizeGet() - 1;
+   if(dependency.state != ITEM_STATE_COMMITTED)
+      dependent.dependenciesPendingCount++;
+}
+
+//------------------------------------------------------------------------------
+
+inline void LoaderThreaded::ItemReady(int itemIndex)
+{
+   Item& item = items[itemIndex];
+   item.state = ITEM_STATE_READY;
+   item.readyTick = theClock->TickCountGet();
+   itemsReady.Add(itemIndex);
+}
+
+//------------------------------------------------------------------------------
+
+inline void LoaderThreaded::ItemCommitted(int itemIndex)
+{
+   Item& item = items[itemIndex];
+   item.state = ITEM_STATE_COMMITTED;
+   item.committedTick = theClock->TickCountGet();
+   itemsCommitOrder.Add(itemIndex);
+   itemsCommittedCount++;
+   while((itemUncommittedFirst < items.SizeGet()) && (items[itemUncommittedFirst].state == ITEM_STATE_COMMITTED))
+      itemUncommittedFirst++;
+
+   for(int edgeIndex = item.dependentFirst; edgeIndex >= 0; edgeIndex = dependencies[edgeIndex].dependentNext)
+   {
+      Item& dependent = items[dependencies[edgeIndex].dependentIndex];
+      dependent.dependenciesPendingCount--;
+      if(!dependent.dependenciesPendingCount)
+         ItemReady(dependencies[edgeIndex].dependentIndex);
+   }
+}
+
+//------------------------------------------------------------------------------
+
+inline void LoaderThreaded::PreparesStart()
+{
+   // Committing an item here can make more ready, which adds them to the
+   // end of the queue.
+   while(itemsReadyHead < itemsReady.SizeGet())
+   {
+      int itemIndex = itemsReady[itemsReadyHead];
+      Item& item = items[itemIndex];
+      if(item.originalIndex < 0)
+      {
+         if(itemsInFlightCount >= itemsInFlightMax)
+            break;
+         item.delegate = DelegateCreate(item.specifications);
+      }
+      itemsReadyHead++;
+      if(!item.delegate)
+      {
+         // Duplicates and unregistered types have nothing to load.
+         ItemCommitted(itemIndex);
+         continue;
+      }
+      item.state = ITEM_STATE_STARTED;
+      item.delegate->loader = this;
+      item.delegate->prepared = false;
+      item.delegate->Init(item.specifications);
+      itemsInFlightCount++;
+      threadPool.Add(PrepareRun, item.delegate);
+   }
+
+   // Release the space used by the started part of the queue.
+   if(itemsReadyHead == itemsReady.SizeGet())
+   {
+      itemsReady.Clear();
+      itemsReadyHead = 0;
+   }
+}
+
+//------------------------------------------------------------------------------
+
+inline int LoaderThreaded::PreparedIndexGet()
+{
+   Guard guard(&mutex);
+   for(int itemIndex = itemUncommittedFirst; itemIndex < items.SizeGet(); itemIndex++)
+   {
+      Item& item = items[itemIndex];
+      if((item.state == ITEM_STATE_STARTED) && item.delegate->prepared)
+         return itemIndex;
+   }
+   return -1;
+}
+
+//------------------------------------------------------------------------------
+
+inline void LoaderThreaded::PrepareRun(void* userData)
+{
+   LoaderThreadedDelegate* delegate = (LoaderThreadedDelegate*)userData;
+   delegate->prepareStartTick = theClock->TickCountGet();
+   delegate->Prepare();
+   uint32 prepareEndTick = theClock->TickCountGet();
+   Guard guard(&delegate->loader->mutex);
+   delegate->prepareEndTick = prepareEndTick;
+   delegate->prepared = true;
+}
+
+//------------------------------------------------------------------------------
+
+inline void LoaderThreaded::TimingReportBuild(JSONValue* report)
+{
+   assert(initialized);
+   report->ObjectSet();
+   JSONValue& resources = report->ArraySet("Resources");
+   uint32 finishTickMax = startTick;
+   int itemLastIndex = -1;
+   for(int itemIndex = 0; itemIndex < items.SizeGet(); itemIndex++)
+   {
+      Item& item = items[itemIndex];
+      JSONValue& resource = resources.ObjectAdd();
+      if(item.typeName)
+         resource.Set(LOADER_ITERATIVE_TYPE_KEY, item.typeName);
+      if(item.id)
+         resource.Set(LOADER_THREADED_ID_KEY, item.id);
+      const char* filename = (const char*)item.specifications->Get(LOADER_THREADED_FILENAME_KEY);
+      if(filename)
+         resource.Set(LOADER_THREADED_FILENAME_KEY, filename);
+      if(item.originalIndex >= 0)
+         resource.Set("DuplicateOf", item.originalIndex);
+      JSONValue& resourceDependencies = resource.ArraySet(LOADER_THREADED_DEPENDENCIES_KEY);
+      for(int edgeIndex = item.dependencyFirst; edgeIndex >= 0; edgeIndex = dependencies[edgeIndex].dependencyNext)
+         resourceDependencies.Add(dependencies[edgeIndex].dependencyIndex);
+      if(item.state != ITEM_STATE_COMMITTED)
+      {
+         resource.Set("Finished", false);
+         continue;
+      }
+
+      // Items that are committed without a delegate have no stages.
+      uint32 readyTick = (item.readyTick > startTick) ? item.readyTick : startTick;
+      uint32 wait = 0;
+      uint32 decode = 0;
+      if(item.commitStartTick)
+      {
+         uint32 prepareStartTick = (item.prepareStartTick > readyTick) ? item.prepareStartTick : readyTick;
+         uint32 prepareTime = item.prepareEndTick - prepareStartTick;
+         wait = (prepareStartTick - readyTick) + (item.commitStartTick - item.prepareEndTick);
+         decode = (prepareTime > item.readTime) ? (prepareTime - item.readTime) : 0;
+      }
+      resource.Set("Start", TickRelativeGet(readyTick));
+      resource.Set("Finish", TickRelativeGet(item.committedTick));
+      resource.Set("Wait", wait);
+      resource.Set("Read", item.readTime);
+      resource.Set("Decode", decode);
+      resource.Set("Upload", item.uploadTime);
+      if(item.committedTick >= finishTickMax)
+      {
+         finishTickMax = item.committedTick;
+         itemLastIndex = itemIndex;
+      }
+   }
+   report->Set("Time", TickRelativeGet(finishTickMax));
+
+   // Walk back from the last item to finish, through whichever dependency
+   // finished last, since that's the one it was waiting on.
+   Table<int> criticalPath;
+   criticalPath.Init(theAllocatorHeaps[heapID]);
+   for(int itemIndex = itemLastIndex; itemIndex >= 0; )
+   {
+      criticalPath.Add(itemIndex);
+      int dependencyLastIndex = -1;
+      for(int edgeIndex = items[itemIndex].dependencyFirst; edgeIndex >= 0; edgeIndex = dependencies[edgeIndex].dependencyNext)
+      {
+         int dependencyIndex = dependencies[edgeIndex].dependencyIndex;
+         if((dependencyLastIndex < 0) || (items[dependencyIndex].committedTick > items[dependencyLastIndex].committedTick))
+            dependencyLastIndex = dependencyIndex;
+      }
+      itemIndex = dependencyLastIndex;
+   }
+   JSONValue& criticalPathValue = report->ArraySet("CriticalPath");
+   for(int pathIndex = criticalPath.SizeGet() - 1; pathIndex >= 0; pathIndex--)
+      criticalPathValue.Add(criticalPath[pathIndex]);
+   criticalPath.Deinit();
+}
+
+//------------------------------------------------------------------------------
+
+inline bool LoaderThreaded::TimingReportSave(const char* filename, FileManager* fileManager)
+{
+   JSONValue report;
+   report.Init(heapID);
+   TimingReportBuild(&report);
+   JSONWriter writer;
+   bool success = writer.Save(filename, fileManager, &report);
+   report.Deinit();
+   return success;
+}
+
+//------------------------------------------------------------------------------
+
+} //namespace Webfoot {
+
+#endif //#ifndef __FROG__LOADERTHREADED_H__
@@ -408,6 +408,10 @@ public:
    /// and unused items are currently allocated, they will be freed
    /// as needed to bring down the number held in reserve.
    void ReserveSizeSet(int _reserveSize);
+   /// Same as the other ReserveSizeSet, but first switch to getting nodes from
+   /// '_allocator', such as an ObjectPool<Node>.  Only call this while the
+   /// collection is empty.
+   void ReserveSizeSet(int _reserveSize, Allocator* _allocator);
 
    /// Return the minimum number of items this collection is currently keeping allocated.
    int ReserveSizeGet() { return reserveSize; }
@@ -678,6 +682,22 @@ void Map<KeyType,ValueType,ComparatorType>::ReserveSizeSet(int _reserveSize)
 
 //-------------------------------------------------------------------------------
 
+template<typename KeyType, typename ValueType, typename ComparatorType>
+void Map<KeyType,ValueType,ComparatorType>::ReserveSizeSet(int _reserveSize, Allocator* _allocator)
+{
+   assert(size == 0);
+   assert(_allocator);
+   if(_allocator != allocator)
+   {
+      // Free any nodes from the old allocator before switching.
+      ReserveSizeSet(0);
+      allocator = _allocator;
+   }
+   ReserveSizeSet(_reserveSize);
+}
+
+//-------------------------------------------------------------------------------
+
 template<typename KeyType, typename ValueType, typename ComparatorType>
 MapNode<KeyType,ValueType,ComparatorType>* Map<KeyType,ValueType,ComparatorType>::NodeAdd(MapNode<KeyType,ValueType,ComparatorType>* newNode,
    MapNode<KeyType,ValueType,ComparatorType>* currentNode, bool* success)
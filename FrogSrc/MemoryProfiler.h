@@ -0,0 +1,614 @@
+#ifndef __FROG__MEMORYPROFILER_H__
+#define __FROG__MEMORYPROFILER_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "FrogMemory.h"
+#include "Utility.h"
+#include "HeapDelegate.h"
+#include "HashTable.h"
+#include "Table.h"
+#include "ThreadUtilities.h"
+#include "JSONValue.h"
+#include "JSONWriter.h"
+
+#if PLATFORM_IS_LINUX || PLATFORM_IS_MACOSX
+   #include <execinfo.h>
+   #include <dlfcn.h>
+   /// True if MemoryProfiler can capture stack traces on this platform.
+   #define MEMORY_PROFILER_BACKTRACE_SUPPORTED 1
+#else
+   #define MEMORY_PROFILER_BACKTRACE_SUPPORTED 0
+#endif
+
+namespace Webfoot {
+
+/// Maximum number of stack frames recorded for a sampled allocation.
+#define MEMORY_PROFILER_FRAME_COUNT_MAX 16
+/// Number of innermost stack frames to skip because they belong to the memory system.
+#define MEMORY_PROFILER_FRAME_SKIP_COUNT 3
+/// By default, MemoryProfiler samples about one allocation per this many bytes allocated.
+#define MEMORY_PROFILER_SAMPLE_INTERVAL_DEFAULT (128*1024)
+/// Number of counters in the filter used to skip lookups when freeing memory
+/// that wasn't sampled.  This must be a power of 2.
+#define MEMORY_PROFILER_FILTER_SIZE 4096
+
+class MemoryProfiler;
+
+//==============================================================================
+
+/// HeapDelegateProfiled sits in front of a different HeapDelegate and reports
+/// allocations and deallocations to theMemoryProfiler.  Use
+/// MemoryProfiler::Install to set one up for each HeapID.  All statistics
+/// are simply returned from the referenced delegate.
+class HeapDelegateProfiled : public HeapDelegate
+{
+public:
+   HeapDelegateProfiled() { delegateReference = NULL; heapId = HEAP_DEFAULT; }
+   virtual ~HeapDelegateProfiled() {}
+
+   /// Initialize the class to allocate from the given delegate and report
+   /// allocations as being from 'heapId'.
+   void Init(HeapDelegate* _delegateReference, HeapID _heapId, bool _threadSafe = true)
+   {
+      Inherited::Init(_threadSafe);
+      delegateReference = _delegateReference;
+      heapId = _heapId;
+   }
+
+   /// Allocate the given amount of memory in bytes.
+   /// Return NULL if no memory is allocated.
+   virtual void* Allocate(size_t size) { return Record(delegateReference->Allocate(size), size); }
+   /// Free the given allocation.  This assumes the allocation was made by
+   /// this HeapDelegate.  Return true if, as far as the delegate knows,
+   /// the memory has been freed successfully.
+   virtual bool Deallocate(void* ptr);
+   /// Allocate from the top of the delegate.
+   /// Return NULL if no memory is allocated.
+   virtual void* AllocateTop(size_t size) { return Record(delegateReference->AllocateTop(size), size); }
+   /// Allocate from the bottom of the delegate.
+   /// Return NULL if no memory is allocated.
+   virtual void* AllocateBottom(size_t size) { return Record(delegateReference->AllocateBottom(size), size); }
+
+   /// Return true since this heap delegate is simply referencing another.
+   virtual bool HeapDelegateReferencingCheck() { return true; }
+
+   /// Return the total amount of free memory the delegate in bytes.
+   virtual size_t MemoryFreeGet() { return delegateReference->MemoryFreeGet(); }
+   /// Return the total number of bytes used, including overhead.
+   virtual size_t MemoryUsedGet() { return delegateReference->MemoryUsedGet(); }
+   /// Return the total number of bytes in the delegate including used and free memory.
+   virtual size_t MemoryTotalGet() { return delegateReference->MemoryTotalGet(); }
+   /// Return the total number of free blocks in the delegate.
+   virtual size_t FreeBlockCountGet() { return delegateReference->FreeBlockCountGet(); }
+   /// Return the size of the largest contiguous free block in the delegate in bytes.
+   virtual size_t MaxFreeContiguousSizeGet() { return delegateReference->MaxFreeContiguousSizeGet(); }
+   /// Return the current number of outstanding allocations from the delegate.
+   virtual size_t AllocationCountGet() { return delegateReference->AllocationCountGet(); }
+   /// Return the maximum number of outstanding allocations from the delegate so far.
+   virtual size_t AllocationCountMaxGet() { return delegateReference->AllocationCountMaxGet(); }
+   #if FROG_TRACK_MEMORY_USED_MAX
+      /// Return the maximum number of bytes allocated at any one time so far.
+      virtual size_t MemoryUsedMaxGet() { return delegateReference->MemoryUsedMaxGet(); }
+   #endif
+
+   /// Return the delegate to which this one forwards everything.
+   HeapDelegate* DelegateReferenceGet() { return delegateReference; }
+
+   typedef HeapDelegate Inherited;
+
+protected:
+   /// Report a successful allocation to the profiler and return 'ptr'.
+   inline void* Record(void* ptr, size_t size);
+
+   /// The delegate from which this class will allocate.
+   HeapDelegate* delegateReference;
+   /// Heap to which allocations are attributed.
+   HeapID heapId;
+};
+
+//==============================================================================
+
+/// MemoryProfiler is a sampling allocation profiler.  Rather than recording
+/// every allocation, it picks roughly one allocation for every
+/// 'sampleInterval' bytes allocated on each thread, captures its stack, and
+/// scales the sample up to estimate the totals.  Estimates are aggregated per
+/// call site and HeapID, including how much of each is still live, and can be
+/// saved as a JSON snapshot.  Call sites are keyed by an ID made from the
+/// offsets of the return addresses within their modules, so it stays the same
+/// from run to run even when the modules are loaded at different addresses,
+/// and snapshots from different runs can be compared with SnapshotDiff or an
+/// external tool.
+///
+/// Allocations that aren't sampled only cost a thread-local subtraction, and
+/// frees of memory that wasn't sampled are usually rejected by a small filter
+/// without taking the lock, so it is cheap enough to leave on for soak tests.
+/// The profiler's own bookkeeping uses theAllocatorMallocFree.  Stacks are only
+/// captured on platforms with backtrace; elsewhere, everything is attributed
+/// to a single call site per heap.
+class MemoryProfiler
+{
+public:
+   MemoryProfiler() { initialized = false; }
+
+   /// Prepare the profiler.  Call Install afterward to start profiling.
+   void Init(size_t _sampleInterval = MEMORY_PROFILER_SAMPLE_INTERVAL_DEFAULT);
+   /// Stop profiling and clean up.  Only call this after other threads have stopped.
+   void Deinit();
+
+   /// Put a HeapDelegateProfiled in front of the delegate of every HeapID in
+   /// theMemory.  Call this from ProjectMemoryInit after all the delegates are set.
+   void Install();
+   /// Restore the delegates that were replaced by Install.
+   void Uninstall();
+
+   /// Consider the given successful allocation for sampling.
+   void AllocationRecord(void* ptr, size_t size, HeapID heapId)
+   {
+      if(!initialized || ReentrantCheck())
+         return;
+      int64& bytesUntilSample = BytesUntilSampleGet();
+      bytesUntilSample -= (int64)size;
+      if(bytesUntilSample > 0)
+         return;
+      bytesUntilSample = (int64)NextSampleIntervalGet();
+      Sample(ptr, size, heapId);
+   }
+
+   /// Note that the given allocation is about to be freed.
+   void DeallocationRecord(void* ptr)
+   {
+      // Unsynchronized reads of the filter are fine here.  A counter for this
+      // pointer can't be going from 0 to non-zero while it's being freed.
+      // Memory freed by the profiler itself was never sampled, and it may be
+      // freed while 'mutex' is held.
+      if(!initialized || ReentrantCheck() || !filter[FilterIndexGet(ptr)])
+         return;
+      Unsample(ptr);
+   }
+
+   /// Return the sampling interval in bytes.
+   size_t SampleIntervalGet() { return sampleInterval; }
+   /// Return the number of allocations that have been sampled so far.
+   size_t SampleCountGet() { return sampleCount; }
+
+   /// Fill 'root' with a snapshot of the current estimates.  Stack addresses are
+   /// converted to symbol names where possible.
+   void SnapshotGet(JSONValue* root);
+   /// Save a snapshot of the current estimates to the given JSON file.  Do not
+   /// include the ".json" extension in the filename.  Return true if successful.
+   bool SnapshotSave(const char* filename, FileManager* fileManager, HeapID tempHeapID = HEAP_DEBUG);
+
+   /// Fill 'result' with the call sites whose live estimates differ between
+   /// the two snapshots, along with the change in their live counts and bytes.
+   static void SnapshotDiff(JSONValue* before, JSONValue* after, JSONValue* result);
+
+   /// Return the shared instance.
+   static MemoryProfiler* InstanceGet()
+   {
+      static MemoryProfiler instance;
+      return &instance;
+   }
+
+protected:
+   /// Estimates for allocations from one call site in one heap.
+   struct CallSite
+   {
+      /// Hash of the heap and stack used to identify the call site.
+      size_t key;
+      /// Heap to which the allocations were attributed.
+      HeapID heapId;
+      /// Number of valid entries in 'frames'.
+      int frameCount;
+      /// Return addresses, innermost first.
+      void* frames[MEMORY_PROFILER_FRAME_COUNT_MAX];
+      /// Estimated number of allocations made so far.
+      double allocationCount;
+      /// Estimated number of bytes allocated so far.
+      double allocationBytes;
+      /// Estimated number of allocations that are still live.
+      double liveCount;
+      /// Estimated number of bytes that are still live.
+      double liveBytes;
+   };
+
+   /// Information kept for each sampled allocation until it is freed.
+   struct LiveSample
+   {
+      /// Index into 'callSites'
+      int callSiteIndex;
+      /// Number of allocations this sample represents.
+      double count;
+      /// Number of bytes this sample represents.
+      double bytes;
+   };
+
+   /// Return true if the calling thread is inside the profiler.
+   static bool& ReentrantCheck()
+   {
+      static thread_local bool reentrant;
+      return reentrant;
+   }
+   /// Return the number of bytes the calling thread can allocate before the next sample.
+   static int64& BytesUntilSampleGet()
+   {
+      static thread_local int64 bytesUntilSample;
+      return bytesUntilSample;
+   }
+   /// Return the number of bytes until the sample after next.  This is
+   /// randomized a bit so periodic allocation patterns don't skew the results.
+   size_t NextSampleIntervalGet()
+   {
+      // Unsynchronized updates from different threads only make this more random.
+      randomState ^= randomState << 13;
+      randomState ^= randomState >> 17;
+      randomState ^= randomState << 5;
+      return (sampleInterval / 2) + (randomState % (sampleInterval + 1));
+   }
+   /// Return the filter counter index for the given pointer.
+   static size_t FilterIndexGet(void* ptr) { return (((size_t)ptr) >> 4) & (MEMORY_PROFILER_FILTER_SIZE - 1); }
+   /// Add the given return address to the FNV-1a hash 'key' in a way that
+   /// doesn't depend on where its module was loaded, and return the result.
+   static size_t FrameHash(size_t key, void* frame);
+
+   /// Record the given allocation as a sample.
+   void Sample(void* ptr, size_t size, HeapID heapId);
+   /// Remove the given allocation from the samples if it's there.
+   void Unsample(void* ptr);
+
+   /// Hash function for the pointer and key tables.
+   static size_t SizeHash(const size_t& value) { return value ^ (value >> 16); }
+   /// Equality function for the pointer and key tables.
+   static bool SizeEqual(const size_t& valueA, const size_t& valueB) { return valueA == valueB; }
+
+   /// True if the profiler is between Init and Deinit.
+   bool initialized;
+   /// Average number of bytes between samples.
+   size_t sampleInterval;
+   /// State of the generator for randomizing the interval.
+   uint32 randomState;
+   /// Number of allocations sampled so far.
+   size_t sampleCount;
+   /// All call sites seen so far.
+   Table<CallSite> callSites;
+   /// Map of call site keys to indices in 'callSites'.
+   HashTable<size_t, int> callSiteIndices;
+   /// Live sampled allocations keyed by address.
+   HashTable<size_t, LiveSample> liveSamples;
+   /// Counts of live samples by FilterIndexGet.
+   unsigned char filter[MEMORY_PROFILER_FILTER_SIZE];
+   /// Delegates that were replaced by Install.
+   HeapDelegateProfiled profiledDelegates[HEAP_COUNT];
+   /// Protects everything except the filter and the thread-local counters.
+   Mutex mutex;
+};
+
+/// Singleton instance
+static MemoryProfiler* const theMemoryProfiler = MemoryProfiler::InstanceGet();
+
+//==============================================================================
+
+inline void* HeapDelegateProfiled::Record(void* ptr, size_t size)
+{
+   if(ptr)
+      theMemoryProfiler->AllocationRecord(ptr, size, heapId);
+   return ptr;
+}
+
+//------------------------------------------------------------------------------
+
+inline bool HeapDelegateProfiled::Deallocate(void* ptr)
+{
+   theMemoryProfiler->DeallocationRecord(ptr);
+   return delegateReference->Deallocate(ptr);
+}
+
+//==============================================================================
+
+inline void MemoryProfiler::Init(size_t _sampleInterval)
+{
+   assert(_sampleInterval > 0);
+   sampleInterval = _sampleInterval;
+   randomState = 2463534242U;
+   sampleCount = 0;
+   memset(filter, 0, sizeof(filter));
+   mutex.Init();
+   callSites.Init(theAllocatorMallocFree);
+   callSiteIndices.Init(SizeHash, SizeEqual, theAllocatorMallocFree);
+   liveSamples.Init(SizeHash, SizeEqual, theAllocatorMallocFree);
+   initialized = true;
+}
+
+//------------------------------------------------------------------------------
+
+inline void MemoryProfiler::Deinit()
+{
+   if(!initialized)
+      return;
+   Uninstall();
+   initialized = false;
+   liveSamples.Deinit();
+   callSiteIndices.Deinit();
+   callSites.Deinit();
+   mutex.Deinit();
+}
+
+//------------------------------------------------------------------------------
+
+inline void MemoryProfiler::Install()
+{
+   assert(initialized);
+   for(int heapIndex = 0; heapIndex < HEAP_COUNT; heapIndex++)
+   {
+      HeapID heapId = (HeapID)heapIndex;
+      HeapDelegate* heapDelegate = theMemory->HeapDelegateGet(heapId);
+      if(!heapDelegate || (heapDelegate == &profiledDelegates[heapIndex]))
+         continue;
+      profiledDelegates[heapIndex].Init(heapDelegate, heapId);
+      theMemory->HeapDelegateSet(heapId, &profiledDelegates[heapIndex]);
+   }
+}
+
+//------------------------------------------------------------------------------
+
+inline void MemoryProfiler::Uninstall()
+{
+   for(int heapIndex = 0; heapIndex < HEAP_COUNT; heapIndex++)
+   {
+      HeapID heapId = (HeapID)heapIndex;
+      if(theMemory->HeapDelegateGet(heapId) == &profiledDelegates[heapIndex])
+         theMemory->HeapDelegateSet(heapId, profiledDelegates[heapIndex].DelegateReferenceGet());
+   }
+}
+
+//------------------------------------------------------------------------------
+
+inline void MemoryProfiler::Sample(void* ptr, size_t size, HeapID heapId)
+{
+   ReentrantCheck() = true;
+
+   CallSite callSite;
+   callSite.heapId = heapId;
+   callSite.frameCount = 0;
+#if MEMORY_PROFILER_BACKTRACE_SUPPORTED
+   void* frames[MEMORY_PROFILER_FRAME_COUNT_MAX + MEMORY_PROFILER_FRAME_SKIP_COUNT];
+   int frameCount = backtrace(frames, MEMORY_PROFILER_FRAME_COUNT_MAX + MEMORY_PROFILER_FRAME_SKIP_COUNT);
+   for(int frameIndex = MEMORY_PROFILER_FRAME_SKIP_COUNT; frameIndex < frameCount; frameIndex++)
+      callSite.frames[callSite.frameCount++] = frames[frameIndex];
+#endif //#if MEMORY_PROFILER_BACKTRACE_SUPPORTED
+
+   // FNV-1a over the heap and return addresses.
+   size_t key = (size_t)2166136261U ^ (size_t)heapId;
+   for(int frameIndex = 0; frameIndex < callSite.frameCount; frameIndex++)
+      key = FrameHash(key, callSite.frames[frameIndex]);
+   callSite.key = key;
+
+   // Each sample stands for 'sampleInterval' bytes of allocations of this size.
+   LiveSample liveSample;
+   liveSample.bytes = (double)std::max(size, sampleInterval);
+   liveSample.count = liveSample.bytes / (double)std::max(size, (size_t)1);
+
+   {
+      Guard guard(&mutex);
+      HashTable<size_t, int>::Iterator iterator = callSiteIndices.Find(key);
+      if(iterator.WithinCheck())
+      {
+         liveSample.callSiteIndex = iterator.Value();
+      }
+      else
+      {
+         callSite.allocationCount = 0.0;
+         callSite.allocationBytes = 0.0;
+         callSite.liveCount = 0.0;
+         callSite.liveBytes = 0.0;
+         liveSample.callSiteIndex = callSites.SizeGet();
+         callSites.Add(callSite);
+         callSiteIndices.Add(key, liveSample.callSiteIndex);
+      }
+
+      CallSite& site = callSites[liveSample.callSiteIndex];
+      site.allocationCount += liveSample.count;
+      site.allocationBytes += liveSample.bytes;
+      site.liveCount += liveSample.count;
+      site.liveBytes += liveSample.bytes;
+
+      if(liveSamples.Add((size_t)ptr, liveSample))
+      {
+         unsigned char& filterCount = filter[FilterIndexGet(ptr)];
+         if(filterCount < 255)
+            filterCount++;
+      }
+      sampleCount++;
+   }
+
+   ReentrantCheck() = false;
+}
+
+//------------------------------------------------------------------------------
+
+inline void MemoryProfiler::Unsample(void* ptr)
+{
+   Guard guard(&mutex);
+   HashTable<size_t, LiveSample>::Iterator iterator = liveSamples.Find((size_t)ptr);
+   if(!iterator.WithinCheck())
+      return;
+
+   LiveSample& liveSample = iterator.Value();
+   CallSite& site = callSites[liveSample.callSiteIndex];
+   site.liveCount -= liveSample.count;
+   site.liveBytes -= liveSample.bytes;
+   liveSamples.Remove(iterator);
+
+   // A saturated counter is left alone, since it no longer knows how many
+   // samples it represents.
+   unsigned char& filterCount = filter[FilterIndexGet(ptr)];
+   if((filterCount > 0) && (filterCount < 255))
+      filterCount--;
+}
+
+//------------------------------------------------------------------------------
+
+inline size_t MemoryProfiler::FrameHash(size_t key, void* frame)
+{
+   size_t offset = (size_t)frame;
+#if MEMORY_PROFILER_BACKTRACE_SUPPORTED
+   // Use the module's name and the offset within it, since the modules can
+   // be loaded at different addresses each run.
+   Dl_info info;
+   if(dladdr(frame, &info) && info.dli_fbase)
+   {
+      offset -= (size_t)info.dli_fbase;
+      const char* moduleName = info.dli_fname ? info.dli_fname : "";
+      const char* slash = strrchr(moduleName, '/');
+      for(const char* character = slash ? slash + 1 : moduleName; *character; character++)
+         key = (key ^ (size_t)(unsigned char)*character) * (size_t)16777619U;
+   }
+#endif //#if MEMORY_PROFILER_BACKTRACE_SUPPORTED
+   return (key ^ offset) * (size_t)16777619U;
+}
+
+//------------------------------------------------------------------------------
+
+inline void MemoryProfiler::SnapshotGet(JSONValue* root)
+{
+   // Building the JSONValues allocates from the profiled heaps, and freeing
+   // from them can lead to Unsample, so copy what's needed while holding the
+   // lock, and build the snapshot after letting it go.
+   ReentrantCheck() = true;
+   Table<CallSite> sites;
+   sites.Init(theAllocatorMallocFree);
+   size_t sampleCountCopy;
+   {
+      Guard guard(&mutex);
+      sites.SizeSet(callSites.SizeGet());
+      for(int callSiteIndex = 0; callSiteIndex < callSites.SizeGet(); callSiteIndex++)
+         sites[callSiteIndex] = callSites[callSiteIndex];
+      sampleCountCopy = sampleCount;
+   }
+
+   root->ObjectSet();
+   root->Set("SampleInterval", (double)sampleInterval);
+   root->Set("SampleCount", (double)sampleCountCopy);
+
+   // Totals for each heap
+   double heapAllocationCounts[HEAP_COUNT] = {0};
+   double heapAllocationBytes[HEAP_COUNT] = {0};
+   double heapLiveCounts[HEAP_COUNT] = {0};
+   double heapLiveBytes[HEAP_COUNT] = {0};
+
+   JSONValue& callSitesValue = root->ObjectSet("CallSites");
+   for(int callSiteIndex = 0; callSiteIndex < sites.SizeGet(); callSiteIndex++)
+   {
+      CallSite& site = sites[callSiteIndex];
+      assert((site.heapId >= 0) && (site.heapId < HEAP_COUNT));
+      heapAllocationCounts[site.heapId] += site.allocationCount;
+      heapAllocationBytes[site.heapId] += site.allocationBytes;
+      heapLiveCounts[site.heapId] += site.liveCount;
+      heapLiveBytes[site.heapId] += site.liveBytes;
+
+      char id[32];
+      FrogSnprintf(id, sizeof(id), "%016llx", (unsigned long long)site.key);
+      JSONValue& siteValue = callSitesValue.ObjectSet(id);
+      siteValue.Set("Heap", Memory::HeapDebugNameGet(site.heapId));
+      siteValue.Set("AllocationCount", site.allocationCount);
+      siteValue.Set("AllocationBytes", site.allocationBytes);
+      siteValue.Set("LiveCount", site.liveCount);
+      siteValue.Set("LiveBytes", site.liveBytes);
+
+      JSONValue& stackValue = siteValue.ArraySet("Stack");
+   #if MEMORY_PROFILER_BACKTRACE_SUPPORTED
+      char** symbols = site.frameCount ? backtrace_symbols(site.frames, site.frameCount) : NULL;
+   #else
+      char** symbols = NULL;
+   #endif
+      for(int frameIndex = 0; frameIndex < site.frameCount; frameIndex++)
+      {
+         if(symbols)
+         {
+            stackValue.Add(symbols[frameIndex]);
+         }
+         else
+         {
+            char address[32];
+            FrogSnprintf(address, sizeof(address), "%p", site.frames[frameIndex]);
+            stackValue.Add(address);
+         }
+      }
+      // backtrace_symbols uses malloc directly.
+      free(symbols);
+   }
+   sites.Deinit();
+
+   JSONValue& heapsValue = root->ObjectSet("Heaps");
+   for(int heapIndex = 0; heapIndex < HEAP_COUNT; heapIndex++)
+   {
+      if(heapAllocationCounts[heapIndex] == 0.0)
+         continue;
+      JSONValue& heapValue = heapsValue.ObjectSet(Memory::HeapDebugNameGet((HeapID)heapIndex));
+      heapValue.Set("AllocationCount", heapAllocationCounts[heapIndex]);
+      heapValue.Set("AllocationBytes", heapAllocationBytes[heapIndex]);
+      heapValue.Set("LiveCount", heapLiveCounts[heapIndex]);
+      heapValue.Set("LiveBytes", heapLiveBytes[heapIndex]);
+   }
+
+   ReentrantCheck() = false;
+}
+
+//------------------------------------------------------------------------------
+
+inline bool MemoryProfiler::SnapshotSave(const char* filename, FileManager* fileManager, HeapID tempHeapID)
+{
+   JSONValue root;
+   root.Init(tempHeapID);
+   SnapshotGet(&root);
+
+   ReentrantCheck() = true;
+   JSONWriter writer;
+   bool success = writer.Save(filename, fileManager, &root, "   ", tempHeapID);
+   root.Deinit();
+   ReentrantCheck() = false;
+   return success;
+}
+
+//------------------------------------------------------------------------------
+
+inline void MemoryProfiler::SnapshotDiff(JSONValue* before, JSONValue* after, JSONValue* result)
+{
+   result->ObjectSet();
+   if(!before->ObjectCheck("CallSites") || !after->ObjectCheck("CallSites"))
+      return;
+
+   JSONValue& beforeSites = before->Get("CallSites");
+   JSONValue& afterSites = after->Get("CallSites");
+   JSONValue& resultSites = result->ObjectSet("CallSites");
+   for(JSONValue::ObjectIterator iterator = afterSites.ObjectBegin(); iterator.WithinCheck(); iterator.Next())
+   {
+      const char* id = iterator.Key();
+      JSONValue* afterSite = iterator.Value();
+      double liveCountBefore = 0.0;
+      double liveBytesBefore = 0.0;
+      if(beforeSites.ObjectCheck(id))
+      {
+         liveCountBefore = beforeSites.Get(id).Get("LiveCount");
+         liveBytesBefore = beforeSites.Get(id).Get("LiveBytes");
+      }
+
+      double liveBytesDelta = (double)afterSite->Get("LiveBytes") - liveBytesBefore;
+      if(liveBytesDelta == 0.0)
+         continue;
+
+      JSONValue& resultSite = resultSites.ObjectSet(id);
+      resultSite.Set("Heap", (const char*)afterSite->Get("Heap"));
+      resultSite.Set("LiveCountDelta", (double)afterSite->Get("LiveCount") - liveCountBefore);
+      resultSite.Set("LiveBytesDelta", liveBytesDelta);
+      if(afterSite->ArrayCheck("Stack"))
+         resultSite.Set("Stack", afterSite->Get("Stack").Clone(result->HeapIDGet()));
+   }
+}
+
+//==============================================================================
+
+} //namespace Webfoot {
+
+#endif //#ifndef __FROG__MEMORYPROFILER_H__
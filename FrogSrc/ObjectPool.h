@@ -0,0 +1,238 @@
+#ifndef __FROG__OBJECTPOOL_H__
+#define __FROG__OBJECTPOOL_H__
+
+#include <new>
+#include "FrogMemory.h"
+#include "Debug.h"
+#include "Allocator.h"
+
+namespace Webfoot {
+
+/// Size in bytes to which ObjectPool chunks are aligned.
+#define OBJECT_POOL_CACHE_LINE_SIZE 64
+/// Default number of objects in each chunk of an ObjectPool.
+#define OBJECT_POOL_CHUNK_SIZE_DEFAULT 64
+
+//===============================================================================
+
+/// ObjectPool hands out fixed-size slots for objects of type 'ValueType'.
+/// Slots are allocated 'chunkSize' at a time in cache-line-aligned chunks from
+/// a backing Allocator, and freed slots are kept in an intrusive free list
+/// so allocating and freeing are just a couple of pointer moves.  Memory is
+/// only returned to the backing allocator by Deinit.
+///
+/// ObjectPool is itself an Allocator, so it can be given to anything that
+/// allocates one node at a time, like List and Map through their
+/// ReserveSizeSet overloads.  Requests larger than a slot are not
+/// supported.  Use New and Delete to construct and destroy objects directly.
+/// If 'statisticsEnabled' is true, the counts returned by the statistics
+/// functions are kept up to date.  ObjectPool is not thread-safe.
+template<typename ValueType, int chunkSize = OBJECT_POOL_CHUNK_SIZE_DEFAULT, bool statisticsEnabled = true>
+class ObjectPool : public Allocator
+{
+public:
+   ObjectPool()
+   {
+      backingAllocator = NULL;
+      chunkHead = NULL;
+      freeHead = NULL;
+      chunkCount = 0;
+      allocationCount = 0;
+      allocationCountMax = 0;
+   }
+   virtual ~ObjectPool() {}
+
+   /// Prepare the pool to get chunks from the given allocator.
+   void Init(Allocator* _backingAllocator = theAllocatorDefault)
+   {
+      backingAllocator = _backingAllocator;
+      chunkHead = NULL;
+      freeHead = NULL;
+      chunkCount = 0;
+      allocationCount = 0;
+      allocationCountMax = 0;
+   }
+
+   /// Free all the chunks.  All objects should be freed before calling this.
+   void Deinit()
+   {
+      assert(!statisticsEnabled || (allocationCount == 0));
+      while(chunkHead)
+      {
+         ChunkHeader* chunk = chunkHead;
+         chunkHead = chunk->next;
+         backingAllocator->Deallocate(chunk->allocation);
+      }
+      freeHead = NULL;
+      chunkCount = 0;
+   }
+
+   /// Return a pointer to a slot for an object.  'size' must not be more than
+   /// the size of 'ValueType'.  Return NULL if no memory is available.
+   virtual void* Allocate(size_t size)
+   {
+      assert(size <= sizeof(ValueType));
+      if(size > sizeof(ValueType))
+         return NULL;
+
+      if(!freeHead && !ChunkAdd())
+         return NULL;
+
+      Slot* slot = freeHead;
+      freeHead = slot->next;
+      if(statisticsEnabled)
+      {
+         allocationCount++;
+         if(allocationCount > allocationCountMax)
+            allocationCountMax = allocationCount;
+      }
+      return slot;
+   }
+
+   /// Return the given slot to the pool.
+   virtual void Deallocate(void* ptr)
+   {
+      if(!ptr)
+         return;
+      Slot* slot = (Slot*)ptr;
+      slot->next = freeHead;
+      freeHead = slot;
+      if(statisticsEnabled)
+      {
+         assert(allocationCount > 0);
+         allocationCount--;
+      }
+   }
+
+   /// Construct an object in a slot from the pool using its default constructor.
+   /// Return NULL if no memory is available.
+   ValueType* New()
+   {
+      void* slot = Allocate(sizeof(ValueType));
+      if(!slot)
+         return NULL;
+      try
+      {
+         return new(slot) ValueType;
+      }
+      catch(...)
+      {
+         Deallocate(slot);
+         throw;
+      }
+   }
+
+   /// Destroy an object created with New and return its slot to the pool.
+   void Delete(ValueType* object)
+   {
+      if(!object)
+         return;
+      object->~ValueType();
+      Deallocate(object);
+   }
+
+   /// Make sure there are slots allocated for at least 'count' objects in total.
+   /// Return false if the memory could not be allocated.
+   bool Reserve(int count)
+   {
+      while((int)(chunkCount * chunkSize) < count)
+      {
+         if(!ChunkAdd())
+            return false;
+      }
+      return true;
+   }
+
+   /// Return the current number of outstanding objects from the pool.
+   /// This is only tracked if 'statisticsEnabled' is true.
+   size_t AllocationCountGet() { return allocationCount; }
+   /// Return the maximum number of outstanding objects from the pool so far.
+   /// This is only tracked if 'statisticsEnabled' is true.
+   size_t AllocationCountMaxGet() { return allocationCountMax; }
+   /// Return the number of chunks currently allocated.
+   size_t ChunkCountGet() { return chunkCount; }
+   /// Return the number of objects for which slots are currently allocated.
+   size_t CapacityGet() { return chunkCount * chunkSize; }
+   /// Return the total number of bytes requested from the backing allocator.
+   size_t MemoryTotalGet() { return chunkCount * ChunkAllocationSizeGet(); }
+
+protected:
+   /// A slot holds an object while allocated and a link to the next free
+   /// slot otherwise.
+   union Slot
+   {
+      Slot* next;
+      unsigned char data[sizeof(ValueType)];
+      /// Unused members to make sure slots are suitably aligned.
+      double alignDouble;
+      void* alignPointer;
+   };
+
+   /// Header at the start of each chunk.
+   struct ChunkHeader
+   {
+      /// Next chunk in the pool.
+      ChunkHeader* next;
+      /// Address returned by the backing allocator for this chunk.
+      void* allocation;
+   };
+
+   enum
+   {
+      /// Bytes from the start of a chunk to the first slot.  This keeps the
+      /// first slot on a cache line boundary.
+      CHUNK_HEADER_SIZE = ((sizeof(ChunkHeader) + OBJECT_POOL_CACHE_LINE_SIZE - 1) / OBJECT_POOL_CACHE_LINE_SIZE) * OBJECT_POOL_CACHE_LINE_SIZE
+   };
+
+   /// Return the number of bytes to request from the backing allocator for each chunk.
+   static size_t ChunkAllocationSizeGet()
+   {
+      return (OBJECT_POOL_CACHE_LINE_SIZE - 1) + CHUNK_HEADER_SIZE + (sizeof(Slot) * chunkSize);
+   }
+
+   /// Allocate another chunk and add its slots to the free list.
+   /// Return false if unsuccessful.
+   bool ChunkAdd()
+   {
+      assert(backingAllocator);
+      void* allocation = backingAllocator->Allocate(ChunkAllocationSizeGet());
+      if(!allocation)
+         return false;
+
+      size_t address = (size_t)allocation;
+      address = (address + OBJECT_POOL_CACHE_LINE_SIZE - 1) & ~(size_t)(OBJECT_POOL_CACHE_LINE_SIZE - 1);
+      ChunkHeader* chunk = (ChunkHeader*)address;
+      chunk->allocation = allocation;
+      chunk->next = chunkHead;
+      chunkHead = chunk;
+      chunkCount++;
+
+      // Link the slots so the lowest address is used first.
+      Slot* slots = (Slot*)(address + CHUNK_HEADER_SIZE);
+      for(int slotIndex = chunkSize - 1; slotIndex >= 0; slotIndex--)
+      {
+         slots[slotIndex].next = freeHead;
+         freeHead = &slots[slotIndex];
+      }
+      return true;
+   }
+
+   /// Allocator from which chunks are allocated.
+   Allocator* backingAllocator;
+   /// Most recently allocated chunk.
+   ChunkHeader* chunkHead;
+   /// First free slot.
+   Slot* freeHead;
+   /// Number of chunks currently allocated.
+   size_t chunkCount;
+   /// Current number of outstanding objects.
+   size_t allocationCount;
+   /// The highest value reached by 'allocationCount'.
+   size_t allocationCountMax;
+};
+
+//===============================================================================
+
+} //namespace Webfoot {
+
+#endif //#ifndef __FROG__OBJECTPOOL_H__
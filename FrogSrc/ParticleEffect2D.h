@@ -327,6 +327,8 @@ public:
    /// Add the given modifier to this particle.  When the particle is
    /// deinitialized, the modifier will be deinitialized and deleted.
    void ModifierAdd(ParticleModifier2D* modifier) { modifiers.Add(modifier); }
+   /// Return the number of modifiers attached to this particle.
+   int ModifierCountGet() { return modifiers.SizeGet(); }
 
    typedef Particle2D Inherited;
 
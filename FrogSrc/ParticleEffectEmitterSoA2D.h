@@ -0,0 +1,330 @@
+#ifndef __FROG__PARTICLEEFFECTEMITTERSOA2D_H__
+#define __FROG__PARTICLEEFFECTEMITTERSOA2D_H__
+
+#include "FrogMemory.h"
+#include "Debug.h"
+#include "Table.h"
+#include "Particle2D.h"
+#include "ParticleEffect2D.h"
+#include "ParticleModifier2D.h"
+#include "ParticleSystemSoA2D.h"
+
+namespace Webfoot {
+
+//==============================================================================
+
+/// ParticleEffectEmitterSoA2D is a ParticleEffectEmitter2D that keeps its
+/// particles in a ParticleSystemSoA2D rather than as individual Particle2D
+/// objects.  It reads the same specifications as ParticleEffectEmitter2D, and
+/// emission, including the random ranges, is still handled by
+/// ParticleEffectEmitter2D.  Each newly emitted particle is copied
+/// into the arrays, and from then on it is updated in bulk.  This makes large
+/// numbers of simple particles much cheaper to update.
+///
+/// The emitter modifiers in the specifications are replaced by their
+/// ParticleModifierSoA2D equivalents during Init.  This covers
+/// ParticleEmitterModifierColorLinear2D, ColorSplineLinear2D,
+/// AdditiveBlendingLinear2D, and ScaleSplineLinear2D.  Any other emitter
+/// modifier is left in place with a warning, so it still runs on emission
+/// and in Update, but it doesn't see the particles in the arrays.
+///
+/// Only one Particle2D is kept.  It serves as a template during emission and
+/// is used to draw each particle in turn.  As a result, there are a few
+/// differences from ParticleEffectEmitter2D.
+///  - Modifiers attached to the particles themselves don't run after
+///    emission, and Init warns about them.  Use ModifierAdd with a
+///    ParticleModifierSoA2D instead.
+///  - Particle trails and expiration effects are not supported.
+///  - Draw order changes as particles expire.
+///  - The particle returned by Emit is the template, so changes to it after
+///    emission are ignored.
+///  - The ParticlesActiveCountGet and AllExpire methods of ParticleEmitter2D
+///    aren't virtual, so use ParticleCountGet and ParticlesExpire when calling
+///    through a pointer to a base class.
+///  - This should not be the source of a dependent emitter.
+///
+/// To use it with an existing effect, initialize the ParticleEffect2D empty,
+/// then Init a ParticleEffectEmitterSoA2D with the specifications of each
+/// emitter and Add it to the effect.
+class ParticleEffectEmitterSoA2D : public ParticleEffectEmitter2D
+{
+public:
+   ParticleEffectEmitterSoA2D() { templateParticle = NULL; }
+   virtual ~ParticleEffectEmitterSoA2D() {}
+
+   /// Create the emitter and its particles according to the given
+   /// specifications.  'filename' may be provided for debug output purposes.
+   void Init(JSONValue* specs, ParticleEffect2D* _particleEffect,
+      HeapID heapID = HEAP_DEFAULT, HeapID heapTempID = HEAP_TEMP, const char* filename = NULL);
+   /// Clean up.
+   virtual void Deinit();
+
+   /// Called by the ParticleEffect2D on every frame.
+   virtual void Update(unsigned int dt);
+   /// Draw all the particles.
+   virtual void Draw();
+
+   /// Emit a particle based on the rules of this emitter.
+   /// Return a pointer to the template particle if successful or NULL if
+   /// unsuccessful.
+   virtual Particle2D* Emit();
+
+   /// Deinit, delete, and remove all particles, including the template.
+   virtual void Clear();
+
+   using ParticleEffectEmitter2D::ModifierAdd;
+   /// Add the given modifier to the particles of this emitter.  When the
+   /// emitter is deinitialized, the modifier will be deinitialized and
+   /// deleted.
+   void ModifierAdd(ParticleModifierSoA2D* modifier) { modifiersSoA.Add(modifier); }
+
+   /// Return the number of particles currently alive.
+   int ParticleCountGet() { return particles.SizeGet(); }
+   /// Same as ParticleCountGet.
+   int ParticlesActiveCountGet() { return particles.SizeGet(); }
+   /// Expire all particles immediately.
+   void ParticlesExpire() { particles.Clear(); }
+   /// Same as ParticlesExpire.
+   void AllExpire() { particles.Clear(); }
+
+   /// Return the arrays of particles.
+   ParticleSystemSoA2D* ParticleSystemGet() { return &particles; }
+
+   typedef ParticleEffectEmitter2D Inherited;
+
+protected:
+   /// Replace the emitter modifiers that have ParticleModifierSoA2D
+   /// equivalents, and warn about the rest.
+   void ModifiersConvert(HeapID heapID, const char* filename);
+
+   /// Particles of the emitter.
+   ParticleSystemSoA2D particles;
+   /// Particle used when emitting and drawing.
+   Particle2D* templateParticle;
+   /// Objects that influence the particles.
+   Table<ParticleModifierSoA2D*> modifiersSoA;
+};
+
+//==============================================================================
+
+inline void ParticleEffectEmitterSoA2D::Init(JSONValue* specs, ParticleEffect2D* _particleEffect,
+   HeapID heapID, HeapID heapTempID, const char* filename)
+{
+   modifiersSoA.Init(theAllocatorHeaps[heapID]);
+   templateParticle = NULL;
+
+   // Let the usual emitter read the specifications and create its pool.
+   Inherited::Init(specs, _particleEffect, heapID, heapTempID, filename);
+
+   // If the emitter pre-simulated during Init, that was done with the usual
+   // particles, so return them to the pool and do it again below.
+   while(activeParticles.SizeGet())
+   {
+      Particle2D* particle = activeParticles.GetBack();
+      activeParticles.RemoveBack();
+      inactiveParticles.Add(particle);
+   }
+
+   // Keep one particle and replace the rest with space in the arrays.
+   int capacity = inactiveParticles.SizeGet();
+   while(inactiveParticles.SizeGet() > 1)
+   {
+      Particle2D* particle = inactiveParticles.GetBack();
+      Inherited::Remove(particle);
+      particle->Deinit();
+      frog_delete particle;
+   }
+   if(inactiveParticles.SizeGet())
+      templateParticle = inactiveParticles.GetBack();
+   ModifiersConvert(heapID, filename);
+
+   particles.Init(capacity, heapID);
+   if(particleUseLifeArea)
+      particles.LifeAreaSet(particleLifeArea);
+
+   // Pre-simulating may not have emitted anything, so go by the
+   // specifications.  It also used up part of the emission time, so start
+   // that over first.
+   if(preSimulateOnInit)
+   {
+      EmissionActiveBegin();
+      PreSimulate();
+   }
+}
+
+//------------------------------------------------------------------------------
+
+inline void ParticleEffectEmitterSoA2D::Deinit()
+{
+   int modifierCount = modifiersSoA.SizeGet();
+   for(int modifierIndex = 0; modifierIndex < modifierCount; modifierIndex++)
+   {
+      ParticleModifierSoA2D* modifier = modifiersSoA[modifierIndex];
+      modifier->Deinit();
+      frog_delete modifier;
+   }
+   modifiersSoA.Deinit();
+   particles.Deinit();
+   templateParticle = NULL;
+
+   Inherited::Deinit();
+}
+
+//------------------------------------------------------------------------------
+
+inline void ParticleEffectEmitterSoA2D::Update(unsigned int dt)
+{
+   particles.Integrate(0, particles.SizeGet(), dt);
+   int modifierCount = modifiersSoA.SizeGet();
+   for(int modifierIndex = 0; modifierIndex < modifierCount; modifierIndex++)
+      modifiersSoA[modifierIndex]->Update(&particles, 0, particles.SizeGet(), dt);
+   particles.ExpiredRemove();
+
+   // This handles the timing of emission.
+   Inherited::Update(dt);
+}
+
+//------------------------------------------------------------------------------
+
+inline void ParticleEffectEmitterSoA2D::Draw()
+{
+   if(!templateParticle)
+      return;
+
+   int particleCount = particles.SizeGet();
+   for(int index = 0; index < particleCount; index++)
+   {
+      templateParticle->PositionSet(Point2F::Create(particles.positionX[index], particles.positionY[index]));
+      templateParticle->RotationSet(particles.rotation[index]);
+      templateParticle->ScaleSet(Point2F::Create(particles.scaleX[index], particles.scaleY[index]));
+      templateParticle->ColorSet(particles.color[index]);
+      templateParticle->AdditiveBlendingSet(particles.additiveBlending[index]);
+      templateParticle->TimeSet(particles.age[index]);
+      templateParticle->Draw();
+   }
+}
+
+//------------------------------------------------------------------------------
+
+inline Particle2D* ParticleEffectEmitterSoA2D::Emit()
+{
+   if(!templateParticle || (particles.SizeGet() >= particles.CapacityGet()))
+      return NULL;
+
+   // Emit the template as usual, so it gets all the emission settings.
+   Particle2D* particle = Inherited::Emit();
+   if(!particle)
+      return NULL;
+   assert(particle == templateParticle);
+
+   int index = particles.Add();
+   Point2F position = particle->PositionGet();
+   particles.positionX[index] = position.x;
+   particles.positionY[index] = position.y;
+   Point2F velocity = particle->VelocityGet();
+   particles.velocityX[index] = velocity.x;
+   particles.velocityY[index] = velocity.y;
+   Point2F acceleration = particle->AccelerationGet();
+   particles.accelerationX[index] = acceleration.x;
+   particles.accelerationY[index] = acceleration.y;
+   particles.rotation[index] = particle->RotationGet();
+   particles.angularVelocity[index] = particle->AngularVelocityGet();
+   particles.angularAcceleration[index] = particle->AngularAccelerationGet();
+   particles.LinearDampingSet(index, particle->LinearDampingGet());
+   particles.AngularDampingSet(index, particle->AngularDampingGet());
+   Point2F scale = particle->ScaleGet();
+   particles.scaleX[index] = scale.x;
+   particles.scaleY[index] = scale.y;
+   particles.additiveBlending[index] = particle->AdditiveBlendingGet();
+   particles.age[index] = particle->AgeGet();
+   particles.lifeDuration[index] = particle->LifeDurationGet();
+   particles.color[index] = particle->ColorGet();
+
+   int modifierCount = modifiersSoA.SizeGet();
+   for(int modifierIndex = 0; modifierIndex < modifierCount; modifierIndex++)
+      modifiersSoA[modifierIndex]->OnEmit(&particles, index);
+
+   // Put the template back so it can be emitted again.
+   activeParticles.Remove(particle);
+   inactiveParticles.Add(particle);
+   return particle;
+}
+
+//------------------------------------------------------------------------------
+
+inline void ParticleEffectEmitterSoA2D::ModifiersConvert(HeapID heapID, const char* filename)
+{
+   if(!filename)
+      filename = "";
+
+   int modifierIndex = 0;
+   int modifierCount = modifiers.SizeGet();
+   for(int specIndex = 0; specIndex < modifierCount; specIndex++)
+   {
+      ParticleEmitterModifier2D* modifier = modifiers[modifierIndex];
+      ParticleModifierSoA2D* modifierSoA = NULL;
+      ParticleEmitterModifierColorLinear2D* colorLinear = dynamic_cast<ParticleEmitterModifierColorLinear2D*>(modifier);
+      ParticleEmitterModifierColorSplineLinear2D* colorSplineLinear = dynamic_cast<ParticleEmitterModifierColorSplineLinear2D*>(modifier);
+      ParticleEmitterModifierAdditiveBlendingLinear2D* additiveBlendingLinear = dynamic_cast<ParticleEmitterModifierAdditiveBlendingLinear2D*>(modifier);
+      ParticleEmitterModifierScaleSplineLinear2D* scaleSplineLinear = dynamic_cast<ParticleEmitterModifierScaleSplineLinear2D*>(modifier);
+      if(colorLinear)
+      {
+         ParticleModifierColorLinearSoA2D* converted = frog_new_ex(heapID) ParticleModifierColorLinearSoA2D();
+         converted->Init(colorLinear->ColorBeginGet(), colorLinear->ColorEndGet(), colorLinear->ProgressionGet());
+         modifierSoA = converted;
+      }
+      else if(colorSplineLinear)
+      {
+         ParticleModifierColorSplineLinearSoA2D* converted = frog_new_ex(heapID) ParticleModifierColorSplineLinearSoA2D();
+         converted->Init(colorSplineLinear->ColorSplineLinearGet(), colorSplineLinear->TimeNormalizedCheck(), heapID);
+         modifierSoA = converted;
+      }
+      else if(additiveBlendingLinear)
+      {
+         ParticleModifierAdditiveBlendingLinearSoA2D* converted = frog_new_ex(heapID) ParticleModifierAdditiveBlendingLinearSoA2D();
+         converted->Init(additiveBlendingLinear->AdditiveBlendingBeginGet(), additiveBlendingLinear->AdditiveBlendingEndGet(),
+            additiveBlendingLinear->ProgressionGet());
+         modifierSoA = converted;
+      }
+      else if(scaleSplineLinear)
+      {
+         ParticleModifierScaleSplineLinearSoA2D* converted = frog_new_ex(heapID) ParticleModifierScaleSplineLinearSoA2D();
+         converted->Init(scaleSplineLinear->ScaleSplineLinearGet(), scaleSplineLinear->TimeNormalizedCheck(), heapID);
+         modifierSoA = converted;
+      }
+
+      if(!modifierSoA)
+      {
+         WarningPrintf("ParticleEffectEmitterSoA2D::Init -- %s: Emitter modifier %d has no structure-of-arrays equivalent, so it won't affect the particles after they're emitted.\n",
+            filename, specIndex);
+         modifierIndex++;
+         continue;
+      }
+      modifiersSoA.Add(modifierSoA);
+      modifier->Deinit();
+      frog_delete modifier;
+      modifiers.RemoveIndex(modifierIndex);
+   }
+
+   ParticleEffectParticle2D* particle = dynamic_cast<ParticleEffectParticle2D*>(templateParticle);
+   if(particle && particle->ModifierCountGet())
+   {
+      WarningPrintf("ParticleEffectEmitterSoA2D::Init -- %s: %d particle modifiers will only run when particles are emitted.\n",
+         filename, particle->ModifierCountGet());
+   }
+}
+
+//------------------------------------------------------------------------------
+
+inline void ParticleEffectEmitterSoA2D::Clear()
+{
+   particles.Clear();
+   templateParticle = NULL;
+   Inherited::Clear();
+}
+
+//------------------------------------------------------------------------------
+
+} //namespace Webfoot {
+
+#endif //#ifndef __FROG__PARTICLEEFFECTEMITTERSOA2D_H__
@@ -128,6 +128,8 @@ public:
    }
    /// Stop using the private seed for random numbers.
    void SeedClear() { usePrivateSeed = false; }
+   /// Return true if the private seed is being used for random numbers.
+   bool SeedCheck() { return usePrivateSeed; }
    /// Similar to FrogMath::RandomF, except this optionally uses a private seed.
    float RandomF();
    
@@ -0,0 +1,509 @@
+#ifndef __FROG__PARTICLEKERNELS2D_H__
+#define __FROG__PARTICLEKERNELS2D_H__
+
+#include <math.h>
+#include "FrogMemory.h"
+#include "Color.h"
+#include "Progression.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+   #include <emmintrin.h>
+   /// True if ParticleKernels2D should use SSE2 to process 4 particles at once.
+   #define PARTICLE_KERNELS_2D_SSE2 1
+#else
+   #define PARTICLE_KERNELS_2D_SSE2 0
+#endif
+
+#if defined(__AVX2__)
+   #include <immintrin.h>
+   /// True if ParticleKernels2D should use AVX2 to process 8 particles at once.
+   #define PARTICLE_KERNELS_2D_AVX2 1
+#else
+   #define PARTICLE_KERNELS_2D_AVX2 0
+#endif
+
+namespace Webfoot {
+
+//==============================================================================
+
+/// ParticleKernels2D holds the loops that update the arrays of a
+/// ParticleSystemSoA2D.  Each one operates on the particles in the range
+/// [begin, end).  Where SSE2 or AVX2 is available at compile time, most of
+/// the range is processed 4 or 8 particles at a time, and the rest is handled
+/// by the matching Scalar function.  The Scalar functions can also be called
+/// directly to check the results of the vectorized versions, which should
+/// match to within floating point rounding.
+///
+/// Progressions are given as ProgressionTables, or NULL for linear.
+class ParticleKernels2D
+{
+public:
+   /// Apply acceleration and damping to the velocities over the given number
+   /// of seconds.  'dampingLog' is the natural log of the fraction of velocity
+   /// kept per second.
+   static void VelocityIntegrate(float* velocityX, float* velocityY, const float* accelerationX,
+      const float* accelerationY, const float* dampingLog, int begin, int end, float seconds);
+   /// Scalar version of VelocityIntegrate.
+   static void VelocityIntegrateScalar(float* velocityX, float* velocityY, const float* accelerationX,
+      const float* accelerationY, const float* dampingLog, int begin, int end, float seconds);
+
+   /// Move the positions by the velocities over the given number of seconds.
+   static void PositionIntegrate(float* positionX, float* positionY, const float* velocityX,
+      const float* velocityY, int begin, int end, float seconds);
+   /// Scalar version of PositionIntegrate.
+   static void PositionIntegrateScalar(float* positionX, float* positionY, const float* velocityX,
+      const float* velocityY, int begin, int end, float seconds);
+
+   /// Apply angular acceleration and damping to the angular velocities, and
+   /// then apply those to the rotations, over the given number of seconds.
+   static void AngularIntegrate(float* rotation, float* angularVelocity, const float* angularAcceleration,
+      const float* dampingLog, int begin, int end, float seconds);
+   /// Scalar version of AngularIntegrate.
+   static void AngularIntegrateScalar(float* rotation, float* angularVelocity, const float* angularAcceleration,
+      const float* dampingLog, int begin, int end, float seconds);
+
+   /// Add 'dt' to each age.
+   static void AgeAdvance(int32* age, int begin, int end, int32 dt);
+   /// Scalar version of AgeAdvance.
+   static void AgeAdvanceScalar(int32* age, int begin, int end, int32 dt);
+
+   /// Set each value by interpolating from 'valueBegin' to 'valueEnd'
+   /// according to how far along the particle is in its life.
+   static void FloatProgress(float* values, const int32* age, const int32* lifeDuration,
+      int begin, int end, float valueBegin, float valueEnd, const ProgressionTable* progressionTable);
+   /// Scalar version of FloatProgress.
+   static void FloatProgressScalar(float* values, const int32* age, const int32* lifeDuration,
+      int begin, int end, float valueBegin, float valueEnd, const ProgressionTable* progressionTable);
+
+   /// Set each color by interpolating from 'colorBegin' to 'colorEnd'
+   /// according to how far along the particle is in its life.
+   static void ColorProgress(ColorRGBA8* colors, const int32* age, const int32* lifeDuration,
+      int begin, int end, const ColorRGBA8& colorBegin, const ColorRGBA8& colorEnd,
+      const ProgressionTable* progressionTable);
+   /// Scalar version of ColorProgress.
+   static void ColorProgressScalar(ColorRGBA8* colors, const int32* age, const int32* lifeDuration,
+      int begin, int end, const ColorRGBA8& colorBegin, const ColorRGBA8& colorEnd,
+      const ProgressionTable* progressionTable);
+
+   /// Return how far along a particle with the given age and life duration is
+   /// in its life from 0 to 1.  Particles that live indefinitely are always
+   /// at 0.
+   static float LifeFractionGet(int32 age, int32 lifeDuration)
+   {
+      if(lifeDuration <= 0)
+         return 0.0f;
+      float t = (float)age / (float)lifeDuration;
+      if(t < 0.0f)
+         t = 0.0f;
+      if(t > 1.0f)
+         t = 1.0f;
+      return t;
+   }
+
+protected:
+   /// Return the given color component interpolated by 't' and clamped.
+   static uchar ComponentProgress(uchar componentBegin, uchar componentEnd, float t)
+   {
+      float component = (float)componentBegin + ((float)componentEnd - (float)componentBegin) * t;
+      if(component < 0.0f)
+         component = 0.0f;
+      if(component > 255.0f)
+         component = 255.0f;
+      return (uchar)(int)component;
+   }
+
+#if PARTICLE_KERNELS_2D_SSE2
+   /// Return e raised to each of the given values.  This is accurate to
+   /// within a few units in the last place for inputs between -87 and 88,
+   /// and inputs outside that range are clamped.
+   static __m128 Exp4(__m128 x);
+   /// Return LifeFractionGet for 4 particles, passed through the given
+   /// progression table, if any.
+   static __m128 Progress4(const int32* age, const int32* lifeDuration, const ProgressionTable* progressionTable);
+#endif
+
+#if PARTICLE_KERNELS_2D_AVX2
+   /// Return e raised to each of the given values.  See Exp4.
+   static __m256 Exp8(__m256 x);
+   /// Return LifeFractionGet for 8 particles, passed through the given
+   /// progression table, if any.
+   static __m256 Progress8(const int32* age, const int32* lifeDuration, const ProgressionTable* progressionTable);
+#endif
+};
+
+//==============================================================================
+
+//Constants for the exponential approximations of ParticleKernels2D, from the
+//Cephes math library.
+#define PARTICLE_KERNELS_2D_EXP_MAX 88.3762626647949f
+#define PARTICLE_KERNELS_2D_EXP_MIN -87.3365447504019f
+#define PARTICLE_KERNELS_2D_LOG2E 1.44269504088896341f
+#define PARTICLE_KERNELS_2D_LN2_HIGH 0.693359375f
+#define PARTICLE_KERNELS_2D_LN2_LOW -2.12194440e-4f
+#define PARTICLE_KERNELS_2D_EXP_P0 1.9875691500e-4f
+#define PARTICLE_KERNELS_2D_EXP_P1 1.3981999507e-3f
+#define PARTICLE_KERNELS_2D_EXP_P2 8.3334519073e-3f
+#define PARTICLE_KERNELS_2D_EXP_P3 4.1665795894e-2f
+#define PARTICLE_KERNELS_2D_EXP_P4 1.6666665459e-1f
+#define PARTICLE_KERNELS_2D_EXP_P5 5.0000001201e-1f
+
+//------------------------------------------------------------------------------
+
+inline void ParticleKernels2D::VelocityIntegrate(float* velocityX, float* velocityY, const float* accelerationX,
+   const float* accelerationY, const float* dampingLog, int begin, int end, float seconds)
+{
+   int index = begin;
+#if PARTICLE_KERNELS_2D_AVX2
+   __m256 seconds8 = _mm256_set1_ps(seconds);
+   for(; index + 8 <= end; index += 8)
+   {
+      __m256 damping = Exp8(_mm256_mul_ps(_mm256_loadu_ps(dampingLog + index), seconds8));
+      __m256 x = _mm256_add_ps(_mm256_loadu_ps(velocityX + index), _mm256_mul_ps(_mm256_loadu_ps(accelerationX + index), seconds8));
+      __m256 y = _mm256_add_ps(_mm256_loadu_ps(velocityY + index), _mm256_mul_ps(_mm256_loadu_ps(accelerationY + index), seconds8));
+      _mm256_storeu_ps(velocityX + index, _mm256_mul_ps(x, damping));
+      _mm256_storeu_ps(velocityY + index, _mm256_mul_ps(y, damping));
+   }
+#endif
+#if PARTICLE_KERNELS_2D_SSE2
+   __m128 seconds4 = _mm_set1_ps(seconds);
+   for(; index + 4 <= end; index += 4)
+   {
+      __m128 damping = Exp4(_mm_mul_ps(_mm_loadu_ps(dampingLog + index), seconds4));
+      __m128 x = _mm_add_ps(_mm_loadu_ps(velocityX + index), _mm_mul_ps(_mm_loadu_ps(accelerationX + index), seconds4));
+      __m128 y = _mm_add_ps(_mm_loadu_ps(velocityY + index), _mm_mul_ps(_mm_loadu_ps(accelerationY + index), seconds4));
+      _mm_storeu_ps(velocityX + index, _mm_mul_ps(x, damping));
+      _mm_storeu_ps(velocityY + index, _mm_mul_ps(y, damping));
+   }
+#endif
+   VelocityIntegrateScalar(velocityX, velocityY, accelerationX, accelerationY, dampingLog, index, end, seconds);
+}
+
+//------------------------------------------------------------------------------
+
+inline void ParticleKernels2D::VelocityIntegrateScalar(float* velocityX, float* velocityY, const float* accelerationX,
+   const float* accelerationY, const float* dampingLog, int begin, int end, float seconds)
+{
+   for(int index = begin; index < end; index++)
+   {
+      float damping = expf(dampingLog[index] * seconds);
+      velocityX[index] = (velocityX[index] + accelerationX[index] * seconds) * damping;
+      velocityY[index] = (velocityY[index] + accelerationY[index] * seconds) * damping;
+   }
+}
+
+//------------------------------------------------------------------------------
+
+inline void ParticleKernels2D::PositionIntegrate(float* positionX, float* positionY, const float* velocityX,
+   const float* velocityY, int begin, int end, float seconds)
+{
+   int index = begin;
+#if PARTICLE_KERNELS_2D_AVX2
+   __m256 seconds8 = _mm256_set1_ps(seconds);
+   for(; index + 8 <= end; index += 8)
+   {
+      _mm256_storeu_ps(positionX + index, _mm256_add_ps(_mm256_loadu_ps(positionX + index), _mm256_mul_ps(_mm256_loadu_ps(velocityX + index), seconds8)));
+      _mm256_storeu_ps(positionY + index, _mm256_add_ps(_mm256_loadu_ps(positionY + index), _mm256_mul_ps(_mm256_loadu_ps(velocityY + index), seconds8)));
+   }
+#endif
+#if PARTICLE_KERNELS_2D_SSE2
+   __m128 seconds4 = _mm_set1_ps(seconds);
+   for(; index + 4 <= end; index += 4)
+   {
+      _mm_storeu_ps(positionX + index, _mm_add_ps(_mm_loadu_ps(positionX + index), _mm_mul_ps(_mm_loadu_ps(velocityX + index), seconds4)));
+      _mm_storeu_ps(positionY + index, _mm_add_ps(_mm_loadu_ps(positionY + index), _mm_mul_ps(_mm_loadu_ps(velocityY + index), seconds4)));
+   }
+#endif
+   PositionIntegrateScalar(positionX, positionY, velocityX, velocityY, index, end, seconds);
+}
+
+//------------------------------------------------------------------------------
+
+inline void ParticleKernels2D::PositionIntegrateScalar(float* positionX, float* positionY, const float* velocityX,
+   const float* velocityY, int begin, int end, float seconds)
+{
+   for(int index = begin; index < end; index++)
+   {
+      positionX[index] += velocityX[index] * seconds;
+      positionY[index] += velocityY[index] * seconds;
+   }
+}
+
+//------------------------------------------------------------------------------
+
+inline void ParticleKernels2D::AngularIntegrate(float* rotation, float* angularVelocity, const float* angularAcceleration,
+   const float* dampingLog, int begin, int end, float seconds)
+{
+   int index = begin;
+#if PARTICLE_KERNELS_2D_AVX2
+   __m256 seconds8 = _mm256_set1_ps(seconds);
+   for(; index + 8 <= end; index += 8)
+   {
+      __m256 damping = Exp8(_mm256_mul_ps(_mm256_loadu_ps(dampingLog + index), seconds8));
+      __m256 velocity = _mm256_add_ps(_mm256_loadu_ps(angularVelocity + index), _mm256_mul_ps(_mm256_loadu_ps(angularAcceleration + index), seconds8));
+      velocity = _mm256_mul_ps(velocity, damping);
+      _mm256_storeu_ps(angularVelocity + index, velocity);
+      _mm256_storeu_ps(rotation + index, _mm256_add_ps(_mm256_loadu_ps(rotation + index), _mm256_mul_ps(velocity, seconds8)));
+   }
+#endif
+#if PARTICLE_KERNELS_2D_SSE2
+   __m128 seconds4 = _mm_set1_ps(seconds);
+   for(; index + 4 <= end; index += 4)
+   {
+      __m128 damping = Exp4(_mm_mul_ps(_mm_loadu_ps(dampingLog + index), seconds4));
+      __m128 velocity = _mm_add_ps(_mm_loadu_ps(angularVelocity + index), _mm_mul_ps(_mm_loadu_ps(angularAcceleration + index), seconds4));
+      velocity = _mm_mul_ps(velocity, damping);
+      _mm_storeu_ps(angularVelocity + index, velocity);
+      _mm_storeu_ps(rotation + index, _mm_add_ps(_mm_loadu_ps(rotation + index), _mm_mul_ps(velocity, seconds4)));
+   }
+#endif
+   AngularIntegrateScalar(rotation, angularVelocity, angularAcceleration, dampingLog, index, end, seconds);
+}
+
+//------------------------------------------------------------------------------
+
+inline void ParticleKernels2D::AngularIntegrateScalar(float* rotation, float* angularVelocity, const float* angularAcceleration,
+   const float* dampingLog, int begin, int end, float seconds)
+{
+   for(int index = begin; index < end; index++)
+   {
+      float damping = expf(dampingLog[index] * seconds);
+      angularVelocity[index] = (angularVelocity[index] + angularAcceleration[index] * seconds) * damping;
+      rotation[index] += angularVelocity[index] * seconds;
+   }
+}
+
+//------------------------------------------------------------------------------
+
+inline void ParticleKernels2D::AgeAdvance(int32* age, int begin, int end, int32 dt)
+{
+   int index = begin;
+#if PARTICLE_KERNELS_2D_AVX2
+   __m256i dt8 = _mm256_set1_epi32(dt);
+   for(; index + 8 <= end; index += 8)
+      _mm256_storeu_si256((__m256i*)(age + index), _mm256_add_epi32(_mm256_loadu_si256((const __m256i*)(age + index)), dt8));
+#endif
+#if PARTICLE_KERNELS_2D_SSE2
+   __m128i dt4 = _mm_set1_epi32(dt);
+   for(; index + 4 <= end; index += 4)
+      _mm_storeu_si128((__m128i*)(age + index), _mm_add_epi32(_mm_loadu_si128((const __m128i*)(age + index)), dt4));
+#endif
+   AgeAdvanceScalar(age, index, end, dt);
+}
+
+//------------------------------------------------------------------------------
+
+inline void ParticleKernels2D::AgeAdvanceScalar(int32* age, int begin, int end, int32 dt)
+{
+   for(int index = begin; index < end; index++)
+      age[index] += dt;
+}
+
+//------------------------------------------------------------------------------
+
+inline void ParticleKernels2D::FloatProgress(float* values, const int32* age, const int32* lifeDuration,
+   int begin, int end, float valueBegin, float valueEnd, const ProgressionTable* progressionTable)
+{
+   int index = begin;
+#if PARTICLE_KERNELS_2D_AVX2
+   __m256 begin8 = _mm256_set1_ps(valueBegin);
+   __m256 difference8 = _mm256_set1_ps(valueEnd - valueBegin);
+   for(; index + 8 <= end; index += 8)
+   {
+      __m256 t = Progress8(age + index, lifeDuration + index, progressionTable);
+      _mm256_storeu_ps(values + index, _mm256_add_ps(begin8, _mm256_mul_ps(difference8, t)));
+   }
+#endif
+#if PARTICLE_KERNELS_2D_SSE2
+   __m128 begin4 = _mm_set1_ps(valueBegin);
+   __m128 difference4 = _mm_set1_ps(valueEnd - valueBegin);
+   for(; index + 4 <= end; index += 4)
+   {
+      __m128 t = Progress4(age + index, lifeDuration + index, progressionTable);
+      _mm_storeu_ps(values + index, _mm_add_ps(begin4, _mm_mul_ps(difference4, t)));
+   }
+#endif
+   FloatProgressScalar(values, age, lifeDuration, index, end, valueBegin, valueEnd, progressionTable);
+}
+
+//------------------------------------------------------------------------------
+
+inline void ParticleKernels2D::FloatProgressScalar(float* values, const int32* age, const int32* lifeDuration,
+   int begin, int end, float valueBegin, float valueEnd, const ProgressionTable* progressionTable)
+{
+   float difference = valueEnd - valueBegin;
+   for(int index = begin; index < end; index++)
+   {
+      float t = LifeFractionGet(age[index], lifeDuration[index]);
+      if(progressionTable)
+         t = progressionTable->ValueGet(t);
+      values[index] = valueBegin + difference * t;
+   }
+}
+
+//------------------------------------------------------------------------------
+
+inline void ParticleKernels2D::ColorProgress(ColorRGBA8* colors, const int32* age, const int32* lifeDuration,
+   int begin, int end, const ColorRGBA8& colorBegin, const ColorRGBA8& colorEnd,
+   const ProgressionTable* progressionTable)
+{
+   int index = begin;
+#if PARTICLE_KERNELS_2D_SSE2
+   // Colors are computed 4 at a time, with one register per component, and
+   // then packed back into bytes.
+   __m128 zero4 = _mm_setzero_ps();
+   __m128 max4 = _mm_set1_ps(255.0f);
+   __m128 redBegin = _mm_set1_ps((float)colorBegin.red);
+   __m128 greenBegin = _mm_set1_ps((float)colorBegin.green);
+   __m128 blueBegin = _mm_set1_ps((float)colorBegin.blue);
+   __m128 alphaBegin = _mm_set1_ps((float)colorBegin.alpha);
+   __m128 redDifference = _mm_set1_ps((float)colorEnd.red - (float)colorBegin.red);
+   __m128 greenDifference = _mm_set1_ps((float)colorEnd.green - (float)colorBegin.green);
+   __m128 blueDifference = _mm_set1_ps((float)colorEnd.blue - (float)colorBegin.blue);
+   __m128 alphaDifference = _mm_set1_ps((float)colorEnd.alpha - (float)colorBegin.alpha);
+   for(; index + 4 <= end; index += 4)
+   {
+      __m128 t = Progress4(age + index, lifeDuration + index, progressionTable);
+      __m128i red = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(_mm_add_ps(redBegin, _mm_mul_ps(redDifference, t)), zero4), max4));
+      __m128i green = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(_mm_add_ps(greenBegin, _mm_mul_ps(greenDifference, t)), zero4), max4));
+      __m128i blue = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(_mm_add_ps(blueBegin, _mm_mul_ps(blueDifference, t)), zero4), max4));
+      __m128i alpha = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(_mm_add_ps(alphaBegin, _mm_mul_ps(alphaDifference, t)), zero4), max4));
+      // ColorRGBA8 is red, green, blue, alpha in memory, so on a little
+      // endian machine, red is the low byte of each 32-bit value.
+      __m128i packed = _mm_or_si128(_mm_or_si128(red, _mm_slli_epi32(green, 8)),
+         _mm_or_si128(_mm_slli_epi32(blue, 16), _mm_slli_epi32(alpha, 24)));
+      _mm_storeu_si128((__m128i*)(colors + index), packed);
+   }
+#endif
+   ColorProgressScalar(colors, age, lifeDuration, index, end, colorBegin, colorEnd, progressionTable);
+}
+
+//------------------------------------------------------------------------------
+
+inline void ParticleKernels2D::ColorProgressScalar(ColorRGBA8* colors, const int32* age, const int32* lifeDuration,
+   int begin, int end, const ColorRGBA8& colorBegin, const ColorRGBA8& colorEnd,
+   const ProgressionTable* progressionTable)
+{
+   for(int index = begin; index < end; index++)
+   {
+      float t = LifeFractionGet(age[index], lifeDuration[index]);
+      if(progressionTable)
+         t = progressionTable->ValueGet(t);
+      ColorRGBA8& color = colors[index];
+      color.red = ComponentProgress(colorBegin.red, colorEnd.red, t);
+      color.green = ComponentProgress(colorBegin.green, colorEnd.green, t);
+      color.blue = ComponentProgress(colorBegin.blue, colorEnd.blue, t);
+      color.alpha = ComponentProgress(colorBegin.alpha, colorEnd.alpha, t);
+   }
+}
+
+//------------------------------------------------------------------------------
+
+#if PARTICLE_KERNELS_2D_SSE2
+
+inline __m128 ParticleKernels2D::Exp4(__m128 x)
+{
+   x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(PARTICLE_KERNELS_2D_EXP_MIN)), _mm_set1_ps(PARTICLE_KERNELS_2D_EXP_MAX));
+
+   // Split x into n*ln(2) + r, where n is an integer.
+   __m128 n = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(PARTICLE_KERNELS_2D_LOG2E)), _mm_set1_ps(0.5f));
+   __m128 truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(n));
+   n = _mm_sub_ps(truncated, _mm_and_ps(_mm_cmpgt_ps(truncated, n), _mm_set1_ps(1.0f)));
+   x = _mm_sub_ps(x, _mm_mul_ps(n, _mm_set1_ps(PARTICLE_KERNELS_2D_LN2_HIGH)));
+   x = _mm_sub_ps(x, _mm_mul_ps(n, _mm_set1_ps(PARTICLE_KERNELS_2D_LN2_LOW)));
+
+   // Approximate e^r.
+   __m128 y = _mm_set1_ps(PARTICLE_KERNELS_2D_EXP_P0);
+   y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(PARTICLE_KERNELS_2D_EXP_P1));
+   y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(PARTICLE_KERNELS_2D_EXP_P2));
+   y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(PARTICLE_KERNELS_2D_EXP_P3));
+   y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(PARTICLE_KERNELS_2D_EXP_P4));
+   y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(PARTICLE_KERNELS_2D_EXP_P5));
+   y = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_mul_ps(y, x), x), x), _mm_set1_ps(1.0f));
+
+   // Multiply by 2^n by building the float directly.
+   __m128i exponent = _mm_slli_epi32(_mm_add_epi32(_mm_cvttps_epi32(n), _mm_set1_epi32(127)), 23);
+   return _mm_mul_ps(y, _mm_castsi128_ps(exponent));
+}
+
+//------------------------------------------------------------------------------
+
+inline __m128 ParticleKernels2D::Progress4(const int32* age, const int32* lifeDuration, const ProgressionTable* progressionTable)
+{
+   __m128i lifeDurations = _mm_loadu_si128((const __m128i*)lifeDuration);
+   __m128 t = _mm_div_ps(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i*)age)), _mm_cvtepi32_ps(lifeDurations));
+   t = _mm_min_ps(_mm_max_ps(t, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+   // Particles that live indefinitely stay at 0.
+   t = _mm_and_ps(t, _mm_castsi128_ps(_mm_cmpgt_epi32(lifeDurations, _mm_setzero_si128())));
+   if(!progressionTable)
+      return t;
+
+   __m128 position = _mm_mul_ps(t, _mm_set1_ps((float)PROGRESSION_TABLE_SIZE));
+   __m128i sampleIndices = _mm_cvttps_epi32(_mm_min_ps(position, _mm_set1_ps((float)(PROGRESSION_TABLE_SIZE - 1))));
+   __m128 fraction = _mm_sub_ps(position, _mm_cvtepi32_ps(sampleIndices));
+
+   // SSE2 has no gather, so the samples are looked up one at a time.
+   int32 indices[4];
+   _mm_storeu_si128((__m128i*)indices, sampleIndices);
+   const float* values = progressionTable->ValuesGet();
+   __m128 value0 = _mm_setr_ps(values[indices[0]], values[indices[1]], values[indices[2]], values[indices[3]]);
+   __m128 value1 = _mm_setr_ps(values[indices[0] + 1], values[indices[1] + 1], values[indices[2] + 1], values[indices[3] + 1]);
+   return _mm_add_ps(value0, _mm_mul_ps(_mm_sub_ps(value1, value0), fraction));
+}
+
+#endif //#if PARTICLE_KERNELS_2D_SSE2
+
+//------------------------------------------------------------------------------
+
+#if PARTICLE_KERNELS_2D_AVX2
+
+inline __m256 ParticleKernels2D::Exp8(__m256 x)
+{
+   x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(PARTICLE_KERNELS_2D_EXP_MIN)), _mm256_set1_ps(PARTICLE_KERNELS_2D_EXP_MAX));
+
+   // Split x into n*ln(2) + r, where n is an integer.
+   __m256 n = _mm256_floor_ps(_mm256_add_ps(_mm256_mul_ps(x, _mm256_set1_ps(PARTICLE_KERNELS_2D_LOG2E)), _mm256_set1_ps(0.5f)));
+   x = _mm256_sub_ps(x, _mm256_mul_ps(n, _mm256_set1_ps(PARTICLE_KERNELS_2D_LN2_HIGH)));
+   x = _mm256_sub_ps(x, _mm256_mul_ps(n, _mm256_set1_ps(PARTICLE_KERNELS_2D_LN2_LOW)));
+
+   // Approximate e^r.
+   __m256 y = _mm256_set1_ps(PARTICLE_KERNELS_2D_EXP_P0);
+   y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(PARTICLE_KERNELS_2D_EXP_P1));
+   y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(PARTICLE_KERNELS_2D_EXP_P2));
+   y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(PARTICLE_KERNELS_2D_EXP_P3));
+   y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(PARTICLE_KERNELS_2D_EXP_P4));
+   y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(PARTICLE_KERNELS_2D_EXP_P5));
+   y = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(y, x), x), x), _mm256_set1_ps(1.0f));
+
+   // Multiply by 2^n by building the float directly.
+   __m256i exponent = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvttps_epi32(n), _mm256_set1_epi32(127)), 23);
+   return _mm256_mul_ps(y, _mm256_castsi256_ps(exponent));
+}
+
+//------------------------------------------------------------------------------
+
+inline __m256 ParticleKernels2D::Progress8(const int32* age, const int32* lifeDuration, const ProgressionTable* progressionTable)
+{
+   __m256i lifeDurations = _mm256_loadu_si256((const __m256i*)lifeDuration);
+   __m256 t = _mm256_div_ps(_mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i*)age)), _mm256_cvtepi32_ps(lifeDurations));
+   t = _mm256_min_ps(_mm256_max_ps(t, _mm256_setzero_ps()), _mm256_set1_ps(1.0f));
+   // Particles that live indefinitely stay at 0.
+   t = _mm256_and_ps(t, _mm256_castsi256_ps(_mm256_cmpgt_epi32(lifeDurations, _mm256_setzero_si256())));
+   if(!progressionTable)
+      return t;
+
+   __m256 position = _mm256_mul_ps(t, _mm256_set1_ps((float)PROGRESSION_TABLE_SIZE));
+   __m256i sampleIndices = _mm256_cvttps_epi32(_mm256_min_ps(position, _mm256_set1_ps((float)(PROGRESSION_TABLE_SIZE - 1))));
+   __m256 fraction = _mm256_sub_ps(position, _mm256_cvtepi32_ps(sampleIndices));
+   const float* values = progressionTable->ValuesGet();
+   __m256 value0 = _mm256_i32gather_ps(values, sampleIndices, 4);
+   __m256 value1 = _mm256_i32gather_ps(values + 1, sampleIndices, 4);
+   return _mm256_add_ps(value0, _mm256_mul_ps(_mm256_sub_ps(value1, value0), fraction));
+}
+
+#endif //#if PARTICLE_KERNELS_2D_AVX2
+
+//------------------------------------------------------------------------------
+
+} //namespace Webfoot {
+
+#endif //#ifndef __FROG__PARTICLEKERNELS2D_H__
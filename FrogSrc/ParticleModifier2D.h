@@ -76,6 +76,13 @@ public:
    
    virtual void Update(unsigned int dt);
    virtual void OnEmit(Particle2D* particle);
+
+   /// Return the color of a particle at the beginning of its life.
+   ColorRGBA8 ColorBeginGet() { return colorBegin; }
+   /// Return the color of a particle at the end of its normal lifespan.
+   ColorRGBA8 ColorEndGet() { return colorEnd; }
+   /// Return the progression followed by the interpolation.
+   Progression* ProgressionGet() { return progression; }
    
    typedef ParticleEmitterModifier2D Inherited;
    
@@ -110,6 +117,12 @@ public:
    virtual void Update(unsigned int dt);
    virtual void OnEmit(Particle2D* particle);
 
+   /// Return the spline which controls the progression of color over the
+   /// particle's life.
+   SplineLinear<ColorRGBA8>* ColorSplineLinearGet() { return &colorSplineLinear; }
+   /// Return true if time is normalized to the expected life of the particle.
+   bool TimeNormalizedCheck() { return timeNormalized; }
+
    typedef ParticleEmitterModifier2D Inherited;
 
 protected:
@@ -134,6 +147,14 @@ public:
    
    virtual void Update(unsigned int dt);
    virtual void OnEmit(Particle2D* particle);
+
+   /// Return the additive blending of a particle at the beginning of its life.
+   float AdditiveBlendingBeginGet() { return additiveBlendingBegin; }
+   /// Return the additive blending of a particle at the end of its normal
+   /// lifespan.
+   float AdditiveBlendingEndGet() { return additiveBlendingEnd; }
+   /// Return the progression followed by the interpolation.
+   Progression* ProgressionGet() { return progression; }
    
    typedef ParticleEmitterModifier2D Inherited;
    
@@ -206,6 +227,12 @@ public:
    virtual void Update(unsigned int dt);
    virtual void OnEmit(Particle2D* particle);
 
+   /// Return the spline which controls the progression of scale over the
+   /// particle's life.
+   SplineLinear<Point2F>* ScaleSplineLinearGet() { return &scaleSplineLinear; }
+   /// Return true if time is normalized to the expected life of the particle.
+   bool TimeNormalizedCheck() { return timeNormalized; }
+
    typedef ParticleEmitterModifier2D Inherited;
 
 protected:
@@ -0,0 +1,567 @@
+#ifndef __FROG__PARTICLESYSTEMSOA2D_H__
+#define __FROG__PARTICLESYSTEMSOA2D_H__
+
+#include <math.h>
+#include <string.h>
+#include "FrogMemory.h"
+#include "Debug.h"
+#include "Point2.h"
+#include "Box2.h"
+#include "Color.h"
+#include "Progression.h"
+#include "SplineLinear.h"
+#include "Particle2D.h"
+#include "ParticleKernels2D.h"
+
+namespace Webfoot {
+
+//Alignment in bytes of each array in a ParticleSystemSoA2D.
+#define PARTICLE_SYSTEM_SOA_2D_ALIGNMENT 16
+
+//==============================================================================
+
+/// ParticleSystemSoA2D stores the state of many 2D particles as a structure of
+/// arrays, with one array per attribute rather than one object per particle.
+/// Updating walks each array in order without virtual calls, which is much
+/// friendlier to the cache than a list of Particle2D objects.  Particles are
+/// identified by their index, which changes when other particles are removed,
+/// since removal swaps the last particle into the gap.
+///
+/// The arrays are public so that modifiers and drawing code can operate on
+/// whole ranges directly.  Only the first SizeGet() entries of each are
+/// meaningful.
+class ParticleSystemSoA2D
+{
+public:
+   ParticleSystemSoA2D();
+
+   /// Allocate space for the given number of particles from the given heap.
+   void Init(int _capacity, HeapID heapID = HEAP_DEFAULT);
+   /// Free the arrays.
+   void Deinit();
+
+   /// Add a particle at rest with default settings and return its index.
+   /// Return -1 if the system is full.
+   int Add();
+   /// Remove the particle at the given index by moving the last particle
+   /// into its place.
+   void Remove(int index);
+   /// Remove all particles.
+   void Clear() { size = 0; }
+
+   /// Advance the particles by the given number of milliseconds and remove
+   /// the ones that have expired.  Return the number that expired.
+   int Update(unsigned int dt);
+   /// Advance the motion and age of the particles in the range [begin, end)
+   /// without removing any.
+   void Integrate(int begin, int end, unsigned int dt);
+   /// Remove particles that have outlived their life durations or left the
+   /// life area.  Return the number removed.
+   int ExpiredRemove();
+
+   /// Return the number of particles.
+   int SizeGet() { return size; }
+   /// Return the maximum number of particles.
+   int CapacityGet() { return capacity; }
+
+   /// Make particles expire if their positions leave the given area.
+   void LifeAreaSet(const Box2F& _lifeArea) { lifeArea = _lifeArea; lifeAreaEnabled = true; }
+   /// Stop expiring particles based on their positions.
+   void LifeAreaClear() { lifeAreaEnabled = false; }
+
+   /// Set the linear damping of the given particle.  See
+   /// Particle2D::LinearDampingSet.
+   void LinearDampingSet(int index, float linearDamping) { linearDampingLog[index] = DampingLogGet(linearDamping); }
+   /// Set the angular damping of the given particle.  See
+   /// Particle2D::LinearDampingSet.
+   void AngularDampingSet(int index, float angularDamping) { angularDampingLog[index] = DampingLogGet(angularDamping); }
+
+   /// Return the position of the given particle.
+   Point2F PositionGet(int index) { return Point2F::Create(positionX[index], positionY[index]); }
+   /// Return the scale of the given particle.
+   Point2F ScaleGet(int index) { return Point2F::Create(scaleX[index], scaleY[index]); }
+
+   /// Horizontal position in units.
+   float* positionX;
+   /// Vertical position in units.
+   float* positionY;
+   /// Horizontal velocity in units per second.
+   float* velocityX;
+   /// Vertical velocity in units per second.
+   float* velocityY;
+   /// Horizontal acceleration in units per second squared.
+   float* accelerationX;
+   /// Vertical acceleration in units per second squared.
+   float* accelerationY;
+   /// Rotation in degrees.
+   float* rotation;
+   /// Angular velocity in degrees per second.
+   float* angularVelocity;
+   /// Angular acceleration in degrees per second squared.
+   float* angularAcceleration;
+   /// Natural log of the fraction of linear velocity kept per second.
+   float* linearDampingLog;
+   /// Natural log of the fraction of angular velocity kept per second.
+   float* angularDampingLog;
+   /// Horizontal scale.
+   float* scaleX;
+   /// Vertical scale.
+   float* scaleY;
+   /// Amount of additive blending from 0 to 1.
+   float* additiveBlending;
+   /// Milliseconds since the particle was emitted.
+   int32* age;
+   /// Age in milliseconds at which the particle expires, or
+   /// Particle2D::LIFE_DURATION_INDEFINITE.
+   int32* lifeDuration;
+   /// Color of the particle.
+   ColorRGBA8* color;
+
+protected:
+   enum
+   {
+      /// Number of float arrays.
+      FLOAT_ARRAY_COUNT = 14,
+      /// Number of int32 arrays.
+      INT32_ARRAY_COUNT = 2
+   };
+
+   /// Copy all the attributes of one particle to another index.
+   void Copy(int destination, int source);
+   /// Return the value for linearDampingLog for the given damping.
+   static float DampingLogGet(float damping)
+   {
+      // Full damping stops the particle immediately.
+      if(damping >= 1.0f)
+         return -1.0e30f;
+      return (damping > 0.0f) ? logf(1.0f - damping) : 0.0f;
+   }
+
+   /// Single allocation that holds all the arrays.
+   void* block;
+   /// Number of particles.
+   int size;
+   /// Maximum number of particles.
+   int capacity;
+   /// True if particles should expire when they leave 'lifeArea'.
+   bool lifeAreaEnabled;
+   /// Area outside of which particles expire.
+   Box2F lifeArea;
+};
+
+//==============================================================================
+
+/// ParticleModifierSoA2D is a base class for objects that change the particles
+/// of a ParticleSystemSoA2D over time.  Unlike ParticleEmitterModifier2D, it
+/// is given whole ranges of particles at once.
+class ParticleModifierSoA2D
+{
+public:
+   virtual ~ParticleModifierSoA2D() {}
+
+   /// Clean up.
+   virtual void Deinit() {}
+   /// Called when the particle at the given index has just been emitted.
+   virtual void OnEmit(ParticleSystemSoA2D* particles, int index) { (void)particles; (void)index; }
+   /// Called on every update for the particles in the range [begin, end)
+   /// after they have moved.
+   virtual void Update(ParticleSystemSoA2D* particles, int begin, int end, unsigned int dt)
+   {
+      (void)particles; (void)begin; (void)end; (void)dt;
+   }
+
+protected:
+   /// Return how far along the given particle is in its life from 0 to 1.
+   /// Particles that live indefinitely are always at 0.
+   static float LifeFractionGet(ParticleSystemSoA2D* particles, int index, Progression* progression)
+   {
+      float t = ParticleKernels2D::LifeFractionGet(particles->age[index], particles->lifeDuration[index]);
+      return progression ? progression->ValueGet(t) : t;
+   }
+   /// Return the time at which to sample a spline for the given particle.  If
+   /// 'timeNormalized' is true, the spline runs from 0 to 1000 over the
+   /// particle's life.  Otherwise, it's sampled at the particle's age.
+   static float SplineTimeGet(ParticleSystemSoA2D* particles, int index, bool timeNormalized)
+   {
+      if(timeNormalized)
+         return ParticleKernels2D::LifeFractionGet(particles->age[index], particles->lifeDuration[index]) * 1000.0f;
+      return (float)particles->age[index];
+   }
+};
+
+//==============================================================================
+
+/// ParticleModifierColorLinearSoA2D interpolates the color of particles over
+/// their lives according to the given progression, like
+/// ParticleEmitterModifierColorLinear2D.
+class ParticleModifierColorLinearSoA2D : public ParticleModifierSoA2D
+{
+public:
+   virtual ~ParticleModifierColorLinearSoA2D() {}
+
+   /// 'progression' may be NULL for a linear progression.
+   void Init(const ColorRGBA8& _colorBegin, const ColorRGBA8& _colorEnd, Progression* progression = NULL)
+   {
+      colorBegin = _colorBegin;
+      colorEnd = _colorEnd;
+      progressionUse = (progression != NULL);
+      progressionTable.Init(progression);
+   }
+
+   virtual void OnEmit(ParticleSystemSoA2D* particles, int index) { particles->color[index] = colorBegin; }
+   virtual void Update(ParticleSystemSoA2D* particles, int begin, int end, unsigned int /*dt*/)
+   {
+      ParticleKernels2D::ColorProgress(particles->color, particles->age, particles->lifeDuration,
+         begin, end, colorBegin, colorEnd, progressionUse ? &progressionTable : NULL);
+   }
+
+   typedef ParticleModifierSoA2D Inherited;
+
+protected:
+   /// Color of a particle at the beginning of its life.
+   ColorRGBA8 colorBegin;
+   /// Color of a particle at the end of its life.
+   ColorRGBA8 colorEnd;
+   /// True if 'progressionTable' should be used rather than a linear progression.
+   bool progressionUse;
+   /// Samples of the progression given to Init.
+   ProgressionTable progressionTable;
+};
+
+//==============================================================================
+
+/// ParticleModifierAdditiveBlendingLinearSoA2D interpolates the additive
+/// blending of particles over their lives according to the given progression,
+/// like ParticleEmitterModifierAdditiveBlendingLinear2D.
+class ParticleModifierAdditiveBlendingLinearSoA2D : public ParticleModifierSoA2D
+{
+public:
+   virtual ~ParticleModifierAdditiveBlendingLinearSoA2D() {}
+
+   /// 'progression' may be NULL for a linear progression.
+   void Init(float _additiveBlendingBegin, float _additiveBlendingEnd, Progression* progression = NULL)
+   {
+      additiveBlendingBegin = _additiveBlendingBegin;
+      additiveBlendingEnd = _additiveBlendingEnd;
+      progressionUse = (progression != NULL);
+      progressionTable.Init(progression);
+   }
+
+   virtual void OnEmit(ParticleSystemSoA2D* particles, int index) { particles->additiveBlending[index] = additiveBlendingBegin; }
+   virtual void Update(ParticleSystemSoA2D* particles, int begin, int end, unsigned int /*dt*/)
+   {
+      ParticleKernels2D::FloatProgress(particles->additiveBlending, particles->age, particles->lifeDuration,
+         begin, end, additiveBlendingBegin, additiveBlendingEnd, progressionUse ? &progressionTable : NULL);
+   }
+
+   typedef ParticleModifierSoA2D Inherited;
+
+protected:
+   /// Additive blending of a particle at the beginning of its life.
+   float additiveBlendingBegin;
+   /// Additive blending of a particle at the end of its life.
+   float additiveBlendingEnd;
+   /// True if 'progressionTable' should be used rather than a linear progression.
+   bool progressionUse;
+   /// Samples of the progression given to Init.
+   ProgressionTable progressionTable;
+};
+
+//==============================================================================
+
+/// ParticleModifierScaleLinearSoA2D interpolates the scale of particles over
+/// their lives according to the given progression, like
+/// ParticleModifierScaleLinear2D, except that the beginning and ending scales
+/// are the same for all particles.
+class ParticleModifierScaleLinearSoA2D : public ParticleModifierSoA2D
+{
+public:
+   virtual ~ParticleModifierScaleLinearSoA2D() {}
+
+   /// 'progression' may be NULL for a linear progression.
+   void Init(const Point2F& _scaleBegin, const Point2F& _scaleEnd, Progression* progression = NULL)
+   {
+      scaleBegin = _scaleBegin;
+      scaleEnd = _scaleEnd;
+      progressionUse = (progression != NULL);
+      progressionTable.Init(progression);
+   }
+
+   virtual void OnEmit(ParticleSystemSoA2D* particles, int index)
+   {
+      particles->scaleX[index] = scaleBegin.x;
+      particles->scaleY[index] = scaleBegin.y;
+   }
+   virtual void Update(ParticleSystemSoA2D* particles, int begin, int end, unsigned int /*dt*/)
+   {
+      const ProgressionTable* table = progressionUse ? &progressionTable : NULL;
+      ParticleKernels2D::FloatProgress(particles->scaleX, particles->age, particles->lifeDuration,
+         begin, end, scaleBegin.x, scaleEnd.x, table);
+      ParticleKernels2D::FloatProgress(particles->scaleY, particles->age, particles->lifeDuration,
+         begin, end, scaleBegin.y, scaleEnd.y, table);
+   }
+
+   typedef ParticleModifierSoA2D Inherited;
+
+protected:
+   /// Scale of a particle at the beginning of its life.
+   Point2F scaleBegin;
+   /// Scale of a particle at the end of its life.
+   Point2F scaleEnd;
+   /// True if 'progressionTable' should be used rather than a linear progression.
+   bool progressionUse;
+   /// Samples of the progression given to Init.
+   ProgressionTable progressionTable;
+};
+
+//==============================================================================
+
+/// ParticleModifierColorSplineLinearSoA2D sets the color of particles from a
+/// SplineLinear over their lives, like
+/// ParticleEmitterModifierColorSplineLinear2D.
+class ParticleModifierColorSplineLinearSoA2D : public ParticleModifierSoA2D
+{
+public:
+   virtual ~ParticleModifierColorSplineLinearSoA2D() {}
+
+   /// Copy the control points of the given spline.  If '_timeNormalized' is
+   /// true, the times of the spline run from 0 to 1000 over the life of each
+   /// particle.  Otherwise, they're the particle's age in milliseconds.
+   void Init(SplineLinear<ColorRGBA8>* spline, bool _timeNormalized, HeapID heapID = HEAP_DEFAULT)
+   {
+      colorSplineLinear.Init(heapID);
+      if(spline->PointCountGet())
+         colorSplineLinear.PointsAdd(spline->PointsGet(), spline->PointCountGet());
+      timeNormalized = _timeNormalized;
+   }
+   virtual void Deinit() { colorSplineLinear.Deinit(); }
+
+   virtual void OnEmit(ParticleSystemSoA2D* particles, int index) { Update(particles, index, index + 1, 0); }
+   virtual void Update(ParticleSystemSoA2D* particles, int begin, int end, unsigned int /*dt*/)
+   {
+      if(!colorSplineLinear.PointCountGet())
+         return;
+      for(int index = begin; index < end; index++)
+         particles->color[index] = colorSplineLinear.ValueGet(SplineTimeGet(particles, index, timeNormalized));
+   }
+
+   typedef ParticleModifierSoA2D Inherited;
+
+protected:
+   /// Spline which controls the color over the particle's life.
+   SplineLinear<ColorRGBA8> colorSplineLinear;
+   /// True if time should be normalized to the expected life of the particle.
+   bool timeNormalized;
+};
+
+//==============================================================================
+
+/// ParticleModifierScaleSplineLinearSoA2D sets the scale of particles from a
+/// SplineLinear over their lives, like
+/// ParticleEmitterModifierScaleSplineLinear2D.
+class ParticleModifierScaleSplineLinearSoA2D : public ParticleModifierSoA2D
+{
+public:
+   virtual ~ParticleModifierScaleSplineLinearSoA2D() {}
+
+   /// Copy the control points of the given spline.  If '_timeNormalized' is
+   /// true, the times of the spline run from 0 to 1000 over the life of each
+   /// particle.  Otherwise, they're the particle's age in milliseconds.
+   void Init(SplineLinear<Point2F>* spline, bool _timeNormalized, HeapID heapID = HEAP_DEFAULT)
+   {
+      scaleSplineLinear.Init(heapID);
+      if(spline->PointCountGet())
+         scaleSplineLinear.PointsAdd(spline->PointsGet(), spline->PointCountGet());
+      timeNormalized = _timeNormalized;
+   }
+   virtual void Deinit() { scaleSplineLinear.Deinit(); }
+
+   virtual void OnEmit(ParticleSystemSoA2D* particles, int index) { Update(particles, index, index + 1, 0); }
+   virtual void Update(ParticleSystemSoA2D* particles, int begin, int end, unsigned int /*dt*/)
+   {
+      if(!scaleSplineLinear.PointCountGet())
+         return;
+      for(int index = begin; index < end; index++)
+      {
+         Point2F scale = scaleSplineLinear.ValueGet(SplineTimeGet(particles, index, timeNormalized));
+         particles->scaleX[index] = scale.x;
+         particles->scaleY[index] = scale.y;
+      }
+   }
+
+   typedef ParticleModifierSoA2D Inherited;
+
+protected:
+   /// Spline which controls the scale over the particle's life.
+   SplineLinear<Point2F> scaleSplineLinear;
+   /// True if time should be normalized to the expected life of the particle.
+   bool timeNormalized;
+};
+
+//==============================================================================
+
+inline ParticleSystemSoA2D::ParticleSystemSoA2D()
+{
+   block = NULL;
+   size = 0;
+   capacity = 0;
+   lifeAreaEnabled = false;
+}
+
+//------------------------------------------------------------------------------
+
+inline void ParticleSystemSoA2D::Init(int _capacity, HeapID heapID)
+{
+   assert(_capacity >= 0);
+   size = 0;
+   lifeAreaEnabled = false;
+
+   // Pad each array so the next one stays aligned.
+   const int alignmentCount = PARTICLE_SYSTEM_SOA_2D_ALIGNMENT / sizeof(float);
+   capacity = _capacity;
+   int paddedCapacity = (_capacity + alignmentCount - 1) & ~(alignmentCount - 1);
+   if(!paddedCapacity)
+      paddedCapacity = alignmentCount;
+   size_t floatArraySize = paddedCapacity * sizeof(float);
+   size_t int32ArraySize = paddedCapacity * sizeof(int32);
+   size_t colorArraySize = paddedCapacity * sizeof(ColorRGBA8);
+   block = FrogMallocEx(floatArraySize * FLOAT_ARRAY_COUNT + int32ArraySize * INT32_ARRAY_COUNT + colorArraySize,
+      heapID, PARTICLE_SYSTEM_SOA_2D_ALIGNMENT);
+   if(!block)
+   {
+      capacity = 0;
+      return;
+   }
+
+   unsigned char* position = (unsigned char*)block;
+   float** floatArrays[FLOAT_ARRAY_COUNT] = {&positionX, &positionY, &velocityX, &velocityY,
+      &accelerationX, &accelerationY, &rotation, &angularVelocity, &angularAcceleration,
+      &linearDampingLog, &angularDampingLog, &scaleX, &scaleY, &additiveBlending};
+   for(int arrayIndex = 0; arrayIndex < FLOAT_ARRAY_COUNT; arrayIndex++)
+   {
+      *floatArrays[arrayIndex] = (float*)position;
+      position += floatArraySize;
+   }
+   age = (int32*)position;
+   position += int32ArraySize;
+   lifeDuration = (int32*)position;
+   position += int32ArraySize;
+   color = (ColorRGBA8*)position;
+}
+
+//------------------------------------------------------------------------------
+
+inline void ParticleSystemSoA2D::Deinit()
+{
+   if(block)
+      FrogFree(block);
+   block = NULL;
+   size = 0;
+   capacity = 0;
+}
+
+//------------------------------------------------------------------------------
+
+inline int ParticleSystemSoA2D::Add()
+{
+   if(size >= capacity)
+      return -1;
+   int index = size++;
+   positionX[index] = 0.0f;
+   positionY[index] = 0.0f;
+   velocityX[index] = 0.0f;
+   velocityY[index] = 0.0f;
+   accelerationX[index] = 0.0f;
+   accelerationY[index] = 0.0f;
+   rotation[index] = 0.0f;
+   angularVelocity[index] = 0.0f;
+   angularAcceleration[index] = 0.0f;
+   linearDampingLog[index] = 0.0f;
+   angularDampingLog[index] = 0.0f;
+   scaleX[index] = 1.0f;
+   scaleY[index] = 1.0f;
+   additiveBlending[index] = 0.0f;
+   age[index] = 0;
+   lifeDuration[index] = Particle2D::LIFE_DURATION_INDEFINITE;
+   color[index] = COLOR_RGBA8_WHITE;
+   return index;
+}
+
+//------------------------------------------------------------------------------
+
+inline void ParticleSystemSoA2D::Remove(int index)
+{
+   assert((index >= 0) && (index < size));
+   size--;
+   if(index != size)
+      Copy(index, size);
+}
+
+//------------------------------------------------------------------------------
+
+inline int ParticleSystemSoA2D::Update(unsigned int dt)
+{
+   Integrate(0, size, dt);
+   return ExpiredRemove();
+}
+
+//------------------------------------------------------------------------------
+
+inline void ParticleSystemSoA2D::Integrate(int begin, int end, unsigned int dt)
+{
+   float seconds = dt * 0.001f;
+
+   // Each kernel touches only a few arrays, so they're kept separate.
+   ParticleKernels2D::VelocityIntegrate(velocityX, velocityY, accelerationX, accelerationY,
+      linearDampingLog, begin, end, seconds);
+   ParticleKernels2D::PositionIntegrate(positionX, positionY, velocityX, velocityY, begin, end, seconds);
+   ParticleKernels2D::AngularIntegrate(rotation, angularVelocity, angularAcceleration,
+      angularDampingLog, begin, end, seconds);
+   ParticleKernels2D::AgeAdvance(age, begin, end, (int32)dt);
+}
+
+//------------------------------------------------------------------------------
+
+inline int ParticleSystemSoA2D::ExpiredRemove()
+{
+   int sizeBefore = size;
+   // Go backwards so that the particle swapped into a gap has already been checked.
+   for(int index = size - 1; index >= 0; index--)
+   {
+      bool expired = (lifeDuration[index] != Particle2D::LIFE_DURATION_INDEFINITE) && (age[index] >= lifeDuration[index]);
+      if(!expired && lifeAreaEnabled)
+         expired = !lifeArea.ContainsCheck(Point2F::Create(positionX[index], positionY[index]));
+      if(expired)
+         Remove(index);
+   }
+   return sizeBefore - size;
+}
+
+//------------------------------------------------------------------------------
+
+inline void ParticleSystemSoA2D::Copy(int destination, int source)
+{
+   positionX[destination] = positionX[source];
+   positionY[destination] = positionY[source];
+   velocityX[destination] = velocityX[source];
+   velocityY[destination] = velocityY[source];
+   accelerationX[destination] = accelerationX[source];
+   accelerationY[destination] = accelerationY[source];
+   rotation[destination] = rotation[source];
+   angularVelocity[destination] = angularVelocity[source];
+   angularAcceleration[destination] = angularAcceleration[source];
+   linearDampingLog[destination] = linearDampingLog[source];
+   angularDampingLog[destination] = angularDampingLog[source];
+   scaleX[destination] = scaleX[source];
+   scaleY[destination] = scaleY[source];
+   additiveBlending[destination] = additiveBlending[source];
+   age[destination] = age[source];
+   lifeDuration[destination] = lifeDuration[source];
+   color[destination] = color[source];
+}
+
+//------------------------------------------------------------------------------
+
+} //namespace Webfoot {
+
+#endif //#ifndef __FROG__PARTICLESYSTEMSOA2D_H__
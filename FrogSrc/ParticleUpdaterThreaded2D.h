@@ -0,0 +1,295 @@
+#ifndef __FROG__PARTICLEUPDATERTHREADED2D_H__
+#define __FROG__PARTICLEUPDATERTHREADED2D_H__
+
+#include "FrogMemory.h"
+#include "Debug.h"
+#include "Table.h"
+#include "ThreadPool.h"
+#include "ParticleEmitter2D.h"
+#include "ParticleEffect2D.h"
+
+namespace Webfoot {
+
+/// Default seed from which ParticleUpdaterThreaded2D derives the seeds of
+/// the emitters it updates.
+#define PARTICLE_UPDATER_THREADED_2D_SEED_DEFAULT 0x2545F491
+
+//==============================================================================
+
+/// ParticleUpdaterThreaded2D updates a set of ParticleEffect2Ds on a
+/// ThreadPool.  Instead of calling ParticleEffect2D::Update, it calls Update
+/// on the emitters of each effect as separate jobs, so the work of a scene
+/// with many effects, or one effect with many emitters, is spread across
+/// the processors.  Drawing still happens on the calling thread, in the order
+/// the effects were added.
+///
+/// Emitters that don't have a private seed use the global random number
+/// generator, which isn't thread-safe and would make the results depend on
+/// the order in which the jobs run.  Add therefore gives every emitter of the
+/// effect its own seed with ParticleEmitter2D::SeedSet, and Update does the
+/// same for any emitter without one, such as an emitter added to the effect
+/// later.  The seeds depend only on the updater's seed, the order in which
+/// effects are added, and the index of each emitter in its effect, so the
+/// same effects added in the same order produce exactly the same particles
+/// with any number of threads, including none.
+///
+/// By default, all the emitters of an effect are updated by the same job,
+/// since an emitter may share the particles of another emitter in the same
+/// effect.  If the emitters of an effect are known to be independent, pass
+/// true for 'emittersIndependent' to let each one run separately.
+///
+/// While Update runs, the emitters and their particles must only allocate
+/// from thread-safe heaps, and particle effects owned by individual
+/// particles, like trails, must also use private seeds.  Effects should not
+/// be updated elsewhere as well, so don't add effects owned by
+/// ParticleEffectWidgets or AnimatedBackgrounds, which update their own.
+class ParticleUpdaterThreaded2D
+{
+public:
+   ParticleUpdaterThreaded2D() { seed = PARTICLE_UPDATER_THREADED_2D_SEED_DEFAULT; seedIndexNext = 0; dt = 0; }
+
+   /// Start the given number of worker threads.  If 'threadCount' is
+   /// negative, use one fewer than the number of processors, since the
+   /// thread that calls Update does work as well.  With 0, everything is
+   /// updated on the calling thread.
+   void Init(int threadCount = -1, HeapID heapID = HEAP_DEFAULT);
+   /// Stop the worker threads.  The effects are not deinitialized.
+   void Deinit();
+
+   /// Add the given effect to the set that is updated and drawn, and give its
+   /// emitters their own seeds.  If 'emittersIndependent' is true, the
+   /// emitters may be updated concurrently.
+   void Add(ParticleEffect2D* effect, bool emittersIndependent = false);
+   /// Remove the given effect without deinitializing it.  Return true if it
+   /// was found.
+   bool Remove(ParticleEffect2D* effect);
+   /// Remove all effects without deinitializing them.
+   void Clear() { effects.Clear(); }
+
+   /// Update all the effects, and return once they're done.  Emitters
+   /// without a private seed are given one first.
+   void Update(unsigned int _dt);
+   /// Draw all the effects in the order they were added.
+   void Draw();
+
+   /// Set the seed from which the seeds of emitters in effects added after
+   /// this are derived, and start the sequence over.
+   void SeedSet(unsigned int _seed) { seed = _seed; seedIndexNext = 0; }
+   /// Give the emitters of the given effect seeds derived from the given
+   /// seed and index.
+   static void EffectSeed(ParticleEffect2D* effect, unsigned int seed, unsigned int seedIndex);
+   /// Give the emitter with the given index in its effect the seed that
+   /// EffectSeed would give it.
+   static void EmitterSeed(ParticleEmitter2D* emitter, unsigned int seed, unsigned int seedIndex, int emitterIndex);
+
+   /// Return the number of effects.
+   int EffectCountGet() { return effects.SizeGet(); }
+   /// Return the number of worker threads.
+   int ThreadCountGet() { return threadPool.ThreadCountGet(); }
+
+protected:
+   /// An effect being updated.
+   struct Effect
+   {
+      /// Effect to update.
+      ParticleEffect2D* effect;
+      /// True if the emitters can be updated in separate jobs.
+      bool emittersIndependent;
+      /// Seed from which the seeds of the emitters are derived.
+      unsigned int seed;
+      /// Index used with 'seed' to derive the seeds of the emitters.
+      unsigned int seedIndex;
+   };
+
+   /// Part of the work of an update.
+   struct Job
+   {
+      /// Updater running the job.
+      ParticleUpdaterThreaded2D* updater;
+      /// Effect with the emitters to update.
+      ParticleEffect2D* effect;
+      /// Index of the first emitter to update.
+      int emitterBegin;
+      /// Index after the last emitter to update.
+      int emitterEnd;
+   };
+
+   /// Called by the ThreadPool to run a job.
+   static void JobRun(void* userData);
+   /// Return a well-mixed, non-zero value based on the given values.
+   static unsigned int SeedMix(unsigned int seed, unsigned int index, unsigned int part);
+
+   /// Runs the jobs.
+   ThreadPool threadPool;
+   /// Effects to update, in the order they were added.
+   Table<Effect> effects;
+   /// Jobs of the current update.
+   Table<Job> jobs;
+   /// Seed from which the seeds of emitters are derived.
+   unsigned int seed;
+   /// Index used to derive the seeds of the next effect that is added.
+   unsigned int seedIndexNext;
+   /// Number of milliseconds for the current update.
+   unsigned int dt;
+};
+
+//==============================================================================
+
+inline void ParticleUpdaterThreaded2D::Init(int threadCount, HeapID heapID)
+{
+   effects.Init(theAllocatorHeaps[heapID]);
+   jobs.Init(theAllocatorHeaps[heapID]);
+   threadPool.Init(threadCount, heapID);
+   dt = 0;
+}
+
+//------------------------------------------------------------------------------
+
+inline void ParticleUpdaterThreaded2D::Deinit()
+{
+   threadPool.Deinit();
+   jobs.Deinit();
+   effects.Deinit();
+}
+
+//------------------------------------------------------------------------------
+
+inline void ParticleUpdaterThreaded2D::Add(ParticleEffect2D* effect, bool emittersIndependent)
+{
+   assert(effect);
+   Effect item;
+   item.effect = effect;
+   item.emittersIndependent = emittersIndependent;
+   item.seed = seed;
+   item.seedIndex = seedIndexNext;
+   effects.Add(item);
+   EffectSeed(effect, item.seed, item.seedIndex);
+   seedIndexNext++;
+}
+
+//------------------------------------------------------------------------------
+
+inline bool ParticleUpdaterThreaded2D::Remove(ParticleEffect2D* effect)
+{
+   int effectCount = effects.SizeGet();
+   for(int effectIndex = 0; effectIndex < effectCount; effectIndex++)
+   {
+      if(effects[effectIndex].effect == effect)
+      {
+         effects.RemoveIndex(effectIndex);
+         return true;
+      }
+   }
+   return false;
+}
+
+//------------------------------------------------------------------------------
+
+inline void ParticleUpdaterThreaded2D::Update(unsigned int _dt)
+{
+   dt = _dt;
+
+   // Jobs are rebuilt on every update, since emitters can be added to and
+   // removed from the effects at any time.
+   jobs.Clear();
+   int effectCount = effects.SizeGet();
+   for(int effectIndex = 0; effectIndex < effectCount; effectIndex++)
+   {
+      Effect& item = effects[effectIndex];
+      int emitterCount = item.effect->EmitterCountGet();
+      // Emitters added to the effect since it was added here would
+      // otherwise fall back to the global random number generator.
+      for(int emitterIndex = 0; emitterIndex < emitterCount; emitterIndex++)
+      {
+         ParticleEmitter2D* emitter = item.effect->EmitterGet(emitterIndex);
+         if(!emitter->SeedCheck())
+            EmitterSeed(emitter, item.seed, item.seedIndex, emitterIndex);
+      }
+
+      Job job;
+      job.updater = this;
+      job.effect = item.effect;
+      if(item.emittersIndependent)
+      {
+         for(int emitterIndex = 0; emitterIndex < emitterCount; emitterIndex++)
+         {
+            job.emitterBegin = emitterIndex;
+            job.emitterEnd = emitterIndex + 1;
+            jobs.Add(job);
+         }
+      }
+      else if(emitterCount)
+      {
+         job.emitterBegin = 0;
+         job.emitterEnd = emitterCount;
+         jobs.Add(job);
+      }
+   }
+
+   // The table isn't changed again until the jobs are finished, so pointers
+   // into it stay valid.
+   int jobCount = jobs.SizeGet();
+   for(int jobIndex = 0; jobIndex < jobCount; jobIndex++)
+      threadPool.Add(JobRun, &jobs[jobIndex]);
+   threadPool.Wait();
+}
+
+//------------------------------------------------------------------------------
+
+inline void ParticleUpdaterThreaded2D::Draw()
+{
+   int effectCount = effects.SizeGet();
+   for(int effectIndex = 0; effectIndex < effectCount; effectIndex++)
+      effects[effectIndex].effect->Draw();
+}
+
+//------------------------------------------------------------------------------
+
+inline void ParticleUpdaterThreaded2D::EffectSeed(ParticleEffect2D* effect, unsigned int seed, unsigned int seedIndex)
+{
+   assert(effect);
+   int emitterCount = effect->EmitterCountGet();
+   for(int emitterIndex = 0; emitterIndex < emitterCount; emitterIndex++)
+      EmitterSeed(effect->EmitterGet(emitterIndex), seed, seedIndex, emitterIndex);
+}
+
+//------------------------------------------------------------------------------
+
+inline void ParticleUpdaterThreaded2D::EmitterSeed(ParticleEmitter2D* emitter, unsigned int seed,
+   unsigned int seedIndex, int emitterIndex)
+{
+   assert(emitter);
+   // Give each emitter a separate stream, even within one effect.
+   unsigned int emitterSeed = SeedMix(seed, seedIndex, (unsigned int)emitterIndex);
+   emitter->SeedSet(SeedMix(emitterSeed, 0, 1), SeedMix(emitterSeed, 0, 2));
+}
+
+//------------------------------------------------------------------------------
+
+inline void ParticleUpdaterThreaded2D::JobRun(void* userData)
+{
+   Job* job = (Job*)userData;
+   for(int emitterIndex = job->emitterBegin; emitterIndex < job->emitterEnd; emitterIndex++)
+      job->effect->EmitterGet(emitterIndex)->Update(job->updater->dt);
+}
+
+//------------------------------------------------------------------------------
+
+inline unsigned int ParticleUpdaterThreaded2D::SeedMix(unsigned int seed, unsigned int index, unsigned int part)
+{
+   // Combine the values, then scramble them with the MurmurHash3 finalizer.
+   unsigned int value = seed ^ (index * 0x9E3779B9U) ^ (part * 0x85EBCA6BU);
+   value ^= value >> 16;
+   value *= 0x85EBCA6BU;
+   value ^= value >> 13;
+   value *= 0xC2B2AE35U;
+   value ^= value >> 16;
+   // Some generators get stuck on a seed of 0.
+   return value ? value : 1;
+}
+
+//------------------------------------------------------------------------------
+
+} //namespace Webfoot {
+
+#endif //#ifndef __FROG__PARTICLEUPDATERTHREADED2D_H__
@@ -183,6 +183,50 @@ ProgressionBounceStop* const theProgressionBounceStop = &ProgressionBounceStop::
 
 //==============================================================================
 
+//Number of intervals sampled by a ProgressionTable.
+#define PROGRESSION_TABLE_SIZE 64
+
+/// ProgressionTable stores samples of a Progression so that it can be
+/// evaluated without a virtual call, and for many values at once, by
+/// interpolating linearly between the samples.
+class ProgressionTable
+{
+public:
+   /// Sample the given progression.  If it is NULL, the table will be linear.
+   void Init(Progression* progression)
+   {
+      for(int sampleIndex = 0; sampleIndex <= PROGRESSION_TABLE_SIZE; sampleIndex++)
+      {
+         float t = (float)sampleIndex / (float)PROGRESSION_TABLE_SIZE;
+         values[sampleIndex] = progression ? progression->ValueGet(t) : t;
+      }
+   }
+
+   /// Return an approximation of the sampled progression's value for 't'.
+   float ValueGet(float t) const
+   {
+      if(t < 0.0f)
+         t = 0.0f;
+      if(t > 1.0f)
+         t = 1.0f;
+      float position = t * (float)PROGRESSION_TABLE_SIZE;
+      int sampleIndex = (int)position;
+      if(sampleIndex > PROGRESSION_TABLE_SIZE - 1)
+         sampleIndex = PROGRESSION_TABLE_SIZE - 1;
+      float fraction = position - (float)sampleIndex;
+      return values[sampleIndex] + (values[sampleIndex + 1] - values[sampleIndex]) * fraction;
+   }
+
+   /// Return the PROGRESSION_TABLE_SIZE + 1 samples, evenly spaced from 0 to 1.
+   const float* ValuesGet() const { return values; }
+
+protected:
+   /// Samples of the progression.
+   float values[PROGRESSION_TABLE_SIZE + 1];
+};
+
+//==============================================================================
+
 } //namespace Webfoot {
 
 #endif //#ifndef __FROG__PROGRESSION_H__
@@ -0,0 +1,206 @@
+#ifndef __FROG__RECTANGLEPACKERMAXRECTS_H__
+#define __FROG__RECTANGLEPACKERMAXRECTS_H__
+
+#include "FrogMemory.h"
+#include "Debug.h"
+#include "Table.h"
+#include "Point2.h"
+#include "Box2.h"
+
+namespace Webfoot {
+
+//==============================================================================
+
+/// RectanglePackerMaxRects places rectangles in a bin of fixed size using the
+/// MaxRects algorithm.  It keeps the list of maximal free rectangles, which
+/// may overlap, and puts each new rectangle in the free rectangle where it
+/// leaves the shortest leftover side.  Rectangles are never rotated.
+///
+/// Rectangles are placed in the order they're inserted, and the results are
+/// considerably better when larger rectangles are inserted first.
+class RectanglePackerMaxRects
+{
+public:
+   /// Prepare to pack rectangles into a bin of the given size.
+   void Init(const Point2I& _binSize, HeapID heapID = HEAP_DEFAULT)
+   {
+      freeBoxes.Init(theAllocatorHeaps[heapID]);
+      Reset(_binSize);
+   }
+   /// Clean up.
+   void Deinit() { freeBoxes.Deinit(); }
+
+   /// Remove all the rectangles and use a bin of the given size.
+   void Reset(const Point2I& _binSize)
+   {
+      assert((_binSize.x > 0) && (_binSize.y > 0));
+      binSize = _binSize;
+      usedArea = 0;
+      usedExtent = Point2I::Create(0, 0);
+      freeBoxes.Clear();
+      freeBoxes.Add(Box2I::Create(0, 0, binSize.x, binSize.y));
+   }
+
+   /// Find a place for a rectangle of the given size and write it to
+   /// 'result'.  Return false if it doesn't fit.
+   bool Insert(const Point2I& size, Box2I* result);
+   /// Return true if a rectangle of the given size would fit.
+   bool FitCheck(const Point2I& size) { return FreeBoxFind(size) != -1; }
+
+   /// Return the size of the bin.
+   Point2I BinSizeGet() { return binSize; }
+   /// Return the total area of the rectangles inserted.
+   int64 UsedAreaGet() { return usedArea; }
+   /// Return the size of the smallest area at the top-left of the bin that
+   /// contains all the rectangles inserted.
+   Point2I UsedExtentGet() { return usedExtent; }
+   /// Return the fraction of the bin covered by rectangles.
+   float OccupancyGet() { return (float)((double)usedArea / ((double)binSize.x * binSize.y)); }
+
+protected:
+   /// Return the index of the free rectangle where a rectangle of the given
+   /// size should go, or -1 if it doesn't fit anywhere.
+   int FreeBoxFind(const Point2I& size);
+   /// If 'freeBox' overlaps 'usedBox', add the parts of 'freeBox' that
+   /// remain free, and return true.
+   bool FreeBoxSplit(const Box2I& freeBox, const Box2I& usedBox);
+   /// Remove free rectangles that are contained by other free rectangles.
+   void FreeBoxesPrune();
+   /// Return true if 'inner' is entirely within 'outer'.
+   static bool ContainedCheck(const Box2I& inner, const Box2I& outer)
+   {
+      return (inner.x >= outer.x) && (inner.y >= outer.y)
+         && ((inner.x + inner.width) <= (outer.x + outer.width))
+         && ((inner.y + inner.height) <= (outer.y + outer.height));
+   }
+
+   /// Size of the bin.
+   Point2I binSize;
+   /// Total area of the rectangles inserted.
+   int64 usedArea;
+   /// See 'UsedExtentGet'.
+   Point2I usedExtent;
+   /// Maximal rectangles of free space.
+   Table<Box2I> freeBoxes;
+};
+
+//==============================================================================
+
+inline bool RectanglePackerMaxRects::Insert(const Point2I& size, Box2I* result)
+{
+   assert(result);
+   int freeBoxIndex = FreeBoxFind(size);
+   if(freeBoxIndex == -1)
+      return false;
+
+   Box2I usedBox = Box2I::Create(freeBoxes[freeBoxIndex].x, freeBoxes[freeBoxIndex].y, size.x, size.y);
+
+   // Replace each free rectangle that overlaps the new one with the parts
+   // that are still free.  New pieces are added to the end, and they never
+   // overlap the new rectangle, so they don't need to be checked.  The free
+   // rectangle is copied, since adding pieces can move the table.
+   int freeBoxCount = freeBoxes.SizeGet();
+   for(int index = 0; index < freeBoxCount; index++)
+   {
+      Box2I freeBox = freeBoxes[index];
+      if(FreeBoxSplit(freeBox, usedBox))
+      {
+         freeBoxes.RemoveIndex(index);
+         index--;
+         freeBoxCount--;
+      }
+   }
+   FreeBoxesPrune();
+
+   usedArea += (int64)size.x * size.y;
+   if(usedExtent.x < usedBox.x + usedBox.width)
+      usedExtent.x = usedBox.x + usedBox.width;
+   if(usedExtent.y < usedBox.y + usedBox.height)
+      usedExtent.y = usedBox.y + usedBox.height;
+   *result = usedBox;
+   return true;
+}
+
+//------------------------------------------------------------------------------
+
+inline int RectanglePackerMaxRects::FreeBoxFind(const Point2I& size)
+{
+   // Best short side fit, with ties broken by the long side.
+   int bestIndex = -1;
+   int bestShortSide = 0;
+   int bestLongSide = 0;
+   int freeBoxCount = freeBoxes.SizeGet();
+   for(int index = 0; index < freeBoxCount; index++)
+   {
+      const Box2I& freeBox = freeBoxes[index];
+      if((freeBox.width < size.x) || (freeBox.height < size.y))
+         continue;
+      int leftoverX = freeBox.width - size.x;
+      int leftoverY = freeBox.height - size.y;
+      int shortSide = (leftoverX < leftoverY) ? leftoverX : leftoverY;
+      int longSide = (leftoverX < leftoverY) ? leftoverY : leftoverX;
+      if((bestIndex == -1) || (shortSide < bestShortSide)
+         || ((shortSide == bestShortSide) && (longSide < bestLongSide)))
+      {
+         bestIndex = index;
+         bestShortSide = shortSide;
+         bestLongSide = longSide;
+      }
+   }
+   return bestIndex;
+}
+
+//------------------------------------------------------------------------------
+
+inline bool RectanglePackerMaxRects::FreeBoxSplit(const Box2I& freeBox, const Box2I& usedBox)
+{
+   int freeRight = freeBox.x + freeBox.width;
+   int freeBottom = freeBox.y + freeBox.height;
+   int usedRight = usedBox.x + usedBox.width;
+   int usedBottom = usedBox.y + usedBox.height;
+   if((usedBox.x >= freeRight) || (usedRight <= freeBox.x) || (usedBox.y >= freeBottom) || (usedBottom <= freeBox.y))
+      return false;
+
+   // Each side of the used rectangle that lies inside the free one leaves a
+   // maximal free rectangle on that side.
+   if(usedBox.x > freeBox.x)
+      freeBoxes.Add(Box2I::Create(freeBox.x, freeBox.y, usedBox.x - freeBox.x, freeBox.height));
+   if(usedRight < freeRight)
+      freeBoxes.Add(Box2I::Create(usedRight, freeBox.y, freeRight - usedRight, freeBox.height));
+   if(usedBox.y > freeBox.y)
+      freeBoxes.Add(Box2I::Create(freeBox.x, freeBox.y, freeBox.width, usedBox.y - freeBox.y));
+   if(usedBottom < freeBottom)
+      freeBoxes.Add(Box2I::Create(freeBox.x, usedBottom, freeBox.width, freeBottom - usedBottom));
+   return true;
+}
+
+//------------------------------------------------------------------------------
+
+inline void RectanglePackerMaxRects::FreeBoxesPrune()
+{
+   // Order doesn't matter, so removals move the last rectangle into the gap,
+   // and the index is checked again.
+   for(int indexA = 0; indexA < freeBoxes.SizeGet(); indexA++)
+   {
+      for(int indexB = indexA + 1; indexB < freeBoxes.SizeGet(); indexB++)
+      {
+         if(ContainedCheck(freeBoxes[indexA], freeBoxes[indexB]))
+         {
+            freeBoxes.RemoveIndexUnordered(indexA);
+            indexA--;
+            break;
+         }
+         if(ContainedCheck(freeBoxes[indexB], freeBoxes[indexA]))
+         {
+            freeBoxes.RemoveIndexUnordered(indexB);
+            indexB--;
+         }
+      }
+   }
+}
+
+//------------------------------------------------------------------------------
+
+} //namespace Webfoot {
+
+#endif //#ifndef __FROG__RECTANGLEPACKERMAXRECTS_H__
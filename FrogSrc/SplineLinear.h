@@ -67,6 +67,11 @@ public:
    /// Return the duration of the spline in milliseconds.
    unsigned int DurationGet();
 
+   /// Return the number of control points.
+   int PointCountGet() { return controlPoints.SizeGet(); }
+   /// Return the control points, which are in order by time.
+   SplineLinearControlPoint<T>* PointsGet() { return controlPoints.SizeGet() ? &controlPoints[0] : NULL; }
+
 protected:
    Table<SplineLinearControlPoint<T> > controlPoints;
 };
@@ -2,6 +2,7 @@
 #define __FROG__SPRITEANIMATION_H__
 
 #include "FrogMemory.h"
+#include "Utility.h"
 #include "Point2.h"
 #include "Box2.h"
 #include "Table.h"
@@ -102,6 +103,8 @@ public:
       Image* sourceImage;
    };
 
+   /// Return the number of frames.
+   int FrameCountGet() { return frames.SizeGet(); }
    /// Return the index of the frame to display at the given time.
    int FrameIndexGet(unsigned int time);
    /// Return the frame with the given index.  SpriteAnimations and their
@@ -109,6 +112,15 @@ public:
    /// your own risk.
    Frame* FrameGetByIndex(int frameIndex);
 
+   /// Set 'buffer' to the name of the image file, without the extension, of
+   /// the image with the given number in the numbered sequence of frames
+   /// named 'animationFilename'.  This is the name FrameLoad uses for the
+   /// image, and the numbers start at 1.  Return true if successful.
+   static bool SequenceFrameFilenameGet(char* buffer, size_t bufferSize, const char* animationFilename, int imageNumber)
+   {
+      return FrogSnprintf(buffer, bufferSize, "%s/%03d", animationFilename, imageNumber);
+   }
+
    /// Return the sum of all offsets applied to the image at the given frame of the animation.
    /// Until frames have individual offsets, this is simply the animationOffset.
    Point2F FrameOffsetGet(int frameIndex) { (void)frameIndex; return animationOffset; }
@@ -0,0 +1,497 @@
+#ifndef __FROG__SPRITEBATCH_H__
+#define __FROG__SPRITEBATCH_H__
+
+#include "FrogMemory.h"
+#include "Debug.h"
+#include "Table.h"
+#include "Point2.h"
+#include "Point3.h"
+#include "Box2.h"
+#include "Color.h"
+#include "Matrix43.h"
+#include "Texture.h"
+#include "ImageCommon.h"
+
+namespace Webfoot {
+
+//Default maximum number of quads held by the vertex buffer of a SpriteBatch.
+#define SPRITE_BATCH_QUAD_CAPACITY_DEFAULT 4096
+//Number of parts into which the vertex buffer of a SpriteBatch is divided,
+//so the CPU can write one while the GPU reads the others.
+#define SPRITE_BATCH_REGION_COUNT 3
+//Maximum number of vertices in the buffer, so they can be indexed with 16 bits.
+#define SPRITE_BATCH_VERTEX_COUNT_MAX 65536
+
+//==============================================================================
+
+/// A vertex as it is written to the buffer of a SpriteBatch.
+struct SpriteBatchVertex
+{
+   /// Position after the transform is applied.
+   float x;
+   float y;
+   float z;
+   /// Texture coordinates.
+   float s;
+   float t;
+   /// Color with the alpha premultiplied and additive blending applied.
+   ColorRGBA8 color;
+};
+
+//==============================================================================
+
+/// Drawing state shared by all the quads of a single draw call.
+struct SpriteBatchState
+{
+   /// Texture of the quads.
+   Texture* texture;
+   /// Mask texture, or NULL if the quads aren't masked.
+   Texture* maskTexture;
+   /// Mask matrix for the mask texture.
+   Matrix43 maskMatrix;
+};
+
+//==============================================================================
+
+/// SpriteBatchBackend is the interface through which a SpriteBatch reaches
+/// the graphics API.  SpriteBatchBackendOpenGL is the normal implementation,
+/// and SpriteBatchBackendRecording draws nothing but remembers what it was
+/// asked to do, so batching can be checked without a graphics context.
+class SpriteBatchBackend
+{
+public:
+   virtual ~SpriteBatchBackend() {}
+
+   /// Create a vertex buffer of the given size in bytes, and return a pointer
+   /// through which it can be written for as long as it exists.  Return NULL
+   /// if unsuccessful.
+   virtual void* VertexBufferCreate(size_t size) = 0;
+   /// Destroy the vertex buffer.
+   virtual void VertexBufferDestroy() = 0;
+
+   /// Draw the given number of quads, beginning with the given vertex, using
+   /// the given state.  Each quad is 4 vertices in the order top-left,
+   /// top-right, bottom-right, bottom-left.
+   virtual void QuadsDraw(const SpriteBatchState& state, int vertexFirst, int quadCount) = 0;
+
+   /// Called once all the draws that read the given region of the buffer
+   /// have been issued.
+   virtual void RegionFence(int regionIndex) = 0;
+   /// Wait until the draws that read the given region of the buffer are
+   /// finished, so it can be overwritten.
+   virtual void RegionWait(int regionIndex) = 0;
+};
+
+//==============================================================================
+
+/// SpriteBatch collects textured quads and draws consecutive quads that share
+/// a texture and mask with a single draw call.  The vertices are written
+/// directly into a buffer that stays mapped, which is divided into
+/// SPRITE_BATCH_REGION_COUNT regions used in turn, so the GPU can still be
+/// reading earlier ones.  Quads are drawn when the state changes, when a
+/// region fills up, or when Flush or End is called.
+///
+/// Additive blending is baked into each vertex's premultiplied color, just
+/// as ScreenOpenGL::ColorPremultiplyAlphaSet does, so quads with different
+/// amounts of additive blending can still share a draw call.
+///
+/// Quads are drawn in the order they are added, so to get the most out of a
+/// batch, draw things that share a texture together, or pack them into a
+/// shared texture.
+///
+///  spriteBatch.Begin();
+///  spriteBatch.ImageDraw(image, position);
+///  ...
+///  spriteBatch.End();
+class SpriteBatch
+{
+public:
+   SpriteBatch();
+
+   /// Prepare to draw through the given backend with room for the given
+   /// number of quads at a time.
+   void Init(SpriteBatchBackend* _backend, int _quadCapacity = SPRITE_BATCH_QUAD_CAPACITY_DEFAULT);
+   /// Clean up.
+   void Deinit();
+
+   /// Call before adding the quads for a frame.
+   void Begin();
+   /// Draw anything that is pending and finish using the current region of
+   /// the buffer.  Call this after the quads for a frame have been added.
+   void End();
+   /// Draw anything that is pending.  Call this before drawing anything
+   /// without the batch that must appear on top of what has been added.
+   void Flush();
+
+   /// Add a quad with the same layout as ScreenOpenGL::QuadTexturedDraw.
+   /// 'vertexBuffer' should point to 4 groups of 5 floats, with the x, y, and
+   /// z of the position followed by the s and t texture coordinates.  If
+   /// 'transform' is given, it is applied to the positions.
+   void QuadAdd(const float* vertexBuffer, Texture* texture, const ColorRGBA8& color = COLOR_RGBA8_WHITE,
+      float additiveBlending = 0.0f, const Matrix43* transform = NULL);
+   /// Add the quads for the given Image with its origin at 'position', like
+   /// ImageOpenGL::Draw.
+   void ImageDraw(ImageCommon* image, const Point2F& position = Point2F::Create(0.0f, 0.0f),
+      const ColorRGBA8& color = COLOR_RGBA8_WHITE, float depth = 0.0f, float additiveBlending = 0.0f,
+      const Matrix43* transform = NULL);
+
+   /// Use the given mask for quads added after this.  Pass NULL to stop
+   /// masking.
+   void MaskSet(Texture* _maskTexture, const Matrix43& _maskMatrix);
+
+   /// Return the number of draw calls made since the last StatisticsReset.
+   int DrawCallCountGet() { return drawCallCount; }
+   /// Return the number of quads drawn since the last StatisticsReset.
+   int QuadCountGet() { return quadCount; }
+   /// Return the number of bytes of vertices written since the last
+   /// StatisticsReset.
+   size_t ByteCountGet() { return byteCount; }
+   /// Reset the draw call, quad, and byte counts.
+   void StatisticsReset() { drawCallCount = 0; quadCount = 0; byteCount = 0; }
+
+protected:
+   /// Finish using the current region of the buffer and wait for the next
+   /// one to be available.
+   void RegionAdvance();
+   /// Return the given color premultiplied by its alpha, with the alpha
+   /// reduced according to 'additiveBlending'.
+   static ColorRGBA8 ColorPremultiply(const ColorRGBA8& color, float additiveBlending);
+
+   /// Backend that does the drawing.
+   SpriteBatchBackend* backend;
+   /// Mapped vertex buffer.
+   SpriteBatchVertex* vertices;
+   /// Number of quads in each region of the buffer.
+   int regionQuadCapacity;
+   /// Index of the region currently being written.
+   int regionIndex;
+   /// Number of quads written to the current region.
+   int regionQuadCount;
+
+   /// State of the quads waiting to be drawn.
+   SpriteBatchState state;
+   /// Index of the first vertex waiting to be drawn.
+   int pendingVertexFirst;
+   /// Number of quads waiting to be drawn.
+   int pendingQuadCount;
+
+   /// Number of draw calls since the last StatisticsReset.
+   int drawCallCount;
+   /// Number of quads drawn since the last StatisticsReset.
+   int quadCount;
+   /// Number of bytes of vertices written since the last StatisticsReset.
+   size_t byteCount;
+};
+
+//==============================================================================
+
+/// SpriteBatchBackendRecording keeps the vertices in main memory and records
+/// each draw call instead of drawing anything.
+class SpriteBatchBackendRecording : public SpriteBatchBackend
+{
+public:
+   /// Details of a call to QuadsDraw.
+   struct DrawCall
+   {
+      /// State of the draw.
+      SpriteBatchState state;
+      /// First vertex drawn.
+      int vertexFirst;
+      /// Number of quads drawn.
+      int quadCount;
+   };
+
+   SpriteBatchBackendRecording() { buffer = NULL; bufferSize = 0; regionWaitCount = 0; regionFenceCount = 0; }
+   virtual ~SpriteBatchBackendRecording() {}
+
+   /// Prepare to make allocations from the given heap.
+   void Init(HeapID _heapID = HEAP_DEFAULT)
+   {
+      heapID = _heapID;
+      drawCalls.Init(theAllocatorHeaps[heapID]);
+      regionWaitCount = 0;
+      regionFenceCount = 0;
+   }
+   /// Clean up.
+   void Deinit()
+   {
+      VertexBufferDestroy();
+      drawCalls.Deinit();
+   }
+
+   virtual void* VertexBufferCreate(size_t size)
+   {
+      VertexBufferDestroy();
+      buffer = FrogMallocEx(size, heapID, FROG_MEM_ALIGN);
+      bufferSize = buffer ? size : 0;
+      return buffer;
+   }
+   virtual void VertexBufferDestroy()
+   {
+      if(buffer)
+         FrogFree(buffer);
+      buffer = NULL;
+      bufferSize = 0;
+   }
+   virtual void QuadsDraw(const SpriteBatchState& state, int vertexFirst, int quadCount)
+   {
+      DrawCall drawCall;
+      drawCall.state = state;
+      drawCall.vertexFirst = vertexFirst;
+      drawCall.quadCount = quadCount;
+      drawCalls.Add(drawCall);
+   }
+   virtual void RegionFence(int /*regionIndex*/) { regionFenceCount++; }
+   virtual void RegionWait(int /*regionIndex*/) { regionWaitCount++; }
+
+   /// Return the number of draw calls recorded.
+   int DrawCallCountGet() { return drawCalls.SizeGet(); }
+   /// Return the given recorded draw call.
+   const DrawCall& DrawCallGet(int drawCallIndex) { return drawCalls[drawCallIndex]; }
+   /// Return the vertex with the given index.
+   const SpriteBatchVertex& VertexGet(int vertexIndex) { return ((SpriteBatchVertex*)buffer)[vertexIndex]; }
+   /// Return the number of bytes of vertices referenced by the recorded draw
+   /// calls.
+   size_t ByteCountGet()
+   {
+      size_t byteCount = 0;
+      for(int drawCallIndex = 0; drawCallIndex < drawCalls.SizeGet(); drawCallIndex++)
+         byteCount += (size_t)drawCalls[drawCallIndex].quadCount * 4 * sizeof(SpriteBatchVertex);
+      return byteCount;
+   }
+   /// Return the number of times RegionWait was called.
+   int RegionWaitCountGet() { return regionWaitCount; }
+   /// Return the number of times RegionFence was called.
+   int RegionFenceCountGet() { return regionFenceCount; }
+   /// Forget the recorded draw calls and counts.
+   void Clear() { drawCalls.Clear(); regionWaitCount = 0; regionFenceCount = 0; }
+
+protected:
+   /// Heap for allocations.
+   HeapID heapID;
+   /// Vertex buffer in main memory.
+   void* buffer;
+   /// Size of 'buffer' in bytes.
+   size_t bufferSize;
+   /// Draw calls recorded so far.
+   Table<DrawCall> drawCalls;
+   /// Number of times RegionWait was called.
+   int regionWaitCount;
+   /// Number of times RegionFence was called.
+   int regionFenceCount;
+};
+
+//==============================================================================
+
+inline SpriteBatch::SpriteBatch()
+{
+   backend = NULL;
+   vertices = NULL;
+   regionQuadCapacity = 0;
+   regionIndex = 0;
+   regionQuadCount = 0;
+   pendingVertexFirst = 0;
+   pendingQuadCount = 0;
+   drawCallCount = 0;
+   quadCount = 0;
+   byteCount = 0;
+}
+
+//------------------------------------------------------------------------------
+
+inline void SpriteBatch::Init(SpriteBatchBackend* _backend, int _quadCapacity)
+{
+   assert(_backend);
+   assert(_quadCapacity >= SPRITE_BATCH_REGION_COUNT);
+   backend = _backend;
+   regionQuadCapacity = _quadCapacity / SPRITE_BATCH_REGION_COUNT;
+   if(regionQuadCapacity * SPRITE_BATCH_REGION_COUNT * 4 > SPRITE_BATCH_VERTEX_COUNT_MAX)
+      regionQuadCapacity = SPRITE_BATCH_VERTEX_COUNT_MAX / (SPRITE_BATCH_REGION_COUNT * 4);
+   size_t bufferSize = (size_t)regionQuadCapacity * SPRITE_BATCH_REGION_COUNT * 4 * sizeof(SpriteBatchVertex);
+   vertices = (SpriteBatchVertex*)backend->VertexBufferCreate(bufferSize);
+   if(!vertices)
+      WarningPrintf("SpriteBatch::Init -- Unable to create a vertex buffer of %d bytes.\n", (int)bufferSize);
+
+   regionIndex = 0;
+   regionQuadCount = 0;
+   state.texture = NULL;
+   state.maskTexture = NULL;
+   state.maskMatrix = Matrix43::Create(1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, MatrixFlag_Identity);
+   pendingVertexFirst = 0;
+   pendingQuadCount = 0;
+   StatisticsReset();
+}
+
+//------------------------------------------------------------------------------
+
+inline void SpriteBatch::Deinit()
+{
+   if(backend)
+   {
+      Flush();
+      backend->VertexBufferDestroy();
+   }
+   backend = NULL;
+   vertices = NULL;
+}
+
+//------------------------------------------------------------------------------
+
+inline void SpriteBatch::Begin()
+{
+   Flush();
+   state.texture = NULL;
+   state.maskTexture = NULL;
+}
+
+//------------------------------------------------------------------------------
+
+inline void SpriteBatch::End()
+{
+   // Move on to the next region, so the next frame doesn't write vertices
+   // this one may still be reading.
+   if(regionQuadCount)
+      RegionAdvance();
+}
+
+//------------------------------------------------------------------------------
+
+inline void SpriteBatch::Flush()
+{
+   if(!pendingQuadCount)
+      return;
+   backend->QuadsDraw(state, pendingVertexFirst, pendingQuadCount);
+   drawCallCount++;
+   quadCount += pendingQuadCount;
+   pendingQuadCount = 0;
+}
+
+//------------------------------------------------------------------------------
+
+inline void SpriteBatch::QuadAdd(const float* vertexBuffer, Texture* texture, const ColorRGBA8& color,
+   float additiveBlending, const Matrix43* transform)
+{
+   assert(vertexBuffer);
+   if(!vertices)
+      return;
+
+   if(pendingQuadCount && (texture != state.texture))
+      Flush();
+   if(regionQuadCount >= regionQuadCapacity)
+      RegionAdvance();
+
+   int vertexIndex = ((regionIndex * regionQuadCapacity) + regionQuadCount) * 4;
+   if(!pendingQuadCount)
+   {
+      state.texture = texture;
+      pendingVertexFirst = vertexIndex;
+   }
+
+   ColorRGBA8 colorPremultiplied = ColorPremultiply(color, additiveBlending);
+   SpriteBatchVertex* vertex = vertices + vertexIndex;
+   for(int cornerIndex = 0; cornerIndex < 4; cornerIndex++)
+   {
+      const float* source = vertexBuffer + (cornerIndex * 5);
+      Point3F position = Point3F::Create(source[0], source[1], source[2]);
+      if(transform)
+         position = (*transform) * position;
+      // Write the whole vertex at once, since the buffer may be write-combined.
+      SpriteBatchVertex newVertex;
+      newVertex.x = position.x;
+      newVertex.y = position.y;
+      newVertex.z = position.z;
+      newVertex.s = source[3];
+      newVertex.t = source[4];
+      newVertex.color = colorPremultiplied;
+      vertex[cornerIndex] = newVertex;
+   }
+
+   regionQuadCount++;
+   pendingQuadCount++;
+   byteCount += 4 * sizeof(SpriteBatchVertex);
+}
+
+//------------------------------------------------------------------------------
+
+inline void SpriteBatch::ImageDraw(ImageCommon* image, const Point2F& position, const ColorRGBA8& color,
+   float depth, float additiveBlending, const Matrix43* transform)
+{
+   assert(image);
+   Point2F internalScale = image->InternalScaleGet();
+   int segmentCount = image->SegmentCountGet();
+   for(int segmentIndex = 0; segmentIndex < segmentCount; segmentIndex++)
+   {
+      const ImageSegment* segment = image->SegmentGet(segmentIndex);
+      if(!segment->texture)
+         continue;
+
+      // The texture subset is in texels, and the segment is scaled to the
+      // logical size of the Image.
+      Point2I textureSize = segment->texture->SizeGet();
+      if(!textureSize.x || !textureSize.y)
+         continue;
+      const Box2F& subset = segment->textureSubset;
+      float left = position.x + segment->position.x;
+      float top = position.y + segment->position.y;
+      float right = left + (subset.width * internalScale.x);
+      float bottom = top + (subset.height * internalScale.y);
+      float sMin = subset.x / (float)textureSize.x;
+      float tMin = subset.y / (float)textureSize.y;
+      float sMax = (subset.x + subset.width) / (float)textureSize.x;
+      float tMax = (subset.y + subset.height) / (float)textureSize.y;
+
+      float vertexBuffer[20] =
+      {
+         left, top, depth, sMin, tMin,
+         right, top, depth, sMax, tMin,
+         right, bottom, depth, sMax, tMax,
+         left, bottom, depth, sMin, tMax
+      };
+      QuadAdd(vertexBuffer, segment->texture, color, additiveBlending, transform);
+   }
+}
+
+//------------------------------------------------------------------------------
+
+inline void SpriteBatch::MaskSet(Texture* _maskTexture, const Matrix43& _maskMatrix)
+{
+   if((_maskTexture == state.maskTexture) && (!_maskTexture || (_maskMatrix == state.maskMatrix)))
+      return;
+   Flush();
+   state.maskTexture = _maskTexture;
+   state.maskMatrix = _maskMatrix;
+}
+
+//------------------------------------------------------------------------------
+
+inline void SpriteBatch::RegionAdvance()
+{
+   Flush();
+   backend->RegionFence(regionIndex);
+   regionIndex = (regionIndex + 1) % SPRITE_BATCH_REGION_COUNT;
+   backend->RegionWait(regionIndex);
+   regionQuadCount = 0;
+}
+
+//------------------------------------------------------------------------------
+
+inline ColorRGBA8 SpriteBatch::ColorPremultiply(const ColorRGBA8& color, float additiveBlending)
+{
+   if(additiveBlending < 0.0f)
+      additiveBlending = 0.0f;
+   if(additiveBlending > 1.0f)
+      additiveBlending = 1.0f;
+   ColorRGBA8 result;
+   result.red = (uchar)((color.red * color.alpha + 127) / 255);
+   result.green = (uchar)((color.green * color.alpha + 127) / 255);
+   result.blue = (uchar)((color.blue * color.alpha + 127) / 255);
+   // With premultiplied alpha, a lower alpha makes the blend more additive.
+   result.alpha = (uchar)(color.alpha * (1.0f - additiveBlending) + 0.5f);
+   return result;
+}
+
+//------------------------------------------------------------------------------
+
+} //namespace Webfoot {
+
+#endif //#ifndef __FROG__SPRITEBATCH_H__
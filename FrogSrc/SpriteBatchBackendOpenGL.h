@@ -0,0 +1,405 @@
+#ifndef __FROG__SPRITEBATCHBACKENDOPENGL_H__
+#define __FROG__SPRITEBATCHBACKENDOPENGL_H__
+
+#include <stddef.h>
+#include "FrogMemory.h"
+#include "Debug.h"
+#include "FrogOpenGL.h"
+#include "Matrix44.h"
+#include "ShaderProgramGLSL.h"
+#include "Screen.h"
+#include "SpriteBatch.h"
+
+namespace Webfoot {
+
+/// Generic attribute index to use for the vertex colors of a SpriteBatch.
+#define SPRITE_BATCH_VERTEX_ATTRIBUTE_COLOR_INDEX 2
+/// Name of the vertex attribute for the vertex colors of a SpriteBatch.
+#define SPRITE_BATCH_VERTEX_ATTRIBUTE_COLOR_NAME "attributeColor"
+
+//==============================================================================
+
+/// SpriteBatchBackendOpenGL draws the quads of a SpriteBatch with OpenGL.
+/// Where GL_ARB_buffer_storage and GL_ARB_sync are available, the vertex
+/// buffer is persistently mapped and each region is protected by a fence, so
+/// the vertices are written straight to memory the GPU reads from.
+/// Otherwise, the vertices are written to main memory and uploaded with
+/// glBufferSubData once per draw call.
+///
+/// The quads are drawn with their own shader program, which follows the
+/// conventions of the shaders of ScreenOpenGL, and the state is changed
+/// through theScreen where it keeps a cache.  The model-view matrix of the
+/// screen is not applied, so pass it as the transform when adding quads if
+/// it's needed.
+class SpriteBatchBackendOpenGL : public SpriteBatchBackend
+{
+public:
+   SpriteBatchBackendOpenGL();
+   virtual ~SpriteBatchBackendOpenGL() {}
+
+   /// Create the shader program and use the 2D projection of the screen.
+   /// Return true if successful.
+   bool Init(HeapID _heapID = HEAP_DEFAULT);
+   /// Clean up.
+   void Deinit();
+
+   virtual void* VertexBufferCreate(size_t size);
+   virtual void VertexBufferDestroy();
+   virtual void QuadsDraw(const SpriteBatchState& state, int vertexFirst, int quadCount);
+   virtual void RegionFence(int regionIndex);
+   virtual void RegionWait(int regionIndex);
+
+   /// Use the given projection matrix in the native format.
+   void ProjectionSet(const Matrix44& _projectionMatrix) { projectionMatrix = _projectionMatrix; projectionMatrixDirty = true; }
+   /// Use an orthographic projection of the 2D area of the screen, like
+   /// ScreenOpenGL::DrawMode2D.
+   void ProjectionDefaultSet();
+
+   /// Return true if the vertex buffer is persistently mapped.
+   bool PersistentMappingCheck() { return persistentMapping; }
+
+protected:
+   /// Heap for allocations.
+   HeapID heapID;
+   /// Program used to draw the quads.
+   ShaderProgramGLSL shaderProgram;
+   /// Location of the projection matrix uniform.
+   GLint uniformProjectionMatrixLocation;
+   /// Location of the mask matrix uniform.
+   GLint uniformMaskMatrixLocation;
+   /// Projection matrix for the quads.
+   Matrix44 projectionMatrix;
+   /// True if the projection matrix must be given to the shader program.
+   bool projectionMatrixDirty;
+
+   /// OpenGL buffer object for the vertices.
+   GLuint vertexBufferID;
+   /// OpenGL buffer object for the indices.
+   GLuint indexBufferID;
+   /// Pointer to the vertices, either mapped or in main memory.
+   void* vertices;
+   /// True if 'vertices' is persistently mapped.
+   bool persistentMapping;
+#if !FROG_OPENGL_ES
+   /// Fences for the draws that read each region of the buffer.
+   GLsync fences[SPRITE_BATCH_REGION_COUNT];
+#endif //#if !FROG_OPENGL_ES
+};
+
+//==============================================================================
+
+inline SpriteBatchBackendOpenGL::SpriteBatchBackendOpenGL()
+{
+   heapID = HEAP_DEFAULT;
+   uniformProjectionMatrixLocation = -1;
+   uniformMaskMatrixLocation = -1;
+   projectionMatrix.IdentitySet();
+   projectionMatrixDirty = true;
+   vertexBufferID = 0;
+   indexBufferID = 0;
+   vertices = NULL;
+   persistentMapping = false;
+#if !FROG_OPENGL_ES
+   for(int regionIndex = 0; regionIndex < SPRITE_BATCH_REGION_COUNT; regionIndex++)
+      fences[regionIndex] = NULL;
+#endif //#if !FROG_OPENGL_ES
+}
+
+//------------------------------------------------------------------------------
+
+inline bool SpriteBatchBackendOpenGL::Init(HeapID _heapID)
+{
+   heapID = _heapID;
+
+   shaderProgram.Init("SpriteBatch", heapID);
+   theScreen->ShaderProgramInitialDeclarationsAdd(&shaderProgram);
+   shaderProgram.SourceStringAdd(ShaderProgramGLSL::VERTEX,
+      "uniform mat4 " SCREEN_PROJECTION_MATRIX_NAME ";\n"
+      "uniform mat4 " SCREEN_MASK_MATRIX_NAME ";\n"
+      "attribute vec3 attributePosition;\n"
+      "attribute vec2 attributeTexCoord0;\n"
+      "attribute vec4 " SPRITE_BATCH_VERTEX_ATTRIBUTE_COLOR_NAME ";\n"
+      "varying vec2 texCoord0;\n"
+      "varying vec2 maskTexCoord;\n"
+      "varying vec4 color;\n"
+      "void main()\n"
+      "{\n"
+      "   vec4 position = vec4(attributePosition, 1.0);\n"
+      "   gl_Position = " SCREEN_PROJECTION_MATRIX_NAME " * position;\n"
+      "   maskTexCoord = (" SCREEN_MASK_MATRIX_NAME " * position).xy;\n"
+      "   texCoord0 = attributeTexCoord0;\n"
+      "   color = " SPRITE_BATCH_VERTEX_ATTRIBUTE_COLOR_NAME ";\n"
+      "}\n");
+   shaderProgram.SourceStringAdd(ShaderProgramGLSL::FRAGMENT,
+      "uniform sampler2D " SCREEN_DIFFUSE_TEXTURE_NAME ";\n"
+      "uniform sampler2D " SCREEN_MASK_TEXTURE_NAME ";\n"
+      "varying vec2 texCoord0;\n"
+      "varying vec2 maskTexCoord;\n"
+      "varying vec4 color;\n"
+      "void main()\n"
+      "{\n"
+      "   float mask = texture2D(" SCREEN_MASK_TEXTURE_NAME ", maskTexCoord).a;\n"
+      "   gl_FragColor = texture2D(" SCREEN_DIFFUSE_TEXTURE_NAME ", texCoord0) * color * mask;\n"
+      "}\n");
+   if(!shaderProgram.Compile())
+   {
+      WarningPrintf("SpriteBatchBackendOpenGL::Init -- Unable to compile the shader program.\n");
+      return false;
+   }
+   shaderProgram.AttributeSet(SCREEN_VERTEX_ATTRIBUTE_POSITION_NAME, SCREEN_VERTEX_ATTRIBUTE_POSITION_INDEX);
+   shaderProgram.AttributeSet(SCREEN_VERTEX_ATTRIBUTE_TEXCOORD0_NAME, SCREEN_VERTEX_ATTRIBUTE_TEXCOORD0_INDEX);
+   shaderProgram.AttributeSet(SPRITE_BATCH_VERTEX_ATTRIBUTE_COLOR_NAME, SPRITE_BATCH_VERTEX_ATTRIBUTE_COLOR_INDEX);
+   if(!shaderProgram.Link())
+   {
+      WarningPrintf("SpriteBatchBackendOpenGL::Init -- Unable to link the shader program.\n");
+      return false;
+   }
+
+   // Samplers only need to be set once.
+   GLuint previousShaderProgram = theScreen->ShaderProgramNativeGet();
+   theScreen->ShaderProgramNativeSet(shaderProgram.ShaderProgramIDGet());
+   shaderProgram.UniformSet(SCREEN_DIFFUSE_TEXTURE_NAME, SCREEN_DIFFUSE_TEXTURE_UNIT_INDEX);
+   shaderProgram.UniformSet(SCREEN_MASK_TEXTURE_NAME, SCREEN_MASK_TEXTURE_UNIT_INDEX);
+   uniformProjectionMatrixLocation = shaderProgram.UniformLocationGet(SCREEN_PROJECTION_MATRIX_NAME);
+   uniformMaskMatrixLocation = shaderProgram.UniformLocationGet(SCREEN_MASK_MATRIX_NAME);
+   theScreen->ShaderProgramNativeSet(previousShaderProgram);
+
+   ProjectionDefaultSet();
+   return true;
+}
+
+//------------------------------------------------------------------------------
+
+inline void SpriteBatchBackendOpenGL::Deinit()
+{
+   VertexBufferDestroy();
+   if(theScreen->ShaderProgramNativeGet() == shaderProgram.ShaderProgramIDGet())
+      theScreen->ShaderProgramNativeSet(0);
+   shaderProgram.Deinit();
+}
+
+//------------------------------------------------------------------------------
+
+inline void SpriteBatchBackendOpenGL::ProjectionDefaultSet()
+{
+   // Map the 2D area to clip space with y pointing down, and compensate for
+   // aspect ratio the same way the screen does.
+   Box2I area = theScreen->ProjectionArea2DGet();
+   Point2F compensation = theScreen->AspectRatioCompensationGet();
+   Matrix44 orthographic;
+   orthographic.OrthographicSet((float)area.x, (float)(area.x + area.width),
+      (float)(area.y + area.height), (float)area.y, -1.0f, 1.0f);
+   Matrix44 scale = Matrix44::Create(compensation.x, 0.0f, 0.0f, 0.0f,
+                                     0.0f, compensation.y, 0.0f, 0.0f,
+                                     0.0f, 0.0f, 1.0f, 0.0f,
+                                     0.0f, 0.0f, 0.0f, 1.0f);
+   ProjectionSet(scale * orthographic);
+}
+
+//------------------------------------------------------------------------------
+
+inline void* SpriteBatchBackendOpenGL::VertexBufferCreate(size_t size)
+{
+   VertexBufferDestroy();
+
+   GLint previousArrayBuffer = 0;
+   GLint previousElementArrayBuffer = 0;
+   glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &previousArrayBuffer);
+   glGetIntegerv(GL_ELEMENT_ARRAY_BUFFER_BINDING, &previousElementArrayBuffer);
+
+   // Every quad is two triangles, and the indices never change.
+   int quadCount = (int)(size / (4 * sizeof(SpriteBatchVertex)));
+   assert(quadCount * 4 <= SPRITE_BATCH_VERTEX_COUNT_MAX);
+   size_t indicesSize = (size_t)quadCount * 6 * sizeof(GLushort);
+   GLushort* indices = (GLushort*)FrogMallocEx(indicesSize, heapID, FROG_MEM_ALIGN);
+   if(!indices)
+      return NULL;
+   for(int quadIndex = 0; quadIndex < quadCount; quadIndex++)
+   {
+      GLushort vertexFirst = (GLushort)(quadIndex * 4);
+      GLushort* quadIndices = indices + (quadIndex * 6);
+      quadIndices[0] = vertexFirst;
+      quadIndices[1] = (GLushort)(vertexFirst + 1);
+      quadIndices[2] = (GLushort)(vertexFirst + 2);
+      quadIndices[3] = vertexFirst;
+      quadIndices[4] = (GLushort)(vertexFirst + 2);
+      quadIndices[5] = (GLushort)(vertexFirst + 3);
+   }
+   glGenBuffers(1, &indexBufferID);
+   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferID);
+   glBufferData(GL_ELEMENT_ARRAY_BUFFER, indicesSize, indices, GL_STATIC_DRAW);
+   FrogFree(indices);
+
+   glGenBuffers(1, &vertexBufferID);
+   glBindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
+#if !FROG_OPENGL_ES
+   if(GLEW_ARB_buffer_storage && GLEW_ARB_sync)
+   {
+      GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+      glBufferStorage(GL_ARRAY_BUFFER, size, NULL, flags);
+      vertices = glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags);
+      persistentMapping = vertices != NULL;
+      if(!persistentMapping)
+      {
+         // Storage from glBufferStorage can't be respecified, so start over
+         // with a new buffer.
+         glDeleteBuffers(1, &vertexBufferID);
+         glGenBuffers(1, &vertexBufferID);
+         glBindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
+      }
+   }
+#endif //#if !FROG_OPENGL_ES
+   if(!persistentMapping)
+   {
+      glBufferData(GL_ARRAY_BUFFER, size, NULL, GL_STREAM_DRAW);
+      vertices = FrogMallocEx(size, heapID, FROG_MEM_ALIGN);
+   }
+
+   glBindBuffer(GL_ARRAY_BUFFER, (GLuint)previousArrayBuffer);
+   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, (GLuint)previousElementArrayBuffer);
+   return vertices;
+}
+
+//------------------------------------------------------------------------------
+
+inline void SpriteBatchBackendOpenGL::VertexBufferDestroy()
+{
+#if !FROG_OPENGL_ES
+   for(int regionIndex = 0; regionIndex < SPRITE_BATCH_REGION_COUNT; regionIndex++)
+   {
+      if(fences[regionIndex])
+         glDeleteSync(fences[regionIndex]);
+      fences[regionIndex] = NULL;
+   }
+#endif //#if !FROG_OPENGL_ES
+
+   if(vertexBufferID)
+   {
+#if !FROG_OPENGL_ES
+      if(persistentMapping)
+      {
+         GLint previousArrayBuffer = 0;
+         glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &previousArrayBuffer);
+         glBindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
+         glUnmapBuffer(GL_ARRAY_BUFFER);
+         glBindBuffer(GL_ARRAY_BUFFER, (GLuint)previousArrayBuffer);
+      }
+#endif //#if !FROG_OPENGL_ES
+      glDeleteBuffers(1, &vertexBufferID);
+      vertexBufferID = 0;
+   }
+   if(indexBufferID)
+   {
+      glDeleteBuffers(1, &indexBufferID);
+      indexBufferID = 0;
+   }
+   if(vertices && !persistentMapping)
+      FrogFree(vertices);
+   vertices = NULL;
+   persistentMapping = false;
+}
+
+//------------------------------------------------------------------------------
+
+inline void SpriteBatchBackendOpenGL::QuadsDraw(const SpriteBatchState& state, int vertexFirst, int quadCount)
+{
+   if(!vertexBufferID || !state.texture)
+      return;
+
+   GLint previousArrayBuffer = 0;
+   GLint previousElementArrayBuffer = 0;
+   glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &previousArrayBuffer);
+   glGetIntegerv(GL_ELEMENT_ARRAY_BUFFER_BINDING, &previousElementArrayBuffer);
+
+   theScreen->ShaderProgramNativeSet(shaderProgram.ShaderProgramIDGet());
+   if(projectionMatrixDirty)
+   {
+      shaderProgram.UniformSet(uniformProjectionMatrixLocation, projectionMatrix);
+      projectionMatrixDirty = false;
+   }
+   shaderProgram.UniformSet(uniformMaskMatrixLocation, state.maskMatrix);
+
+   // Without a mask, the screen binds a fully opaque one.
+   theScreen->MaskTextureSet(state.maskTexture);
+   glActiveTexture(GL_TEXTURE0 + SCREEN_DIFFUSE_TEXTURE_UNIT_INDEX);
+   glBindTexture(GL_TEXTURE_2D, state.texture->TextureIDGet());
+   // The vertex colors have premultiplied alpha.
+   glEnable(GL_BLEND);
+   glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+
+   glBindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
+   size_t vertexSize = sizeof(SpriteBatchVertex);
+   if(!persistentMapping)
+   {
+      glBufferSubData(GL_ARRAY_BUFFER, vertexFirst * vertexSize, quadCount * 4 * vertexSize,
+         (char*)vertices + (vertexFirst * vertexSize));
+   }
+   theScreen->VertexAttributeNativeEnabledSet(SCREEN_VERTEX_ATTRIBUTE_POSITION_INDEX, true);
+   theScreen->VertexAttributeNativeEnabledSet(SCREEN_VERTEX_ATTRIBUTE_TEXCOORD0_INDEX, true);
+   theScreen->VertexAttributeNativeEnabledSet(SPRITE_BATCH_VERTEX_ATTRIBUTE_COLOR_INDEX, true);
+   glVertexAttribPointer(SCREEN_VERTEX_ATTRIBUTE_POSITION_INDEX, 3, GL_FLOAT, GL_FALSE, (GLsizei)vertexSize,
+      (const GLvoid*)offsetof(SpriteBatchVertex, x));
+   glVertexAttribPointer(SCREEN_VERTEX_ATTRIBUTE_TEXCOORD0_INDEX, 2, GL_FLOAT, GL_FALSE, (GLsizei)vertexSize,
+      (const GLvoid*)offsetof(SpriteBatchVertex, s));
+   glVertexAttribPointer(SPRITE_BATCH_VERTEX_ATTRIBUTE_COLOR_INDEX, 4, GL_UNSIGNED_BYTE, GL_TRUE, (GLsizei)vertexSize,
+      (const GLvoid*)offsetof(SpriteBatchVertex, color));
+
+   // The indices refer to absolute vertex numbers, so start at the indices
+   // of the first quad.
+   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferID);
+   glDrawElements(GL_TRIANGLES, quadCount * 6, GL_UNSIGNED_SHORT,
+      (const GLvoid*)((vertexFirst / 4) * 6 * sizeof(GLushort)));
+
+   // Other drawing doesn't expect the color attribute.
+   theScreen->VertexAttributeNativeEnabledSet(SPRITE_BATCH_VERTEX_ATTRIBUTE_COLOR_INDEX, false);
+   glBindBuffer(GL_ARRAY_BUFFER, (GLuint)previousArrayBuffer);
+   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, (GLuint)previousElementArrayBuffer);
+
+   theScreen->DrawCallCountAdd(1);
+   theScreen->PolygonCountAdd(quadCount * 2);
+}
+
+//------------------------------------------------------------------------------
+
+inline void SpriteBatchBackendOpenGL::RegionFence(int regionIndex)
+{
+#if !FROG_OPENGL_ES
+   if(!persistentMapping)
+      return;
+   if(fences[regionIndex])
+      glDeleteSync(fences[regionIndex]);
+   fences[regionIndex] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+#else
+   (void)regionIndex;
+#endif //#if !FROG_OPENGL_ES
+}
+
+//------------------------------------------------------------------------------
+
+inline void SpriteBatchBackendOpenGL::RegionWait(int regionIndex)
+{
+#if !FROG_OPENGL_ES
+   GLsync fence = fences[regionIndex];
+   if(!fence)
+      return;
+   // Flush on the first attempt, so the fence is sure to be reached.
+   GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+   for(;;)
+   {
+      GLenum result = glClientWaitSync(fence, flags, 1000000);
+      if(result != GL_TIMEOUT_EXPIRED)
+         break;
+      flags = 0;
+   }
+   glDeleteSync(fence);
+   fences[regionIndex] = NULL;
+#else
+   (void)regionIndex;
+#endif //#if !FROG_OPENGL_ES
+}
+
+//------------------------------------------------------------------------------
+
+} //namespace Webfoot {
+
+#endif //#ifndef __FROG__SPRITEBATCHBACKENDOPENGL_H__
@@ -8,6 +8,7 @@ namespace Webfoot {
 
 class SpriteAnimation;
 class SpriteResourceFile;
+class StringAtom;
 
 //=============================================================================
 
@@ -24,6 +25,11 @@ class SpriteResourceFile;
 /// resource file in memory, including the image data, use ResourceFileLoad and
 /// ResourceFileUnload.
 /// Do not include the extension when specifying a resource filename.
+///
+/// Resource files and animations can also be named by StringAtoms.  Include
+/// SpriteManagerAtoms.h to use those overloads.  The lookups themselves still
+/// compare the text, since they are done by the string versions, but callers
+/// that already keep atoms don't need to convert them back.
 class SpriteManager
 {
 public:
@@ -46,6 +52,13 @@ public:
    /// file.
    bool AnimationExistsCheck(const char* resourceFilename, const char* animationName);
 
+   /// Same as the other AnimationLoad, AnimationUnload, and
+   /// AnimationExistsCheck, but take the names as StringAtoms.  These are
+   /// defined in SpriteManagerAtoms.h.
+   inline SpriteAnimation* AnimationLoad(StringAtom resourceFilename, StringAtom spriteName);
+   inline void AnimationUnload(StringAtom resourceFilename, StringAtom animationName);
+   inline bool AnimationExistsCheck(StringAtom resourceFilename, StringAtom animationName);
+
    /// Preload a resource file and all its SpriteAnimations.
    void ResourceFileLoad(const char* resourceFilename);
    /// Undo a call to ResourceFileLoad.  This will not necessarily
@@ -63,6 +76,9 @@ public:
    /// Return a pointer to the given resource file.
    /// Return NULL if the file is not loaded.
    SpriteResourceFile* ResourceFileGet(const char* filename);
+   /// Same as the other ResourceFileGet, but take the filename as a
+   /// StringAtom.  This is defined in SpriteManagerAtoms.h.
+   inline SpriteResourceFile* ResourceFileGet(StringAtom filename);
 
    static SpriteManager instance;
 
@@ -0,0 +1,42 @@
+#ifndef __FROG__SPRITEMANAGERATOMS_H__
+#define __FROG__SPRITEMANAGERATOMS_H__
+
+#include "FrogMemory.h"
+#include "StringAtom.h"
+#include "SpriteManager.h"
+
+namespace Webfoot {
+
+//=============================================================================
+
+inline SpriteAnimation* SpriteManager::AnimationLoad(StringAtom resourceFilename, StringAtom spriteName)
+{
+   return AnimationLoad(resourceFilename.StringGet(), spriteName.StringGet());
+}
+
+//-----------------------------------------------------------------------------
+
+inline void SpriteManager::AnimationUnload(StringAtom resourceFilename, StringAtom animationName)
+{
+   AnimationUnload(resourceFilename.StringGet(), animationName.StringGet());
+}
+
+//-----------------------------------------------------------------------------
+
+inline bool SpriteManager::AnimationExistsCheck(StringAtom resourceFilename, StringAtom animationName)
+{
+   return AnimationExistsCheck(resourceFilename.StringGet(), animationName.StringGet());
+}
+
+//-----------------------------------------------------------------------------
+
+inline SpriteResourceFile* SpriteManager::ResourceFileGet(StringAtom filename)
+{
+   return ResourceFileGet(filename.StringGet());
+}
+
+//=============================================================================
+
+} // namespace Webfoot {
+
+#endif //#ifndef __FROG__SPRITEMANAGERATOMS_H__
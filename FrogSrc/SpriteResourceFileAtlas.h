@@ -0,0 +1,291 @@
+#ifndef __FROG__SPRITERESOURCEFILEATLAS_H__
+#define __FROG__SPRITERESOURCEFILEATLAS_H__
+
+#include "FrogMemory.h"
+#include "Debug.h"
+#include "Table.h"
+#include "Box2.h"
+#include "Bitmap.h"
+#include "Texture.h"
+#include "Image.h"
+#include "Screen.h"
+#include "JSONValue.h"
+#include "SpriteAnimation.h"
+#include "SpriteResourceFile.h"
+#include "TextureAtlasBuilder.h"
+
+namespace Webfoot {
+
+//==============================================================================
+
+/// SpriteResourceFileAtlas packs the frames of the animations of a
+/// SpriteResourceFile onto a few shared textures at runtime, for when no
+/// atlas was built offline.  Each frame's Image is changed to refer to its
+/// place on a shared texture, so everything that draws the frames, including
+/// Sprite and SpriteAnimation, uses the shared textures without any other
+/// changes.  Consecutive frames on the same texture can then be merged into
+/// one draw call by a SpriteBatch.
+///
+/// Only animations that are loaded when Init is called are packed, and only
+/// frames with a single segment whose bitmap data is still in memory, so set
+/// "KeepBitmapData" for the animations that should be packed.  The original
+/// textures stay loaded with their Images.  Once the atlas is created, call
+/// OriginalBitmapDataDeallocate to release the bitmap data that was kept for
+/// packing.  SpriteAnimation::UnnecessaryBitmapDataDeallocate won't do it,
+/// since the frames refer to the shared textures by then.
+///
+/// The pages are limited to the largest texture size supported by the
+/// screen.  To build the atlas offline instead, use the TextureAtlasPack
+/// tool, which calls Init and then saves the pages and description with
+/// BuilderGet()->Save.
+///
+/// Call Deinit to give the Images their original textures back before the
+/// animations are unloaded.
+class SpriteResourceFileAtlas
+{
+public:
+   SpriteResourceFileAtlas() { resourceFile = NULL; imageSkippedCount = 0; }
+
+   /// Pack the frames of the loaded animations of the given resource file
+   /// onto pages with edges no longer than 'edgeMax' and no shorter than
+   /// 'edgeMin', leaving 'padding' texels around each frame.  If 'edgeMax'
+   /// is not positive, use the default.  Return true if at least one frame
+   /// was packed.
+   bool Init(SpriteResourceFile* _resourceFile, int edgeMax = -1, int padding = TEXTURE_ATLAS_PADDING_DEFAULT,
+      int edgeMin = TEXTURE_ATLAS_EDGE_MIN_DEFAULT, HeapID _heapID = HEAP_DEFAULT);
+   /// Give the Images their original segments back and free the shared
+   /// textures.
+   void Deinit();
+
+   /// If the current platform does not need to keep the bitmap data to draw
+   /// (OpenGL, for example), free the bitmap data of the original textures
+   /// of the packed Images.  The Images can still be drawn with their
+   /// original textures after Deinit, but they can't be packed again.
+   void OriginalBitmapDataDeallocate();
+
+   /// Return the number of shared textures.
+   int TextureCountGet() { return textures.SizeGet(); }
+   /// Return the shared texture with the given index.
+   Texture* TextureGet(int textureIndex) { return textures[textureIndex]; }
+   /// Return the number of Images that now use the shared textures.
+   int ImagePackedCountGet() { return originals.SizeGet(); }
+   /// Return the number of Images that could not be packed.
+   int ImageSkippedCountGet() { return imageSkippedCount; }
+   /// Return the fraction of the area of the shared textures used by frames.
+   float EfficiencyGet() { return builder.EfficiencyGet(); }
+   /// Return the builder that created the pages.
+   TextureAtlasBuilder* BuilderGet() { return &builder; }
+
+   /// Set 'report' to a JSON object with the results of packing.
+   void ReportBuild(JSONValue* report);
+   /// Print a summary of the results of packing.
+   void ReportPrint();
+
+protected:
+   /// Segment of an Image before it was packed.
+   struct ImageOriginal
+   {
+      /// Image that was changed.
+      Image* image;
+      /// Its original segment.
+      ImageSegment segment;
+   };
+
+   /// Return true if the given Image has already been considered.
+   bool ImageSeenCheck(Image* image);
+
+   /// Heap for allocations.
+   HeapID heapID;
+   /// File whose animations were packed.
+   SpriteResourceFile* resourceFile;
+   /// Packs the frames.
+   TextureAtlasBuilder builder;
+   /// Shared textures, one for each page of 'builder'.
+   Table<Texture*> textures;
+   /// Original segments of the Images that were packed.
+   Table<ImageOriginal> originals;
+   /// Images considered so far, since frames can share Images.
+   Table<Image*> imagesSeen;
+   /// Number of Images that could not be packed.
+   int imageSkippedCount;
+};
+
+//==============================================================================
+
+inline bool SpriteResourceFileAtlas::Init(SpriteResourceFile* _resourceFile, int edgeMax, int padding, int edgeMin,
+   HeapID _heapID)
+{
+   assert(_resourceFile);
+   resourceFile = _resourceFile;
+   heapID = _heapID;
+   textures.Init(theAllocatorHeaps[heapID]);
+   originals.Init(theAllocatorHeaps[heapID]);
+   imagesSeen.Init(theAllocatorTemp);
+   imageSkippedCount = 0;
+
+   if(edgeMax <= 0)
+      edgeMax = TEXTURE_ATLAS_EDGE_MAX_DEFAULT;
+#if !FROG_OPENGL_ES
+   int textureSizeMax = theScreen->TextureSizeMax32Get();
+   while((textureSizeMax > 0) && (edgeMax > textureSizeMax))
+      edgeMax >>= 1;
+#endif //#if !FROG_OPENGL_ES
+   if(edgeMin > edgeMax)
+      edgeMin = edgeMax;
+   builder.Init(edgeMax, edgeMin, padding, heapID);
+
+   JSONValue* specifications = resourceFile->SpecificationsGet();
+   if(!specifications || !specifications->ObjectCheck())
+   {
+      imagesSeen.Deinit();
+      return false;
+   }
+
+   char itemName[FROG_PATH_MAX+1];
+   for(JSONValue::ObjectIterator iterator = specifications->ObjectBegin(); iterator.WithinCheck(); iterator.Next())
+   {
+      const char* animationName = iterator.Key();
+      SpriteAnimation* animation = resourceFile->AnimationGet(animationName);
+      if(!animation)
+         continue;
+
+      int frameCount = animation->FrameCountGet();
+      for(int frameIndex = 0; frameIndex < frameCount; frameIndex++)
+      {
+         Image* image = animation->FrameGetByIndex(frameIndex)->image;
+         if(!image || ImageSeenCheck(image))
+            continue;
+         imagesSeen.Add(image);
+
+         // Images that were split by BitmapSplitter are too large to share a
+         // texture anyway.
+         const ImageSegment* segment = (image->SegmentCountGet() == 1) ? image->SegmentGet(0) : NULL;
+         Bitmap* bitmap = (segment && segment->texture) ? segment->texture->BitmapGet() : NULL;
+         if(!bitmap || !bitmap->DataGet())
+         {
+            imageSkippedCount++;
+            continue;
+         }
+         FrogSnprintf(itemName, sizeof(itemName), "%s/%d", animationName, frameIndex);
+         builder.Add(bitmap, Box2I::Create(segment->textureSubset), itemName, image);
+      }
+   }
+   imagesSeen.Deinit();
+
+   if(!builder.Build())
+      return false;
+
+   for(int pageIndex = 0; pageIndex < builder.PageCountGet(); pageIndex++)
+   {
+      Texture* texture = NULL;
+      Bitmap* page = builder.PageGet(pageIndex);
+      if(page)
+      {
+         texture = theScreen->TextureCreate(heapID);
+         if(!texture->Init(heapID) || !texture->BitmapSet(page))
+         {
+            WarningPrintf("SpriteResourceFileAtlas::Init -- Unable to create a texture for page %d of %s.\n",
+               pageIndex, resourceFile->FilenameGet());
+            texture->Deinit();
+            frog_delete texture;
+            texture = NULL;
+         }
+      }
+      textures.Add(texture);
+   }
+
+   // Point each packed Image at its place on the shared texture.
+   for(int itemIndex = 0; itemIndex < builder.ItemCountGet(); itemIndex++)
+   {
+      const TextureAtlasItem* item = builder.ItemGet(itemIndex);
+      if((item->pageIndex == -1) || !textures[item->pageIndex])
+      {
+         imageSkippedCount++;
+         continue;
+      }
+      ImageOriginal original;
+      original.image = (Image*)item->userData;
+      original.segment = *original.image->SegmentGet(0);
+      originals.Add(original);
+
+      ImageSegment segment = original.segment;
+      segment.texture = textures[item->pageIndex];
+      segment.textureSubset = Box2F::Create(item->box);
+      segment.shouldUnloadTexture = false;
+      original.image->SegmentSet(&segment, 0);
+   }
+   return originals.SizeGet() > 0;
+}
+
+//------------------------------------------------------------------------------
+
+inline void SpriteResourceFileAtlas::Deinit()
+{
+   for(int originalIndex = 0; originalIndex < originals.SizeGet(); originalIndex++)
+      originals[originalIndex].image->SegmentSet(&originals[originalIndex].segment, 0);
+   originals.Deinit();
+
+   for(int textureIndex = 0; textureIndex < textures.SizeGet(); textureIndex++)
+   {
+      if(textures[textureIndex])
+      {
+         textures[textureIndex]->Deinit();
+         frog_delete textures[textureIndex];
+      }
+   }
+   textures.Deinit();
+   builder.Deinit();
+   resourceFile = NULL;
+}
+
+//------------------------------------------------------------------------------
+
+inline void SpriteResourceFileAtlas::OriginalBitmapDataDeallocate()
+{
+   for(int originalIndex = 0; originalIndex < originals.SizeGet(); originalIndex++)
+   {
+      // Several Images can share one texture, so skip the ones already freed.
+      Texture* texture = originals[originalIndex].segment.texture;
+      Bitmap* bitmap = texture ? texture->BitmapGet() : NULL;
+      if(bitmap && bitmap->DataGet())
+         texture->UnnecessaryBitmapDataDeallocate();
+   }
+}
+
+//------------------------------------------------------------------------------
+
+inline void SpriteResourceFileAtlas::ReportBuild(JSONValue* report)
+{
+   builder.ReportBuild(report);
+   if(resourceFile)
+      report->Set("ResourceFile", resourceFile->FilenameGet());
+   report->Set("ImagePackedCount", originals.SizeGet());
+   report->Set("ImageSkippedCount", imageSkippedCount);
+}
+
+//------------------------------------------------------------------------------
+
+inline void SpriteResourceFileAtlas::ReportPrint()
+{
+   DebugPrintf("SpriteResourceFileAtlas -- %s: %d Images moved to %d textures, %d skipped.\n",
+      resourceFile ? resourceFile->FilenameGet() : "", originals.SizeGet(), textures.SizeGet(), imageSkippedCount);
+   builder.ReportPrint();
+}
+
+//------------------------------------------------------------------------------
+
+inline bool SpriteResourceFileAtlas::ImageSeenCheck(Image* image)
+{
+   for(int imageIndex = 0; imageIndex < imagesSeen.SizeGet(); imageIndex++)
+   {
+      if(imagesSeen[imageIndex] == image)
+         return true;
+   }
+   return false;
+}
+
+//------------------------------------------------------------------------------
+
+} //namespace Webfoot {
+
+#endif //#ifndef __FROG__SPRITERESOURCEFILEATLAS_H__
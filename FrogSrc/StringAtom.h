@@ -0,0 +1,385 @@
+#ifndef __FROG__STRINGATOM_H__
+#define __FROG__STRINGATOM_H__
+
+#include <string.h>
+#include <assert.h>
+#include "FrogMemory.h"
+#include "Allocator.h"
+#include "ThreadUtilities.h"
+
+namespace Webfoot {
+
+/// Number of atoms in each chunk of the table that maps atoms to strings.
+#define STRING_ATOM_CHUNK_SIZE 1024
+/// Maximum number of chunks of atoms.  The most atoms that can exist is this
+/// times STRING_ATOM_CHUNK_SIZE.
+#define STRING_ATOM_CHUNK_COUNT_MAX 1024
+/// Size in bytes of the blocks from which the text of the strings is allocated.
+#define STRING_ATOM_TEXT_BLOCK_SIZE (16*1024)
+/// Initial value for the FNV-1a hash used by StringAtomTable.
+#define STRING_ATOM_HASH_BASIS 2166136261U
+/// Multiplier for the FNV-1a hash used by StringAtomTable.
+#define STRING_ATOM_HASH_PRIME 16777619U
+
+class StringAtomTable;
+
+//==============================================================================
+
+/// A StringAtom is a 32-bit ID for a string that has been interned in
+/// theStringAtoms.  Any two atoms for equal strings have equal IDs, so
+/// atoms can be compared and hashed as integers, and the text they stand for
+/// is stored only once and never moves.  A default-constructed atom stands
+/// for the empty string.  Get atoms from theStringAtoms->AtomGet, and cache
+/// them where possible rather than getting them again in the hot path.
+class StringAtom
+{
+public:
+   StringAtom() { id = 0; }
+
+   bool operator==(const StringAtom& other) const { return id == other.id; }
+   bool operator!=(const StringAtom& other) const { return id != other.id; }
+   /// Order atoms by ID.  This is consistent but unrelated to the order of the strings.
+   bool operator<(const StringAtom& other) const { return id < other.id; }
+
+   /// Return the ID of this atom.
+   uint32 IDGet() const { return id; }
+   /// Return true if this atom stands for the empty string.
+   bool EmptyCheck() const { return id == 0; }
+   /// Return the interned text for this atom.  The pointer is valid until
+   /// theStringAtoms is deinitialized, and it is the same for every atom
+   /// with the same ID.
+   inline const char* StringGet() const;
+
+   /// A hash function for use with HashTable and FlatHashMap.
+   static size_t Hash(const StringAtom& atom) { return (size_t)atom.id; }
+   /// A function for use with HashTable and FlatHashMap that returns true if
+   /// two atoms are the same.
+   static bool EqualCheck(const StringAtom& atomA, const StringAtom& atomB) { return atomA.id == atomB.id; }
+   /// A comparison function for use with Map and FlatMap.
+   static bool Comparator(const StringAtom& atomA, const StringAtom& atomB) { return atomA.id < atomB.id; }
+
+protected:
+   /// Index of the string in theStringAtoms.
+   uint32 id;
+
+   friend class StringAtomTable;
+};
+
+//==============================================================================
+
+/// \internal Computes the StringAtomTable hash of the characters from
+/// 'index' to 'length' of a string literal.  Since the length is known at
+/// compile time, the loop is unrolled and optimizing compilers reduce the
+/// whole thing to a constant.
+template<int length, int index>
+struct StringAtomLiteralHash
+{
+   static inline uint32 Get(const char* literal, uint32 hash)
+   {
+      return StringAtomLiteralHash<length, index + 1>::Get(literal, (hash ^ (unsigned char)literal[index]) * STRING_ATOM_HASH_PRIME);
+   }
+};
+
+template<int length>
+struct StringAtomLiteralHash<length, length>
+{
+   static inline uint32 Get(const char*, uint32 hash) { return hash; }
+};
+
+//==============================================================================
+
+/// StringAtomHash is a string along with its hash as used by StringAtomTable.
+/// When constructed from a string literal, the hash is computed at compile
+/// time, so getting an atom for a literal only needs a table lookup.
+///
+///  StringAtom updateAtom = theStringAtoms->AtomGet(StringAtomHash("Update"));
+///
+/// Only use the array constructor with literals.  For a char array holding a
+/// shorter string, use the explicit 'const char*' constructor instead.
+class StringAtomHash
+{
+public:
+   /// Hash a string literal at compile time.
+   template<int size>
+   StringAtomHash(const char (&literal)[size])
+   {
+      string = literal;
+      length = size - 1;
+      hash = StringAtomLiteralHash<size - 1, 0>::Get(literal, STRING_ATOM_HASH_BASIS);
+      assert(strlen(literal) == length);
+   }
+
+   /// Hash the given string at runtime.
+   explicit StringAtomHash(const char* _string)
+   {
+      string = _string ? _string : "";
+      hash = STRING_ATOM_HASH_BASIS;
+      const char* character = string;
+      for(; *character; character++)
+         hash = (hash ^ (unsigned char)*character) * STRING_ATOM_HASH_PRIME;
+      length = character - string;
+   }
+
+   /// The string itself.
+   const char* string;
+   /// Length of the string, not counting the null terminator.
+   size_t length;
+   /// FNV-1a hash of the string.
+   uint32 hash;
+};
+
+//==============================================================================
+
+/// StringAtomTable interns strings and hands out StringAtoms for them.  It
+/// is safe to get atoms from multiple threads at once.  Getting the string
+/// for an atom doesn't lock at all, since the text of a string never moves
+/// once it is interned.  Strings are only freed by Deinit, so this is meant
+/// for names drawn from a limited set, like event names, animation names, and
+/// JSON keys, rather than arbitrary text.  The table doesn't need to be
+/// initialized before use.  Memory comes from theAllocatorMallocFree.
+class StringAtomTable
+{
+public:
+   StringAtomTable()
+   {
+      mutex.Init();
+      memset(chunks, 0, sizeof(chunks));
+      atomCount = 0;
+      buckets = NULL;
+      bucketCount = 0;
+      textBlockHead = NULL;
+      textBlockUsed = 0;
+   }
+
+   /// Free all the interned strings.  Any atoms that exist become invalid.
+   void Deinit();
+
+   /// Return the atom for the given string, interning the string if needed.
+   /// NULL is treated like the empty string.
+   StringAtom AtomGet(const char* string) { return AtomGet(StringAtomHash(string)); }
+   /// Same as the other AtomGet, but use the hash that has already been computed.
+   StringAtom AtomGet(const StringAtomHash& stringHash) { return AtomGetHelper(stringHash, true); }
+
+   /// Return the atom for the given string if it has already been interned.
+   /// Otherwise, return the atom for the empty string.
+   StringAtom AtomFind(const char* string) { return AtomGetHelper(StringAtomHash(string), false); }
+   /// Same as the other AtomFind, but use the hash that has already been computed.
+   StringAtom AtomFind(const StringAtomHash& stringHash) { return AtomGetHelper(stringHash, false); }
+
+   /// Return the interned text for the given atom.
+   const char* StringGet(StringAtom atom)
+   {
+      if(!atom.id)
+         return "";
+      return TextGet(atom.id);
+   }
+
+   /// Return the number of atoms that have been handed out, including the
+   /// one for the empty string.
+   int CountGet() { Guard guard(&mutex); return (int)(atomCount ? atomCount : 1); }
+
+   /// Return the shared instance.
+   static StringAtomTable* InstanceGet()
+   {
+      static StringAtomTable instance;
+      return &instance;
+   }
+
+protected:
+   /// Slot in the hash table from strings to atoms.
+   struct Bucket
+   {
+      /// Hash of the string.
+      uint32 hash;
+      /// ID of the atom, or 0 if the bucket is empty.
+      uint32 id;
+   };
+
+   /// Header of each block of text.
+   struct TextBlock
+   {
+      /// Previously allocated block.
+      TextBlock* next;
+   };
+
+   /// Return the interned text for the atom with the given non-zero ID.
+   const char* TextGet(uint32 id) { return chunks[id / STRING_ATOM_CHUNK_SIZE][id % STRING_ATOM_CHUNK_SIZE]; }
+   /// Find the atom for the given string and add it if it doesn't exist
+   /// and 'add' is true.
+   StringAtom AtomGetHelper(const StringAtomHash& stringHash, bool add);
+   /// Copy the given string into the text blocks and return the copy.
+   const char* TextAdd(const char* string, size_t length);
+   /// Reallocate the buckets with twice as many and rehash them.
+   /// Return false if unsuccessful.
+   bool BucketsGrow();
+
+   /// Protects everything but the contents of 'chunks' for existing atoms.
+   Mutex mutex;
+   /// Chunks of pointers to the interned strings, indexed by atom ID.
+   const char** chunks[STRING_ATOM_CHUNK_COUNT_MAX];
+   /// One more than the highest atom ID, or 0 if nothing has been interned.
+   uint32 atomCount;
+   /// Hash table from strings to atoms.  This uses linear probing.
+   Bucket* buckets;
+   /// Number of buckets.  This is 0 or a power of 2.
+   uint32 bucketCount;
+   /// Most recently allocated block of text.  The text follows the header.
+   TextBlock* textBlockHead;
+   /// Number of bytes of text used in 'textBlockHead'.
+   size_t textBlockUsed;
+};
+
+static StringAtomTable* const theStringAtoms = StringAtomTable::InstanceGet();
+
+//==============================================================================
+
+inline const char* StringAtom::StringGet() const
+{
+   return theStringAtoms->StringGet(*this);
+}
+
+//==============================================================================
+
+inline void StringAtomTable::Deinit()
+{
+   Guard guard(&mutex);
+   for(int chunkIndex = 0; chunkIndex < STRING_ATOM_CHUNK_COUNT_MAX; chunkIndex++)
+   {
+      if(chunks[chunkIndex])
+         theAllocatorMallocFree->Deallocate((void*)chunks[chunkIndex]);
+      chunks[chunkIndex] = NULL;
+   }
+   while(textBlockHead)
+   {
+      TextBlock* textBlock = textBlockHead;
+      textBlockHead = textBlock->next;
+      theAllocatorMallocFree->Deallocate(textBlock);
+   }
+   if(buckets)
+      theAllocatorMallocFree->Deallocate(buckets);
+   buckets = NULL;
+   bucketCount = 0;
+   atomCount = 0;
+   textBlockUsed = 0;
+}
+
+//------------------------------------------------------------------------------
+
+inline StringAtom StringAtomTable::AtomGetHelper(const StringAtomHash& stringHash, bool add)
+{
+   StringAtom atom;
+   if(!stringHash.length)
+      return atom;
+
+   Guard guard(&mutex);
+
+   // Look for an existing atom.
+   uint32 mask = bucketCount - 1;
+   for(uint32 bucketIndex = stringHash.hash & mask; bucketCount && buckets[bucketIndex].id; bucketIndex = (bucketIndex + 1) & mask)
+   {
+      Bucket* bucket = &buckets[bucketIndex];
+      if((bucket->hash == stringHash.hash) && !strcmp(TextGet(bucket->id), stringHash.string))
+      {
+         atom.id = bucket->id;
+         return atom;
+      }
+   }
+   if(!add)
+      return atom;
+
+   // Keep the table at most half full.
+   if(!atomCount)
+      atomCount = 1;
+   if((atomCount * 2 > bucketCount) && !BucketsGrow())
+      return atom;
+   uint32 id = atomCount;
+   if(id >= STRING_ATOM_CHUNK_SIZE * STRING_ATOM_CHUNK_COUNT_MAX)
+   {
+      assert(false && "Too many string atoms.");
+      return atom;
+   }
+
+   // Store the string.
+   const char** chunk = chunks[id / STRING_ATOM_CHUNK_SIZE];
+   if(!chunk)
+   {
+      chunk = (const char**)theAllocatorMallocFree->Allocate(sizeof(const char*) * STRING_ATOM_CHUNK_SIZE);
+      if(!chunk)
+         return atom;
+      chunks[id / STRING_ATOM_CHUNK_SIZE] = chunk;
+   }
+   const char* text = TextAdd(stringHash.string, stringHash.length);
+   if(!text)
+      return atom;
+   chunk[id % STRING_ATOM_CHUNK_SIZE] = text;
+   atomCount++;
+
+   // Add it to the hash table.
+   mask = bucketCount - 1;
+   uint32 bucketIndex = stringHash.hash & mask;
+   while(buckets[bucketIndex].id)
+      bucketIndex = (bucketIndex + 1) & mask;
+   buckets[bucketIndex].hash = stringHash.hash;
+   buckets[bucketIndex].id = id;
+
+   atom.id = id;
+   return atom;
+}
+
+//------------------------------------------------------------------------------
+
+inline const char* StringAtomTable::TextAdd(const char* string, size_t length)
+{
+   size_t size = length + 1;
+   size_t blockTextSize = STRING_ATOM_TEXT_BLOCK_SIZE - sizeof(TextBlock);
+   if(!textBlockHead || (textBlockUsed + size > blockTextSize))
+   {
+      // Long strings get a block of their own.
+      size_t newBlockTextSize = (size > blockTextSize) ? size : blockTextSize;
+      TextBlock* textBlock = (TextBlock*)theAllocatorMallocFree->Allocate(sizeof(TextBlock) + newBlockTextSize);
+      if(!textBlock)
+         return NULL;
+      textBlock->next = textBlockHead;
+      textBlockHead = textBlock;
+      textBlockUsed = 0;
+   }
+   char* text = (char*)(textBlockHead + 1) + textBlockUsed;
+   memcpy(text, string, length);
+   text[length] = '\0';
+   textBlockUsed += size;
+   return text;
+}
+
+//------------------------------------------------------------------------------
+
+inline bool StringAtomTable::BucketsGrow()
+{
+   uint32 newBucketCount = bucketCount ? (bucketCount * 2) : 256;
+   Bucket* newBuckets = (Bucket*)theAllocatorMallocFree->Allocate(sizeof(Bucket) * newBucketCount);
+   if(!newBuckets)
+      return false;
+   memset(newBuckets, 0, sizeof(Bucket) * newBucketCount);
+
+   uint32 mask = newBucketCount - 1;
+   for(uint32 oldBucketIndex = 0; oldBucketIndex < bucketCount; oldBucketIndex++)
+   {
+      if(!buckets[oldBucketIndex].id)
+         continue;
+      uint32 bucketIndex = buckets[oldBucketIndex].hash & mask;
+      while(newBuckets[bucketIndex].id)
+         bucketIndex = (bucketIndex + 1) & mask;
+      newBuckets[bucketIndex] = buckets[oldBucketIndex];
+   }
+
+   if(buckets)
+      theAllocatorMallocFree->Deallocate(buckets);
+   buckets = newBuckets;
+   bucketCount = newBucketCount;
+   return true;
+}
+
+//------------------------------------------------------------------------------
+
+} //namespace Webfoot {
+
+#endif //#ifndef __FROG__STRINGATOM_H__
@@ -3,6 +3,7 @@
 
 #include "FrogMemory.h"
 #include <algorithm>
+#include <string.h>
 #include "Debug.h"
 #include "Utility.h"
 #include "Allocator.h"
@@ -24,14 +25,108 @@ bool TableComparatorDefault(const ValueType& valueA, const ValueType& valueB)
 
 //===============================================================================
 
+/// True if the compiler supports rvalue references, so Table and TableStatic
+/// can move items rather than copy them when shifting or reallocating.
+#if (__cplusplus >= 201103L) || (defined(_MSC_VER) && (_MSC_VER >= 1600))
+   #define TABLE_MOVE_SUPPORTED 1
+#else
+   #define TABLE_MOVE_SUPPORTED 0
+#endif
+
+#if TABLE_MOVE_SUPPORTED
+   /// Return 'value' in a form that allows it to be moved rather than copied.
+   template<typename ValueType>
+   inline ValueType&& TableMove(ValueType& value) { return static_cast<ValueType&&>(value); }
+#else
+   template<typename ValueType>
+   inline ValueType& TableMove(ValueType& value) { return value; }
+#endif
+
+//===============================================================================
+
+/// TableRelocatable<ValueType>::value is true if an item of the given type can
+/// be moved to a different address by simply copying its bytes and then
+/// forgetting about the original without calling its destructor.  Table and
+/// TableStatic use this to grow, insert, and remove with memcpy and memmove
+/// rather than constructing, assigning, and destroying each item.  This is
+/// true for built-in types and pointers.  It is also true for most classes
+/// that don't store pointers to themselves or their own members, and it can be
+/// declared for those using TABLE_RELOCATABLE_DECLARE.
+template<typename ValueType> struct TableRelocatable { enum { value = false }; };
+template<typename ValueType> struct TableRelocatable<ValueType*> { enum { value = true }; };
+
+/// Declare that the given type can be relocated with memcpy.  Use this at
+/// namespace scope within the Webfoot namespace.
+#define TABLE_RELOCATABLE_DECLARE(ValueType) \
+   template<> struct TableRelocatable<ValueType> { enum { value = true }; };
+
+TABLE_RELOCATABLE_DECLARE(bool)
+TABLE_RELOCATABLE_DECLARE(char)
+TABLE_RELOCATABLE_DECLARE(signed char)
+TABLE_RELOCATABLE_DECLARE(unsigned char)
+TABLE_RELOCATABLE_DECLARE(short)
+TABLE_RELOCATABLE_DECLARE(unsigned short)
+TABLE_RELOCATABLE_DECLARE(int)
+TABLE_RELOCATABLE_DECLARE(unsigned int)
+TABLE_RELOCATABLE_DECLARE(long)
+TABLE_RELOCATABLE_DECLARE(unsigned long)
+TABLE_RELOCATABLE_DECLARE(long long)
+TABLE_RELOCATABLE_DECLARE(unsigned long long)
+TABLE_RELOCATABLE_DECLARE(float)
+TABLE_RELOCATABLE_DECLARE(double)
+
+/// Swap two items, using memcpy if they are relocatable.
+template<typename ValueType>
+inline void TableItemsSwap(ValueType& a, ValueType& b)
+{
+   if(TableRelocatable<ValueType>::value)
+   {
+      SwapByCopy(a, b);
+   }
+   else
+   {
+      ValueType c(TableMove(a));
+      a = TableMove(b);
+      b = TableMove(c);
+   }
+}
+
+//===============================================================================
+
+/// Function that returns the new capacity for a Table, given its current
+/// capacity and the size of each item in bytes.
+typedef int (*TableNewCapacityFunction)(int oldCapacity, size_t valueSize);
+
+/// TableNewCapacityFunction that roughly doubles the capacity.  This is the default.
+inline int TableNewCapacityDouble(int oldCapacity, size_t /*valueSize*/) { return oldCapacity*2 + 8; }
+/// TableNewCapacityFunction that increases the capacity by roughly half.  This
+/// wastes less memory for large items at the cost of more frequent growth.
+inline int TableNewCapacityHalf(int oldCapacity, size_t /*valueSize*/) { return oldCapacity + (oldCapacity/2) + 8; }
+
 /// ExpansionPolicy that rougly doubles the size of the Table when expansion
-/// is needed.
+/// is needed.  Use NewCapacityFunctionSet to change how Tables of a
+/// particular type grow without changing their ExpansionPolicy.
 template<typename ValueType> class TableExpansionPolicyDefault
 {
 public:
-   static inline int NewCapacityGet(int oldCapacity) { return oldCapacity*2 + 8; }
+   static inline int NewCapacityGet(int oldCapacity) { return newCapacityFunction(oldCapacity, sizeof(ValueType)); }
+
+   /// Set the function used to choose the new capacity of Tables of 'ValueType'
+   /// that use this policy.  Pass NULL to restore the default.  This is not
+   /// thread-safe, so it should be done during initialization.
+   static void NewCapacityFunctionSet(TableNewCapacityFunction _newCapacityFunction)
+   {
+      newCapacityFunction = _newCapacityFunction ? _newCapacityFunction : TableNewCapacityDouble;
+   }
+
+protected:
+   /// Function used by NewCapacityGet.
+   static TableNewCapacityFunction newCapacityFunction;
 };
 
+template<typename ValueType>
+TableNewCapacityFunction TableExpansionPolicyDefault<ValueType>::newCapacityFunction = TableNewCapacityDouble;
+
 //===============================================================================
 
 /// Table is a dynamically expanding managed array.
@@ -43,6 +138,8 @@ public:
 /// ExpansionPolicy a class with a static NewCapacityGet member that returns
 /// the new amount to allocate given the current capacity.
 /// It is safer and more efficient to use Table for POD items like pointers.
+/// For other types, declaring them with TABLE_RELOCATABLE_DECLARE when
+/// possible avoids copying every item each time the Table grows.
 /// Be sure to call Deinit when finished.
 template<typename ValueType, typename ExpansionPolicy=TableExpansionPolicyDefault<ValueType> > class Table
 {
@@ -112,6 +209,32 @@ public:
    /// Insert the given values at the specified point in the Table.
    void AddCount(const ValueType* newValues, int newValueCount, int insertionIndex);
 
+   /// Construct a new item at the end of the Table in place using the
+   /// constructor that takes the given arguments, and return a reference to it.
+   /// The arguments may refer to items already in the Table.
+   ValueType& EmplaceBack() { EmplaceSlot slot(this); new(slot.AddressGet()) ValueType; return slot.Commit(); }
+   template<typename A0>
+   ValueType& EmplaceBack(const A0& a0) { EmplaceSlot slot(this); new(slot.AddressGet()) ValueType(a0); return slot.Commit(); }
+   template<typename A0, typename A1>
+   ValueType& EmplaceBack(const A0& a0, const A1& a1) { EmplaceSlot slot(this); new(slot.AddressGet()) ValueType(a0, a1); return slot.Commit(); }
+   template<typename A0, typename A1, typename A2>
+   ValueType& EmplaceBack(const A0& a0, const A1& a1, const A2& a2) { EmplaceSlot slot(this); new(slot.AddressGet()) ValueType(a0, a1, a2); return slot.Commit(); }
+   template<typename A0, typename A1, typename A2, typename A3>
+   ValueType& EmplaceBack(const A0& a0, const A1& a1, const A2& a2, const A3& a3) { EmplaceSlot slot(this); new(slot.AddressGet()) ValueType(a0, a1, a2, a3); return slot.Commit(); }
+
+   /// Construct a new item in place using the constructor that takes the
+   /// given arguments, then move it to the given index, and return a
+   /// reference to it.  The arguments may refer to items already in the Table.
+   ValueType& Emplace(int index) { EmplaceBack(); return BackRotate(index); }
+   template<typename A0>
+   ValueType& Emplace(int index, const A0& a0) { EmplaceBack(a0); return BackRotate(index); }
+   template<typename A0, typename A1>
+   ValueType& Emplace(int index, const A0& a0, const A1& a1) { EmplaceBack(a0, a1); return BackRotate(index); }
+   template<typename A0, typename A1, typename A2>
+   ValueType& Emplace(int index, const A0& a0, const A1& a1, const A2& a2) { EmplaceBack(a0, a1, a2); return BackRotate(index); }
+   template<typename A0, typename A1, typename A2, typename A3>
+   ValueType& Emplace(int index, const A0& a0, const A1& a1, const A2& a2, const A3& a3) { EmplaceBack(a0, a1, a2, a3); return BackRotate(index); }
+
    /// Return a reference to the given element of the Table.
    ValueType& operator[](size_t i) { return data[i]; }
    /// Return a reference to the given element of the Table.
@@ -196,15 +319,49 @@ public:
       assert(index >= 0);
       if((index >= 0) && (index < size))
       {
+         if(TableRelocatable<ValueType>::value)
+         {
+            // Destroy the item and slide everything above it down.
+            data[index].~ValueType();
+            memmove((void*)&data[index], (void*)&data[index+1], sizeof(ValueType) * (size-index-1));
+            size--;
+            return;
+         }
+
          // Shift everything above it down.
          for(int destIndex = index; destIndex < (size-1); destIndex++)
-            data[destIndex] = data[destIndex+1];
+            data[destIndex] = TableMove(data[destIndex+1]);
          size--;
 
          // Since we now have one fewer element, destroy the former top-most element.
          data[size].~ValueType();
       }
    }
+
+   /// Remove the item at the given index by moving the last item into its
+   /// place.  This doesn't shift the other items, but it doesn't preserve
+   /// their order either.
+   void RemoveIndexUnordered(int index)
+   {
+      assert(index < size);
+      assert(index >= 0);
+      if((index >= 0) && (index < size))
+      {
+         size--;
+         if(TableRelocatable<ValueType>::value)
+         {
+            data[index].~ValueType();
+            if(index != size)
+               memcpy((void*)&data[index], (void*)&data[size], sizeof(ValueType));
+         }
+         else
+         {
+            if(index != size)
+               data[index] = TableMove(data[size]);
+            data[size].~ValueType();
+         }
+      }
+   }
    
    /// Remove the value at the given address in the Table.
    void Remove(ValueType *entry) { RemoveIndex((int)(entry-data)); }
@@ -239,20 +396,38 @@ public:
          (oldIndex < 0) || (oldIndex >= size))
          return;
 
-      ValueType item = data[oldIndex];
+      if(TableRelocatable<ValueType>::value)
+      {
+         // Set the item's bytes aside and slide the ones in between.
+         union
+         {
+            unsigned char bytes[sizeof(ValueType)];
+            double alignDouble;
+            void* alignPointer;
+         } item;
+         memcpy(item.bytes, (void*)&data[oldIndex], sizeof(ValueType));
+         if(newIndex < oldIndex)
+            memmove((void*)&data[newIndex+1], (void*)&data[newIndex], sizeof(ValueType) * (oldIndex-newIndex));
+         else
+            memmove((void*)&data[oldIndex], (void*)&data[oldIndex+1], sizeof(ValueType) * (newIndex-oldIndex));
+         memcpy((void*)&data[newIndex], item.bytes, sizeof(ValueType));
+         return;
+      }
+
+      ValueType item(TableMove(data[oldIndex]));
       if(newIndex < oldIndex)
       {
          // Shift items right.
          for(int i = oldIndex; i > newIndex; i--)
-            data[i] = data[i-1];
-         data[newIndex] = item;
+            data[i] = TableMove(data[i-1]);
+         data[newIndex] = TableMove(item);
       }
       else //if(newIndex > oldIndex)
       {
          // Shift items left.
          for(int i = oldIndex; i < newIndex; i++)
-            data[i] = data[i+1];
-         data[newIndex] = item;
+            data[i] = TableMove(data[i+1]);
+         data[newIndex] = TableMove(item);
       }
    }
 
@@ -317,9 +492,28 @@ public:
          newCapacity = std::max(size, newCapacity);
       int newSize = std::min(size, newCapacity);
 
-      // If needed, make a new buffer with the right data.
-      ValueType* newData = CopyTableData(data, newSize, newCapacity, allocator);
-      DestroyAndFreeData(data, size, allocator);
+      // If needed, make a new buffer and move the items that fit.
+      ValueType* newData = NULL;
+      if(newCapacity)
+      {
+         newData = (ValueType*)allocator->Allocate(sizeof(ValueType) * newCapacity);
+         try
+         {
+            RelocateConstruct(newData, data, newSize);
+         }
+         catch(...)
+         {
+            allocator->Deallocate((void*)newData);
+            throw;
+         }
+      }
+      if(data)
+      {
+         RelocatedDestroy(data, newSize);
+         for(int index = newSize; index < size; index++)
+            data[index].~ValueType();
+         allocator->Deallocate((void*)data);
+      }
 
       data = newData;
       capacity = newCapacity;
@@ -342,7 +536,7 @@ public:
    /// Pop and return the item on top of the stack (same as GetBack followed by RemoveBack)
    ValueType Pop()
    {
-      ValueType& item = GetBack();
+      ValueType item(TableMove(GetBack()));
       RemoveBack();
       return item;
    }
@@ -451,6 +645,16 @@ public:
    template<typename ComparatorType>
    int BinarySearch(const ValueType& value, ComparatorType compare);
 
+   /// Exchange the contents of this Table with those of the given Table,
+   /// including their allocators.  No items are copied.
+   void Swap(Table& other)
+   {
+      Webfoot::Swap(size, other.size);
+      Webfoot::Swap(capacity, other.capacity);
+      Webfoot::Swap(data, other.data);
+      Webfoot::Swap(allocator, other.allocator);
+   }
+
    /// Randomly swap the elements of the Table.  The number of elements in the
    /// collection should not exceed the maximum value for the random number
    /// generator. 
@@ -461,7 +665,7 @@ public:
          // Choose a random index with which to swap.
          int otherIndex = (int)FrogMath::Random(size);
          if(index != otherIndex)
-            Swap(data[index], data[otherIndex]);
+            TableItemsSwap(data[index], data[otherIndex]);
       }
    }
 
@@ -477,7 +681,7 @@ public:
          // Choose a random index with which to swap.
          int otherIndex = (int)randomNumberGenerator->Random(size);
          if(index != otherIndex)
-            Swap(data[index], data[otherIndex]);
+            TableItemsSwap(data[index], data[otherIndex]);
       }
    }
 
@@ -510,11 +714,118 @@ protected:
    /// in sourceTable.  If there is nothing to copy, return NULL.
    ValueType* CopyTableData(ValueType* sourceData, int sourceSize, int newCapacity, Allocator* _allocator);
 
+   /// Construct 'count' items in the uninitialized memory at 'destinationData'
+   /// by moving them from 'sourceData'.  Relocatable items are copied with
+   /// memcpy.  Afterward, call RelocatedDestroy on the source items before
+   /// freeing them.  If a constructor throws, anything that was constructed
+   /// is destroyed.
+   static void RelocateConstruct(ValueType* destinationData, ValueType* sourceData, int count);
+   /// Destroy 'count' items that have been relocated, or whose relocated
+   /// copies are being abandoned.  This does nothing for relocatable items,
+   /// since the copied bytes still refer to the same resources.
+   static void RelocatedDestroy(ValueType* relocatedData, int count)
+   {
+      if(!TableRelocatable<ValueType>::value)
+      {
+         for(int index = 0; index < count; index++)
+            relocatedData[index].~ValueType();
+      }
+   }
+
+   /// Return the capacity the ExpansionPolicy chooses for at least 'requiredCapacity' items.
+   int ExpandedCapacityGet(int requiredCapacity)
+   {
+      int newCapacity = capacity;
+      do
+         newCapacity = ExpansionPolicy::NewCapacityGet(newCapacity);
+      while(requiredCapacity > newCapacity);
+      return newCapacity;
+   }
+
+   /// Move the last item to the given index, shift the items after it up, and
+   /// return a reference to it.
+   ValueType& BackRotate(int index)
+   {
+      assert((index >= 0) && (index < size));
+      Move(index, size-1);
+      return data[index];
+   }
+
+   /// Helper for EmplaceBack that provides the memory for a new item at the
+   /// end of the Table.  If the Table is full, the new item goes in a new
+   /// buffer, and the existing items aren't moved until Commit, so the
+   /// constructor arguments can refer to them.  If Commit isn't reached,
+   /// the new buffer is freed.
+   class EmplaceSlot
+   {
+   public:
+      EmplaceSlot(Table* _table)
+      {
+         table = _table;
+         newData = NULL;
+         newCapacity = 0;
+         if(table->size == table->capacity)
+         {
+            assert(table->allocator);
+            newCapacity = table->ExpandedCapacityGet(table->size + 1);
+            newData = (ValueType*)table->allocator->Allocate(sizeof(ValueType) * newCapacity);
+         }
+      }
+      ~EmplaceSlot()
+      {
+         if(newData)
+            table->allocator->Deallocate((void*)newData);
+      }
+
+      /// Return the address at which to construct the new item.
+      void* AddressGet() { return newData ? (void*)&newData[table->size] : (void*)&table->data[table->size]; }
+
+      /// Call this once the new item has been constructed.  Return a reference to it.
+      ValueType& Commit()
+      {
+         if(newData)
+         {
+            try
+            {
+               RelocateConstruct(newData, table->data, table->size);
+            }
+            catch(...)
+            {
+               newData[table->size].~ValueType();
+               throw;
+            }
+            if(table->data)
+            {
+               RelocatedDestroy(table->data, table->size);
+               table->allocator->Deallocate((void*)table->data);
+            }
+            table->data = newData;
+            table->capacity = newCapacity;
+            newData = NULL;
+         }
+         table->size++;
+         return table->data[table->size - 1];
+      }
+
+   protected:
+      /// Table to which the item is being added.
+      Table* table;
+      /// Buffer that will replace the Table's data, if needed.
+      ValueType* newData;
+      /// Capacity of 'newData'.
+      int newCapacity;
+   };
+   friend class EmplaceSlot;
+
    /// Helper function for sorting the Table.
    template<typename ComparatorType>
    static void QuickSortSpan(ValueType* lower, ValueType* upper, ComparatorType compare);
 };
 
+/// A Table only refers to its buffer, so it can be relocated.
+template<typename ValueType, typename ExpansionPolicy>
+struct TableRelocatable<Table<ValueType, ExpansionPolicy> > { enum { value = true }; };
+
 //===============================================================================
 
 template<typename ValueType, typename ExpansionPolicy>
@@ -584,6 +895,35 @@ ValueType* Table<ValueType, ExpansionPolicy>::CopyTableData(ValueType* sourceDat
 
 //------------------------------------------------------------------------------
 
+template<typename ValueType, typename ExpansionPolicy>
+void Table<ValueType, ExpansionPolicy>::RelocateConstruct(ValueType* destinationData,
+   ValueType* sourceData, int count)
+{
+   if(count <= 0)
+      return;
+
+   if(TableRelocatable<ValueType>::value)
+   {
+      memcpy((void*)destinationData, (void*)sourceData, sizeof(ValueType) * count);
+      return;
+   }
+
+   int index = 0;
+   try
+   {
+      for(; index < count; index++)
+         new((void*)&destinationData[index]) ValueType(TableMove(sourceData[index]));
+   }
+   catch(...)
+   {
+      for(int destroyIndex = 0; destroyIndex < index; destroyIndex++)
+         destinationData[destroyIndex].~ValueType();
+      throw;
+   }
+}
+
+//------------------------------------------------------------------------------
+
 template<typename ValueType, typename ExpansionPolicy>
 void Table<ValueType, ExpansionPolicy>::AddCount(const ValueType* newValues, int newValueCount, int insertionIndex)
 {
@@ -594,75 +934,106 @@ void Table<ValueType, ExpansionPolicy>::AddCount(const ValueType* newValues, int
       return;
 
    int newSize = size+newValueCount;
+   int insertionIndexEnd = insertionIndex + newValueCount;
    
    if(newSize > capacity)
    {
-      int newCapacity = capacity;
-      do
-         newCapacity = ExpansionPolicy::NewCapacityGet(newCapacity);
-      while(newSize > newCapacity);
+      int newCapacity = ExpandedCapacityGet(newSize);
       ValueType* newData = (ValueType*)allocator->Allocate(sizeof(ValueType) * newCapacity);
-      int index = 0;
+
+      // Add the new values first, since they may refer to items that are about to move.
+      int index = insertionIndex;
       try
       {
-         // Copy everything before the new item.
-         for(; index < insertionIndex; index++)
-            new((void*)&newData[index]) ValueType(data[index]);
-         
-         // Add the new values
-         for(int newValueIndex = 0; newValueIndex < newValueCount; newValueIndex++)
-         {
-            new((void*)&newData[index]) ValueType((ValueType)newValues[newValueIndex]);
-            index++;
-         }
-
-         // Copy everything after the new item.
-         for(; index < newSize; index++)
-            new((void*)&newData[index]) ValueType(data[index-newValueCount]);
+         for(; index < insertionIndexEnd; index++)
+            new((void*)&newData[index]) ValueType((ValueType)newValues[index-insertionIndex]);
       }
       catch(...)
       {
          // If there's a problem in a constructor, destroy anything that did
          // construct correctly and free the newly allocated memory.
-         DestroyAndFreeData(newData, index, allocator);
+         for(int destroyIndex = insertionIndex; destroyIndex < index; destroyIndex++)
+            newData[destroyIndex].~ValueType();
+         allocator->Deallocate((void*)newData);
          throw;
       }
-      
-      DestroyAndFreeData(data, size, allocator);
+
+      // Move everything before and after the new items.
+      bool frontRelocated = false;
+      try
+      {
+         RelocateConstruct(newData, data, insertionIndex);
+         frontRelocated = true;
+         RelocateConstruct(&newData[insertionIndexEnd], &data[insertionIndex], size-insertionIndex);
+      }
+      catch(...)
+      {
+         if(frontRelocated)
+            RelocatedDestroy(newData, insertionIndex);
+         for(int destroyIndex = insertionIndex; destroyIndex < insertionIndexEnd; destroyIndex++)
+            newData[destroyIndex].~ValueType();
+         allocator->Deallocate((void*)newData);
+         throw;
+      }
+
+      if(data)
+      {
+         RelocatedDestroy(data, size);
+         allocator->Deallocate((void*)data);
+      }
 
       data = newData;
       capacity = newCapacity;
    }
-   else
+   else if(TableRelocatable<ValueType>::value && (insertionIndex < size) &&
+      ((newValues + newValueCount <= data) || (newValues >= data + size)))
    {
-      // We need to construct a new item at the end, so figure out
-      // what the value will be.
-      const ValueType* newLastValue;
-      int insertionIndexLimit = insertionIndex + newValueCount;
-      if(insertionIndex + newValueCount == newSize)
+      // Slide the items after the insertion point up to make a gap.
+      memmove((void*)&data[insertionIndexEnd], (void*)&data[insertionIndex], sizeof(ValueType) * (size-insertionIndex));
+      int index = insertionIndex;
+      try
       {
-         insertionIndexLimit--;
-         newLastValue = (const ValueType*)&newValues[newValueCount-1];
+         for(; index < insertionIndexEnd; index++)
+            new((void*)&data[index]) ValueType((ValueType)newValues[index-insertionIndex]);
       }
-      else
-      {      
-         newLastValue = &data[size-1];
+      catch(...)
+      {
+         // Close the gap again.
+         for(int destroyIndex = insertionIndex; destroyIndex < index; destroyIndex++)
+            data[destroyIndex].~ValueType();
+         memmove((void*)&data[insertionIndex], (void*)&data[insertionIndexEnd], sizeof(ValueType) * (size-insertionIndex));
+         throw;
       }
-
-      // Construct the new last item.
-      new ((void*)(&data[newSize-1])) ValueType(*newLastValue);
-
-      // Shift everything after the last new item, excluding the very last item,
-      // which is already in place.
-      if(size > 1)
+   }
+   else
+   {
+      // New values that come from the part of the table being shifted up
+      // are read from where they end up.  Those slots are never overwritten
+      // by new values, since they're all at or after 'insertionIndexEnd'.
+      const ValueType* shiftedBottom = &data[insertionIndex];
+      const ValueType* shiftedTop = &data[size];
+
+      // Shift everything after the insertion point up, starting from the
+      // end.  Slots at or beyond the old size haven't been constructed yet.
+      for(int destIndex = newSize-1; destIndex >= insertionIndexEnd; destIndex--)
       {
-         for(int destIndex = newSize-2; destIndex >= insertionIndex+newValueCount; destIndex--)
-            data[destIndex] = data[destIndex-newValueCount];
+         if(destIndex >= size)
+            new((void*)&data[destIndex]) ValueType(TableMove(data[destIndex-newValueCount]));
+         else
+            data[destIndex] = TableMove(data[destIndex-newValueCount]);
       }
 
-      // Add any remaining new values to be inserted.
-      for(int index = insertionIndex; index < insertionIndexLimit; index++)
-         data[index] = (ValueType)newValues[index-insertionIndex];
+      // Add the new values, constructing any that land beyond the old size.
+      for(int index = insertionIndex; index < insertionIndexEnd; index++)
+      {
+         const ValueType* newValue = (const ValueType*)&newValues[index-insertionIndex];
+         if((newValue >= shiftedBottom) && (newValue < shiftedTop))
+            newValue += newValueCount;
+         if(index >= size)
+            new((void*)&data[index]) ValueType(*newValue);
+         else
+            data[index] = *newValue;
+      }
    }
    size = newSize;
 }
@@ -681,12 +1052,12 @@ void Table<ValueType, ExpansionPolicy>::QuickSortSpan(ValueType* lower, ValueTyp
    ValueType* alternative = lower + ((upper-lower) >> 1);
    if(lower != alternative)
    {
-      if(compare(pivotValue, *alternative)) Swap(pivotValue, *alternative);
-      if(compare(*upper, pivotValue)) Swap(pivotValue, *upper);
+      if(compare(pivotValue, *alternative)) TableItemsSwap(pivotValue, *alternative);
+      if(compare(*upper, pivotValue)) TableItemsSwap(pivotValue, *upper);
    }
    else
    {
-      if(compare(*upper, *lower)) Swap(*lower, *upper);
+      if(compare(*upper, *lower)) TableItemsSwap(*lower, *upper);
       return;
    }
 
@@ -702,11 +1073,11 @@ void Table<ValueType, ExpansionPolicy>::QuickSortSpan(ValueType* lower, ValueTyp
          if(++left >= right) goto EndOfLoop;
       } while(compare(*left, pivotValue));
       
-      Swap(*left, *right--);
+      TableItemsSwap(*left, *right--);
    }
 
 EndOfLoop:
-   Swap(pivotValue, *right);
+   TableItemsSwap(pivotValue, *right);
    ValueType* pivot = right;
 
    // And recurse
@@ -744,9 +1115,9 @@ void Table<ValueType, ExpansionPolicy>::SortStable(ComparatorType compare, Alloc
    // Sort the temporary table.
    sortTable.Sort(comparatorWrapper);
    
-   // Use the sorted list of pointers to copy everything into the sorted position.
+   // Use the sorted list of pointers to move everything into the sorted position.
    for(int index = 0; index < SizeGet(); index++)
-      (*this)[index] = *(sortTable[index]);
+      (*this)[index] = TableMove(*(sortTable[index]));
    
    // Clean up the temporary table.
    sortTable.Deinit();
@@ -49,6 +49,32 @@ public:
    /// Insert the given values at the specified point in the TableStatic.
    void AddCount(const ValueType* newValues, int newValueCount, int insertionIndex);
 
+   /// Set the next unused item to one constructed with the given arguments,
+   /// add it to the end of the TableStatic, and return a reference to it.
+   /// Since every item of a TableStatic is always constructed, the new value
+   /// is moved into place rather than constructed there.
+   ValueType& EmplaceBack() { assert(size < capacity); data[size] = ValueType(); return data[size++]; }
+   template<typename A0>
+   ValueType& EmplaceBack(const A0& a0) { assert(size < capacity); data[size] = ValueType(a0); return data[size++]; }
+   template<typename A0, typename A1>
+   ValueType& EmplaceBack(const A0& a0, const A1& a1) { assert(size < capacity); data[size] = ValueType(a0, a1); return data[size++]; }
+   template<typename A0, typename A1, typename A2>
+   ValueType& EmplaceBack(const A0& a0, const A1& a1, const A2& a2) { assert(size < capacity); data[size] = ValueType(a0, a1, a2); return data[size++]; }
+   template<typename A0, typename A1, typename A2, typename A3>
+   ValueType& EmplaceBack(const A0& a0, const A1& a1, const A2& a2, const A3& a3) { assert(size < capacity); data[size] = ValueType(a0, a1, a2, a3); return data[size++]; }
+
+   /// Same as EmplaceBack, except the new item is then moved to the given
+   /// index.  Return a reference to it.
+   ValueType& Emplace(int index) { EmplaceBack(); Move(index, size-1); return data[index]; }
+   template<typename A0>
+   ValueType& Emplace(int index, const A0& a0) { EmplaceBack(a0); Move(index, size-1); return data[index]; }
+   template<typename A0, typename A1>
+   ValueType& Emplace(int index, const A0& a0, const A1& a1) { EmplaceBack(a0, a1); Move(index, size-1); return data[index]; }
+   template<typename A0, typename A1, typename A2>
+   ValueType& Emplace(int index, const A0& a0, const A1& a1, const A2& a2) { EmplaceBack(a0, a1, a2); Move(index, size-1); return data[index]; }
+   template<typename A0, typename A1, typename A2, typename A3>
+   ValueType& Emplace(int index, const A0& a0, const A1& a1, const A2& a2, const A3& a3) { EmplaceBack(a0, a1, a2, a3); Move(index, size-1); return data[index]; }
+
    /// Return a reference to the given element of the TableStatic.
    ValueType& operator[](size_t i) { return data[i]; }
    /// Return a reference to the given element of the TableStatic.
@@ -134,10 +160,25 @@ public:
       if((index >= 0) && (index < size))
       {
          for(int destIndex = index; destIndex < (size-1); destIndex++)
-            data[destIndex] = data[destIndex+1];
+            data[destIndex] = TableMove(data[destIndex+1]);
          size--;
       }
    }
+
+   /// Remove the item at the given index by moving the last item into its
+   /// place.  This doesn't shift the other items, but it doesn't preserve
+   /// their order either.
+   void RemoveIndexUnordered(int index)
+   {
+      assert(index < size);
+      assert(index >= 0);
+      if((index >= 0) && (index < size))
+      {
+         size--;
+         if(index != size)
+            data[index] = TableMove(data[size]);
+      }
+   }
    
    /// Remove the value at the given address in the TableStatic.
    void Remove(ValueType *entry) { RemoveIndex((int)(entry-data)); }
@@ -172,20 +213,20 @@ public:
          (oldIndex < 0) || (oldIndex >= size))
          return;
 
-      ValueType item = data[oldIndex];
+      ValueType item(TableMove(data[oldIndex]));
       if(newIndex < oldIndex)
       {
          // Shift items right.
          for(int i = oldIndex; i > newIndex; i--)
-            data[i] = data[i-1];
-         data[newIndex] = item;
+            data[i] = TableMove(data[i-1]);
+         data[newIndex] = TableMove(item);
       }
       else //if(newIndex > oldIndex)
       {
          // Shift items left.
          for(int i = oldIndex; i < newIndex; i++)
-            data[i] = data[i+1];
-         data[newIndex] = item;
+            data[i] = TableMove(data[i+1]);
+         data[newIndex] = TableMove(item);
       }
    }
 
@@ -226,7 +267,7 @@ public:
    /// Pop and return the item on top of the stack (same as GetBack followed by RemoveBack)
    ValueType Pop()
    {
-      ValueType& item = GetBack();
+      ValueType item(TableMove(GetBack()));
       RemoveBack();
       return item;
    }
@@ -345,7 +386,7 @@ public:
          // Choose a random index with which to swap.
          int otherIndex = (int)FrogMath::Random(size);
          if(index != otherIndex)
-            Swap(data[index], data[otherIndex]);
+            TableItemsSwap(data[index], data[otherIndex]);
       }
    }
 
@@ -360,6 +401,10 @@ protected:
    static void QuickSortSpan(ValueType* lower, ValueType* upper, ComparatorType compare);
 };
 
+/// A TableStatic can be relocated if its items can.
+template<typename ValueType, int capacity>
+struct TableRelocatable<TableStatic<ValueType, capacity> > { enum { value = TableRelocatable<ValueType>::value }; };
+
 //===============================================================================
 
 template<typename ValueType, int capacity>
@@ -418,15 +463,18 @@ void TableStatic<ValueType, capacity>::AddCount(const ValueType* newValues, int
       newLastValue = &data[size-1];
    }
 
-   // Construct the new last item.
-   new ((void*)(&data[newSize-1])) ValueType(*newLastValue);
+   // Set the new last item.  Every item of the array is already constructed.
+   if(newLastValue == &data[size-1])
+      data[newSize-1] = TableMove(data[size-1]);
+   else
+      data[newSize-1] = *newLastValue;
 
    // Shift everything after the last new item, excluding the very last item,
    // which is already in place.
    if(size > 1)
    {
       for(int destIndex = newSize-2; destIndex >= insertionIndex+newValueCount; destIndex--)
-         data[destIndex] = data[destIndex-newValueCount];
+         data[destIndex] = TableMove(data[destIndex-newValueCount]);
    }
 
    // Add any remaining new values to be inserted.
@@ -450,12 +498,12 @@ void TableStatic<ValueType, capacity>::QuickSortSpan(ValueType* lower, ValueType
    ValueType* alternative = lower + ((upper-lower) >> 1);
    if(lower != alternative)
    {
-      if(compare(pivotValue, *alternative)) Swap(pivotValue, *alternative);
-      if(compare(*upper, pivotValue)) Swap(pivotValue, *upper);
+      if(compare(pivotValue, *alternative)) TableItemsSwap(pivotValue, *alternative);
+      if(compare(*upper, pivotValue)) TableItemsSwap(pivotValue, *upper);
    }
    else
    {
-      if(compare(*upper, *lower)) Swap(*lower, *upper);
+      if(compare(*upper, *lower)) TableItemsSwap(*lower, *upper);
       return;
    }
 
@@ -471,11 +519,11 @@ void TableStatic<ValueType, capacity>::QuickSortSpan(ValueType* lower, ValueType
          if(++left >= right) goto EndOfLoop;
       } while(compare(*left, pivotValue));
       
-      Swap(*left, *right--);
+      TableItemsSwap(*left, *right--);
    }
 
 EndOfLoop:
-   Swap(pivotValue, *right);
+   TableItemsSwap(pivotValue, *right);
    ValueType* pivot = right;
 
    // And recurse
@@ -516,7 +564,7 @@ void TableStatic<ValueType, capacity>::SortStable(ComparatorType compare, Alloca
    
    // Use the sorted list of pointers to copy everything into the sorted position.
    for(int index = 0; index < SizeGet(); index++)
-      (*this)[index] = *(sortTable[index]);
+      (*this)[index] = TableMove(*(sortTable[index]));
    
    // Clean up the temporary table.
    sortTable.Deinit();
@@ -0,0 +1,258 @@
+/// ParticleKernels2DCheck runs each ParticleKernels2D loop on ranges whose
+/// beginnings and ends don't line up with the vector width, and compares the
+/// results with the matching Scalar function.  This catches vector loops that
+/// stop early, run past 'end', or touch particles before 'begin', as well as
+/// differences larger than floating point rounding.  The arrays are also
+/// offset from their natural alignment, since ParticleSystemSoA2D ranges can
+/// start anywhere.
+///
+/// The vector paths are chosen at compile time, so build it once for each
+/// instruction set to check, such as with -msse2 and with -mavx2, and run
+/// each build.  It prints the mismatches it finds and returns 1 if there were
+/// any.
+///
+/// Build it as a console program linked with the Frog library.  It is not
+/// part of the library itself.
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "FrogMemory.h"
+#include "Color.h"
+#include "Progression.h"
+#include "ParticleKernels2D.h"
+
+using namespace Webfoot;
+
+/// Number of particles in each array.
+#define PARTICLE_KERNELS_CHECK_SIZE 53
+/// Largest value of 'begin' to try.  Together with every 'end' from 'begin'
+/// to PARTICLE_KERNELS_CHECK_SIZE, this covers every remainder for both the
+/// 4-wide and 8-wide loops.
+#define PARTICLE_KERNELS_CHECK_BEGIN_MAX 9
+/// Allowed relative difference between vector and scalar floats.
+#define PARTICLE_KERNELS_CHECK_TOLERANCE 1.0e-5f
+/// Same as Particle2D::LIFE_DURATION_INDEFINITE.
+#define PARTICLE_KERNELS_CHECK_LIFE_INDEFINITE -1
+
+//==============================================================================
+
+/// Inputs for the kernels.  Each array has one extra entry at the front, so
+/// the particles start 4 bytes past the array's alignment.
+struct ParticleKernelsCheckInput
+{
+   float floatsBuffer[6][PARTICLE_KERNELS_CHECK_SIZE + 1];
+   int32 ageBuffer[PARTICLE_KERNELS_CHECK_SIZE + 1];
+   int32 lifeDurationBuffer[PARTICLE_KERNELS_CHECK_SIZE + 1];
+   ColorRGBA8 colorBuffer[PARTICLE_KERNELS_CHECK_SIZE + 1];
+
+   float* FloatsGet(int arrayIndex) { return floatsBuffer[arrayIndex] + 1; }
+   int32* AgeGet() { return ageBuffer + 1; }
+   int32* LifeDurationGet() { return lifeDurationBuffer + 1; }
+   ColorRGBA8* ColorsGet() { return colorBuffer + 1; }
+};
+
+//==============================================================================
+
+/// Number of mismatches found so far.
+static int mismatchCount = 0;
+
+//------------------------------------------------------------------------------
+
+/// Return a pseudorandom value in [min, max) and advance 'state'.
+static float RandomFloatGet(unsigned int* state, float min, float max)
+{
+   *state = *state * 1664525u + 1013904223u;
+   return min + (max - min) * (float)(*state >> 8) * (1.0f / 16777216.0f);
+}
+
+//------------------------------------------------------------------------------
+
+/// Fill the input with values that include the special cases the kernels
+/// handle, like full damping, no damping, indefinite lives, and particles past
+/// the ends of their lives.
+static void InputFill(ParticleKernelsCheckInput* input)
+{
+   unsigned int random = 12345;
+   for(int arrayIndex = 0; arrayIndex < 6; arrayIndex++)
+   {
+      for(int index = -1; index < PARTICLE_KERNELS_CHECK_SIZE; index++)
+         input->FloatsGet(arrayIndex)[index] = RandomFloatGet(&random, -200.0f, 200.0f);
+   }
+   // The last array is used as the damping log.
+   float* dampingLog = input->FloatsGet(5);
+   for(int index = -1; index < PARTICLE_KERNELS_CHECK_SIZE; index++)
+   {
+      switch((index + 1) % 5)
+      {
+      case 0: dampingLog[index] = 0.0f; break;
+      case 1: dampingLog[index] = -1.0e30f; break;
+      default: dampingLog[index] = logf(1.0f - RandomFloatGet(&random, 0.0f, 0.99f)); break;
+      }
+   }
+
+   for(int index = -1; index < PARTICLE_KERNELS_CHECK_SIZE; index++)
+   {
+      input->AgeGet()[index] = (int32)RandomFloatGet(&random, 0.0f, 3000.0f);
+      switch((index + 1) % 7)
+      {
+      case 0: input->LifeDurationGet()[index] = PARTICLE_KERNELS_CHECK_LIFE_INDEFINITE; break;
+      case 1: input->LifeDurationGet()[index] = 0; break;
+      default: input->LifeDurationGet()[index] = (int32)RandomFloatGet(&random, 1.0f, 2500.0f); break;
+      }
+      input->ColorsGet()[index] = ColorRGBA8::Create((uchar)index, 0, 0, 0);
+   }
+}
+
+//------------------------------------------------------------------------------
+
+/// Return true if the given floats match to within rounding.
+static bool FloatsCloseCheck(float a, float b)
+{
+   float magnitude = fabsf(a) > fabsf(b) ? fabsf(a) : fabsf(b);
+   if(magnitude < 1.0f)
+      magnitude = 1.0f;
+   return fabsf(a - b) <= PARTICLE_KERNELS_CHECK_TOLERANCE * magnitude;
+}
+
+//------------------------------------------------------------------------------
+
+/// Compare every particle of the given float arrays, including those outside
+/// [begin, end), which should be untouched by both.
+static void FloatsCompare(const char* kernelName, const char* arrayName, const float* vector, const float* scalar, int begin, int end)
+{
+   for(int index = -1; index < PARTICLE_KERNELS_CHECK_SIZE; index++)
+   {
+      if(!FloatsCloseCheck(vector[index], scalar[index]))
+      {
+         printf("ParticleKernels2DCheck -- %s [%d, %d): %s[%d] is %.9g, but the scalar version gives %.9g\n",
+            kernelName, begin, end, arrayName, index, vector[index], scalar[index]);
+         mismatchCount++;
+      }
+   }
+}
+
+//------------------------------------------------------------------------------
+
+/// Compare every particle of the given int32 arrays.
+static void Int32sCompare(const char* kernelName, const char* arrayName, const int32* vector, const int32* scalar, int begin, int end)
+{
+   for(int index = -1; index < PARTICLE_KERNELS_CHECK_SIZE; index++)
+   {
+      if(vector[index] != scalar[index])
+      {
+         printf("ParticleKernels2DCheck -- %s [%d, %d): %s[%d] is %d, but the scalar version gives %d\n",
+            kernelName, begin, end, arrayName, index, (int)vector[index], (int)scalar[index]);
+         mismatchCount++;
+      }
+   }
+}
+
+//------------------------------------------------------------------------------
+
+/// Compare every particle of the given color arrays.  Components may differ
+/// by 1 where rounding puts a value on the other side of an integer.
+static void ColorsCompare(const char* kernelName, const ColorRGBA8* vector, const ColorRGBA8* scalar, int begin, int end)
+{
+   for(int index = -1; index < PARTICLE_KERNELS_CHECK_SIZE; index++)
+   {
+      const uchar* vectorComponents = (const uchar*)&vector[index];
+      const uchar* scalarComponents = (const uchar*)&scalar[index];
+      for(int componentIndex = 0; componentIndex < 4; componentIndex++)
+      {
+         int difference = (int)vectorComponents[componentIndex] - (int)scalarComponents[componentIndex];
+         if((difference > 1) || (difference < -1))
+         {
+            printf("ParticleKernels2DCheck -- %s [%d, %d): component %d of color %d is %d, but the scalar version gives %d\n",
+               kernelName, begin, end, componentIndex, index, (int)vectorComponents[componentIndex], (int)scalarComponents[componentIndex]);
+            mismatchCount++;
+         }
+      }
+   }
+}
+
+//------------------------------------------------------------------------------
+
+/// Run every kernel and its Scalar version on the range [begin, end) of
+/// separate copies of 'source', and compare the results.
+static void RangeCheck(ParticleKernelsCheckInput* source, int begin, int end, const ProgressionTable* progressionTable)
+{
+   const float seconds = 0.016f;
+   static ParticleKernelsCheckInput vector;
+   static ParticleKernelsCheckInput scalar;
+
+   memcpy(&vector, source, sizeof(vector));
+   memcpy(&scalar, source, sizeof(scalar));
+   ParticleKernels2D::VelocityIntegrate(vector.FloatsGet(0), vector.FloatsGet(1), vector.FloatsGet(2), vector.FloatsGet(3), vector.FloatsGet(5), begin, end, seconds);
+   ParticleKernels2D::VelocityIntegrateScalar(scalar.FloatsGet(0), scalar.FloatsGet(1), scalar.FloatsGet(2), scalar.FloatsGet(3), scalar.FloatsGet(5), begin, end, seconds);
+   FloatsCompare("VelocityIntegrate", "velocityX", vector.FloatsGet(0), scalar.FloatsGet(0), begin, end);
+   FloatsCompare("VelocityIntegrate", "velocityY", vector.FloatsGet(1), scalar.FloatsGet(1), begin, end);
+
+   memcpy(&vector, source, sizeof(vector));
+   memcpy(&scalar, source, sizeof(scalar));
+   ParticleKernels2D::PositionIntegrate(vector.FloatsGet(0), vector.FloatsGet(1), vector.FloatsGet(2), vector.FloatsGet(3), begin, end, seconds);
+   ParticleKernels2D::PositionIntegrateScalar(scalar.FloatsGet(0), scalar.FloatsGet(1), scalar.FloatsGet(2), scalar.FloatsGet(3), begin, end, seconds);
+   FloatsCompare("PositionIntegrate", "positionX", vector.FloatsGet(0), scalar.FloatsGet(0), begin, end);
+   FloatsCompare("PositionIntegrate", "positionY", vector.FloatsGet(1), scalar.FloatsGet(1), begin, end);
+
+   memcpy(&vector, source, sizeof(vector));
+   memcpy(&scalar, source, sizeof(scalar));
+   ParticleKernels2D::AngularIntegrate(vector.FloatsGet(0), vector.FloatsGet(1), vector.FloatsGet(2), vector.FloatsGet(5), begin, end, seconds);
+   ParticleKernels2D::AngularIntegrateScalar(scalar.FloatsGet(0), scalar.FloatsGet(1), scalar.FloatsGet(2), scalar.FloatsGet(5), begin, end, seconds);
+   FloatsCompare("AngularIntegrate", "rotation", vector.FloatsGet(0), scalar.FloatsGet(0), begin, end);
+   FloatsCompare("AngularIntegrate", "angularVelocity", vector.FloatsGet(1), scalar.FloatsGet(1), begin, end);
+
+   memcpy(&vector, source, sizeof(vector));
+   memcpy(&scalar, source, sizeof(scalar));
+   ParticleKernels2D::AgeAdvance(vector.AgeGet(), begin, end, 16);
+   ParticleKernels2D::AgeAdvanceScalar(scalar.AgeGet(), begin, end, 16);
+   Int32sCompare("AgeAdvance", "age", vector.AgeGet(), scalar.AgeGet(), begin, end);
+
+   const char* floatProgressName = progressionTable ? "FloatProgress with a table" : "FloatProgress";
+   memcpy(&vector, source, sizeof(vector));
+   memcpy(&scalar, source, sizeof(scalar));
+   ParticleKernels2D::FloatProgress(vector.FloatsGet(0), vector.AgeGet(), vector.LifeDurationGet(), begin, end, 2.0f, -3.0f, progressionTable);
+   ParticleKernels2D::FloatProgressScalar(scalar.FloatsGet(0), scalar.AgeGet(), scalar.LifeDurationGet(), begin, end, 2.0f, -3.0f, progressionTable);
+   FloatsCompare(floatProgressName, "values", vector.FloatsGet(0), scalar.FloatsGet(0), begin, end);
+
+   const char* colorProgressName = progressionTable ? "ColorProgress with a table" : "ColorProgress";
+   ColorRGBA8 colorBegin = ColorRGBA8::Create(255, 16, 200, 255);
+   ColorRGBA8 colorEnd = ColorRGBA8::Create(0, 240, 100, 0);
+   memcpy(&vector, source, sizeof(vector));
+   memcpy(&scalar, source, sizeof(scalar));
+   ParticleKernels2D::ColorProgress(vector.ColorsGet(), vector.AgeGet(), vector.LifeDurationGet(), begin, end, colorBegin, colorEnd, progressionTable);
+   ParticleKernels2D::ColorProgressScalar(scalar.ColorsGet(), scalar.AgeGet(), scalar.LifeDurationGet(), begin, end, colorBegin, colorEnd, progressionTable);
+   ColorsCompare(colorProgressName, vector.ColorsGet(), scalar.ColorsGet(), begin, end);
+}
+
+//------------------------------------------------------------------------------
+
+int main()
+{
+   printf("ParticleKernels2DCheck -- Checking %s against the scalar kernels.\n",
+      PARTICLE_KERNELS_2D_AVX2 ? "AVX2 and SSE2" : (PARTICLE_KERNELS_2D_SSE2 ? "SSE2" : "the scalar fallback"));
+
+   static ParticleKernelsCheckInput input;
+   InputFill(&input);
+   ProgressionTable progressionTable;
+   progressionTable.Init(theProgressionSmooth);
+
+   int rangeCount = 0;
+   for(int begin = 0; begin <= PARTICLE_KERNELS_CHECK_BEGIN_MAX; begin++)
+   {
+      for(int end = begin; end <= PARTICLE_KERNELS_CHECK_SIZE; end++)
+      {
+         RangeCheck(&input, begin, end, NULL);
+         RangeCheck(&input, begin, end, &progressionTable);
+         rangeCount++;
+      }
+   }
+
+   if(mismatchCount)
+   {
+      printf("ParticleKernels2DCheck -- %d mismatches in %d ranges.\n", mismatchCount, rangeCount);
+      return 1;
+   }
+   printf("ParticleKernels2DCheck -- All %d ranges match.\n", rangeCount);
+   return 0;
+}
@@ -0,0 +1,269 @@
+/// SpriteBatchCheck draws through a SpriteBatch into a
+/// SpriteBatchBackendRecording and checks the draw calls and bytes it
+/// records.  It covers splitting batches when the texture or mask changes,
+/// wrapping around the regions of the vertex buffer, and drawing 1000 sprites
+/// with 2 textures, both interleaved and grouped by texture.  No graphics
+/// context is needed, since nothing is actually drawn.
+///
+/// It prints each check that fails and returns 1 if there were any.
+///
+/// Build it as a console program linked with the Frog library.  It is not
+/// part of the library itself.
+
+#include <stdio.h>
+#include "FrogMemory.h"
+#include "Color.h"
+#include "Matrix43.h"
+#include "Texture.h"
+#include "SpriteBatch.h"
+
+using namespace Webfoot;
+
+/// Number of sprites drawn by the large check.
+#define SPRITE_BATCH_CHECK_SPRITE_COUNT 1000
+/// Quad capacity of the batch used to check wrapping, which gives each
+/// region room for 4 quads.
+#define SPRITE_BATCH_CHECK_WRAP_QUAD_CAPACITY (4 * SPRITE_BATCH_REGION_COUNT)
+
+//==============================================================================
+
+/// Texture that can be created without the Screen.  It is never initialized,
+/// since the batch only compares the pointers.
+class SpriteBatchCheckTexture : public Texture
+{
+};
+
+//==============================================================================
+
+/// Number of checks that failed so far.
+static int failureCount = 0;
+
+//------------------------------------------------------------------------------
+
+/// Print a message if 'actual' is not 'expected'.
+static void IntCheck(const char* checkName, const char* valueName, int actual, int expected)
+{
+   if(actual == expected)
+      return;
+   printf("SpriteBatchCheck -- %s: %s is %d, but it should be %d\n", checkName, valueName, actual, expected);
+   failureCount++;
+}
+
+//------------------------------------------------------------------------------
+
+/// Print a message if the given condition is false.
+static void TrueCheck(const char* checkName, const char* description, bool condition)
+{
+   if(condition)
+      return;
+   printf("SpriteBatchCheck -- %s: %s\n", checkName, description);
+   failureCount++;
+}
+
+//------------------------------------------------------------------------------
+
+/// Add a unit quad with the given texture.
+static void QuadAdd(SpriteBatch* spriteBatch, Texture* texture)
+{
+   static const float vertexBuffer[20] =
+   {
+      0.0f, 0.0f, 0.0f, 0.0f, 0.0f,
+      1.0f, 0.0f, 0.0f, 1.0f, 0.0f,
+      1.0f, 1.0f, 0.0f, 1.0f, 1.0f,
+      0.0f, 1.0f, 0.0f, 0.0f, 1.0f
+   };
+   spriteBatch->QuadAdd(vertexBuffer, texture);
+}
+
+//------------------------------------------------------------------------------
+
+/// Check that the batch and the backend agree on the number of draw calls and
+/// bytes, and that they match what was expected.
+static void CountsCheck(const char* checkName, SpriteBatch* spriteBatch, SpriteBatchBackendRecording* backend,
+   int drawCallCount, int quadCount)
+{
+   int byteCount = quadCount * 4 * (int)sizeof(SpriteBatchVertex);
+   IntCheck(checkName, "the number of draw calls recorded", backend->DrawCallCountGet(), drawCallCount);
+   IntCheck(checkName, "the number of draw calls counted", spriteBatch->DrawCallCountGet(), drawCallCount);
+   IntCheck(checkName, "the number of quads counted", spriteBatch->QuadCountGet(), quadCount);
+   IntCheck(checkName, "the number of bytes recorded", (int)backend->ByteCountGet(), byteCount);
+   IntCheck(checkName, "the number of bytes counted", (int)spriteBatch->ByteCountGet(), byteCount);
+}
+
+//------------------------------------------------------------------------------
+
+/// Check that a change of texture ends a batch, and that consecutive quads
+/// with the same texture share one.
+static void TextureSplitCheck(Texture* textureA, Texture* textureB)
+{
+   const char* checkName = "Texture split";
+   SpriteBatchBackendRecording backend;
+   backend.Init();
+   SpriteBatch spriteBatch;
+   spriteBatch.Init(&backend);
+
+   spriteBatch.Begin();
+   QuadAdd(&spriteBatch, textureA);
+   QuadAdd(&spriteBatch, textureA);
+   QuadAdd(&spriteBatch, textureB);
+   QuadAdd(&spriteBatch, textureB);
+   QuadAdd(&spriteBatch, textureB);
+   QuadAdd(&spriteBatch, textureA);
+   spriteBatch.End();
+
+   CountsCheck(checkName, &spriteBatch, &backend, 3, 6);
+   if(backend.DrawCallCountGet() == 3)
+   {
+      static const int quadCounts[3] = { 2, 3, 1 };
+      static const int vertexFirsts[3] = { 0, 8, 20 };
+      Texture* textures[3] = { textureA, textureB, textureA };
+      for(int drawCallIndex = 0; drawCallIndex < 3; drawCallIndex++)
+      {
+         const SpriteBatchBackendRecording::DrawCall& drawCall = backend.DrawCallGet(drawCallIndex);
+         IntCheck(checkName, "the number of quads in a draw call", drawCall.quadCount, quadCounts[drawCallIndex]);
+         IntCheck(checkName, "the first vertex of a draw call", drawCall.vertexFirst, vertexFirsts[drawCallIndex]);
+         TrueCheck(checkName, "A draw call has the wrong texture.", drawCall.state.texture == textures[drawCallIndex]);
+      }
+   }
+
+   spriteBatch.Deinit();
+   backend.Deinit();
+}
+
+//------------------------------------------------------------------------------
+
+/// Check that changing the mask ends a batch, and that setting the same mask
+/// again doesn't.
+static void MaskSplitCheck(Texture* texture, Texture* maskTexture)
+{
+   const char* checkName = "Mask split";
+   SpriteBatchBackendRecording backend;
+   backend.Init();
+   SpriteBatch spriteBatch;
+   spriteBatch.Init(&backend);
+   Matrix43 maskMatrix = Matrix43::Create(1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f,
+      MatrixFlag_Identity);
+   Matrix43 maskMatrixMoved = maskMatrix;
+   maskMatrixMoved.TranslationSet(8.0f, 0.0f, 0.0f);
+
+   spriteBatch.Begin();
+   QuadAdd(&spriteBatch, texture);
+   QuadAdd(&spriteBatch, texture);
+   spriteBatch.MaskSet(maskTexture, maskMatrix);
+   QuadAdd(&spriteBatch, texture);
+   spriteBatch.MaskSet(maskTexture, maskMatrix);
+   QuadAdd(&spriteBatch, texture);
+   spriteBatch.MaskSet(maskTexture, maskMatrixMoved);
+   QuadAdd(&spriteBatch, texture);
+   spriteBatch.MaskSet(NULL, maskMatrix);
+   QuadAdd(&spriteBatch, texture);
+   spriteBatch.End();
+
+   CountsCheck(checkName, &spriteBatch, &backend, 4, 6);
+   if(backend.DrawCallCountGet() == 4)
+   {
+      static const int quadCounts[4] = { 2, 2, 1, 1 };
+      Texture* maskTextures[4] = { NULL, maskTexture, maskTexture, NULL };
+      for(int drawCallIndex = 0; drawCallIndex < 4; drawCallIndex++)
+      {
+         const SpriteBatchBackendRecording::DrawCall& drawCall = backend.DrawCallGet(drawCallIndex);
+         IntCheck(checkName, "the number of quads in a draw call", drawCall.quadCount, quadCounts[drawCallIndex]);
+         TrueCheck(checkName, "A draw call has the wrong mask.", drawCall.state.maskTexture == maskTextures[drawCallIndex]);
+      }
+   }
+
+   spriteBatch.Deinit();
+   backend.Deinit();
+}
+
+//------------------------------------------------------------------------------
+
+/// Check that a batch ends when its region fills up, and that the regions
+/// are used in turn and wrap around to the first one.
+static void RegionWrapCheck(Texture* texture)
+{
+   const char* checkName = "Region wrap";
+   SpriteBatchBackendRecording backend;
+   backend.Init();
+   SpriteBatch spriteBatch;
+   spriteBatch.Init(&backend, SPRITE_BATCH_CHECK_WRAP_QUAD_CAPACITY);
+   int regionQuadCapacity = SPRITE_BATCH_CHECK_WRAP_QUAD_CAPACITY / SPRITE_BATCH_REGION_COUNT;
+
+   // Fill every region and part of the first one again.
+   int quadCount = (regionQuadCapacity * SPRITE_BATCH_REGION_COUNT) + 2;
+   spriteBatch.Begin();
+   for(int quadIndex = 0; quadIndex < quadCount; quadIndex++)
+      QuadAdd(&spriteBatch, texture);
+   spriteBatch.End();
+
+   CountsCheck(checkName, &spriteBatch, &backend, SPRITE_BATCH_REGION_COUNT + 1, quadCount);
+   IntCheck(checkName, "the number of fences", backend.RegionFenceCountGet(), SPRITE_BATCH_REGION_COUNT + 1);
+   IntCheck(checkName, "the number of waits", backend.RegionWaitCountGet(), SPRITE_BATCH_REGION_COUNT + 1);
+   if(backend.DrawCallCountGet() == SPRITE_BATCH_REGION_COUNT + 1)
+   {
+      for(int drawCallIndex = 0; drawCallIndex <= SPRITE_BATCH_REGION_COUNT; drawCallIndex++)
+      {
+         const SpriteBatchBackendRecording::DrawCall& drawCall = backend.DrawCallGet(drawCallIndex);
+         int regionIndex = drawCallIndex % SPRITE_BATCH_REGION_COUNT;
+         IntCheck(checkName, "the first vertex of a draw call", drawCall.vertexFirst, regionIndex * regionQuadCapacity * 4);
+         IntCheck(checkName, "the number of quads in a draw call", drawCall.quadCount,
+            (drawCallIndex < SPRITE_BATCH_REGION_COUNT) ? regionQuadCapacity : 2);
+      }
+   }
+
+   spriteBatch.Deinit();
+   backend.Deinit();
+}
+
+//------------------------------------------------------------------------------
+
+/// Check drawing many sprites with 2 textures, first alternating between
+/// them, which needs a draw call for each sprite, and then grouped by
+/// texture, which needs one for each texture.
+static void ManySpritesCheck(Texture* textureA, Texture* textureB)
+{
+   SpriteBatchBackendRecording backend;
+   backend.Init();
+   SpriteBatch spriteBatch;
+   spriteBatch.Init(&backend);
+
+   spriteBatch.Begin();
+   for(int spriteIndex = 0; spriteIndex < SPRITE_BATCH_CHECK_SPRITE_COUNT; spriteIndex++)
+      QuadAdd(&spriteBatch, (spriteIndex % 2) ? textureB : textureA);
+   spriteBatch.End();
+   CountsCheck("Many sprites interleaved", &spriteBatch, &backend, SPRITE_BATCH_CHECK_SPRITE_COUNT,
+      SPRITE_BATCH_CHECK_SPRITE_COUNT);
+
+   backend.Clear();
+   spriteBatch.StatisticsReset();
+   spriteBatch.Begin();
+   for(int spriteIndex = 0; spriteIndex < SPRITE_BATCH_CHECK_SPRITE_COUNT; spriteIndex++)
+      QuadAdd(&spriteBatch, (spriteIndex < SPRITE_BATCH_CHECK_SPRITE_COUNT / 2) ? textureA : textureB);
+   spriteBatch.End();
+   CountsCheck("Many sprites grouped", &spriteBatch, &backend, 2, SPRITE_BATCH_CHECK_SPRITE_COUNT);
+
+   spriteBatch.Deinit();
+   backend.Deinit();
+}
+
+//------------------------------------------------------------------------------
+
+int main()
+{
+   SpriteBatchCheckTexture textureA;
+   SpriteBatchCheckTexture textureB;
+   SpriteBatchCheckTexture maskTexture;
+
+   TextureSplitCheck(&textureA, &textureB);
+   MaskSplitCheck(&textureA, &maskTexture);
+   RegionWrapCheck(&textureA);
+   ManySpritesCheck(&textureA, &textureB);
+
+   if(failureCount)
+   {
+      printf("SpriteBatchCheck -- %d checks failed.\n", failureCount);
+      return 1;
+   }
+   printf("SpriteBatchCheck -- All checks passed.\n");
+   return 0;
+}
@@ -0,0 +1,484 @@
+#ifndef __FROG__TEXTUREATLASBUILDER_H__
+#define __FROG__TEXTUREATLASBUILDER_H__
+
+#include <string.h>
+#include "FrogMemory.h"
+#include "Debug.h"
+#include "Utility.h"
+#include "FrogString.h"
+#include "Table.h"
+#include "Point2.h"
+#include "Box2.h"
+#include "Bitmap.h"
+#include "BitmapManager.h"
+#include "BitmapLoaderPNG.h"
+#include "FileManager.h"
+#include "JSONValue.h"
+#include "JSONWriter.h"
+#include "RectanglePackerMaxRects.h"
+
+namespace Webfoot {
+
+/// Default maximum length of the edges of the pages of a texture atlas.
+#define TEXTURE_ATLAS_EDGE_MAX_DEFAULT 2048
+/// Default minimum length of the edges of the pages of a texture atlas.
+#define TEXTURE_ATLAS_EDGE_MIN_DEFAULT 16
+/// Default number of texels around each item of a texture atlas that are
+/// filled by repeating the item's edges, so filtering doesn't pick up the
+/// neighbors.
+#define TEXTURE_ATLAS_PADDING_DEFAULT 1
+
+//==============================================================================
+
+/// One of the rectangles of bitmap data packed by a TextureAtlasBuilder.
+struct TextureAtlasItem
+{
+   /// Name of the item for the saved description, or NULL.
+   char* name;
+   /// Bitmap with the item's texels.
+   Bitmap* bitmap;
+   /// Part of 'bitmap' to pack.
+   Box2I subset;
+   /// Data for the caller's own use.
+   void* userData;
+   /// Index of the page that contains the item, or -1 if it couldn't be
+   /// packed.
+   int pageIndex;
+   /// Where the item is on its page in texels, not including the padding.
+   Box2I box;
+};
+
+//==============================================================================
+
+/// TextureAtlasBuilder copies many small rectangles of bitmap data onto a
+/// few large pages, so the things drawn with them can share textures.  The
+/// rectangles are placed with RectanglePackerMaxRects, largest first, and a
+/// new page is started when one doesn't fit on any of the existing ones.
+/// Like the bitmaps made by BitmapSplitter, the edges of the pages are powers
+/// of 2 between the given minimum and maximum, and each page is shrunk to the
+/// smallest such size that holds what was placed on it.  Pages are always
+/// Bitmap::FORMAT_RGBA8.
+///
+/// It's used both by offline tools, which call Save to write the pages and a
+/// JSON description of where each item went, and at runtime by
+/// SpriteResourceFileAtlas.
+///
+///  builder.Init();
+///  builder.Add(bitmap, bitmap->DimensionsBoxGet(), "Player/Run0");
+///  ...
+///  builder.Build();
+///  builder.Save("Atlases/Player");
+///  builder.Deinit();
+class TextureAtlasBuilder
+{
+public:
+   /// Prepare to pack items onto pages with edges no longer than 'edgeMax'
+   /// and no shorter than 'edgeMin', both of which must be powers of 2.
+   /// Leave 'padding' texels around each item.
+   void Init(int _edgeMax = TEXTURE_ATLAS_EDGE_MAX_DEFAULT, int _edgeMin = TEXTURE_ATLAS_EDGE_MIN_DEFAULT,
+      int _padding = TEXTURE_ATLAS_PADDING_DEFAULT, HeapID _heapID = HEAP_DEFAULT);
+   /// Clean up, including the pages.
+   void Deinit();
+
+   /// Add the given part of the given bitmap to be packed by Build.  The
+   /// bitmap is not copied, so it must remain valid until Build returns.
+   /// 'name' is used to identify the item in the description written by Save.
+   /// Return the index of the item.
+   int Add(Bitmap* bitmap, const Box2I& subset, const char* name = NULL, void* userData = NULL);
+
+   /// Pack the items that have been added and create the pages, with data
+   /// from 'dataAllocator'.  Items too large for a page are left out.  Return
+   /// true if at least one item was packed.
+   bool Build(Allocator* dataAllocator = theAllocatorBitmapData);
+
+   /// Write each page to a PNG file named with the given prefix followed by
+   /// the page number, and write a description of the atlas to a JSON file
+   /// named with the prefix alone.  Return true if successful.
+   bool Save(const char* filenamePrefix, FileManager* fileManager = theFiles);
+   /// Set 'report' to a JSON object describing the pages, where each named
+   /// item went, and how efficiently the pages are used.  If
+   /// 'filenamePrefix' is given, include the filenames used by Save.
+   void ReportBuild(JSONValue* report, const char* filenamePrefix = NULL);
+   /// Print a summary of the packing results.
+   void ReportPrint();
+
+   /// Return the number of items that have been added.
+   int ItemCountGet() { return items.SizeGet(); }
+   /// Return the item with the given index.
+   const TextureAtlasItem* ItemGet(int itemIndex) { return &items[itemIndex]; }
+   /// Return the number of pages created by Build.
+   int PageCountGet() { return pages.SizeGet(); }
+   /// Return the page with the given index.
+   Bitmap* PageGet(int pageIndex) { return pages[pageIndex]; }
+
+   /// Return the number of items that were packed by Build.
+   int PackedCountGet() { return packedCount; }
+   /// Return the fraction of the area of the pages covered by packed items,
+   /// not counting the padding.
+   float EfficiencyGet();
+
+protected:
+   /// Orders the items so the largest are packed first.
+   struct ItemOrderComparator
+   {
+      bool operator()(const int& indexA, const int& indexB) const;
+      Table<TextureAtlasItem>* items;
+   };
+
+   /// Copy the given item to its place on its page, and repeat its edges into
+   /// the padding.  Return true if successful.
+   bool ItemCopy(TextureAtlasItem* item);
+   /// Delete the pages.
+   void PagesClear();
+
+   /// Heap for allocations.
+   HeapID heapID;
+   /// Maximum length of the edges of pages.
+   int edgeMax;
+   /// Minimum length of the edges of pages.
+   int edgeMin;
+   /// Texels around each item filled by repeating its edges.
+   int padding;
+   /// Items to pack.
+   Table<TextureAtlasItem> items;
+   /// Pages created by Build.
+   Table<Bitmap*> pages;
+   /// Number of items packed by Build.
+   int packedCount;
+};
+
+//==============================================================================
+
+inline void TextureAtlasBuilder::Init(int _edgeMax, int _edgeMin, int _padding, HeapID _heapID)
+{
+   assert((_edgeMax > 0) && PowerOf2Check(_edgeMax));
+   assert((_edgeMin > 0) && PowerOf2Check(_edgeMin) && (_edgeMin <= _edgeMax));
+   assert(_padding >= 0);
+   edgeMax = _edgeMax;
+   edgeMin = _edgeMin;
+   padding = _padding;
+   heapID = _heapID;
+   items.Init(theAllocatorHeaps[heapID]);
+   pages.Init(theAllocatorHeaps[heapID]);
+   packedCount = 0;
+}
+
+//------------------------------------------------------------------------------
+
+inline void TextureAtlasBuilder::Deinit()
+{
+   PagesClear();
+   for(int itemIndex = 0; itemIndex < items.SizeGet(); itemIndex++)
+   {
+      if(items[itemIndex].name)
+         StringDelete(items[itemIndex].name);
+   }
+   items.Deinit();
+   pages.Deinit();
+}
+
+//------------------------------------------------------------------------------
+
+inline int TextureAtlasBuilder::Add(Bitmap* bitmap, const Box2I& subset, const char* name, void* userData)
+{
+   assert(bitmap);
+   assert((subset.x >= 0) && (subset.y >= 0) && (subset.width > 0) && (subset.height > 0));
+   assert((subset.x + subset.width <= bitmap->WidthGet()) && (subset.y + subset.height <= bitmap->HeightGet()));
+   TextureAtlasItem item;
+   item.name = name ? StringClone(name, heapID) : NULL;
+   item.bitmap = bitmap;
+   item.subset = subset;
+   item.userData = userData;
+   item.pageIndex = -1;
+   item.box = Box2I::Create(0, 0, 0, 0);
+   items.Add(item);
+   return items.SizeGet() - 1;
+}
+
+//------------------------------------------------------------------------------
+
+inline bool TextureAtlasBuilder::Build(Allocator* dataAllocator)
+{
+   PagesClear();
+   packedCount = 0;
+   int itemCount = items.SizeGet();
+   if(!itemCount)
+      return false;
+
+   Table<int> order;
+   order.Init(theAllocatorTemp);
+   order.SizeSet(itemCount);
+   for(int itemIndex = 0; itemIndex < itemCount; itemIndex++)
+      order[itemIndex] = itemIndex;
+   ItemOrderComparator comparator;
+   comparator.items = &items;
+   order.Sort(comparator);
+
+   // Every page starts at the largest size, and the unused part is trimmed
+   // once everything is placed.
+   Table<RectanglePackerMaxRects*> packers;
+   packers.Init(theAllocatorTemp);
+   Point2I binSize = Point2I::Create(edgeMax, edgeMax);
+   for(int orderIndex = 0; orderIndex < itemCount; orderIndex++)
+   {
+      TextureAtlasItem* item = &items[order[orderIndex]];
+      item->pageIndex = -1;
+      Point2I paddedSize = Point2I::Create(item->subset.width + (padding * 2), item->subset.height + (padding * 2));
+      if((paddedSize.x > edgeMax) || (paddedSize.y > edgeMax))
+         continue;
+
+      Box2I paddedBox;
+      int pageIndex = 0;
+      for(; pageIndex < packers.SizeGet(); pageIndex++)
+      {
+         if(packers[pageIndex]->Insert(paddedSize, &paddedBox))
+            break;
+      }
+      if(pageIndex == packers.SizeGet())
+      {
+         RectanglePackerMaxRects* packer = frog_new_ex(HEAP_TEMP) RectanglePackerMaxRects();
+         packer->Init(binSize, HEAP_TEMP);
+         packers.Add(packer);
+         if(!packer->Insert(paddedSize, &paddedBox))
+            continue;
+      }
+      item->pageIndex = pageIndex;
+      item->box = Box2I::Create(paddedBox.x + padding, paddedBox.y + padding, item->subset.width, item->subset.height);
+   }
+   order.Deinit();
+
+   bool success = true;
+   for(int pageIndex = 0; pageIndex < packers.SizeGet(); pageIndex++)
+   {
+      RectanglePackerMaxRects* packer = packers[pageIndex];
+      Point2I extent = packer->UsedExtentGet();
+      Point2I pageSize = Point2I::Create(PowerOf2Ceil(extent.x), PowerOf2Ceil(extent.y));
+      if(pageSize.x < edgeMin)
+         pageSize.x = edgeMin;
+      if(pageSize.y < edgeMin)
+         pageSize.y = edgeMin;
+      packer->Deinit();
+      frog_delete packer;
+
+      Bitmap* page = theBitmaps->BitmapCreate(Bitmap::FORMAT_RGBA8, heapID);
+      if(!page || !page->Allocate(pageSize, Bitmap::FORMAT_RGBA8, dataAllocator))
+      {
+         WarningPrintf("TextureAtlasBuilder::Build -- Unable to allocate a page of %d x %d.\n", pageSize.x, pageSize.y);
+         if(page)
+         {
+            page->Deinit();
+            frog_delete page;
+         }
+         page = NULL;
+         success = false;
+      }
+      else
+      {
+         page->Clear();
+      }
+      pages.Add(page);
+   }
+   packers.Deinit();
+
+   for(int itemIndex = 0; itemIndex < itemCount; itemIndex++)
+   {
+      TextureAtlasItem* item = &items[itemIndex];
+      if(item->pageIndex == -1)
+         continue;
+      if(pages[item->pageIndex] && ItemCopy(item))
+         packedCount++;
+      else
+         item->pageIndex = -1;
+   }
+   return success && (packedCount > 0);
+}
+
+//------------------------------------------------------------------------------
+
+inline bool TextureAtlasBuilder::Save(const char* filenamePrefix, FileManager* fileManager)
+{
+   assert(filenamePrefix);
+   char filename[FROG_PATH_MAX+1];
+   bool success = true;
+   for(int pageIndex = 0; pageIndex < pages.SizeGet(); pageIndex++)
+   {
+      if(!pages[pageIndex] || !FrogSnprintf(filename, sizeof(filename), "%s%d.png", filenamePrefix, pageIndex)
+         || !theBitmapLoaderPNG->Save(pages[pageIndex], filename, fileManager))
+      {
+         WarningPrintf("TextureAtlasBuilder::Save -- Unable to save page %d of %s.\n", pageIndex, filenamePrefix);
+         success = false;
+      }
+   }
+
+   JSONValue report;
+   report.Init(heapID);
+   ReportBuild(&report, filenamePrefix);
+   JSONWriter writer;
+   success = writer.Save(filenamePrefix, fileManager, &report) && success;
+   report.Deinit();
+   return success;
+}
+
+//------------------------------------------------------------------------------
+
+inline void TextureAtlasBuilder::ReportBuild(JSONValue* report, const char* filenamePrefix)
+{
+   assert(report);
+   report->ObjectSet();
+   char filename[FROG_PATH_MAX+1];
+   JSONValue& pagesValue = report->ArraySet("Pages");
+   for(int pageIndex = 0; pageIndex < pages.SizeGet(); pageIndex++)
+   {
+      JSONValue& pageValue = pagesValue.ObjectAdd();
+      if(filenamePrefix && FrogSnprintf(filename, sizeof(filename), "%s%d", filenamePrefix, pageIndex))
+         pageValue.Set("Filename", (const char*)filename);
+      if(pages[pageIndex])
+         pageValue.Set("Size", pages[pageIndex]->SizeGet());
+   }
+
+   JSONValue& itemsValue = report->ObjectSet("Items");
+   int unpackedCount = 0;
+   for(int itemIndex = 0; itemIndex < items.SizeGet(); itemIndex++)
+   {
+      TextureAtlasItem* item = &items[itemIndex];
+      if(item->pageIndex == -1)
+         unpackedCount++;
+      if(!item->name)
+         continue;
+      JSONValue& itemValue = itemsValue.ObjectSet(item->name);
+      itemValue.Set("Page", item->pageIndex);
+      if(item->pageIndex != -1)
+         itemValue.Set("Box", Box2F::Create(item->box));
+   }
+
+   report->Set("PackedCount", packedCount);
+   report->Set("UnpackedCount", unpackedCount);
+   report->Set("Efficiency", EfficiencyGet());
+}
+
+//------------------------------------------------------------------------------
+
+inline void TextureAtlasBuilder::ReportPrint()
+{
+   int64 pageArea = 0;
+   for(int pageIndex = 0; pageIndex < pages.SizeGet(); pageIndex++)
+   {
+      if(!pages[pageIndex])
+         continue;
+      Point2I size = pages[pageIndex]->SizeGet();
+      pageArea += (int64)size.x * size.y;
+      DebugPrintf("TextureAtlasBuilder -- Page %d: %d x %d\n", pageIndex, size.x, size.y);
+   }
+   DebugPrintf("TextureAtlasBuilder -- %d of %d items packed onto %d pages of %d texels, %.1f%% efficient.\n",
+      packedCount, items.SizeGet(), pages.SizeGet(), (int)pageArea, EfficiencyGet() * 100.0f);
+}
+
+//------------------------------------------------------------------------------
+
+inline float TextureAtlasBuilder::EfficiencyGet()
+{
+   int64 itemArea = 0;
+   for(int itemIndex = 0; itemIndex < items.SizeGet(); itemIndex++)
+   {
+      if(items[itemIndex].pageIndex != -1)
+         itemArea += (int64)items[itemIndex].box.width * items[itemIndex].box.height;
+   }
+   int64 pageArea = 0;
+   for(int pageIndex = 0; pageIndex < pages.SizeGet(); pageIndex++)
+   {
+      if(pages[pageIndex])
+         pageArea += (int64)pages[pageIndex]->WidthGet() * pages[pageIndex]->HeightGet();
+   }
+   return pageArea ? (float)((double)itemArea / (double)pageArea) : 0.0f;
+}
+
+//------------------------------------------------------------------------------
+
+inline bool TextureAtlasBuilder::ItemOrderComparator::operator()(const int& indexA, const int& indexB) const
+{
+   // Longest edge first, then largest area, then the order they were added.
+   const TextureAtlasItem& itemA = (*items)[indexA];
+   const TextureAtlasItem& itemB = (*items)[indexB];
+   int edgeA = (itemA.subset.width > itemA.subset.height) ? itemA.subset.width : itemA.subset.height;
+   int edgeB = (itemB.subset.width > itemB.subset.height) ? itemB.subset.width : itemB.subset.height;
+   if(edgeA != edgeB)
+      return edgeA > edgeB;
+   int areaA = itemA.subset.width * itemA.subset.height;
+   int areaB = itemB.subset.width * itemB.subset.height;
+   if(areaA != areaB)
+      return areaA > areaB;
+   return indexA < indexB;
+}
+
+//------------------------------------------------------------------------------
+
+inline bool TextureAtlasBuilder::ItemCopy(TextureAtlasItem* item)
+{
+   Bitmap* source = item->bitmap;
+   Bitmap* converted = NULL;
+   if(source->FormatGet() != Bitmap::FORMAT_RGBA8)
+   {
+      converted = theBitmaps->BitmapConvert(Bitmap::FORMAT_RGBA8, source, HEAP_TEMP, theAllocatorTemp);
+      source = converted;
+   }
+   if(!source || !source->DataGet())
+   {
+      WarningPrintf("TextureAtlasBuilder::ItemCopy -- No RGBA8 data is available for item %s.\n",
+         item->name ? item->name : "");
+      if(converted)
+      {
+         converted->Deinit();
+         frog_delete converted;
+      }
+      return false;
+   }
+
+   Bitmap* page = pages[item->pageIndex];
+   int pageWidth = page->WidthGet();
+   int sourceWidth = source->WidthGet();
+   uint32* pageData = (uint32*)page->DataGet();
+   const uint32* sourceData = (const uint32*)source->DataGet();
+   int width = item->subset.width;
+   int height = item->subset.height;
+   for(int row = -padding; row < height + padding; row++)
+   {
+      // Rows in the padding repeat the nearest edge row.
+      int sourceRow = (row < 0) ? 0 : ((row >= height) ? (height - 1) : row);
+      const uint32* sourceLine = sourceData + ((size_t)(item->subset.y + sourceRow) * sourceWidth) + item->subset.x;
+      uint32* pageLine = pageData + ((size_t)(item->box.y + row) * pageWidth) + item->box.x;
+      memcpy(pageLine, sourceLine, width * sizeof(uint32));
+      for(int column = 1; column <= padding; column++)
+      {
+         pageLine[-column] = sourceLine[0];
+         pageLine[width - 1 + column] = sourceLine[width - 1];
+      }
+   }
+
+   if(converted)
+   {
+      converted->Deinit();
+      frog_delete converted;
+   }
+   return true;
+}
+
+//------------------------------------------------------------------------------
+
+inline void TextureAtlasBuilder::PagesClear()
+{
+   for(int pageIndex = 0; pageIndex < pages.SizeGet(); pageIndex++)
+   {
+      if(pages[pageIndex])
+      {
+         pages[pageIndex]->Deinit();
+         frog_delete pages[pageIndex];
+      }
+   }
+   pages.Clear();
+}
+
+//------------------------------------------------------------------------------
+
+} //namespace Webfoot {
+
+#endif //#ifndef __FROG__TEXTUREATLASBUILDER_H__
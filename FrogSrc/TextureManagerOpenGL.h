@@ -2,10 +2,14 @@
 #define __FROG__TEXTUREMANAGEROPENGL_H__
 
 #include "FrogMemory.h"
+#include "Debug.h"
 #include "Allocator.h"
 #include "FileManager.h"
 #include "Texture.h"
 #include "TextureManagerCommon.h"
+#include "Bitmap.h"
+#include "BitmapManager.h"
+#include "Screen.h"
 
 namespace Webfoot {
 
@@ -35,6 +39,17 @@ public:
    /// Free the object with theTextures->Unload when you're done.
    Texture* CloneCreate(Texture* sourceTexture, Allocator* dataAllocator = theAllocatorBitmapData,
       HeapID objectHeap = HEAP_DEFAULT);
+
+   /// Register a Texture for the given file made from a Bitmap that was
+   /// already loaded with theBitmaps->Load, as though Load had been called
+   /// with the default options.  This lets the slow part of loading, reading
+   /// and decoding the file, happen elsewhere, like on a worker thread.  The
+   /// alpha of 'bitmap' should already be premultiplied.  The Texture takes
+   /// ownership of 'bitmap', and if the file is already loaded, 'bitmap' is
+   /// freed and the existing Texture's reference count is incremented
+   /// instead.  Free the Texture with Unload.  Return NULL if unsuccessful.
+   Texture* BitmapAdd(const char* filename, Bitmap* bitmap, HeapID objectHeap = HEAP_DEFAULT,
+      FileManager* fileManager = theFiles);
    
    /// Singleton instance
    static TextureManagerOpenGL instance;
@@ -87,6 +102,43 @@ static TextureManagerOpenGL * const theTextures = &TextureManagerOpenGL::instanc
 
 //==============================================================================
 
+inline Texture* TextureManagerOpenGL::BitmapAdd(const char* filename, Bitmap* bitmap, HeapID objectHeap,
+   FileManager* fileManager)
+{
+   assert(filename);
+   assert(bitmap);
+   Texture* texture = (Texture*)textures.Increment(filename, fileManager);
+   if(texture)
+   {
+      theBitmaps->Unload(bitmap);
+      return texture;
+   }
+
+   texture = theScreen->TextureCreate(objectHeap);
+   if(!texture->Init(objectHeap) || !texture->BitmapSet(bitmap))
+   {
+      texture->Deinit();
+      frog_delete texture;
+      theBitmaps->Unload(bitmap);
+      return NULL;
+   }
+
+   void* metadata = NULL;
+#if defined _DEBUG && PLATFORM_IS_WINDOWS
+   TextureMetadata* textureMetadata = frog_new_ex(objectHeap) TextureMetadata;
+   textureMetadata->options = 0;
+   textureMetadata->dataAllocator = theAllocatorBitmapData;
+   textureMetadata->objectHeap = objectHeap;
+   textureMetadata->tempHeap = HEAP_TEMP;
+   textureMetadata->fileModificationTime = theBitmaps->FileModificationTimeGet(filename, fileManager);
+   metadata = textureMetadata;
+#endif
+   textures.Add(filename, fileManager, texture, metadata);
+   return texture;
+}
+
+//==============================================================================
+
 } //namespace Webfoot {
 
 #endif //#ifndef __FROG__TEXTUREMANAGEROPENGL_H__
@@ -63,6 +63,8 @@ public:
    static void Sleep(unsigned int duration) { (void)duration; }
    /// Allow other threads to run.
    static void Yield() {}
+   /// Return the number of threads the hardware can run at once.
+   static int ProcessorCountGet() { return 1; }
 
    /// Check the guard bytes of the stack and return true if everything appears fine.
    /// Not supported on all platforms.
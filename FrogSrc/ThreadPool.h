@@ -0,0 +1,225 @@
+#ifndef __FROG__THREADPOOL_H__
+#define __FROG__THREADPOOL_H__
+
+#include "FrogMemory.h"
+#include "Table.h"
+#include "Thread.h"
+
+namespace Webfoot {
+
+/// Stack size used for the worker threads of a ThreadPool.
+#define THREAD_POOL_STACK_SIZE (256 * 1024)
+
+//==============================================================================
+
+/// ThreadPool runs jobs on a set of worker threads.  Jobs are started in the
+/// order they were added, but they may run concurrently and finish in any
+/// order.  The thread that calls Wait also runs jobs until all of them are
+/// finished, so work still gets done on platforms where threads aren't
+/// supported and a pool with no worker threads is useful as well.
+///
+/// Jobs must not call Add or Wait on the pool that is running them, and only
+/// one thread at a time should call Wait.
+class ThreadPool
+{
+public:
+   /// Function called to run a job.
+   typedef void (*JobFunction)(void* userData);
+
+   ThreadPool() { threadCount = 0; quitting = false; jobHead = 0; jobsRunningCount = 0; }
+
+   /// Start the given number of worker threads.  If 'threadCount' is
+   /// negative, start one fewer than the number of processors, since the
+   /// thread that calls Wait does work as well.  Memory is drawn from the
+   /// given heap.
+   void Init(int _threadCount = -1, HeapID heapID = HEAP_DEFAULT);
+   /// Finish any remaining jobs and stop the worker threads.
+   void Deinit();
+
+   /// Queue the given function to be called with the given data on a worker
+   /// thread.
+   void Add(JobFunction function, void* userData);
+   /// Run queued jobs on the calling thread and wait until all jobs that have
+   /// been added are finished.
+   void Wait();
+   /// If a job is queued, run it on the calling thread and return true.
+   /// Otherwise, return false immediately.  This lets a thread help with the
+   /// queue without waiting for jobs that are already running.
+   bool JobRunTry();
+
+   /// Return the number of worker threads.
+   int ThreadCountGet() { return threadCount; }
+
+protected:
+   /// A job waiting to be run.
+   struct Job
+   {
+      JobFunction function;
+      void* userData;
+   };
+
+   /// Entry point for the worker threads.
+   static void WorkerRun(void* userData);
+   /// Run the next queued job.  The mutex must be locked, and it is unlocked
+   /// while the job runs.  Return false if no jobs were queued.
+   bool JobRun();
+
+   /// Worker threads.
+   Table<Thread*> threads;
+   /// Number of worker threads.
+   int threadCount;
+   /// True if the worker threads should stop once the queue is empty.
+   bool quitting;
+   /// Jobs that have been added.  Jobs before 'jobHead' have been started.
+   Table<Job> jobs;
+   /// Index of the next job to start.
+   int jobHead;
+   /// Number of jobs that have been started but haven't finished.
+   int jobsRunningCount;
+   /// Protects the queue and counts.
+   Mutex mutex;
+   /// Notified when a job is added or the pool is shutting down.
+   ConditionVariable jobAddedCondition;
+   /// Notified when a job finishes.
+   ConditionVariable jobFinishedCondition;
+};
+
+//==============================================================================
+
+inline void ThreadPool::Init(int _threadCount, HeapID heapID)
+{
+   threadCount = (_threadCount >= 0) ? _threadCount : (Thread::ProcessorCountGet() - 1);
+   quitting = false;
+   jobHead = 0;
+   jobsRunningCount = 0;
+   mutex.Init();
+   jobAddedCondition.Init();
+   jobFinishedCondition.Init();
+   jobs.Init(theAllocatorHeaps[heapID]);
+   threads.Init(theAllocatorHeaps[heapID]);
+
+   for(int threadIndex = 0; threadIndex < threadCount; threadIndex++)
+   {
+      Thread* thread = frog_new_ex(heapID) Thread();
+      thread->Init(WorkerRun, this, Thread::PRIORITY_DEFAULT, THREAD_POOL_STACK_SIZE, heapID);
+      threads.Add(thread);
+   }
+}
+
+//------------------------------------------------------------------------------
+
+inline void ThreadPool::Deinit()
+{
+   Wait();
+
+   mutex.Lock();
+   quitting = true;
+   mutex.Unlock();
+   // Notify may only wake one waiting thread on some platforms.
+   for(int threadIndex = 0; threadIndex < threads.SizeGet(); threadIndex++)
+      jobAddedCondition.Notify();
+
+   for(int threadIndex = 0; threadIndex < threads.SizeGet(); threadIndex++)
+   {
+      threads[threadIndex]->Join();
+      threads[threadIndex]->Deinit();
+      frog_delete threads[threadIndex];
+   }
+   threads.Deinit();
+   threadCount = 0;
+
+   jobs.Deinit();
+   jobFinishedCondition.Deinit();
+   jobAddedCondition.Deinit();
+   mutex.Deinit();
+}
+
+//------------------------------------------------------------------------------
+
+inline void ThreadPool::Add(JobFunction function, void* userData)
+{
+   assert(function);
+   Job job;
+   job.function = function;
+   job.userData = userData;
+
+   mutex.Lock();
+   jobs.Add(job);
+   mutex.Unlock();
+   jobAddedCondition.Notify();
+}
+
+//------------------------------------------------------------------------------
+
+inline void ThreadPool::Wait()
+{
+   mutex.Lock();
+   while(true)
+   {
+      if(JobRun())
+         continue;
+      if(jobsRunningCount == 0)
+         break;
+      jobFinishedCondition.Wait(&mutex);
+   }
+   mutex.Unlock();
+}
+
+//------------------------------------------------------------------------------
+
+inline bool ThreadPool::JobRunTry()
+{
+   mutex.Lock();
+   bool jobRan = JobRun();
+   mutex.Unlock();
+   return jobRan;
+}
+
+//------------------------------------------------------------------------------
+
+inline bool ThreadPool::JobRun()
+{
+   if(jobHead >= jobs.SizeGet())
+      return false;
+
+   Job job = jobs[jobHead];
+   jobHead++;
+   jobsRunningCount++;
+   mutex.Unlock();
+
+   job.function(job.userData);
+
+   mutex.Lock();
+   jobsRunningCount--;
+   // Reuse the queue's memory once everything in it has been started.
+   if(jobHead == jobs.SizeGet())
+   {
+      jobs.Clear();
+      jobHead = 0;
+   }
+   jobFinishedCondition.Notify();
+   return true;
+}
+
+//------------------------------------------------------------------------------
+
+inline void ThreadPool::WorkerRun(void* userData)
+{
+   ThreadPool* pool = (ThreadPool*)userData;
+   pool->mutex.Lock();
+   while(true)
+   {
+      if(pool->JobRun())
+         continue;
+      if(pool->quitting)
+         break;
+      pool->jobAddedCondition.Wait(&pool->mutex);
+   }
+   pool->mutex.Unlock();
+}
+
+//------------------------------------------------------------------------------
+
+} //namespace Webfoot {
+
+#endif //#ifndef __FROG__THREADPOOL_H__
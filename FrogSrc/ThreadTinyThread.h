@@ -68,6 +68,13 @@ public:
    static void Sleep(unsigned int duration);
    /// Allow other threads to run.
    static void Yield();
+   /// Return the number of threads the hardware can run at once, or 1 if that
+   /// can't be determined.
+   static int ProcessorCountGet()
+   {
+      unsigned int processorCount = tthread::thread::hardware_concurrency();
+      return processorCount ? (int)processorCount : 1;
+   }
 
    /// Check the guard bytes of the stack and return true if everything appears fine.
    /// Not supported on all platforms.
@@ -0,0 +1,194 @@
+/// FileArchivePack builds an archive for FileManagerArchive from a list of
+/// files, using FileArchiveWriter.
+///
+///    FileArchivePack [-threads <count>] [-chunk <size>] <archive> <list> [sourcePath]
+///
+/// 'list' is a text file with one entry per line, optionally followed by the
+/// codec to compress it with:
+///
+///    Images/Title.png store
+///    Levels/Level1.json deflate
+///    Sprites/Player.xml
+///
+/// The codec is one of "store", "lz4", or "deflate", and defaults to "lz4".
+/// Each entry is read from 'sourcePath', or the current folder if it's not
+/// given, and is stored in the archive under the name as listed, which is the
+/// name that will be passed to Open.  Names can't contain spaces.
+///
+/// '-threads' sets the number of worker threads used for compression in
+/// addition to the calling thread.  By default, all processors are used.  The
+/// archive is the same no matter how many threads there are.  '-chunk' sets
+/// the uncompressed size of each chunk in bytes.
+///
+/// Build it as a console program linked with the Frog library.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "FrogMemory.h"
+#include "Utility.h"
+#include "Table.h"
+#include "File.h"
+#include "FileManagerStdio.h"
+#include "FileArchive.h"
+#include "FileArchiveWriter.h"
+
+using namespace Webfoot;
+
+//==============================================================================
+
+/// Names of the codecs as they appear in the list, in the order of
+/// FileArchiveCodec.
+static const char* fileArchivePackCodecNames[FILE_ARCHIVE_CODEC_COUNT] = { "store", "lz4", "deflate" };
+
+//------------------------------------------------------------------------------
+
+/// Set 'codec' to the codec with the given name.  Return true if successful.
+static bool CodecParse(const char* name, FileArchiveCodec* codec)
+{
+   for(int codecIndex = 0; codecIndex < FILE_ARCHIVE_CODEC_COUNT; codecIndex++)
+   {
+      if(!strcmp(name, fileArchivePackCodecNames[codecIndex]))
+      {
+         *codec = (FileArchiveCodec)codecIndex;
+         return true;
+      }
+   }
+   return false;
+}
+
+//------------------------------------------------------------------------------
+
+/// Load each file listed in 'listFilename' from 'sourceFileManager' and add
+/// it to 'writer'.  The loaded data is added to 'datas' so it can be freed
+/// after the archive is written.  Return the number of entries added, or -1
+/// if the list couldn't be read or has a mistake.
+static int EntriesAdd(FileManager* sourceFileManager, const char* listFilename, FileArchiveWriter* writer,
+   Table<void*>* datas)
+{
+   FILE* listFile = fopen(listFilename, "r");
+   if(!listFile)
+   {
+      printf("FileArchivePack -- Unable to read %s\n", listFilename);
+      return -1;
+   }
+
+   int addedCount = 0;
+   int lineNumber = 0;
+   char line[FROG_PATH_MAX+32];
+   while(fgets(line, sizeof(line), listFile))
+   {
+      lineNumber++;
+      char name[FROG_PATH_MAX+1];
+      char codecName[32];
+      char extra[2];
+      bool nameSuccess = false;
+      bool codecSuccess = true;
+      bool extraSuccess = true;
+      const char* nextPosition = UTF8Strtok(line, " \t\r\n", name, sizeof(name), &nameSuccess);
+      if(!nextPosition)
+         continue;
+      FileArchiveCodec codec = FILE_ARCHIVE_CODEC_LZ4;
+      nextPosition = UTF8Strtok(nextPosition, " \t\r\n", codecName, sizeof(codecName), &codecSuccess);
+      if(nextPosition && !(codecSuccess && CodecParse(codecName, &codec)))
+         codecSuccess = false;
+      if(nextPosition && UTF8Strtok(nextPosition, " \t\r\n", extra, sizeof(extra), &extraSuccess))
+         extraSuccess = false;
+      if(!nameSuccess || !codecSuccess || !extraSuccess)
+      {
+         printf("FileArchivePack -- Line %d of %s should be a name followed by store, lz4, or deflate.\n",
+            lineNumber, listFilename);
+         addedCount = -1;
+         break;
+      }
+
+      size_t size = 0;
+      void* data = sourceFileManager->FileLoad(name, &size);
+      if(!data)
+      {
+         printf("FileArchivePack -- Unable to read %s\n", name);
+         addedCount = -1;
+         break;
+      }
+      datas->Add(data);
+      if(!writer->Add(name, data, size, codec))
+      {
+         printf("FileArchivePack -- Unable to add %s\n", name);
+         addedCount = -1;
+         break;
+      }
+      addedCount++;
+   }
+   fclose(listFile);
+   return addedCount;
+}
+
+//------------------------------------------------------------------------------
+
+int main(int argc, char** argv)
+{
+   int threadCount = -1;
+   size_t chunkSize = FILE_ARCHIVE_CHUNK_SIZE_DEFAULT;
+   int argIndex = 1;
+   for(; (argIndex + 1 < argc) && (argv[argIndex][0] == '-'); argIndex += 2)
+   {
+      if(!strcmp(argv[argIndex], "-threads"))
+         threadCount = atoi(argv[argIndex + 1]);
+      else if(!strcmp(argv[argIndex], "-chunk"))
+         chunkSize = (size_t)atol(argv[argIndex + 1]);
+      else
+         break;
+   }
+   if((argc - argIndex < 2) || (threadCount < -1) || !chunkSize)
+   {
+      printf("Usage: FileArchivePack [-threads <count>] [-chunk <size>] <archive> <list> [sourcePath]\n");
+      return 1;
+   }
+   const char* archiveFilename = argv[argIndex];
+   const char* listFilename = argv[argIndex + 1];
+   const char* sourcePath = (argc - argIndex > 2) ? argv[argIndex + 2] : NULL;
+
+   // The sources are read relative to 'sourcePath', but the archive is
+   // written relative to the current folder.
+   FileManagerStdio fileManager;
+   if(!fileManager.Init())
+      return 1;
+   FileManagerStdio sourceFileManager;
+   if(!sourceFileManager.Init(sourcePath))
+   {
+      printf("FileArchivePack -- Unable to use %s as the source path.\n", sourcePath);
+      fileManager.Deinit();
+      return 1;
+   }
+
+   FileArchiveWriter writer;
+   writer.Init(chunkSize);
+   Table<void*> datas;
+   datas.Init(theAllocatorMallocFree);
+   int addedCount = EntriesAdd(&sourceFileManager, listFilename, &writer, &datas);
+
+   bool success = false;
+   if(addedCount >= 0)
+   {
+      File* archive = fileManager.Open(archiveFilename, FileManager::WRITE);
+      if(archive)
+      {
+         success = writer.Write(archive, threadCount);
+         success = fileManager.Close(archive) && success;
+      }
+      if(!success)
+         printf("FileArchivePack -- Unable to write %s\n", archiveFilename);
+   }
+
+   for(int dataIndex = 0; dataIndex < datas.SizeGet(); dataIndex++)
+      sourceFileManager.FileUnload(datas[dataIndex]);
+   datas.Deinit();
+   writer.Deinit();
+   sourceFileManager.Deinit();
+   fileManager.Deinit();
+
+   if(!success)
+      return 1;
+   printf("FileArchivePack -- Packed %d entries into %s\n", addedCount, archiveFilename);
+   return 0;
+}
@@ -0,0 +1,154 @@
+/// FileDatIndexAppend adds a name index section to an existing resource
+/// file, so FileManagerDatMapped can look up its entries without searching
+/// the table of contents.
+///
+///    FileDatIndexAppend <archive> <names> [rootPath]
+///
+/// 'names' is a text file listing one name per line, as it will be passed to
+/// Open.  Each name is resolved through FileManagerDat, so only names that
+/// it can find are indexed, and the entries come straight from the archive's
+/// own table of contents.  If the archive will be used with a root path,
+/// pass the same root path here, since the index stores full names.  Names
+/// left out of the list still work; they're just found the slow way.
+///
+/// The index is appended to the archive in place.  Archives that already
+/// have an index are left alone, so rebuild the archive to change the list.
+///
+/// Build it as a console program linked with the Frog library.
+
+#include <stdio.h>
+#include <string.h>
+#include "FrogMemory.h"
+#include "Utility.h"
+#include "File.h"
+#include "FileManagerStdio.h"
+#include "FileManagerDatMapped.h"
+#include "FileDatIndex.h"
+
+using namespace Webfoot;
+
+//==============================================================================
+
+/// FileManagerDatMapped with access to its lookups, so the entries can be
+/// found the same way they will be at runtime.
+class FileDatIndexSource : public FileManagerDatMapped
+{
+public:
+   /// Return the information for the given file, or NULL if it doesn't
+   /// exist.
+   const WT_IO_DAT_INFO* InfoGet(const char* filename) { return EntryInfoGet(filename); }
+   /// Return the root path passed to Init.
+   const char* RootPathGet() { return rootPath; }
+};
+
+//==============================================================================
+
+/// Add the entry for each name listed in 'namesFilename' to 'writer'.  Return
+/// the number of entries added, or -1 if the list couldn't be read.
+static int NamesAdd(FileDatIndexSource* source, const char* namesFilename, FileDatIndexWriter* writer)
+{
+   FILE* namesFile = fopen(namesFilename, "r");
+   if(!namesFile)
+      return -1;
+
+   const char* rootPath = source->RootPathGet();
+   size_t rootPathLength = strlen(rootPath);
+   const char* separator = (rootPathLength && (rootPath[rootPathLength-1] != '/')) ? "/" : "";
+   int addedCount = 0;
+   char name[FROG_PATH_MAX+1];
+   char path[FROG_PATH_MAX+1];
+   while(fgets(name, sizeof(name), namesFile))
+   {
+      size_t nameLength = strlen(name);
+      while(nameLength && ((name[nameLength-1] == '\n') || (name[nameLength-1] == '\r')))
+         name[--nameLength] = '\0';
+      if(!nameLength)
+         continue;
+
+      const WT_IO_DAT_INFO* info = source->InfoGet(name);
+      if(!info)
+      {
+         printf("FileDatIndexAppend -- '%s' is not in the archive and will be skipped.\n", name);
+         continue;
+      }
+      // The index is searched with the root path prepended, as in
+      // FileManagerDatMapped::EntryInfoGet.
+      if(!FrogSnprintf(path, sizeof(path), "%s%s%s", rootPath, separator, name))
+      {
+         printf("FileDatIndexAppend -- '%s' is too long and will be skipped.\n", name);
+         continue;
+      }
+      // The info may not be aligned, so copy it.
+      WT_IO_DAT_INFO infoCopy;
+      memcpy(&infoCopy, info, sizeof(infoCopy));
+      if(writer->Add(path, infoCopy))
+         addedCount++;
+   }
+   fclose(namesFile);
+   return addedCount;
+}
+
+//------------------------------------------------------------------------------
+
+int main(int argc, char** argv)
+{
+   if(argc < 3)
+   {
+      printf("Usage: FileDatIndexAppend <archive> <names> [rootPath]\n");
+      return 1;
+   }
+   const char* archiveFilename = argv[1];
+   const char* namesFilename = argv[2];
+   const char* rootPath = (argc > 3) ? argv[3] : NULL;
+
+   FileManagerStdio fileManager;
+   if(!fileManager.Init())
+      return 1;
+
+   FileDatIndexWriter writer;
+   writer.Init();
+   FileDatIndexSource source;
+   if(!source.Init(&fileManager, archiveFilename, archiveFilename, HEAP_DEFAULT, rootPath))
+   {
+      printf("FileDatIndexAppend -- Unable to read the table of contents of %s\n", archiveFilename);
+      writer.Deinit();
+      fileManager.Deinit();
+      return 1;
+   }
+   if(!source.MappedCheck() || source.IndexedCheck())
+   {
+      printf(source.MappedCheck() ? "FileDatIndexAppend -- %s already has a name index.\n"
+         : "FileDatIndexAppend -- Unable to map %s\n", archiveFilename);
+      source.Deinit();
+      writer.Deinit();
+      fileManager.Deinit();
+      return 1;
+   }
+   int addedCount = NamesAdd(&source, namesFilename, &writer);
+   source.Deinit();
+   if(addedCount < 0)
+   {
+      printf("FileDatIndexAppend -- Unable to read %s\n", namesFilename);
+      writer.Deinit();
+      fileManager.Deinit();
+      return 1;
+   }
+
+   bool success = false;
+   File* archive = fileManager.Open(archiveFilename, FileManager::WRITE | FileManager::APPEND);
+   if(archive)
+   {
+      success = archive->Seek(0, File::BACK) && writer.Write(archive);
+      success = fileManager.Close(archive) && success;
+   }
+   writer.Deinit();
+   fileManager.Deinit();
+
+   if(!success)
+   {
+      printf("FileDatIndexAppend -- Unable to write the index to %s\n", archiveFilename);
+      return 1;
+   }
+   printf("FileDatIndexAppend -- Indexed %d entries of %s\n", addedCount, archiveFilename);
+   return 0;
+}
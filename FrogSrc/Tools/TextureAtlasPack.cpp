@@ -0,0 +1,173 @@
+/// TextureAtlasPack builds a texture atlas offline for the animations of a
+/// sprite resource file, using SpriteResourceFileAtlas.
+///
+///    TextureAtlasPack [-edgeMax <texels>] [-edgeMin <texels>] [-padding <texels>] <spriteResourceFile> <outputPrefix>
+///
+/// Every animation of the resource file is loaded with its bitmap data kept
+/// in memory, and the frames are packed onto pages with edges no longer than
+/// '-edgeMax' and no shorter than '-edgeMin', both of which must be powers of
+/// 2, with '-padding' texels around each frame.  Each page is written to a
+/// PNG file named with 'outputPrefix' followed by the page number, and a
+/// description of where each frame went is written to a JSON file named with
+/// 'outputPrefix' alone, as in TextureAtlasBuilder::Save.  A summary of the
+/// results is printed when it's done.
+///
+/// Run it from the folder that holds the game's files, since the resource
+/// file and its images are found the same way the game finds them.  A small
+/// window is opened while it runs, since the frames have to be loaded as
+/// textures, and the pages can't be larger than the largest texture the
+/// graphics driver supports.
+///
+/// Build it as a console program linked with the Frog library.
+
+#include "Frog.h"
+#include <windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Screen.h"
+#include "SpriteResourceFileAtlas.h"
+
+using namespace Webfoot;
+
+/// Width of the window opened while packing.
+#define TEXTURE_ATLAS_PACK_WINDOW_WIDTH 320
+/// Height of the window opened while packing.
+#define TEXTURE_ATLAS_PACK_WINDOW_HEIGHT 240
+
+//==============================================================================
+
+/// Window procedure for the window opened while packing, which doesn't
+/// handle any messages itself.
+static LRESULT CALLBACK WindowProcedure(HWND hWnd, UINT wMsg, WPARAM wParam, LPARAM lParam)
+{
+   return DefWindowProc(hWnd, wMsg, wParam, lParam);
+}
+
+//------------------------------------------------------------------------------
+
+/// Load every animation of the given resource file with its bitmap data kept
+/// in memory.  Return the resource file, or NULL if it couldn't be loaded.
+static SpriteResourceFile* ResourceFileLoad(const char* resourceFilename)
+{
+   if(!theSprites->ResourceFileExistsCheck(resourceFilename))
+      return NULL;
+   theSprites->ResourceFileSpecificationsLoad(resourceFilename);
+   SpriteResourceFile* resourceFile = theSprites->ResourceFileGet(resourceFilename);
+   if(!resourceFile)
+      return NULL;
+
+   // SpriteResourceFileAtlas can only pack frames whose bitmap data is still
+   // in memory.
+   JSONValue* specifications = resourceFile->SpecificationsGet();
+   if(specifications && specifications->ObjectCheck())
+   {
+      for(JSONValue::ObjectIterator iterator = specifications->ObjectBegin(); iterator.WithinCheck(); iterator.Next())
+      {
+         JSONValue* animationSpecifications = iterator.Value();
+         if(animationSpecifications->ObjectCheck())
+            animationSpecifications->Set("KeepBitmapData", true);
+      }
+   }
+   resourceFile->AllLoad();
+   return resourceFile;
+}
+
+//------------------------------------------------------------------------------
+
+int main(int argc, char** argv)
+{
+   int edgeMax = TEXTURE_ATLAS_EDGE_MAX_DEFAULT;
+   int edgeMin = TEXTURE_ATLAS_EDGE_MIN_DEFAULT;
+   int padding = TEXTURE_ATLAS_PADDING_DEFAULT;
+   int argIndex = 1;
+   for(; (argIndex + 1 < argc) && (argv[argIndex][0] == '-'); argIndex += 2)
+   {
+      if(!strcmp(argv[argIndex], "-edgeMax"))
+         edgeMax = atoi(argv[argIndex + 1]);
+      else if(!strcmp(argv[argIndex], "-edgeMin"))
+         edgeMin = atoi(argv[argIndex + 1]);
+      else if(!strcmp(argv[argIndex], "-padding"))
+         padding = atoi(argv[argIndex + 1]);
+      else
+         break;
+   }
+   if((argc - argIndex != 2) || (edgeMax <= 0) || !PowerOf2Check(edgeMax) || (edgeMin <= 0)
+      || !PowerOf2Check(edgeMin) || (edgeMin > edgeMax) || (padding < 0))
+   {
+      printf("Usage: TextureAtlasPack [-edgeMax <texels>] [-edgeMin <texels>] [-padding <texels>] <spriteResourceFile> <outputPrefix>\n");
+      printf("'edgeMax' and 'edgeMin' must be powers of 2.\n");
+      return 1;
+   }
+   const char* resourceFilename = argv[argIndex];
+   const char* outputPrefix = argv[argIndex + 1];
+
+   theClock->Init();
+   FrogMemoryInit();
+   theEvents->Init();
+   FileManagerStdio fileManager;
+   fileManager.Init();
+   theFiles = &fileManager;
+   DebugInit();
+
+   ScreenParameters screenParameters;
+   screenParameters.fullscreen = false;
+   screenParameters.screenSize.x = TEXTURE_ATLAS_PACK_WINDOW_WIDTH;
+   screenParameters.screenSize.y = TEXTURE_ATLAS_PACK_WINDOW_HEIGHT;
+   screenParameters.windowTitle = "TextureAtlasPack";
+   screenParameters.hInstance = GetModuleHandle(NULL);
+   screenParameters.wndProc = WindowProcedure;
+   screenParameters.nCmdShow = SW_SHOWMINNOACTIVE;
+   bool success = theScreen->Init(&screenParameters);
+   if(success)
+   {
+      theBitmaps->Init();
+      theTextures->Init();
+      theImages->Init();
+      theSprites->Init();
+
+      SpriteResourceFile* resourceFile = ResourceFileLoad(resourceFilename);
+      if(!resourceFile)
+      {
+         printf("TextureAtlasPack -- Unable to load %s\n", resourceFilename);
+         success = false;
+      }
+      else
+      {
+         SpriteResourceFileAtlas atlas;
+         if(!atlas.Init(resourceFile, edgeMax, padding, edgeMin))
+         {
+            printf("TextureAtlasPack -- None of the frames of %s could be packed.\n", resourceFilename);
+            success = false;
+         }
+         else if(!atlas.BuilderGet()->Save(outputPrefix))
+         {
+            printf("TextureAtlasPack -- Unable to save the atlas to %s\n", outputPrefix);
+            success = false;
+         }
+         atlas.ReportPrint();
+         printf("TextureAtlasPack -- Packed %d images of %s onto %d pages, %.1f%% efficient.\n",
+            atlas.ImagePackedCountGet(), resourceFilename, atlas.TextureCountGet(), atlas.EfficiencyGet() * 100.0f);
+         atlas.Deinit();
+         resourceFile->AllUnload();
+         theSprites->ResourceFileSpecificationsUnload(resourceFilename);
+      }
+
+      theSprites->Deinit();
+      theScreen->Deinit();
+      theImages->Deinit();
+      theTextures->Deinit();
+      theBitmaps->Deinit();
+   }
+   else
+   {
+      printf("TextureAtlasPack -- Unable to open a window to load the textures.\n");
+   }
+
+   theEvents->Deinit();
+   DebugDeinit();
+   theFiles = NULL;
+   fileManager.Deinit();
+   FrogMemoryDeinit();
+   return success ? 0 : 1;
+}